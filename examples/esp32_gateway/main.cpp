@@ -5,7 +5,7 @@
 #include "AkitaSmartCityServices.h"
 
 // --- Include Filesystem library (Required for Gateway Buffering) ---
-// This needs to match the 'FileSystem' definition in AkitaSmartCityServices.cpp
+// This needs to match the 'FileSystem' definition in ASCSFileSystem.h
 // and the board_build.filesystem setting in platformio.ini
 #include <SPIFFS.h> // Or LittleFS.h
 #define FileSystem SPIFFS // Or LittleFS
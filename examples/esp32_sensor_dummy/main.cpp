@@ -64,6 +64,9 @@ void setup() {
     //    Check the configured role *before* setting the sensor if optimizing memory,
     //    but it's safe to set it anyway. The plugin won't use it if not in Sensor role.
     ascsPlugin.setSensor(std::move(mySensor)); // Plugin takes ownership
+    //    Several sensors, each with its own interval (readings due together share a packet):
+    //    ascsPlugin.addSensor(std::move(noiseSensor), 30000);
+    //    ascsPlugin.addSensor(std::move(parkingSensor), 120000);
 
     // 2. Register the plugin with Meshtastic
     //    Meshtastic will call plugin.init() and plugin.loop() automatically.
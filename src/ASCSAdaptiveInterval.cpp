@@ -0,0 +1,58 @@
+#include "ASCSAdaptiveInterval.h"
+
+void ASCSAdaptiveInterval::configure(uint32_t baseMs, uint32_t minMs, uint32_t maxMs, uint32_t batteryLowMv) {
+    m_baseMs = baseMs;
+    m_batteryLowMv = batteryLowMv;
+    m_step = 0;
+    m_minStep = 0;
+    m_maxStep = 0;
+    m_stableRounds = 0;
+    m_batteryLow = false;
+    if (baseMs == 0) return;
+    // Whole halvings/doublings of the base that stay within the bounds
+    while (minMs > 0 && m_minStep > -ASCS_ADAPT_MAX_STEPS && (baseMs >> (1 - m_minStep)) >= minMs) m_minStep--;
+    while (m_maxStep < ASCS_ADAPT_MAX_STEPS && ((uint64_t)baseMs << (m_maxStep + 1)) <= maxMs) m_maxStep++;
+}
+
+uint32_t ASCSAdaptiveInterval::getIntervalMs() const {
+    return m_step >= 0 ? m_baseMs << m_step : m_baseMs >> -m_step;
+}
+
+bool ASCSAdaptiveInterval::setStep(int step) {
+    if (step < m_minStep) step = m_minStep;
+    if (step > m_maxStep) step = m_maxStep;
+    if (step == m_step) return false;
+    if (step < m_step) {
+        m_stats.shortened++;
+    } else {
+        m_stats.lengthened++;
+    }
+    m_step = step;
+    return true;
+}
+
+bool ASCSAdaptiveInterval::onRound(float excess) {
+    if (!isEnabled() || m_batteryLow) return false;
+    if (excess > 1.0f) {
+        // Left its band: quickly (shorter), or about as often as the interval should be (kept)
+        m_stableRounds = 0;
+        return excess >= ASCS_ADAPT_FAST_BANDS && setStep(m_step - 1);
+    }
+    if (++m_stableRounds < ASCS_ADAPT_STABLE_ROUNDS) return false;
+    m_stableRounds = 0;
+    return setStep(m_step + 1);
+}
+
+bool ASCSAdaptiveInterval::onBattery(uint32_t batteryMv) {
+    if (m_batteryLowMv == 0 || batteryMv == 0) return false;
+    if (!m_batteryLow && batteryMv < m_batteryLowMv) {
+        m_batteryLow = true;
+        m_stats.batteryLow++;
+        m_stableRounds = 0;
+        return setStep(m_maxStep);
+    }
+    if (m_batteryLow && batteryMv >= m_batteryLowMv + ASCS_ADAPT_BATTERY_HYSTERESIS_MV) {
+        m_batteryLow = false; // Stays long until the readings call for shorter
+    }
+    return false;
+}
@@ -0,0 +1,82 @@
+#ifndef ASCS_ADAPTIVE_INTERVAL_H
+#define ASCS_ADAPTIVE_INTERVAL_H
+
+#include <stdint.h>
+
+// --- Adaptive Read Interval Constants ---
+
+#define ASCS_ADAPT_FAST_BANDS 2.0f          // A reading that moved this many deadbands changes quickly
+#define ASCS_ADAPT_STABLE_ROUNDS 3           // Rounds in a row within their deadbands before the interval doubles
+#define ASCS_ADAPT_MAX_STEPS 8               // Halvings/doublings of read_int at most (1/256 .. 256 x)
+#define ASCS_ADAPT_BATTERY_HYSTERESIS_MV 100 // The battery counts as recovered this far above `bat_low_mv`
+#define ASCS_BATTERY_KEY "battery_v"         // Reading key of the node's battery voltage (V)
+
+/**
+ * @brief Counters of the adaptive read interval (logged with the service table cleanup).
+ */
+struct ASCSAdaptiveStats {
+    uint32_t shortened = 0;  // Halvings after a round with a reading changing quickly
+    uint32_t lengthened = 0; // Doublings after ASCS_ADAPT_STABLE_ROUNDS stable rounds
+    uint32_t batteryLow = 0; // Times the battery fell below `bat_low_mv`
+};
+
+/**
+ * @brief Read interval of a Sensor that follows its readings and battery, within configured bounds.
+ *
+ * The interval is `read_int` halved or doubled a whole number of times, so due times stay on the
+ * grid of the node's transmit slot. Change is measured in deadbands (`deadband`): the interval
+ * halves (down to `read_min`) after a round in which a reading moved ASCS_ADAPT_FAST_BANDS bands or
+ * more since it was last sent, and doubles (up to `read_max`) after ASCS_ADAPT_STABLE_ROUNDS rounds
+ * in a row within their bands; in between it is kept. It settles where readings leave their bands
+ * about once every few reads: quick to follow a storm, slow to relax after it. While the battery
+ * is below `bat_low_mv` the interval is held at `read_max`, whatever the readings do, until it is
+ * ASCS_ADAPT_BATTERY_HYSTERESIS_MV above again.
+ */
+class ASCSAdaptiveInterval {
+public:
+    ASCSAdaptiveInterval() = default;
+
+    /**
+     * @param baseMs The configured interval (`read_int`).
+     * @param minMs Shortest interval (0 or >= baseMs: never shorter than baseMs).
+     * @param maxMs Longest interval (0 or <= baseMs: never longer than baseMs).
+     * @param batteryLowMv Battery level below which the interval is held at the longest (0 = ignore).
+     */
+    void configure(uint32_t baseMs, uint32_t minMs, uint32_t maxMs, uint32_t batteryLowMv);
+
+    /**
+     * @brief Whether the bounds allow any interval other than the configured one.
+     */
+    bool isEnabled() const { return m_minStep < 0 || m_maxStep > 0; }
+
+    /**
+     * @brief Updates the interval after a round of reads.
+     * @param excess Largest move of a reading since last sent, in deadband widths (ASCSDeadband::check()).
+     * @return True if the interval changed.
+     */
+    bool onRound(float excess);
+
+    /**
+     * @brief Updates the battery state from a battery_v reading.
+     * @return True if the interval changed.
+     */
+    bool onBattery(uint32_t batteryMv);
+
+    uint32_t getIntervalMs() const;
+    bool isBatteryLow() const { return m_batteryLow; }
+    const ASCSAdaptiveStats &getStats() const { return m_stats; }
+
+private:
+    bool setStep(int step);
+
+    uint32_t m_baseMs = 0;
+    uint32_t m_batteryLowMv = 0;
+    int m_step = 0;    // Interval = base * 2^step
+    int m_minStep = 0;
+    int m_maxStep = 0;
+    uint8_t m_stableRounds = 0;
+    bool m_batteryLow = false;
+    ASCSAdaptiveStats m_stats;
+};
+
+#endif // ASCS_ADAPTIVE_INTERVAL_H
@@ -28,6 +28,49 @@ void ASCSConfig::load() {
          m_mqttUser = ASCS_DEFAULT_MQTT_USER;
          m_mqttPassword = ASCS_DEFAULT_MQTT_PASSWORD;
          m_mqttBaseTopic = ASCS_DEFAULT_MQTT_BASE_TOPIC;
+         m_mqttTopicTemplate = ASCS_DEFAULT_MQTT_TOPIC_TEMPLATE;
+         m_mqttUseV5 = ASCS_DEFAULT_MQTT_USE_V5;
+         m_mqttMessageExpirySec = ASCS_DEFAULT_MQTT_MESSAGE_EXPIRY_S;
+         m_mqttBatchMaxRecords = ASCS_DEFAULT_MQTT_BATCH_MAX;
+         m_mqttBatchWindowMs = ASCS_DEFAULT_MQTT_BATCH_WINDOW_MS;
+         m_gatewaySinks = ASCS_DEFAULT_GATEWAY_SINKS;
+         m_lpHost = ASCS_DEFAULT_LP_HOST;
+         m_lpPort = ASCS_DEFAULT_LP_PORT;
+         m_lpMeasurement = ASCS_DEFAULT_LP_MEASUREMENT;
+         m_lpBatchMaxRecords = ASCS_DEFAULT_LP_BATCH_MAX;
+         m_lpBatchWindowMs = ASCS_DEFAULT_LP_BATCH_WINDOW_MS;
+         m_filePath = ASCS_DEFAULT_FILE_PATH;
+         m_fileMaxBytes = ASCS_DEFAULT_FILE_MAX_BYTES;
+         m_fileBatchMaxRecords = ASCS_DEFAULT_FILE_BATCH_MAX;
+         m_fileBatchWindowMs = ASCS_DEFAULT_FILE_BATCH_WINDOW_MS;
+         m_gwRatePerMin = ASCS_DEFAULT_GW_RATE_PER_MIN;
+         m_gwRateBurst = ASCS_DEFAULT_GW_RATE_BURST;
+         m_gwExemptKeys = ASCS_DEFAULT_GW_EXEMPT_KEYS;
+         m_gwMetricsIntervalMs = ASCS_DEFAULT_GW_METRICS_INTERVAL_MS;
+         m_gatewaySwitchPct = ASCS_DEFAULT_GATEWAY_SWITCH_PCT;
+         m_discoveryMinIntervalMs = ASCS_DEFAULT_DISCOVERY_MIN_INTERVAL_MS;
+         m_discoveryRedundancy = ASCS_DEFAULT_DISCOVERY_REDUNDANCY;
+         m_gatewaySelection = ASCS_DEFAULT_GATEWAY_SELECTION;
+         m_gwWeight = ASCS_DEFAULT_GW_WEIGHT;
+         m_txSlotMs = ASCS_DEFAULT_TX_SLOT_MS;
+         m_gwReslotPct = ASCS_DEFAULT_GW_RESLOT_PCT;
+         m_pollMode = ASCS_DEFAULT_POLL_MODE;
+         m_gwPollIntervalMs = ASCS_DEFAULT_GW_POLL_INTERVAL_MS;
+         m_gwPollBatch = ASCS_DEFAULT_GW_POLL_BATCH;
+         m_gwPollAirtimePct = ASCS_DEFAULT_GW_POLL_AIRTIME_PCT;
+         m_sensorMergeWindowMs = ASCS_DEFAULT_SENSOR_MERGE_WINDOW_MS;
+         m_sensorDeadbands = ASCS_DEFAULT_SENSOR_DEADBANDS;
+         m_sensorHeartbeatMs = ASCS_DEFAULT_SENSOR_HEARTBEAT_MS;
+         m_sensorStatsOutputs = ASCS_DEFAULT_SENSOR_STATS_OUTPUTS;
+         m_priorityKeys = ASCS_DEFAULT_PRIORITY_KEYS;
+         m_modem = ASCS_DEFAULT_MODEM;
+         m_dutyCyclePct = ASCS_DEFAULT_DUTY_CYCLE_PCT;
+         m_storeMaxPackets = ASCS_DEFAULT_STORE_MAX_PACKETS;
+         m_storeFlushMs = ASCS_DEFAULT_STORE_FLUSH_MS;
+         m_sensorReadMinMs = ASCS_DEFAULT_SENSOR_READ_MIN_MS;
+         m_sensorReadMaxMs = ASCS_DEFAULT_SENSOR_READ_MAX_MS;
+         m_batteryLowMv = ASCS_DEFAULT_BATTERY_LOW_MV;
+         m_eventDebounceMs = ASCS_DEFAULT_EVENT_DEBOUNCE_MS;
          return;
     }
 
@@ -40,6 +83,25 @@ void ASCSConfig::load() {
     // Load new interval, defaulting if not present
     m_mqttReconnectIntervalMs = m_preferences.getUInt("mqtt_rec_int", ASCS_DEFAULT_MQTT_RECONNECT_INTERVAL_MS);
 
+    m_gatewaySwitchPct = m_preferences.getUInt("gw_switch_pct", ASCS_DEFAULT_GATEWAY_SWITCH_PCT);
+    m_discoveryMinIntervalMs = m_preferences.getUInt("disc_min", ASCS_DEFAULT_DISCOVERY_MIN_INTERVAL_MS);
+    m_discoveryRedundancy = m_preferences.getUInt("disc_k", ASCS_DEFAULT_DISCOVERY_REDUNDANCY);
+    m_gatewaySelection = m_preferences.getString("gw_select", ASCS_DEFAULT_GATEWAY_SELECTION).c_str();
+    m_txSlotMs = m_preferences.getUInt("tx_slot", ASCS_DEFAULT_TX_SLOT_MS);
+    m_pollMode = m_preferences.getBool("poll_mode", ASCS_DEFAULT_POLL_MODE);
+    m_sensorMergeWindowMs = m_preferences.getUInt("merge_win", ASCS_DEFAULT_SENSOR_MERGE_WINDOW_MS);
+    m_sensorDeadbands = m_preferences.getString("deadband", ASCS_DEFAULT_SENSOR_DEADBANDS).c_str();
+    m_sensorHeartbeatMs = m_preferences.getUInt("hb_int", ASCS_DEFAULT_SENSOR_HEARTBEAT_MS);
+    m_sensorStatsOutputs = m_preferences.getString("stat_out", ASCS_DEFAULT_SENSOR_STATS_OUTPUTS).c_str();
+    m_priorityKeys = m_preferences.getString("prio_keys", ASCS_DEFAULT_PRIORITY_KEYS).c_str();
+    m_modem = m_preferences.getString("modem", ASCS_DEFAULT_MODEM).c_str();
+    m_dutyCyclePct = m_preferences.getUInt("duty_pct", ASCS_DEFAULT_DUTY_CYCLE_PCT);
+    m_storeMaxPackets = m_preferences.getUInt("sf_max", ASCS_DEFAULT_STORE_MAX_PACKETS);
+    m_storeFlushMs = m_preferences.getUInt("sf_flush_ms", ASCS_DEFAULT_STORE_FLUSH_MS);
+    m_sensorReadMinMs = m_preferences.getUInt("read_min", ASCS_DEFAULT_SENSOR_READ_MIN_MS);
+    m_sensorReadMaxMs = m_preferences.getUInt("read_max", ASCS_DEFAULT_SENSOR_READ_MAX_MS);
+    m_batteryLowMv = m_preferences.getUInt("bat_low_mv", ASCS_DEFAULT_BATTERY_LOW_MV);
+    m_eventDebounceMs = m_preferences.getUInt("evt_debounce_ms", ASCS_DEFAULT_EVENT_DEBOUNCE_MS);
 
     // Load gateway settings only if the role *might* be gateway, avoids unnecessary string ops
     // Note: The plugin logic still needs the #ifdef ASCS_ROLE_GATEWAY for compilation
@@ -51,6 +113,30 @@ void ASCSConfig::load() {
          m_mqttUser = m_preferences.getString("mqtt_user", ASCS_DEFAULT_MQTT_USER).c_str();
          m_mqttPassword = m_preferences.getString("mqtt_pass", ASCS_DEFAULT_MQTT_PASSWORD).c_str();
          m_mqttBaseTopic = m_preferences.getString("mqtt_topic", ASCS_DEFAULT_MQTT_BASE_TOPIC).c_str();
+         m_mqttTopicTemplate = m_preferences.getString("mqtt_tpl", ASCS_DEFAULT_MQTT_TOPIC_TEMPLATE).c_str();
+         m_mqttUseV5 = m_preferences.getBool("mqtt_v5", ASCS_DEFAULT_MQTT_USE_V5);
+         m_mqttMessageExpirySec = m_preferences.getUInt("mqtt_expiry", ASCS_DEFAULT_MQTT_MESSAGE_EXPIRY_S);
+         m_mqttBatchMaxRecords = m_preferences.getUInt("mqtt_batch", ASCS_DEFAULT_MQTT_BATCH_MAX);
+         m_mqttBatchWindowMs = m_preferences.getUInt("mqtt_batch_ms", ASCS_DEFAULT_MQTT_BATCH_WINDOW_MS);
+         m_gatewaySinks = m_preferences.getString("gw_sinks", ASCS_DEFAULT_GATEWAY_SINKS).c_str();
+         m_lpHost = m_preferences.getString("lp_host", ASCS_DEFAULT_LP_HOST).c_str();
+         m_lpPort = m_preferences.getInt("lp_port", ASCS_DEFAULT_LP_PORT);
+         m_lpMeasurement = m_preferences.getString("lp_meas", ASCS_DEFAULT_LP_MEASUREMENT).c_str();
+         m_lpBatchMaxRecords = m_preferences.getUInt("lp_batch", ASCS_DEFAULT_LP_BATCH_MAX);
+         m_lpBatchWindowMs = m_preferences.getUInt("lp_batch_ms", ASCS_DEFAULT_LP_BATCH_WINDOW_MS);
+         m_filePath = m_preferences.getString("file_path", ASCS_DEFAULT_FILE_PATH).c_str();
+         m_fileMaxBytes = m_preferences.getUInt("file_max", ASCS_DEFAULT_FILE_MAX_BYTES);
+         m_fileBatchMaxRecords = m_preferences.getUInt("file_batch", ASCS_DEFAULT_FILE_BATCH_MAX);
+         m_fileBatchWindowMs = m_preferences.getUInt("file_batch_ms", ASCS_DEFAULT_FILE_BATCH_WINDOW_MS);
+         m_gwRatePerMin = m_preferences.getUInt("gw_rate", ASCS_DEFAULT_GW_RATE_PER_MIN);
+         m_gwRateBurst = m_preferences.getUInt("gw_burst", ASCS_DEFAULT_GW_RATE_BURST);
+         m_gwExemptKeys = m_preferences.getString("gw_exempt", ASCS_DEFAULT_GW_EXEMPT_KEYS).c_str();
+         m_gwMetricsIntervalMs = m_preferences.getUInt("gw_metrics_ms", ASCS_DEFAULT_GW_METRICS_INTERVAL_MS);
+         m_gwWeight = m_preferences.getUInt("gw_weight", ASCS_DEFAULT_GW_WEIGHT);
+         m_gwReslotPct = m_preferences.getUInt("gw_reslot_pct", ASCS_DEFAULT_GW_RESLOT_PCT);
+         m_gwPollIntervalMs = m_preferences.getUInt("gw_poll_int", ASCS_DEFAULT_GW_POLL_INTERVAL_MS);
+         m_gwPollBatch = m_preferences.getUInt("gw_poll_batch", ASCS_DEFAULT_GW_POLL_BATCH);
+         m_gwPollAirtimePct = m_preferences.getUInt("gw_poll_air", ASCS_DEFAULT_GW_POLL_AIRTIME_PCT);
     } else {
         // Ensure defaults are loaded if role is not gateway
          m_wifiSsid = ASCS_DEFAULT_WIFI_SSID;
@@ -60,6 +146,30 @@ void ASCSConfig::load() {
          m_mqttUser = ASCS_DEFAULT_MQTT_USER;
          m_mqttPassword = ASCS_DEFAULT_MQTT_PASSWORD;
          m_mqttBaseTopic = ASCS_DEFAULT_MQTT_BASE_TOPIC;
+         m_mqttTopicTemplate = ASCS_DEFAULT_MQTT_TOPIC_TEMPLATE;
+         m_mqttUseV5 = ASCS_DEFAULT_MQTT_USE_V5;
+         m_mqttMessageExpirySec = ASCS_DEFAULT_MQTT_MESSAGE_EXPIRY_S;
+         m_mqttBatchMaxRecords = ASCS_DEFAULT_MQTT_BATCH_MAX;
+         m_mqttBatchWindowMs = ASCS_DEFAULT_MQTT_BATCH_WINDOW_MS;
+         m_gatewaySinks = ASCS_DEFAULT_GATEWAY_SINKS;
+         m_lpHost = ASCS_DEFAULT_LP_HOST;
+         m_lpPort = ASCS_DEFAULT_LP_PORT;
+         m_lpMeasurement = ASCS_DEFAULT_LP_MEASUREMENT;
+         m_lpBatchMaxRecords = ASCS_DEFAULT_LP_BATCH_MAX;
+         m_lpBatchWindowMs = ASCS_DEFAULT_LP_BATCH_WINDOW_MS;
+         m_filePath = ASCS_DEFAULT_FILE_PATH;
+         m_fileMaxBytes = ASCS_DEFAULT_FILE_MAX_BYTES;
+         m_fileBatchMaxRecords = ASCS_DEFAULT_FILE_BATCH_MAX;
+         m_fileBatchWindowMs = ASCS_DEFAULT_FILE_BATCH_WINDOW_MS;
+         m_gwRatePerMin = ASCS_DEFAULT_GW_RATE_PER_MIN;
+         m_gwRateBurst = ASCS_DEFAULT_GW_RATE_BURST;
+         m_gwExemptKeys = ASCS_DEFAULT_GW_EXEMPT_KEYS;
+         m_gwMetricsIntervalMs = ASCS_DEFAULT_GW_METRICS_INTERVAL_MS;
+         m_gwWeight = ASCS_DEFAULT_GW_WEIGHT;
+         m_gwReslotPct = ASCS_DEFAULT_GW_RESLOT_PCT;
+         m_gwPollIntervalMs = ASCS_DEFAULT_GW_POLL_INTERVAL_MS;
+         m_gwPollBatch = ASCS_DEFAULT_GW_POLL_BATCH;
+         m_gwPollAirtimePct = ASCS_DEFAULT_GW_POLL_AIRTIME_PCT;
     }
 
      Log.println(LOG_LEVEL_DEBUG, "ASCSConfig: Configuration loaded.");
@@ -90,15 +200,58 @@ uint32_t ASCSConfig::getServiceId() const { return m_serviceId; }
 uint32_t ASCSConfig::getTargetNodeId() const { return m_targetNodeId; }
 uint32_t ASCSConfig::getSensorReadIntervalMs() const { return m_sensorReadIntervalMs; }
 uint32_t ASCSConfig::getDiscoveryIntervalMs() const { return m_discoveryIntervalMs; }
+uint32_t ASCSConfig::getDiscoveryMinIntervalMs() const { return m_discoveryMinIntervalMs; }
+uint32_t ASCSConfig::getDiscoveryRedundancy() const { return m_discoveryRedundancy; }
 uint32_t ASCSConfig::getServiceTimeoutMs() const { return m_serviceTimeoutMs; }
 uint32_t ASCSConfig::getMqttReconnectIntervalMs() const { return m_mqttReconnectIntervalMs; }
+uint32_t ASCSConfig::getGatewaySwitchPct() const { return m_gatewaySwitchPct; }
+const std::string& ASCSConfig::getGatewaySelection() const { return m_gatewaySelection; }
+uint32_t ASCSConfig::getTxSlotMs() const { return m_txSlotMs; }
+bool ASCSConfig::getPollMode() const { return m_pollMode; }
+uint32_t ASCSConfig::getSensorMergeWindowMs() const { return m_sensorMergeWindowMs; }
+const std::string& ASCSConfig::getSensorDeadbands() const { return m_sensorDeadbands; }
+uint32_t ASCSConfig::getSensorHeartbeatMs() const { return m_sensorHeartbeatMs; }
+const std::string& ASCSConfig::getSensorStatsOutputs() const { return m_sensorStatsOutputs; }
+const std::string& ASCSConfig::getPriorityKeys() const { return m_priorityKeys; }
+const std::string& ASCSConfig::getModem() const { return m_modem; }
+uint32_t ASCSConfig::getDutyCyclePct() const { return m_dutyCyclePct; }
+uint32_t ASCSConfig::getStoreMaxPackets() const { return m_storeMaxPackets; }
+uint32_t ASCSConfig::getStoreFlushMs() const { return m_storeFlushMs; }
+uint32_t ASCSConfig::getSensorReadMinMs() const { return m_sensorReadMinMs; }
+uint32_t ASCSConfig::getSensorReadMaxMs() const { return m_sensorReadMaxMs; }
+uint32_t ASCSConfig::getBatteryLowMv() const { return m_batteryLowMv; }
+uint32_t ASCSConfig::getEventDebounceMs() const { return m_eventDebounceMs; }
 
 
-std::string ASCSConfig::getWifiSsid() const { return m_wifiSsid; }
-std::string ASCSConfig::getWifiPassword() const { return m_wifiPassword; }
-std::string ASCSConfig::getMqttServer() const { return m_mqttServer; }
+const std::string& ASCSConfig::getWifiSsid() const { return m_wifiSsid; }
+const std::string& ASCSConfig::getWifiPassword() const { return m_wifiPassword; }
+const std::string& ASCSConfig::getMqttServer() const { return m_mqttServer; }
 int ASCSConfig::getMqttPort() const { return m_mqttPort; }
-std::string ASCSConfig::getMqttUser() const { return m_mqttUser; }
-std::string ASCSConfig::getMqttPassword() const { return m_mqttPassword; }
-std::string ASCSConfig::getMqttBaseTopic() const { return m_mqttBaseTopic; }
+const std::string& ASCSConfig::getMqttUser() const { return m_mqttUser; }
+const std::string& ASCSConfig::getMqttPassword() const { return m_mqttPassword; }
+const std::string& ASCSConfig::getMqttBaseTopic() const { return m_mqttBaseTopic; }
+const std::string& ASCSConfig::getMqttTopicTemplate() const { return m_mqttTopicTemplate; }
+bool ASCSConfig::getMqttUseV5() const { return m_mqttUseV5; }
+uint32_t ASCSConfig::getMqttMessageExpirySec() const { return m_mqttMessageExpirySec; }
+uint32_t ASCSConfig::getMqttBatchMaxRecords() const { return m_mqttBatchMaxRecords; }
+uint32_t ASCSConfig::getMqttBatchWindowMs() const { return m_mqttBatchWindowMs; }
+const std::string& ASCSConfig::getGatewaySinks() const { return m_gatewaySinks; }
+const std::string& ASCSConfig::getLpHost() const { return m_lpHost; }
+int ASCSConfig::getLpPort() const { return m_lpPort; }
+const std::string& ASCSConfig::getLpMeasurement() const { return m_lpMeasurement; }
+uint32_t ASCSConfig::getLpBatchMaxRecords() const { return m_lpBatchMaxRecords; }
+uint32_t ASCSConfig::getLpBatchWindowMs() const { return m_lpBatchWindowMs; }
+const std::string& ASCSConfig::getFilePath() const { return m_filePath; }
+uint32_t ASCSConfig::getFileMaxBytes() const { return m_fileMaxBytes; }
+uint32_t ASCSConfig::getFileBatchMaxRecords() const { return m_fileBatchMaxRecords; }
+uint32_t ASCSConfig::getFileBatchWindowMs() const { return m_fileBatchWindowMs; }
+uint32_t ASCSConfig::getGatewayRatePerMin() const { return m_gwRatePerMin; }
+uint32_t ASCSConfig::getGatewayRateBurst() const { return m_gwRateBurst; }
+const std::string& ASCSConfig::getGatewayExemptKeys() const { return m_gwExemptKeys; }
+uint32_t ASCSConfig::getGatewayMetricsIntervalMs() const { return m_gwMetricsIntervalMs; }
+uint32_t ASCSConfig::getGatewayWeight() const { return m_gwWeight; }
+uint32_t ASCSConfig::getGatewayReslotPct() const { return m_gwReslotPct; }
+uint32_t ASCSConfig::getGatewayPollIntervalMs() const { return m_gwPollIntervalMs; }
+uint32_t ASCSConfig::getGatewayPollBatch() const { return m_gwPollBatch; }
+uint32_t ASCSConfig::getGatewayPollAirtimePct() const { return m_gwPollAirtimePct; }
 
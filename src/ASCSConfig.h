@@ -4,6 +4,7 @@
 #include <Preferences.h>
 #include <string>
 #include "generated_proto/SmartCity.pb.h" // For ServiceDiscovery_Role enum
+#include "ASCSConfigList.h" // For parsing the list-valued preferences
 
 // --- Default Configuration Constants ---
 // Defined here for clarity, but could be in a separate config_defaults.h
@@ -12,9 +13,28 @@
 #define ASCS_DEFAULT_SERVICE_ID 1
 #define ASCS_DEFAULT_TARGET_NODE 0 // 0 means auto-discover/broadcast
 #define ASCS_DEFAULT_SENSOR_READ_INTERVAL_MS 60000
-#define ASCS_DEFAULT_DISCOVERY_INTERVAL_MS 300000
+#define ASCS_DEFAULT_DISCOVERY_INTERVAL_MS 300000 // Slowest discovery interval, reached while the mesh is stable
+#define ASCS_DEFAULT_DISCOVERY_MIN_INTERVAL_MS 30000 // Fastest discovery interval (after boot or a topology change)
+#define ASCS_DEFAULT_DISCOVERY_REDUNDANCY 3 // Skip an announcement after hearing this many matching ones in the interval (0 = never skip)
 #define ASCS_DEFAULT_SERVICE_TIMEOUT_MS 900000 // 3x discovery interval
 #define ASCS_DEFAULT_MQTT_RECONNECT_INTERVAL_MS 10000
+#define ASCS_DEFAULT_GATEWAY_SWITCH_PCT 20 // Min % lower link cost before switching to another gateway
+#define ASCS_DEFAULT_GATEWAY_SELECTION "cost" // Gateway choice: "cost" (cheapest link) or "hash" (spread over gateways by node ID)
+#define ASCS_DEFAULT_TX_SLOT_MS 2000 // Sensor transmit slot width; each sensor reads in its own slot of read_int (0 = free-running timer)
+#define ASCS_DEFAULT_POLL_MODE false // Sensors: true = send when polled by the gateway, not periodically
+#define ASCS_DEFAULT_SENSOR_MERGE_WINDOW_MS 5000 // Sensors due within this time of each other are read together and sent in one packet
+#define ASCS_DEFAULT_SENSOR_DEADBANDS "" // Per-key report deadbands, "key:abs" or "key:pct%", "*" for other keys ("" = send every reading)
+#define ASCS_DEFAULT_SENSOR_HEARTBEAT_MS 900000 // Readings within their deadbands are still sent after this long (0 = never)
+#define ASCS_DEFAULT_SENSOR_STATS_OUTPUTS "mean,max" // Keys sent per reading key of windowed sensors: any of mean,min,max,std,n
+#define ASCS_DEFAULT_PRIORITY_KEYS "alarm:critical" // Reading key prefixes raising a packet's priority, "prefix:critical|high" (active = non-zero value)
+#define ASCS_DEFAULT_MODEM "LongFast" // Modem preset of the channel or "SF/BW kHz/CR", for time on air
+#define ASCS_DEFAULT_DUTY_CYCLE_PCT 10 // Max own airtime per hour, percent (0 = no limit)
+#define ASCS_DEFAULT_STORE_MAX_PACKETS 32 // Packets held while no gateway is known (0 = broadcast them as before)
+#define ASCS_DEFAULT_STORE_FLUSH_MS 300000 // Time between batches of held packets once a gateway is known again
+#define ASCS_DEFAULT_SENSOR_READ_MIN_MS 0 // Shortest adaptive read interval while readings change (0 = read_int)
+#define ASCS_DEFAULT_SENSOR_READ_MAX_MS 0 // Longest adaptive read interval while readings are stable (0 = read_int)
+#define ASCS_DEFAULT_BATTERY_LOW_MV 0 // battery_v below this reads at read_max (0 = ignore the battery)
+#define ASCS_DEFAULT_EVENT_DEBOUNCE_MS 1000 // Sensor events within this time of the last sent go out together (latest values)
 
 #define ASCS_DEFAULT_WIFI_SSID "YourWiFi_SSID"
 #define ASCS_DEFAULT_WIFI_PASSWORD "YourWiFiPassword"
@@ -23,6 +43,33 @@
 #define ASCS_DEFAULT_MQTT_USER ""
 #define ASCS_DEFAULT_MQTT_PASSWORD ""
 #define ASCS_DEFAULT_MQTT_BASE_TOPIC "akita/smartcity"
+// Placeholders: {base}, {service}, {node}, {sensor}, {key} ({key} must be last, one topic per reading)
+#define ASCS_DEFAULT_MQTT_TOPIC_TEMPLATE "{base}/sensor/{service}/{node}/{sensor}"
+#define ASCS_DEFAULT_MQTT_USE_V5 false     // false: PubSubClient (MQTT 3.1.1), true: built-in MQTT 5 client
+#define ASCS_DEFAULT_MQTT_MESSAGE_EXPIRY_S 0 // MQTT 5 Message Expiry Interval for readings (0 = never expire)
+#define ASCS_DEFAULT_MQTT_BATCH_MAX 0        // Max records per batch message (0 or 1 = one message per packet)
+#define ASCS_DEFAULT_MQTT_BATCH_WINDOW_MS 5000 // Max time a record waits in an open batch
+// Gateway sinks: comma-separated list of "mqtt", "lp" (line protocol over TCP), "file"
+#define ASCS_DEFAULT_GATEWAY_SINKS "mqtt"
+#define ASCS_DEFAULT_LP_HOST ""             // Line protocol listener (e.g., Telegraf socket_listener)
+#define ASCS_DEFAULT_LP_PORT 8094
+#define ASCS_DEFAULT_LP_MEASUREMENT "ascs"  // Measurement name for line protocol output (lp and file sinks)
+#define ASCS_DEFAULT_LP_BATCH_MAX 32
+#define ASCS_DEFAULT_LP_BATCH_WINDOW_MS 1000
+#define ASCS_DEFAULT_FILE_PATH "/ascs_data.lp"
+#define ASCS_DEFAULT_FILE_MAX_BYTES 65536   // Rotate the local file at this size
+#define ASCS_DEFAULT_FILE_BATCH_MAX 16
+#define ASCS_DEFAULT_FILE_BATCH_WINDOW_MS 10000
+// Gateway overload protection: per-origin-node token buckets, latest value per sensor kept while over budget
+#define ASCS_DEFAULT_GW_RATE_PER_MIN 30 // Records per minute allowed per origin node (0 = no rate limiting)
+#define ASCS_DEFAULT_GW_RATE_BURST 10 // Token bucket depth per origin node (records)
+#define ASCS_DEFAULT_GW_EXEMPT_KEYS "alarm" // Comma-separated reading key prefixes that bypass rate limiting
+#define ASCS_DEFAULT_GW_METRICS_INTERVAL_MS 60000 // Interval for gateway metrics records (0 = disabled)
+#define ASCS_DEFAULT_GW_WEIGHT 100 // Relative share of sensors this gateway takes in "hash" selection (advertised in ServiceDiscovery)
+#define ASCS_DEFAULT_GW_RESLOT_PCT 25 // Loss (%) of a sensor's readings at which the gateway asks it to change slot (0 = never)
+#define ASCS_DEFAULT_GW_POLL_INTERVAL_MS 300000 // Interval at which the gateway polls each sensor in poll mode (0 = no polling)
+#define ASCS_DEFAULT_GW_POLL_BATCH 4 // Max sensors named in one poll request
+#define ASCS_DEFAULT_GW_POLL_AIRTIME_PCT 25 // Share (%) of channel time polls and their answers may use
 
 #define ASCS_PREFERENCES_NAMESPACE "ascs"
 
@@ -42,17 +89,60 @@ public:
     uint32_t getTargetNodeId() const;
     uint32_t getSensorReadIntervalMs() const;
     uint32_t getDiscoveryIntervalMs() const;
+    uint32_t getDiscoveryMinIntervalMs() const;
+    uint32_t getDiscoveryRedundancy() const;
     uint32_t getServiceTimeoutMs() const;
     uint32_t getMqttReconnectIntervalMs() const; // Added getter
+    uint32_t getGatewaySwitchPct() const;
+    const std::string& getGatewaySelection() const;
+    uint32_t getTxSlotMs() const;
+    bool getPollMode() const;
+    uint32_t getSensorMergeWindowMs() const;
+    const std::string& getSensorDeadbands() const;
+    uint32_t getSensorHeartbeatMs() const;
+    const std::string& getSensorStatsOutputs() const;
+    const std::string& getPriorityKeys() const;
+    const std::string& getModem() const;
+    uint32_t getDutyCyclePct() const;
+    uint32_t getStoreMaxPackets() const;
+    uint32_t getStoreFlushMs() const;
+    uint32_t getSensorReadMinMs() const;
+    uint32_t getSensorReadMaxMs() const;
+    uint32_t getBatteryLowMv() const;
+    uint32_t getEventDebounceMs() const;
 
-    // Gateway specific getters
-    std::string getWifiSsid() const;
-    std::string getWifiPassword() const;
-    std::string getMqttServer() const;
+    // Gateway specific getters (strings returned by reference to avoid copies on the publish path)
+    const std::string& getWifiSsid() const;
+    const std::string& getWifiPassword() const;
+    const std::string& getMqttServer() const;
     int getMqttPort() const;
-    std::string getMqttUser() const;
-    std::string getMqttPassword() const;
-    std::string getMqttBaseTopic() const;
+    const std::string& getMqttUser() const;
+    const std::string& getMqttPassword() const;
+    const std::string& getMqttBaseTopic() const;
+    const std::string& getMqttTopicTemplate() const;
+    bool getMqttUseV5() const;
+    uint32_t getMqttMessageExpirySec() const;
+    uint32_t getMqttBatchMaxRecords() const;
+    uint32_t getMqttBatchWindowMs() const;
+    const std::string& getGatewaySinks() const;
+    const std::string& getLpHost() const;
+    int getLpPort() const;
+    const std::string& getLpMeasurement() const;
+    uint32_t getLpBatchMaxRecords() const;
+    uint32_t getLpBatchWindowMs() const;
+    const std::string& getFilePath() const;
+    uint32_t getFileMaxBytes() const;
+    uint32_t getFileBatchMaxRecords() const;
+    uint32_t getFileBatchWindowMs() const;
+    uint32_t getGatewayRatePerMin() const;
+    uint32_t getGatewayRateBurst() const;
+    const std::string& getGatewayExemptKeys() const;
+    uint32_t getGatewayMetricsIntervalMs() const;
+    uint32_t getGatewayWeight() const;
+    uint32_t getGatewayReslotPct() const;
+    uint32_t getGatewayPollIntervalMs() const;
+    uint32_t getGatewayPollBatch() const;
+    uint32_t getGatewayPollAirtimePct() const;
 
 private:
     Preferences m_preferences;
@@ -63,8 +153,27 @@ private:
     uint32_t m_targetNodeId;
     uint32_t m_sensorReadIntervalMs;
     uint32_t m_discoveryIntervalMs;
+    uint32_t m_discoveryMinIntervalMs;
+    uint32_t m_discoveryRedundancy;
     uint32_t m_serviceTimeoutMs;
     uint32_t m_mqttReconnectIntervalMs;
+    uint32_t m_gatewaySwitchPct;
+    std::string m_gatewaySelection;
+    uint32_t m_txSlotMs;
+    bool m_pollMode;
+    uint32_t m_sensorMergeWindowMs;
+    std::string m_sensorDeadbands;
+    uint32_t m_sensorHeartbeatMs;
+    std::string m_sensorStatsOutputs;
+    std::string m_priorityKeys;
+    std::string m_modem;
+    uint32_t m_dutyCyclePct;
+    uint32_t m_storeMaxPackets;
+    uint32_t m_storeFlushMs;
+    uint32_t m_sensorReadMinMs;
+    uint32_t m_sensorReadMaxMs;
+    uint32_t m_batteryLowMv;
+    uint32_t m_eventDebounceMs;
 
     // Gateway specific
     std::string m_wifiSsid;
@@ -74,6 +183,30 @@ private:
     std::string m_mqttUser;
     std::string m_mqttPassword;
     std::string m_mqttBaseTopic;
+    std::string m_mqttTopicTemplate;
+    bool m_mqttUseV5;
+    uint32_t m_mqttMessageExpirySec;
+    uint32_t m_mqttBatchMaxRecords;
+    uint32_t m_mqttBatchWindowMs;
+    std::string m_gatewaySinks;
+    std::string m_lpHost;
+    int m_lpPort;
+    std::string m_lpMeasurement;
+    uint32_t m_lpBatchMaxRecords;
+    uint32_t m_lpBatchWindowMs;
+    std::string m_filePath;
+    uint32_t m_fileMaxBytes;
+    uint32_t m_fileBatchMaxRecords;
+    uint32_t m_fileBatchWindowMs;
+    uint32_t m_gwRatePerMin;
+    uint32_t m_gwRateBurst;
+    std::string m_gwExemptKeys;
+    uint32_t m_gwMetricsIntervalMs;
+    uint32_t m_gwWeight;
+    uint32_t m_gwReslotPct;
+    uint32_t m_gwPollIntervalMs;
+    uint32_t m_gwPollBatch;
+    uint32_t m_gwPollAirtimePct;
 };
 
 #endif // ASCS_CONFIG_H
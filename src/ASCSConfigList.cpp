@@ -0,0 +1,28 @@
+#include "ASCSConfigList.h"
+
+std::vector<std::string> ASCSConfigList::split(const std::string &list) {
+    std::vector<std::string> items;
+    size_t pos = 0;
+    while (pos <= list.length()) {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos) comma = list.length();
+        std::string item = trim(list.substr(pos, comma - pos));
+        pos = comma + 1;
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+bool ASCSConfigList::splitPair(const std::string &item, std::string &name, std::string &value) {
+    size_t colon = item.find(':');
+    if (colon == std::string::npos) return false;
+    name = trim(item.substr(0, colon));
+    value = trim(item.substr(colon + 1));
+    return !name.empty();
+}
+
+std::string ASCSConfigList::trim(const std::string &text) {
+    size_t first = text.find_first_not_of(' ');
+    if (first == std::string::npos) return std::string();
+    return text.substr(first, text.find_last_not_of(' ') - first + 1);
+}
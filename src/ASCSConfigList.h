@@ -0,0 +1,33 @@
+#ifndef ASCS_CONFIG_LIST_H
+#define ASCS_CONFIG_LIST_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Parsing of list-valued preferences (`deadband`, `prio_keys`, `stat_out`, `rl_exempt`,
+ * `gw_sinks`): comma-separated items, optionally "name:value" pairs, surrounding spaces ignored.
+ *
+ * Kept apart from ASCSConfig (which includes it) so helpers built on a host (tools/mesh_sim.cpp)
+ * can parse their lists without the Arduino Preferences dependency.
+ */
+class ASCSConfigList {
+public:
+    /**
+     * @brief Splits a comma-separated list into its items, trimmed; empty items are skipped.
+     */
+    static std::vector<std::string> split(const std::string &list);
+
+    /**
+     * @brief Splits an item "name:value" at the first ':', both parts trimmed.
+     * @return False if the item has no ':' or an empty name.
+     */
+    static bool splitPair(const std::string &item, std::string &name, std::string &value);
+
+    /**
+     * @brief 'text' without leading and trailing spaces.
+     */
+    static std::string trim(const std::string &text);
+};
+
+#endif // ASCS_CONFIG_LIST_H
@@ -0,0 +1,137 @@
+#include "ASCSDeadband.h"
+#include "ASCSConfigList.h"
+#include <math.h>
+#include <stdlib.h>
+
+uint32_t ASCSDeadband::hash(const std::string &text) {
+    uint32_t h = 2166136261u; // FNV-1a
+    for (char c : text) {
+        h ^= (uint8_t)c;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+void ASCSDeadband::configure(const std::string &bands, uint32_t heartbeatMs) {
+    m_heartbeatMs = heartbeatMs;
+    m_bands.clear();
+    m_defaultBand = {0, 0.0f, false};
+    m_sensors.clear();
+    m_enabled = false;
+
+    // The comma-separated "key:band[%]" list
+    for (const std::string &entry : ASCSConfigList::split(bands)) {
+        std::string key, width;
+        if (!ASCSConfigList::splitPair(entry, key, width)) continue;
+        Band band = {hash(key), (float)atof(width.c_str()), width.find('%') != std::string::npos};
+        if (band.width < 0.0f) band.width = 0.0f;
+        if (band.relative) band.width /= 100.0f;
+        if (key == "*") {
+            m_defaultBand = band;
+        } else {
+            m_bands.push_back(band);
+        }
+        m_enabled = true;
+    }
+}
+
+const ASCSDeadband::Band &ASCSDeadband::findBand(uint32_t keyHash) const {
+    for (const Band &candidate : m_bands) {
+        if (candidate.keyHash == keyHash) return candidate;
+    }
+    return m_defaultBand;
+}
+
+bool ASCSDeadband::outsideBand(uint32_t keyHash, float last, float value) const {
+    const Band *band = &findBand(keyHash);
+    float width = band->relative ? band->width * fabsf(last) : band->width;
+    if (width <= 0.0f) return value != last;
+    return fabsf(value - last) > width;
+}
+
+bool ASCSDeadband::check(const std::string &sensorId, const std::map<std::string, float> &readings, unsigned long now, bool force /*= false*/,
+                         float *excess /*= nullptr*/) {
+    if (excess) *excess = 0.0f;
+    if (!m_enabled) {
+        m_stats.sent++;
+        return true;
+    }
+
+    uint32_t sensorHash = hash(sensorId);
+    SensorState *state = nullptr;
+    for (SensorState &candidate : m_sensors) {
+        if (candidate.sensorHash == sensorHash) {
+            state = &candidate;
+            break;
+        }
+    }
+
+    if (excess && state && state->values.size() == readings.size()) {
+        // How far the readings moved, for the adaptive read interval (keys without a band do not count)
+        size_t i = 0;
+        for (const auto &reading : readings) {
+            const SentValue &last = state->values[i++];
+            const Band &band = findBand(last.keyHash);
+            float width = band.relative ? band.width * fabsf(last.value) : band.width;
+            if (width <= 0.0f || last.keyHash != hash(reading.first)) continue;
+            float moved = fabsf(reading.second - last.value) / width;
+            if (moved > *excess) *excess = moved;
+        }
+    }
+
+    bool send = force || !state || state->values.size() != readings.size();
+    bool heartbeat = false;
+    if (!send) {
+        size_t i = 0;
+        for (const auto &reading : readings) {
+            const SentValue &last = state->values[i++];
+            uint32_t keyHash = hash(reading.first);
+            if (last.keyHash != keyHash || outsideBand(keyHash, last.value, reading.second)) {
+                send = true;
+                break;
+            }
+        }
+    }
+    if (!send && m_heartbeatMs > 0 && now - state->lastSent >= m_heartbeatMs) {
+        send = true;
+        heartbeat = true;
+    }
+    if (!send) {
+        m_stats.suppressed++;
+        return false;
+    }
+
+    // Remember what is sent: the bands are measured from it
+    if (!state) {
+        if (m_sensors.size() >= ASCS_DEADBAND_MAX_SENSORS) m_sensors.erase(m_sensors.begin());
+        m_sensors.push_back({sensorHash, now, {}});
+        state = &m_sensors.back();
+    }
+    state->lastSent = now;
+    state->values.clear();
+    for (const auto &reading : readings) {
+        state->values.push_back({hash(reading.first), reading.second});
+    }
+    if (heartbeat) {
+        m_stats.heartbeats++;
+    } else {
+        m_stats.sent++;
+    }
+    return true;
+}
+
+void ASCSDeadband::note(const std::string &sensorId, const std::map<std::string, float> &readings, unsigned long now) {
+    if (!m_enabled) return;
+    uint32_t sensorHash = hash(sensorId);
+    for (SensorState &state : m_sensors) {
+        if (state.sensorHash != sensorHash) continue;
+        for (const auto &reading : readings) {
+            uint32_t keyHash = hash(reading.first);
+            for (SentValue &last : state.values) {
+                if (last.keyHash == keyHash) last.value = reading.second;
+            }
+        }
+        state.lastSent = now;
+        return;
+    }
+}
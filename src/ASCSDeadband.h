@@ -0,0 +1,92 @@
+#ifndef ASCS_DEADBAND_H
+#define ASCS_DEADBAND_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// --- Deadband Constants ---
+
+#define ASCS_DEADBAND_MAX_SENSORS 8 // Sensors whose last sent values are kept (as ASCS_SENSOR_MAX_SENSORS)
+
+/**
+ * @brief Counters of the report deadbands (logged with the service table cleanup).
+ */
+struct ASCSDeadbandStats {
+    uint32_t sent = 0;       // Readings sent (a key left its band, keys changed, first reading, or forced)
+    uint32_t heartbeats = 0; // Readings sent only because the heartbeat interval had passed
+    uint32_t suppressed = 0; // Readings not sent: every key within its band
+};
+
+/**
+ * @brief Suppresses sensor readings that have not changed enough to be worth sending.
+ *
+ * Each reading key has a band, absolute ("temperature_c:0.2") or relative to the last sent
+ * value ("pressure_pa:0.1%"); "*" sets the band of keys not listed, otherwise they are sent on
+ * any change. A sensor's readings are sent when any key moved outside its band since the
+ * readings last sent, when the keys changed, or when the heartbeat interval has passed (so the
+ * gateway still hears from the sensor); they are sent or suppressed as a whole.
+ *
+ * Last sent values are kept per sensor as (key hash, value) pairs, 8 bytes per key.
+ */
+class ASCSDeadband {
+public:
+    ASCSDeadband() = default;
+
+    /**
+     * @param bands Comma-separated "key:band" or "key:band%" entries ("" disables: every reading is sent).
+     * @param heartbeatMs Readings are sent at least this often (0 = only on change).
+     */
+    void configure(const std::string &bands, uint32_t heartbeatMs);
+
+    bool isEnabled() const { return m_enabled; }
+
+    /**
+     * @brief Decides whether a sensor's readings are sent, and if so records them as last sent.
+     * @param force Send regardless of the bands (e.g., answering a poll).
+     * @param excess If given, set to the largest move of a key with a band since the readings last
+     *               sent, in band widths (above 1: it left its band; 0 for a sensor's first reading).
+     * @return True to send.
+     */
+    bool check(const std::string &sensorId, const std::map<std::string, float> &readings, unsigned long now, bool force = false,
+               float *excess = nullptr);
+
+    /**
+     * @brief Records readings sent without check() (sensor events) as last sent: keys the sensor
+     * already has a value for are updated, and the heartbeat restarts. Other keys are ignored.
+     */
+    void note(const std::string &sensorId, const std::map<std::string, float> &readings, unsigned long now);
+
+    const ASCSDeadbandStats &getStats() const { return m_stats; }
+
+private:
+    struct Band {
+        uint32_t keyHash;
+        float width;
+        bool relative; // 'width' is a fraction of the last sent value
+    };
+    struct SentValue {
+        uint32_t keyHash;
+        float value;
+    };
+    struct SensorState {
+        uint32_t sensorHash;
+        unsigned long lastSent;
+        std::vector<SentValue> values; // In key order of the readings map
+    };
+
+    static uint32_t hash(const std::string &text);
+    const Band &findBand(uint32_t keyHash) const;
+    bool outsideBand(uint32_t keyHash, float last, float value) const;
+
+    bool m_enabled = false;
+    uint32_t m_heartbeatMs = 0;
+    std::vector<Band> m_bands;
+    Band m_defaultBand = {0, 0.0f, false}; // Keys not listed: any change
+    std::vector<SensorState> m_sensors;
+    ASCSDeadbandStats m_stats;
+};
+
+#endif // ASCS_DEADBAND_H
@@ -0,0 +1,49 @@
+#include "ASCSDiscoveryReplies.h"
+#include "ASCSLinkMetrics.h"
+
+uint32_t ASCSDiscoveryReplies::replyDelayMs(float linkCost, uint32_t randomValue) {
+    const uint32_t half = ASCS_DISCOVERY_REPLY_WINDOW_MS / 2;
+
+    // First half of the window by link quality (best link first), second half random
+    float quality = (linkCost - 1.0f) / (ASCS_LINK_MAX_ETX - 1.0f);
+    if (quality < 0.0f) quality = 0.0f;
+    if (quality > 1.0f) quality = 1.0f;
+    return (uint32_t)(quality * half) + randomValue % half;
+}
+
+bool ASCSDiscoveryReplies::schedule(uint32_t querier, unsigned long now, uint32_t delayMs) {
+    for (size_t i = 0; i < m_count; i++) {
+        if (m_pending[i].querier == querier) return false; // Repeated query, already answering
+    }
+    if (m_count >= ASCS_DISCOVERY_MAX_PENDING_REPLIES) return false;
+    m_pending[m_count++] = {querier, now + delayMs, 0};
+    m_stats.scheduled++;
+    return true;
+}
+
+void ASCSDiscoveryReplies::overheard(uint32_t querier) {
+    for (size_t i = 0; i < m_count; i++) {
+        if (m_pending[i].querier != querier) continue;
+        if (++m_pending[i].overheard >= ASCS_DISCOVERY_REPLY_REDUNDANCY) {
+            removeAt(i);
+            m_stats.suppressed++;
+        }
+        return;
+    }
+}
+
+bool ASCSDiscoveryReplies::popDue(unsigned long now, uint32_t &querier) {
+    for (size_t i = 0; i < m_count; i++) {
+        if ((long)(now - m_pending[i].dueAt) >= 0) {
+            querier = m_pending[i].querier;
+            removeAt(i);
+            m_stats.sent++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ASCSDiscoveryReplies::removeAt(size_t index) {
+    m_pending[index] = m_pending[--m_count]; // Order does not matter
+}
@@ -0,0 +1,81 @@
+#ifndef ASCS_DISCOVERY_REPLIES_H
+#define ASCS_DISCOVERY_REPLIES_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// --- Discovery Query/Reply Constants ---
+
+#define ASCS_DISCOVERY_REPLY_WINDOW_MS 4000  // Replies are spread over this window (best path first)
+#define ASCS_DISCOVERY_REPLY_REDUNDANCY 2    // A pending reply is cancelled after overhearing this many other replies
+#define ASCS_DISCOVERY_MAX_PENDING_REPLIES 4 // Queries answered at once; further queries are ignored until one is done
+#define ASCS_DISCOVERY_QUERY_JITTER_MS 10000 // Max random delay of the first query (spreads a mesh-wide power-up)
+#define ASCS_DISCOVERY_QUERY_RETRY_MS 30000  // First retry while no gateway answers; doubles with each retry
+#define ASCS_DISCOVERY_QUERY_MAX_TRIES 4     // Queries per gateway search; then only the announcements are left
+
+/**
+ * @brief Counters of the discovery reply scheduler (logged with the service table cleanup).
+ */
+struct ASCSDiscoveryReplyStats {
+    uint32_t scheduled = 0;  // Queries accepted for a reply
+    uint32_t sent = 0;       // Replies due and sent
+    uint32_t suppressed = 0; // Replies cancelled because other nodes already answered
+};
+
+/**
+ * @brief Schedules the unicast replies of a Gateway (or an Aggregator with a route) to discovery queries.
+ *
+ * Each reply waits a delay (replyDelayMs()) so that answers from several nodes do not
+ * collide; nodes with a better path to a gateway answer earlier. A node that overhears
+ * enough replies to the same querier before its own is due cancels it, so a query gets a few
+ * answers instead of one from every node in range.
+ */
+class ASCSDiscoveryReplies {
+public:
+    ASCSDiscoveryReplies() = default;
+
+    /**
+     * @brief Delay before replying to a query.
+     * @param linkCost Expected transmissions of the query's link (ASCSLinkStats::expectedTransmissions()),
+     *                 plus the route cost to a gateway for an Aggregator.
+     * @param randomValue Any random number (spreads nodes with similar links).
+     */
+    static uint32_t replyDelayMs(float linkCost, uint32_t randomValue);
+
+    /**
+     * @brief Schedules a reply to 'querier', due at now + delayMs.
+     * @return False if a reply to 'querier' is already pending or too many are pending.
+     */
+    bool schedule(uint32_t querier, unsigned long now, uint32_t delayMs);
+
+    /**
+     * @brief Another node's reply to 'querier' was overheard.
+     */
+    void overheard(uint32_t querier);
+
+    /**
+     * @brief Takes the next reply that is due.
+     * @param querier Set to the node to reply to.
+     * @return True if a reply is due.
+     */
+    bool popDue(unsigned long now, uint32_t &querier);
+
+    bool hasPending() const { return m_count > 0; }
+    const ASCSDiscoveryReplyStats &getStats() const { return m_stats; }
+    void clear() { m_count = 0; }
+
+private:
+    struct PendingReply {
+        uint32_t querier;
+        unsigned long dueAt;
+        uint8_t overheard;
+    };
+
+    void removeAt(size_t index);
+
+    PendingReply m_pending[ASCS_DISCOVERY_MAX_PENDING_REPLIES];
+    size_t m_count = 0;
+    ASCSDiscoveryReplyStats m_stats;
+};
+
+#endif // ASCS_DISCOVERY_REPLIES_H
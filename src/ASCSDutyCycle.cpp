@@ -0,0 +1,44 @@
+#include "ASCSDutyCycle.h"
+
+static const unsigned long kBucketMs = ASCS_DUTY_WINDOW_MS / ASCS_DUTY_BUCKETS;
+
+void ASCSDutyCycle::configure(uint32_t percent) {
+    if (percent > 100) percent = 100;
+    m_budgetMs = (uint32_t)(ASCS_DUTY_WINDOW_MS * percent / 100);
+}
+
+void ASCSDutyCycle::advance(unsigned long now) {
+    unsigned long elapsed = now - m_bucketStart;
+    if (elapsed < kBucketMs) return;
+    unsigned long steps = elapsed / kBucketMs;
+    if (steps >= ASCS_DUTY_BUCKETS) {
+        // Idle for the whole window
+        for (uint32_t &bucket : m_buckets) bucket = 0;
+        m_usedMs = 0;
+    } else {
+        for (unsigned long i = 0; i < steps; i++) {
+            m_current = (m_current + 1) % ASCS_DUTY_BUCKETS;
+            m_usedMs -= m_buckets[m_current];
+            m_buckets[m_current] = 0;
+        }
+    }
+    m_bucketStart += steps * kBucketMs;
+}
+
+bool ASCSDutyCycle::allows(uint32_t airtimeMs, bool critical, unsigned long now) {
+    if (m_budgetMs == 0) return true;
+    advance(now);
+    uint32_t budget = critical ? m_budgetMs : m_budgetMs - m_budgetMs / 100 * ASCS_DUTY_CRITICAL_RESERVE_PCT;
+    return m_usedMs + airtimeMs <= budget;
+}
+
+void ASCSDutyCycle::record(uint32_t airtimeMs, unsigned long now) {
+    advance(now);
+    m_buckets[m_current] += airtimeMs;
+    m_usedMs += airtimeMs;
+}
+
+uint32_t ASCSDutyCycle::usedMs(unsigned long now) {
+    advance(now);
+    return m_usedMs;
+}
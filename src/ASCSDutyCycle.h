@@ -0,0 +1,58 @@
+#ifndef ASCS_DUTY_CYCLE_H
+#define ASCS_DUTY_CYCLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// --- Duty Cycle Constants ---
+
+#define ASCS_DUTY_WINDOW_MS 3600000UL   // Duty cycle is measured over a sliding hour (ETSI EN 300 220)
+#define ASCS_DUTY_BUCKETS 60            // Airtime is kept per minute of the window
+#define ASCS_DUTY_CRITICAL_RESERVE_PCT 10 // Share of the budget only critical packets may use
+
+/**
+ * @brief Own transmit airtime over the last hour, against a duty-cycle budget (`duty_pct`).
+ *
+ * Airtime is summed per minute in a ring of ASCS_DUTY_BUCKETS buckets (240 bytes), so the
+ * window slides by the minute. The last ASCS_DUTY_CRITICAL_RESERVE_PCT of the budget is kept
+ * for critical packets: an alarm can still go out when routine traffic has used up its share.
+ */
+class ASCSDutyCycle {
+public:
+    ASCSDutyCycle() = default;
+
+    /**
+     * @param percent Duty-cycle limit in percent of the window (0 = no limit, only counted).
+     */
+    void configure(uint32_t percent);
+
+    bool isLimited() const { return m_budgetMs > 0; }
+    uint32_t getBudgetMs() const { return m_budgetMs; }
+
+    /**
+     * @brief Whether a packet of 'airtimeMs' fits in the budget now.
+     * @param critical Critical packets may use the reserve.
+     */
+    bool allows(uint32_t airtimeMs, bool critical, unsigned long now);
+
+    /**
+     * @brief Records a transmission.
+     */
+    void record(uint32_t airtimeMs, unsigned long now);
+
+    /**
+     * @brief Airtime used within the window (up to one bucket of it may be older than an hour).
+     */
+    uint32_t usedMs(unsigned long now);
+
+private:
+    void advance(unsigned long now); // Clears the buckets that left the window
+
+    uint32_t m_budgetMs = 0;
+    uint32_t m_buckets[ASCS_DUTY_BUCKETS] = {};
+    uint32_t m_usedMs = 0;           // Sum of the buckets
+    unsigned long m_bucketStart = 0; // Start of the current bucket
+    size_t m_current = 0;
+};
+
+#endif // ASCS_DUTY_CYCLE_H
@@ -0,0 +1,67 @@
+#include "ASCSEventDebouncer.h"
+
+size_t ASCSEventDebouncer::drain(size_t sensor, SensorEventQueue &queue) {
+    if (sensor >= m_slots.size()) m_slots.resize(sensor + 1);
+    Slot &slot = m_slots[sensor];
+
+    uint32_t dropped = queue.getDropped();
+    m_stats.dropped += dropped - slot.dropped;
+    slot.dropped = dropped;
+
+    size_t taken = 0;
+    SensorEvent event;
+    while (queue.pop(event)) {
+        if (!event.key) continue;
+        if (slot.events == 0) {
+            slot.firstEventMs = event.timeMs;
+            m_pending++;
+        }
+        slot.readings[event.key] = event.value;
+        slot.events++;
+        taken++;
+    }
+    m_stats.events += taken;
+    return taken;
+}
+
+bool ASCSEventDebouncer::takeReady(unsigned long now, size_t &sensor, std::map<std::string, float> &readings) {
+    if (m_pending == 0) return false;
+    for (size_t i = 0; i < m_slots.size(); i++) {
+        Slot &slot = m_slots[i];
+        if (slot.events == 0) continue;
+        if (slot.sent && now - slot.lastSent < m_debounceMs) continue; // Still within the burst
+
+        uint32_t events = slot.events;
+        slot.events = 0;
+        m_pending--;
+        bool changed = false;
+        for (const auto &reading : slot.readings) {
+            auto last = slot.lastValues.find(reading.first);
+            if (last == slot.lastValues.end() || last->second != reading.second) {
+                changed = true;
+                break;
+            }
+        }
+        if (!changed) {
+            // The burst ended where the last packet left off (contact bounce)
+            m_stats.coalesced += events;
+            slot.readings.clear();
+            continue;
+        }
+
+        sensor = i;
+        readings.clear();
+        readings.swap(slot.readings);
+        for (const auto &reading : readings) {
+            slot.lastValues[reading.first] = reading.second;
+        }
+        uint32_t latency = (uint32_t)now - slot.firstEventMs;
+        if (latency > m_stats.maxLatencyMs) m_stats.maxLatencyMs = latency;
+        m_stats.packets++;
+        m_stats.coalesced += events - (uint32_t)readings.size();
+        slot.lastSent = now;
+        slot.sent = true;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,73 @@
+#ifndef ASCS_EVENT_DEBOUNCER_H
+#define ASCS_EVENT_DEBOUNCER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "interfaces/SensorEventQueue.h"
+
+/**
+ * @brief Counters of the sensor event path (logged with the service table cleanup).
+ */
+struct ASCSEventStats {
+    uint32_t events = 0;       // Events taken from the sensors' queues
+    uint32_t packets = 0;      // Packets sent with events
+    uint32_t coalesced = 0;    // Events not sent: replaced by a later value of their key, or back to the value sent (bursts)
+    uint32_t dropped = 0;      // Events lost to a full queue (SensorEventQueue::getDropped())
+    uint32_t maxLatencyMs = 0; // Longest time from an event to its packet being handed on
+};
+
+/**
+ * @brief Turns the events sensors post (SensorEventQueue) into packets: at once after a quiet
+ * spell, at most one per sensor per debounce time during a burst.
+ *
+ * The first event of a sensor after the debounce time is ready to send immediately (the leading
+ * edge). Events arriving within the debounce time after a send are collected, later values of a
+ * key replacing earlier ones, and go out together once it has passed (the trailing edge), unless
+ * every key settled back to the value last sent: a bouncing contact costs one packet, and the
+ * final state is always reported.
+ */
+class ASCSEventDebouncer {
+public:
+    ASCSEventDebouncer() = default;
+
+    void configure(uint32_t debounceMs) { m_debounceMs = debounceMs; }
+
+    /**
+     * @brief Takes the events waiting in a sensor's queue.
+     * @param sensor Index of the sensor (ASCSSensorRegistry).
+     * @return Number of events taken.
+     */
+    size_t drain(size_t sensor, SensorEventQueue &queue);
+
+    /**
+     * @brief Takes the collected events of a sensor that may send now.
+     * @param sensor Set to the index of the sensor.
+     * @param readings Filled (after clearing) with the latest value of each key posted.
+     * @return False if no sensor has events ready.
+     */
+    bool takeReady(unsigned long now, size_t &sensor, std::map<std::string, float> &readings);
+
+    bool hasPending() const { return m_pending > 0; }
+    const ASCSEventStats &getStats() const { return m_stats; }
+
+private:
+    struct Slot {
+        std::map<std::string, float> readings;   // Collected since the last send
+        std::map<std::string, float> lastValues; // Last value sent of each key
+        uint32_t firstEventMs = 0;               // Time of the oldest collected event
+        uint32_t events = 0;                     // Events collected
+        unsigned long lastSent = 0;
+        bool sent = false;
+        uint32_t dropped = 0;                    // Queue drops already counted
+    };
+
+    uint32_t m_debounceMs = 0;
+    std::vector<Slot> m_slots;
+    size_t m_pending = 0; // Slots with collected events
+    ASCSEventStats m_stats;
+};
+
+#endif // ASCS_EVENT_DEBOUNCER_H
@@ -0,0 +1,70 @@
+#include "ASCSFileSink.h"
+
+#ifdef ASCS_ROLE_GATEWAY
+#include "ASCSFileSystem.h"
+#include "ASCSLineProtocolSink.h" // For appendLine
+#include "plugin_api.h" // For Log definition
+
+ASCSFileSink::ASCSFileSink(const std::string &path, uint32_t maxBytes, const std::string &measurement, uint32_t serviceId)
+    : m_path(path), m_rotatedPath(path + ".1"), m_maxBytes(maxBytes), m_measurement(measurement), m_serviceId(serviceId) {
+}
+
+bool ASCSFileSink::begin() {
+    // The filesystem must be mounted in setup() before Meshtastic starts the plugin.
+    m_mounted = FileSystem.exists("/");
+    if (!m_mounted) {
+        Log.println(LOG_LEVEL_ERROR, "ASCSFileSink: Filesystem not mounted!");
+        return false;
+    }
+    Log.printf(LOG_LEVEL_INFO, "ASCSFileSink: Appending to %s (rotates at %lu bytes)\n", m_path.c_str(), (unsigned long)m_maxBytes);
+    return true;
+}
+
+bool ASCSFileSink::write(const std::vector<ASCSBatchRecord> &records) {
+    m_lineBuffer.clear();
+    for (const ASCSBatchRecord &record : records) {
+        ASCSLineProtocolSink::appendLine(m_lineBuffer, m_measurement, m_serviceId, record);
+    }
+    if (m_lineBuffer.empty()) return true; // Nothing writable (no valid readings)
+
+    File file = FileSystem.open(m_path.c_str(), FILE_APPEND);
+    if (!file) {
+        Log.printf(LOG_LEVEL_ERROR, "ASCSFileSink: Failed to open %s for append!\n", m_path.c_str());
+        return false;
+    }
+    if (file.size() > 0 && file.size() + m_lineBuffer.length() > m_maxBytes) {
+        file.close();
+        rotate();
+        file = FileSystem.open(m_path.c_str(), FILE_APPEND);
+        if (!file) {
+            Log.printf(LOG_LEVEL_ERROR, "ASCSFileSink: Failed to reopen %s after rotation!\n", m_path.c_str());
+            return false;
+        }
+    }
+
+    size_t written = file.write(reinterpret_cast<const uint8_t*>(m_lineBuffer.data()), m_lineBuffer.length());
+    file.close();
+    if (written != m_lineBuffer.length()) {
+        Log.printf(LOG_LEVEL_ERROR, "ASCSFileSink: Short write to %s (%d/%d bytes). Filesystem full?\n",
+                   m_path.c_str(), (int)written, (int)m_lineBuffer.length());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Moves the current file to "<path>.1", replacing any previous rotated file.
+ */
+void ASCSFileSink::rotate() {
+    if (FileSystem.exists(m_rotatedPath.c_str())) {
+        FileSystem.remove(m_rotatedPath.c_str());
+    }
+    if (!FileSystem.rename(m_path.c_str(), m_rotatedPath.c_str())) {
+        Log.printf(LOG_LEVEL_ERROR, "ASCSFileSink: Failed to rotate %s, truncating instead.\n", m_path.c_str());
+        FileSystem.remove(m_path.c_str());
+        return;
+    }
+    Log.printf(LOG_LEVEL_INFO, "ASCSFileSink: Rotated %s to %s\n", m_path.c_str(), m_rotatedPath.c_str());
+}
+
+#endif // ASCS_ROLE_GATEWAY
@@ -0,0 +1,43 @@
+#ifndef ASCS_FILE_SINK_H
+#define ASCS_FILE_SINK_H
+
+#include "interfaces/GatewaySink.h"
+#include <string>
+
+/**
+ * @brief Gateway sink appending records to a local file in InfluxDB line protocol.
+ *
+ * Useful as an on-device audit log or where the uplink is collected offline. The file is
+ * append-only; when it would exceed the configured size it is renamed to "<path>.1"
+ * (replacing the previous one) and a new file is started, so at most two files are kept.
+ * Batching amortizes the open/append/close cycle and flash writes over several records.
+ */
+class ASCSFileSink : public GatewaySink {
+public:
+    /**
+     * @param path File path on the gateway filesystem (e.g., "/ascs_data.lp").
+     * @param maxBytes Size at which the file is rotated.
+     * @param measurement Measurement name written at the start of every line.
+     * @param serviceId Gateway service ID, written as the 'service' tag.
+     */
+    ASCSFileSink(const std::string &path, uint32_t maxBytes, const std::string &measurement, uint32_t serviceId);
+    virtual ~ASCSFileSink() = default;
+
+    const char *getSinkName() const override { return "file"; }
+    bool begin() override;
+    bool isReady() override { return m_mounted; }
+    bool write(const std::vector<ASCSBatchRecord> &records) override;
+
+private:
+    void rotate();
+
+    std::string m_path;
+    std::string m_rotatedPath; // "<path>.1"
+    uint32_t m_maxBytes;
+    std::string m_measurement;
+    uint32_t m_serviceId;
+    bool m_mounted = false;
+    std::string m_lineBuffer; // Reused between writes to avoid reallocating
+};
+
+#endif // ASCS_FILE_SINK_H
@@ -0,0 +1,13 @@
+#ifndef ASCS_FILESYSTEM_H
+#define ASCS_FILESYSTEM_H
+
+// Filesystem used by the Gateway role (buffer/spill files, local file sink).
+// Must match the filesystem mounted in setup() and board_build.filesystem in platformio.ini.
+#ifdef ASCS_ROLE_GATEWAY
+// Choose ONE filesystem library:
+#include <SPIFFS.h>        // Option 1: Default ESP32 filesystem
+// #include <LittleFS.h>   // Option 2: Often preferred on ESP32 for wear leveling
+#define FileSystem SPIFFS  // Define which filesystem to use (SPIFFS or LittleFS)
+#endif
+
+#endif // ASCS_FILESYSTEM_H
@@ -0,0 +1,181 @@
+#include "ASCSLineProtocolSink.h"
+
+#ifdef ASCS_ROLE_GATEWAY
+#include <WiFi.h>
+#include "plugin_api.h" // For Log definition
+#include "ASCSTopicCache.h" // For formatNodeHex
+#include "ASCSTypedReadings.h" // For typeOf/toInt
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Appends 'str' escaping the characters that are special in the given line protocol element. A
+// backslash is escaped too, so one at the end of 'str' cannot escape the delimiter after it.
+static void appendEscaped(std::string &out, const std::string &str, const char *specials) {
+    for (char c : str) {
+        if (c == '\\' || (c != '\0' && strchr(specials, c))) out += '\\';
+        out += c;
+    }
+}
+
+// Whether a reading key would clash with the record fields appendLine() writes: "seq", "priority" or
+// "interval_ms" preceded by any number of underscores. Such keys get one more leading underscore, so
+// "seq" is written as "_seq" and a reading "_seq" as "__seq", and no two fields share a name.
+static bool isReservedField(const std::string &key) {
+    size_t start = key.find_first_not_of('_');
+    if (start == std::string::npos) return false;
+    return key.compare(start, std::string::npos, "seq") == 0 || key.compare(start, std::string::npos, "priority") == 0 ||
+           key.compare(start, std::string::npos, "interval_ms") == 0;
+}
+
+ASCSLineProtocolSink::ASCSLineProtocolSink(const std::string &host, uint16_t port, const std::string &measurement,
+                                           uint32_t serviceId, Client *netClient)
+    : m_host(host), m_port(port), m_measurement(measurement), m_serviceId(serviceId), m_client(netClient) {
+}
+
+ASCSLineProtocolSink::~ASCSLineProtocolSink() {
+    if (m_client) m_client->stop();
+    if (m_ownsClient) delete m_client;
+}
+
+bool ASCSLineProtocolSink::begin() {
+    if (m_host.empty()) {
+        Log.println(LOG_LEVEL_ERROR, "ASCSLineProtocolSink: No listener host configured (lp_host).");
+        return false;
+    }
+    if (!m_client) {
+        try {
+            m_client = new WiFiClient();
+            m_ownsClient = true;
+        } catch (const std::bad_alloc& e) {
+            Log.println(LOG_LEVEL_CRITICAL, "ASCSLineProtocolSink: Failed to allocate network client!");
+            return false;
+        }
+    }
+    Log.printf(LOG_LEVEL_INFO, "ASCSLineProtocolSink: Writing measurement '%s' to %s:%u\n",
+               m_measurement.c_str(), m_host.c_str(), m_port);
+    return true;
+}
+
+/**
+ * @brief Reconnects periodically while disconnected and discards anything the listener sends.
+ */
+void ASCSLineProtocolSink::loop() {
+    if (!m_client) return;
+
+    if (m_client->connected()) {
+        // Listeners only send error text before closing; drain it so the receive window stays open.
+        while (m_client->available() > 0) {
+            m_client->read();
+        }
+        return;
+    }
+
+    unsigned long now = millis();
+    if (!m_attempted || now - m_lastConnectAttempt > ASCS_LP_RECONNECT_INTERVAL_MS) {
+        connect();
+    }
+}
+
+void ASCSLineProtocolSink::connect() {
+    m_attempted = true;
+    m_lastConnectAttempt = millis();
+    if (m_ownsClient && WiFi.status() != WL_CONNECTED) {
+        return; // Will retry once WiFi is up
+    }
+    if (m_client->connect(m_host.c_str(), m_port)) {
+        Log.printf(LOG_LEVEL_INFO, "ASCSLineProtocolSink: Connected to %s:%u\n", m_host.c_str(), m_port);
+    } else {
+        Log.printf(LOG_LEVEL_WARNING, "ASCSLineProtocolSink: Connection to %s:%u failed. Will retry later.\n", m_host.c_str(), m_port);
+    }
+}
+
+bool ASCSLineProtocolSink::isReady() {
+    return m_client && m_client->connected();
+}
+
+bool ASCSLineProtocolSink::write(const std::vector<ASCSBatchRecord> &records) {
+    if (!isReady()) return false;
+
+    m_lineBuffer.clear();
+    for (const ASCSBatchRecord &record : records) {
+        appendLine(m_lineBuffer, m_measurement, m_serviceId, record);
+    }
+    if (m_lineBuffer.empty()) return true; // Nothing writable (no valid readings)
+
+    size_t written = m_client->write(reinterpret_cast<const uint8_t*>(m_lineBuffer.data()), m_lineBuffer.length());
+    if (written != m_lineBuffer.length()) {
+        // A partial line would corrupt the stream; reconnect and let the caller spill the records.
+        Log.printf(LOG_LEVEL_ERROR, "ASCSLineProtocolSink: Short write (%d/%d bytes), reconnecting.\n",
+                   (int)written, (int)m_lineBuffer.length());
+        m_client->stop();
+        return false;
+    }
+    Log.printf(LOG_LEVEL_DEBUG, "ASCSLineProtocolSink: Wrote %d records (%d bytes)\n", (int)records.size(), (int)written);
+    return true;
+}
+
+size_t ASCSLineProtocolSink::appendLine(std::string &out, const std::string &measurement, uint32_t serviceId,
+                                        const ASCSBatchRecord &record) {
+    size_t start = out.length();
+    char num[32];
+
+    // --- Measurement and tags ---
+    appendEscaped(out, measurement, ", ");
+    snprintf(num, sizeof(num), ",service=%lu,node=", (unsigned long)serviceId);
+    out += num;
+    char nodeHex[8];
+    ASCSTopicCache::formatNodeHex(record.nodeId, nodeHex);
+    out.append(nodeHex, 8);
+    if (!record.sensorId.empty()) {
+        out += ",sensor=";
+        appendEscaped(out, record.sensorId, ",= ");
+    }
+
+    // --- Fields ---
+    char separator = ' ';
+    for (const auto &reading : record.readings) {
+        if (isnan(reading.second) || isinf(reading.second)) continue; // Not representable in line protocol
+        out += separator;
+        if (isReservedField(reading.first)) out += '_'; // Not a duplicate of seq/priority/interval_ms
+        appendEscaped(out, reading.first, ",= ");
+        switch (ASCSTypedReadings::typeOf(&record.types, reading.first)) {
+            case ReadingType::BOOL: // Boolean field
+                out += reading.second != 0.0f ? "=t" : "=f";
+                break;
+            case ReadingType::INT: // Integer field
+                snprintf(num, sizeof(num), "=%ldi", (long)ASCSTypedReadings::toInt(reading.second));
+                out += num;
+                break;
+            default:
+                snprintf(num, sizeof(num), "=%.7g", reading.second);
+                out += num;
+                break;
+        }
+        separator = ',';
+    }
+    if (separator == ' ') {
+        out.resize(start); // A line needs at least one field
+        return 0;
+    }
+    snprintf(num, sizeof(num), ",seq=%lui", (unsigned long)record.sequenceNum);
+    out += num;
+    if (record.priority > 0) {
+        snprintf(num, sizeof(num), ",priority=%ui", (unsigned)record.priority);
+        out += num;
+    }
+    if (record.intervalMs > 0) {
+        snprintf(num, sizeof(num), ",interval_ms=%lui", (unsigned long)record.intervalMs);
+        out += num;
+    }
+
+    // --- Timestamp (nanoseconds; omitted if unknown so the server assigns one) ---
+    if (record.timestampUtc > 0) {
+        snprintf(num, sizeof(num), " %lu000000000", (unsigned long)record.timestampUtc);
+        out += num;
+    }
+    out += '\n';
+    return out.length() - start;
+}
+
+#endif // ASCS_ROLE_GATEWAY
@@ -0,0 +1,68 @@
+#ifndef ASCS_LINE_PROTOCOL_SINK_H
+#define ASCS_LINE_PROTOCOL_SINK_H
+
+#include "interfaces/GatewaySink.h"
+#include <string>
+
+class Client;
+
+// --- Line Protocol Sink Constants ---
+
+#define ASCS_LP_SPILL_FILENAME "/ascs_spill_lp.dat" // Spill file while the listener is unreachable
+#define ASCS_LP_RECONNECT_INTERVAL_MS 10000         // Min time between connection attempts
+
+/**
+ * @brief Gateway sink writing InfluxDB line protocol over a TCP stream.
+ *
+ * Intended for a line-protocol listener next to the database (e.g., Telegraf socket_listener,
+ * QuestDB ILP/TCP), so records are ingested without a JSON round trip. One line per record:
+ *
+ *   <measurement>,service=<id>,node=<hex>,sensor=<sensor_id> <key>=<value>,...,seq=<n>i <timestamp_ns>
+ *
+ * A whole batch is formatted into one buffer and written with a single call.
+ */
+class ASCSLineProtocolSink : public GatewaySink {
+public:
+    /**
+     * @param host Listener host name or IP address.
+     * @param port Listener TCP port.
+     * @param measurement Measurement name written at the start of every line.
+     * @param serviceId Gateway service ID, written as the 'service' tag.
+     * @param netClient Network client to use (not owned), or nullptr to allocate a WiFiClient in begin().
+     */
+    ASCSLineProtocolSink(const std::string &host, uint16_t port, const std::string &measurement,
+                         uint32_t serviceId, Client *netClient = nullptr);
+    virtual ~ASCSLineProtocolSink();
+
+    const char *getSinkName() const override { return "lp"; }
+    bool begin() override;
+    void loop() override;
+    bool isReady() override;
+    bool write(const std::vector<ASCSBatchRecord> &records) override;
+    const char *getSpillFilename() const override { return ASCS_LP_SPILL_FILENAME; }
+
+    /**
+     * @brief Appends one record as a line-protocol line (with trailing newline) to 'out'.
+     * Readings that are NaN or infinite are skipped; records without any valid reading produce no line.
+     * BOOL readings are written as t/f and INT readings with the 'i' suffix (record.types).
+     * Reading keys named like the record fields (seq, priority, interval_ms) get a leading '_'.
+     * @return Number of bytes appended.
+     */
+    static size_t appendLine(std::string &out, const std::string &measurement, uint32_t serviceId,
+                             const ASCSBatchRecord &record);
+
+private:
+    void connect();
+
+    std::string m_host;
+    uint16_t m_port;
+    std::string m_measurement;
+    uint32_t m_serviceId;
+    Client *m_client;
+    bool m_ownsClient = false;
+    unsigned long m_lastConnectAttempt = 0;
+    bool m_attempted = false;
+    std::string m_lineBuffer; // Reused between writes to avoid reallocating
+};
+
+#endif // ASCS_LINE_PROTOCOL_SINK_H
@@ -0,0 +1,32 @@
+#include "ASCSLinkMetrics.h"
+
+#include <math.h>
+
+void ASCSLinkStats::add(const ASCSLinkSample &sample) {
+    if (samples == 0) {
+        // First sample initializes the averages
+        rssi = (float)sample.rssi;
+        snr = sample.snr;
+        hops = sample.hops >= 0 ? (float)sample.hops : 0.0f;
+    } else {
+        rssi += ASCS_LINK_EWMA_ALPHA * ((float)sample.rssi - rssi);
+        snr += ASCS_LINK_EWMA_ALPHA * (sample.snr - snr);
+        if (sample.hops >= 0) {
+            hops += ASCS_LINK_EWMA_ALPHA * ((float)sample.hops - hops);
+        }
+    }
+    if (samples < UINT16_MAX) samples++;
+    cost = expectedTransmissions(rssi, snr, hops);
+}
+
+float ASCSLinkStats::expectedTransmissions(float rssi, float snr, float hops) {
+    // Delivery probability of the first hop
+    float pSnr = 1.0f / (1.0f + expf(-(snr - ASCS_LINK_SNR_FLOOR_DB) / ASCS_LINK_SNR_SLOPE_DB));
+    float pRssi = 1.0f / (1.0f + expf(-(rssi - ASCS_LINK_RSSI_FLOOR_DBM) / ASCS_LINK_RSSI_SLOPE_DB));
+    float p = pSnr * pRssi;
+    float etx = (p > 1.0f / ASCS_LINK_MAX_ETX) ? 1.0f / p : ASCS_LINK_MAX_ETX;
+
+    // Further hops cannot be observed here; count them at a typical cost
+    if (hops > 0) etx += hops * ASCS_LINK_HOP_ETX;
+    return etx;
+}
@@ -0,0 +1,54 @@
+#ifndef ASCS_LINK_METRICS_H
+#define ASCS_LINK_METRICS_H
+
+#include <stdint.h>
+
+// --- Link Metrics Constants ---
+
+#define ASCS_LINK_EWMA_ALPHA 0.25f      // Weight of a new sample in the moving averages
+#define ASCS_LINK_SNR_FLOOR_DB -15.0f   // SNR at which about half the packets are lost (LongFast, SF11)
+#define ASCS_LINK_SNR_SLOPE_DB 2.0f     // Width of the SNR loss curve
+#define ASCS_LINK_RSSI_FLOOR_DBM -126.0f // RSSI at which about half the packets are lost
+#define ASCS_LINK_RSSI_SLOPE_DB 3.0f    // Width of the RSSI loss curve
+#define ASCS_LINK_HOP_ETX 1.5f          // Assumed expected transmissions for each hop beyond the first (not observable)
+#define ASCS_LINK_MAX_ETX 10.0f         // Cap for the first-hop estimate (link practically unusable)
+#define ASCS_LINK_UNKNOWN_COST 4.0f     // Cost of a node without link samples, so measured links are preferred
+
+/**
+ * @brief Link quality observed on one received packet.
+ */
+struct ASCSLinkSample {
+    int32_t rssi = 0;  // dBm, of the last hop (packet.rx_rssi)
+    float snr = 0;     // dB, of the last hop (packet.rx_snr)
+    int8_t hops = -1;  // Hops the packet travelled (hop_start - hop_limit), -1 if unknown
+};
+
+/**
+ * @brief Moving averages of the link towards one node and its expected transmission cost.
+ *
+ * Cost = ETX(first hop, from SNR and RSSI) + ASCS_LINK_HOP_ETX for each further hop.
+ * The first-hop delivery probability is modelled as logistic curves around the
+ * demodulation floors, so a marginal link costs several transmissions and a strong
+ * one costs about one. Lower is better.
+ */
+struct ASCSLinkStats {
+    float rssi = 0;
+    float snr = 0;
+    float hops = 0;        // Average hop count (0 = direct neighbour)
+    uint16_t samples = 0;
+    float cost = ASCS_LINK_UNKNOWN_COST;
+
+    /**
+     * @brief Adds a sample to the moving averages and recomputes the cost.
+     */
+    void add(const ASCSLinkSample &sample);
+
+    void reset() { *this = ASCSLinkStats(); }
+
+    /**
+     * @brief Expected transmissions to deliver one packet over a path with the given metrics.
+     */
+    static float expectedTransmissions(float rssi, float snr, float hops);
+};
+
+#endif // ASCS_LINK_METRICS_H
@@ -0,0 +1,61 @@
+#include "ASCSLoRaAirtime.h"
+#include <ctype.h>
+#include <stdlib.h>
+
+namespace {
+struct Preset {
+    const char *name; // Lower case, without '_'
+    uint8_t spreadingFactor;
+    uint32_t bandwidthHz;
+    uint8_t codingRate;
+};
+
+// Meshtastic modem presets
+const Preset kPresets[] = {
+    {"shortturbo", 7, 500000, 5},   {"shortfast", 7, 250000, 5},    {"shortslow", 8, 250000, 5},
+    {"mediumfast", 9, 250000, 5},   {"mediumslow", 10, 250000, 5},  {"longfast", 11, 250000, 5},
+    {"longmoderate", 11, 125000, 8}, {"longslow", 12, 125000, 8},    {"verylongslow", 12, 62500, 8},
+};
+} // namespace
+
+bool ASCSLoRaAirtime::parse(const std::string &text, ASCSLoRaModem &modem) {
+    std::string name;
+    for (char c : text) {
+        if (c != '_' && c != ' ' && c != '-') name += (char)tolower((unsigned char)c);
+    }
+    for (const Preset &preset : kPresets) {
+        if (name == preset.name) {
+            modem = {preset.spreadingFactor, preset.bandwidthHz, preset.codingRate};
+            return true;
+        }
+    }
+
+    // Explicit "SF/bandwidth kHz/CR"
+    const char *p = name.c_str();
+    char *end;
+    long sf = strtol(p, &end, 10);
+    if (*end != '/') return false;
+    double bwKhz = strtod(end + 1, &end);
+    if (*end != '/') return false;
+    long cr = strtol(end + 1, &end, 10);
+    if (*end != '\0' || sf < 7 || sf > 12 || bwKhz < 7.8 || bwKhz > 500 || cr < 5 || cr > 8) return false;
+    modem = {(uint8_t)sf, (uint32_t)(bwKhz * 1000 + 0.5), (uint8_t)cr};
+    return true;
+}
+
+uint32_t ASCSLoRaAirtime::timeOnAirMs(const ASCSLoRaModem &modem, size_t payloadBytes) {
+    // Symbol time in us, and whether the modem uses low data rate optimization
+    uint32_t symbolUs = (uint32_t)((1000000ULL << modem.spreadingFactor) / modem.bandwidthHz);
+    int de = symbolUs >= ASCS_LORA_LDRO_SYMBOL_US ? 1 : 0;
+    int sf = modem.spreadingFactor;
+
+    // Payload symbols: 8 + ceil((8 PL - 4 SF + 28 + 16 CRC - 20 IH) / (4 (SF - 2 DE))) * CR, at least 8
+    long bits = 8L * (long)payloadBytes - 4 * sf + 28 + 16;
+    long perBlock = 4L * (sf - 2 * de);
+    long blocks = bits > 0 ? (bits + perBlock - 1) / perBlock : 0;
+    uint64_t payloadSymbols = 8 + (uint64_t)blocks * modem.codingRate;
+
+    // Preamble: n + 4.25 symbols
+    uint64_t us = (uint64_t)symbolUs * (4 * ASCS_LORA_PREAMBLE_SYMBOLS + 17) / 4 + (uint64_t)symbolUs * payloadSymbols;
+    return (uint32_t)((us + 999) / 1000);
+}
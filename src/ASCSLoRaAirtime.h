@@ -0,0 +1,41 @@
+#ifndef ASCS_LORA_AIRTIME_H
+#define ASCS_LORA_AIRTIME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+// --- LoRa Airtime Constants ---
+
+#define ASCS_LORA_PREAMBLE_SYMBOLS 16   // Meshtastic preamble length
+#define ASCS_LORA_MESH_OVERHEAD 22      // Bytes on air besides our payload: Meshtastic header (16) and Data wrapper (port, length)
+#define ASCS_LORA_LDRO_SYMBOL_US 16000  // Low data rate optimization is on for symbols this long or longer
+
+/**
+ * @brief LoRa modem settings of the channel (spreading factor, bandwidth, coding rate).
+ */
+struct ASCSLoRaModem {
+    uint8_t spreadingFactor = 11; // 7 .. 12
+    uint32_t bandwidthHz = 250000;
+    uint8_t codingRate = 5;       // Denominator of 4/5 .. 4/8
+};
+
+/**
+ * @brief Time on air of LoRa packets (Semtech AN1200.13), for explicit header and CRC on, as Meshtastic sends.
+ */
+class ASCSLoRaAirtime {
+public:
+    /**
+     * @brief Parses a Meshtastic modem preset name ("LongFast", "MediumSlow", ...; case and '_' ignored)
+     * or explicit settings "SF/bandwidth kHz/CR", e.g. "11/250/5".
+     * @return False if not recognized ('modem' unchanged).
+     */
+    static bool parse(const std::string &text, ASCSLoRaModem &modem);
+
+    /**
+     * @brief Time on air in ms of a packet with 'payloadBytes' bytes of LoRa payload (rounded up).
+     */
+    static uint32_t timeOnAirMs(const ASCSLoRaModem &modem, size_t payloadBytes);
+};
+
+#endif // ASCS_LORA_AIRTIME_H
@@ -0,0 +1,494 @@
+#include "ASCSMqtt5Transport.h"
+
+#ifdef ASCS_ROLE_GATEWAY
+#include "plugin_api.h" // For Log definition
+#include <WiFi.h>       // For Client
+#include <string.h>
+
+// Space reserved in front of every outgoing packet body for the fixed header (type + up to 4 length bytes)
+#define MQTT5_HEADER_RESERVE 5
+
+// MQTT control packet types (upper nibble of the fixed header)
+#define MQTT5_CONNECT     0x10
+#define MQTT5_CONNACK     0x20
+#define MQTT5_PUBLISH     0x30
+#define MQTT5_PUBACK      0x40
+#define MQTT5_PINGREQ     0xC0
+#define MQTT5_PINGRESP    0xD0
+#define MQTT5_DISCONNECT  0xE0
+
+// MQTT 5 property identifiers used by this client
+#define MQTT5_PROP_MESSAGE_EXPIRY     0x02
+#define MQTT5_PROP_SERVER_KEEP_ALIVE  0x13
+#define MQTT5_PROP_TOPIC_ALIAS_MAX    0x22
+#define MQTT5_PROP_TOPIC_ALIAS        0x23
+#define MQTT5_PROP_MAX_PACKET_SIZE    0x27
+
+namespace {
+
+// Reads a Variable Byte Integer from a buffer. Returns bytes consumed, or 0 if malformed.
+size_t readVarInt(const uint8_t *in, size_t avail, uint32_t &value) {
+    value = 0;
+    for (size_t i = 0; i < 4 && i < avail; i++) {
+        value |= (uint32_t)(in[i] & 0x7F) << (7 * i);
+        if ((in[i] & 0x80) == 0) return i + 1;
+    }
+    return 0;
+}
+
+uint16_t readU16(const uint8_t *in) { return (uint16_t)((in[0] << 8) | in[1]); }
+uint32_t readU32(const uint8_t *in) { return ((uint32_t)in[0] << 24) | ((uint32_t)in[1] << 16) | ((uint32_t)in[2] << 8) | in[3]; }
+
+// Returns the size of the value of a property, or 0 if the identifier is unknown/malformed.
+size_t propertyValueSize(uint8_t id, const uint8_t *value, size_t avail) {
+    switch (id) {
+        // Byte
+        case 0x01: case 0x17: case 0x19: case 0x24: case 0x25: case 0x28: case 0x29: case 0x2A:
+            return 1;
+        // Two Byte Integer
+        case 0x13: case 0x21: case 0x22: case 0x23:
+            return 2;
+        // Four Byte Integer
+        case 0x02: case 0x11: case 0x18: case 0x27:
+            return 4;
+        // Variable Byte Integer
+        case 0x0B: {
+            uint32_t ignored;
+            return readVarInt(value, avail, ignored);
+        }
+        // UTF-8 String / Binary Data
+        case 0x03: case 0x08: case 0x09: case 0x12: case 0x15: case 0x16: case 0x1A: case 0x1C: case 0x1F:
+            return avail >= 2 ? 2u + readU16(value) : 0;
+        // UTF-8 String Pair
+        case 0x26: {
+            if (avail < 2) return 0;
+            size_t first = 2u + readU16(value);
+            if (avail < first + 2) return 0;
+            return first + 2u + readU16(value + first);
+        }
+        default:
+            return 0;
+    }
+}
+
+uint32_t topicHash(const char *topic) {
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (const char *p = topic; *p; ++p) {
+        hash ^= (uint8_t)*p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+} // namespace
+
+ASCSMqtt5Transport::ASCSMqtt5Transport(Client &netClient) : m_netClient(netClient) {}
+
+void ASCSMqtt5Transport::setServer(const char *host, uint16_t port) {
+    m_host = host;
+    m_port = port;
+}
+
+void ASCSMqtt5Transport::setCallback(MqttMessageCallback callback) {
+    m_callback = callback;
+}
+
+bool ASCSMqtt5Transport::connect(const char *clientId, const char *user, const char *password) {
+    if (!m_host) return false;
+    if (connected()) return true;
+
+    m_netClient.stop(); // Drop any half-open socket from a previous session
+    if (!m_netClient.connect(m_host, m_port)) {
+        m_state = STATE_CONNECT_FAILED;
+        return false;
+    }
+
+    // Aliases belong to a network connection; start from a clean table.
+    for (AliasEntry &entry : m_aliases) entry.alias = 0;
+    m_aliasMax = 0;
+    m_maxPacketSize = ASCS_MQTT5_BUFFER_SIZE;
+    m_keepAliveS = ASCS_MQTT5_KEEPALIVE_S;
+    m_pingOutstanding = false;
+
+    size_t clientIdLen = strlen(clientId);
+    size_t userLen = user ? strlen(user) : 0;
+    size_t passLen = (user && password) ? strlen(password) : 0;
+    if (MQTT5_HEADER_RESERVE + 16 + clientIdLen + userLen + passLen + 6 > sizeof(m_buffer)) {
+        m_netClient.stop();
+        m_state = STATE_PROTOCOL_ERROR;
+        return false;
+    }
+
+    // --- Variable header ---
+    uint8_t *p = m_buffer + MQTT5_HEADER_RESERVE;
+    p += putUtf8(p, "MQTT", 4);
+    *p++ = 5; // Protocol level: MQTT 5
+    uint8_t flags = 0x02; // Clean Start
+    if (user) {
+        flags |= 0x80; // User Name
+        if (password) flags |= 0x40; // Password
+    }
+    *p++ = flags;
+    *p++ = (uint8_t)(m_keepAliveS >> 8);
+    *p++ = (uint8_t)(m_keepAliveS & 0xFF);
+    // Properties: Maximum Packet Size, so the broker never sends more than our buffer holds
+    *p++ = 5;
+    *p++ = MQTT5_PROP_MAX_PACKET_SIZE;
+    *p++ = 0;
+    *p++ = 0;
+    *p++ = (uint8_t)(ASCS_MQTT5_BUFFER_SIZE >> 8);
+    *p++ = (uint8_t)(ASCS_MQTT5_BUFFER_SIZE & 0xFF);
+
+    // --- Payload ---
+    p += putUtf8(p, clientId, clientIdLen);
+    if (user) {
+        p += putUtf8(p, user, userLen);
+        if (password) p += putUtf8(p, password, passLen);
+    }
+
+    if (!writePacket(MQTT5_CONNECT, p - (m_buffer + MQTT5_HEADER_RESERVE))) {
+        m_state = STATE_CONNECT_FAILED;
+        return false;
+    }
+
+    uint8_t header;
+    size_t length;
+    if (!readPacket(header, length, ASCS_MQTT5_CONNACK_TIMEOUT_MS)) {
+        m_netClient.stop();
+        m_state = STATE_CONNECTION_TIMEOUT;
+        return false;
+    }
+    m_state = STATE_PROTOCOL_ERROR; // parseConnack() stores the broker's reason code on refusal
+    if ((header & 0xF0) != MQTT5_CONNACK || !parseConnack(length)) {
+        m_netClient.stop();
+        return false;
+    }
+
+    m_state = STATE_CONNECTED;
+    m_lastInbound = millis();
+    Log.printf(LOG_LEVEL_DEBUG, "ASCS MQTT5: Connected (alias max %u, max packet %lu, keepalive %us)\n",
+               m_aliasMax, (unsigned long)m_maxPacketSize, m_keepAliveS);
+    return true;
+}
+
+bool ASCSMqtt5Transport::parseConnack(size_t length) {
+    if (length < 2) return false;
+    uint8_t reasonCode = m_buffer[1];
+    if (reasonCode != 0) {
+        m_state = reasonCode; // e.g., 0x86 Bad User Name or Password, 0x87 Not authorized
+        return false;
+    }
+    if (length == 2) return true; // No properties
+
+    uint32_t propsLen;
+    size_t n = readVarInt(m_buffer + 2, length - 2, propsLen);
+    if (n == 0 || 2 + n + propsLen > length) return false;
+
+    const uint8_t *prop = m_buffer + 2 + n;
+    const uint8_t *end = prop + propsLen;
+    while (prop < end) {
+        uint8_t id = *prop++;
+        size_t valueSize = propertyValueSize(id, prop, end - prop);
+        if (valueSize == 0 || prop + valueSize > end) return false;
+        switch (id) {
+            case MQTT5_PROP_TOPIC_ALIAS_MAX: {
+                uint16_t brokerMax = readU16(prop);
+                m_aliasMax = brokerMax < ASCS_MQTT5_MAX_TOPIC_ALIASES ? brokerMax : ASCS_MQTT5_MAX_TOPIC_ALIASES;
+                break;
+            }
+            case MQTT5_PROP_MAX_PACKET_SIZE: {
+                uint32_t brokerMax = readU32(prop);
+                if (brokerMax < m_maxPacketSize) m_maxPacketSize = brokerMax;
+                break;
+            }
+            case MQTT5_PROP_SERVER_KEEP_ALIVE:
+                m_keepAliveS = readU16(prop);
+                break;
+            default:
+                break; // Other CONNACK properties are not needed
+        }
+        prop += valueSize;
+    }
+    return true;
+}
+
+bool ASCSMqtt5Transport::connected() {
+    if (m_state != STATE_CONNECTED) return false;
+    if (!m_netClient.connected()) {
+        m_state = STATE_DISCONNECTED;
+        return false;
+    }
+    return true;
+}
+
+void ASCSMqtt5Transport::disconnect() {
+    if (connected()) {
+        // Reason code and properties omitted: Normal disconnection
+        writePacket(MQTT5_DISCONNECT, 0);
+    }
+    m_netClient.stop();
+    m_state = STATE_DISCONNECTED;
+}
+
+bool ASCSMqtt5Transport::loop() {
+    if (!connected()) return false;
+
+    // Drain incoming packets
+    while (m_netClient.available() > 0) {
+        uint8_t header;
+        size_t length;
+        if (!readPacket(header, length, 1000)) {
+            Log.println(LOG_LEVEL_WARNING, "ASCS MQTT5: Failed to read incoming packet, closing connection.");
+            m_netClient.stop();
+            m_state = STATE_PROTOCOL_ERROR;
+            return false;
+        }
+        m_lastInbound = millis();
+        handleIncoming(header, length);
+        if (!connected()) return false; // Broker may have sent DISCONNECT
+    }
+
+    // Keepalive: ping when idle, drop the connection if the previous ping went unanswered
+    if (m_keepAliveS > 0 && millis() - m_lastOutbound >= (unsigned long)m_keepAliveS * 1000UL) {
+        if (m_pingOutstanding) {
+            Log.println(LOG_LEVEL_WARNING, "ASCS MQTT5: PINGRESP timeout, closing connection.");
+            m_netClient.stop();
+            m_state = STATE_CONNECTION_TIMEOUT;
+            return false;
+        }
+        if (!writePacket(MQTT5_PINGREQ, 0)) return false;
+        m_pingOutstanding = true;
+    }
+    return true;
+}
+
+int ASCSMqtt5Transport::state() {
+    connected(); // Refresh state if the socket dropped
+    return m_state;
+}
+
+bool ASCSMqtt5Transport::publish(const char *topic, const uint8_t *payload, size_t length, bool retain,
+                                 const MqttPublishOptions &options) {
+    if (!connected()) return false;
+
+    size_t fullTopicLen = strlen(topic);
+    size_t expiryPropLen = options.messageExpirySec > 0 ? 5 : 0;
+    bool mayAlias = options.allowTopicAlias && m_aliasMax > 0;
+
+    // Size check with the full topic first, so an alias is never bound for a packet that cannot be sent
+    size_t worstPropsLen = expiryPropLen + (mayAlias ? 3 : 0);
+    size_t worstBodyLen = 2 + fullTopicLen + varIntSize(worstPropsLen) + worstPropsLen + length;
+    if (MQTT5_HEADER_RESERVE + worstBodyLen > sizeof(m_buffer) ||
+        1 + varIntSize(worstBodyLen) + worstBodyLen > m_maxPacketSize) {
+        Log.printf(LOG_LEVEL_ERROR, "ASCS MQTT5: Publish of %u bytes exceeds packet size limit.\n", (unsigned)length);
+        return false;
+    }
+
+    bool sendTopic = true;
+    uint16_t alias = mayAlias ? resolveAlias(topic, sendTopic) : 0;
+    size_t topicLen = sendTopic ? fullTopicLen : 0;
+    size_t propsLen = expiryPropLen + (alias ? 3 : 0);
+
+    uint8_t *p = m_buffer + MQTT5_HEADER_RESERVE;
+    p += putUtf8(p, topic, topicLen); // Zero-length topic when the alias is already bound
+    p += putVarInt(p, propsLen);
+    if (expiryPropLen) {
+        *p++ = MQTT5_PROP_MESSAGE_EXPIRY;
+        *p++ = (uint8_t)(options.messageExpirySec >> 24);
+        *p++ = (uint8_t)(options.messageExpirySec >> 16);
+        *p++ = (uint8_t)(options.messageExpirySec >> 8);
+        *p++ = (uint8_t)(options.messageExpirySec & 0xFF);
+    }
+    if (alias) {
+        *p++ = MQTT5_PROP_TOPIC_ALIAS;
+        *p++ = (uint8_t)(alias >> 8);
+        *p++ = (uint8_t)(alias & 0xFF);
+    }
+    memcpy(p, payload, length);
+    p += length;
+
+    size_t bodyLen = p - (m_buffer + MQTT5_HEADER_RESERVE);
+    if (!writePacket(MQTT5_PUBLISH | (retain ? 0x01 : 0x00), bodyLen)) {
+        return false;
+    }
+    recordPublish(1 + varIntSize(bodyLen) + bodyLen);
+    return true;
+}
+
+uint16_t ASCSMqtt5Transport::resolveAlias(const char *topic, bool &sendTopic) {
+    sendTopic = true;
+    size_t topicLen = strlen(topic);
+    if (topicLen >= sizeof(m_aliases[0].topic)) return 0; // Too long to remember; send in full
+
+    uint32_t hash = topicHash(topic);
+    unsigned long now = millis();
+    AliasEntry *victim = nullptr;
+
+    for (uint16_t i = 0; i < m_aliasMax; i++) {
+        AliasEntry &entry = m_aliases[i];
+        if (entry.alias != 0 && entry.hash == hash && strcmp(entry.topic, topic) == 0) {
+            entry.lastUsed = now;
+            sendTopic = false; // Broker already knows this alias
+            return entry.alias;
+        }
+        // Prefer a free slot, otherwise the least recently used one
+        if (!victim || (victim->alias != 0 && (entry.alias == 0 || now - entry.lastUsed > now - victim->lastUsed))) {
+            victim = &entry;
+        }
+    }
+    if (!victim) return 0;
+
+    // With more active topics than slots, evicting on every miss would rebind on every publish
+    // (cyclic access defeats LRU). Only reclaim slots from topics that have gone quiet.
+    if (victim->alias != 0 && now - victim->lastUsed < ASCS_MQTT5_ALIAS_IDLE_MS) return 0;
+
+    // (Re)bind: send the full topic together with the alias once
+    victim->alias = (uint16_t)(victim - m_aliases) + 1; // Aliases are 1-based
+    victim->hash = hash;
+    victim->lastUsed = now;
+    memcpy(victim->topic, topic, topicLen + 1);
+    return victim->alias;
+}
+
+void ASCSMqtt5Transport::handleIncoming(uint8_t header, size_t length) {
+    switch (header & 0xF0) {
+        case MQTT5_PINGRESP:
+            m_pingOutstanding = false;
+            break;
+
+        case MQTT5_DISCONNECT:
+            Log.printf(LOG_LEVEL_WARNING, "ASCS MQTT5: Broker sent DISCONNECT (reason 0x%02x)\n", length > 0 ? m_buffer[0] : 0);
+            m_netClient.stop();
+            m_state = STATE_DISCONNECTED;
+            break;
+
+        case MQTT5_PUBLISH: {
+            uint8_t qos = (header >> 1) & 0x03;
+            if (length < 2) return;
+            size_t topicLen = readU16(m_buffer);
+            size_t pos = 2 + topicLen;
+            if (pos > length || topicLen >= ASCS_MQTT_TOPIC_MAX_LEN) return;
+
+            char topic[ASCS_MQTT_TOPIC_MAX_LEN];
+            memcpy(topic, m_buffer + 2, topicLen);
+            topic[topicLen] = '\0';
+
+            uint16_t packetId = 0;
+            if (qos > 0) {
+                if (pos + 2 > length) return;
+                packetId = readU16(m_buffer + pos);
+                pos += 2;
+            }
+            uint32_t propsLen;
+            size_t n = readVarInt(m_buffer + pos, length - pos, propsLen);
+            if (n == 0 || pos + n + propsLen > length) return;
+            pos += n + propsLen; // Incoming properties are not used
+
+            // readPacket() leaves at least one spare byte after the payload for the callback's terminator
+            if (m_callback) m_callback(topic, m_buffer + pos, (unsigned int)(length - pos));
+
+            if (qos == 1) {
+                // PUBACK with implied reason code 0 (Success)
+                uint8_t *p = m_buffer + MQTT5_HEADER_RESERVE;
+                p[0] = (uint8_t)(packetId >> 8);
+                p[1] = (uint8_t)(packetId & 0xFF);
+                writePacket(MQTT5_PUBACK, 2);
+            }
+            break;
+        }
+
+        default:
+            break; // SUBACK etc. are not used
+    }
+}
+
+bool ASCSMqtt5Transport::writePacket(uint8_t type, size_t bodyLength) {
+    // Prepend the fixed header directly in front of the body
+    uint8_t lengthBytes[4];
+    size_t n = putVarInt(lengthBytes, bodyLength);
+    uint8_t *start = m_buffer + MQTT5_HEADER_RESERVE - 1 - n;
+    start[0] = type;
+    memcpy(start + 1, lengthBytes, n);
+
+    size_t total = 1 + n + bodyLength;
+    if (m_netClient.write(start, total) != total) {
+        Log.println(LOG_LEVEL_WARNING, "ASCS MQTT5: Short write, closing connection.");
+        m_netClient.stop();
+        m_state = STATE_DISCONNECTED;
+        return false;
+    }
+    m_lastOutbound = millis();
+    return true;
+}
+
+bool ASCSMqtt5Transport::readByte(uint8_t &out, unsigned long timeoutMs) {
+    unsigned long start = millis();
+    while (m_netClient.available() <= 0) {
+        if (!m_netClient.connected() || millis() - start > timeoutMs) return false;
+        delay(1);
+    }
+    int value = m_netClient.read();
+    if (value < 0) return false;
+    out = (uint8_t)value;
+    return true;
+}
+
+bool ASCSMqtt5Transport::readPacket(uint8_t &header, size_t &length, unsigned long timeoutMs) {
+    if (!readByte(header, timeoutMs)) return false;
+
+    uint32_t remaining = 0;
+    for (int i = 0; i < 4; i++) {
+        uint8_t b;
+        if (!readByte(b, timeoutMs)) return false;
+        remaining |= (uint32_t)(b & 0x7F) << (7 * i);
+        if ((b & 0x80) == 0) break;
+        if (i == 3) return false; // Malformed length
+    }
+
+    // Keep one spare byte so PUBLISH payloads can be null-terminated in place
+    if (remaining >= sizeof(m_buffer)) {
+        // Should not happen (Maximum Packet Size was announced); discard it to stay in sync
+        for (uint32_t i = 0; i < remaining; i++) {
+            uint8_t ignored;
+            if (!readByte(ignored, timeoutMs)) return false;
+        }
+        length = 0;
+        header = 0; // Reserved type, ignored by handleIncoming()
+        return true;
+    }
+
+    size_t received = 0;
+    unsigned long start = millis();
+    while (received < remaining) {
+        if (m_netClient.available() <= 0) {
+            if (!m_netClient.connected() || millis() - start > timeoutMs) return false;
+            delay(1);
+            continue;
+        }
+        int n = m_netClient.read(m_buffer + received, remaining - received);
+        if (n <= 0) return false;
+        received += n;
+    }
+    length = remaining;
+    return true;
+}
+
+size_t ASCSMqtt5Transport::putVarInt(uint8_t *out, size_t value) {
+    size_t n = 0;
+    do {
+        uint8_t b = value & 0x7F;
+        value >>= 7;
+        if (value > 0) b |= 0x80;
+        out[n++] = b;
+    } while (value > 0 && n < 4);
+    return n;
+}
+
+size_t ASCSMqtt5Transport::putUtf8(uint8_t *out, const char *str, size_t len) {
+    out[0] = (uint8_t)(len >> 8);
+    out[1] = (uint8_t)(len & 0xFF);
+    memcpy(out + 2, str, len);
+    return 2 + len;
+}
+
+#endif // ASCS_ROLE_GATEWAY
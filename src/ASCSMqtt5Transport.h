@@ -0,0 +1,99 @@
+#ifndef ASCS_MQTT5_TRANSPORT_H
+#define ASCS_MQTT5_TRANSPORT_H
+
+#include "interfaces/MqttTransport.h"
+#include "ASCSTopicCache.h" // For ASCS_MQTT_TOPIC_MAX_LEN
+
+class Client;
+
+// --- MQTT 5 Transport Constants ---
+
+#define ASCS_MQTT5_BUFFER_SIZE ASCS_MQTT_MAX_PACKET_SIZE // Max size of a single outgoing/incoming MQTT packet
+#define ASCS_MQTT5_MAX_TOPIC_ALIASES 32  // Client-side alias slots (capped by the broker's Topic Alias Maximum)
+#define ASCS_MQTT5_ALIAS_IDLE_MS 300000 // An alias slot can be reassigned once its topic is idle this long
+#define ASCS_MQTT5_KEEPALIVE_S 15        // Keep Alive sent in CONNECT (seconds)
+#define ASCS_MQTT5_CONNACK_TIMEOUT_MS 5000 // Max time to wait for CONNACK
+
+/**
+ * @brief Minimal MQTT 5 client (QoS 0 publish, subscribe callbacks, keepalive) over an Arduino Client.
+ *
+ * Compared to MQTT 3.1.1 it adds:
+ * - Topic Aliases: the first publish to a topic binds it to a 2-byte alias; later publishes
+ *   send an empty topic plus the alias. Topics are per (node, sensor), so each pair gets its own
+ *   alias. When all slots are in use, topics without a slot are sent in full until an
+ *   existing alias has been idle for ASCS_MQTT5_ALIAS_IDLE_MS; that slot is then rebound.
+ * - Message Expiry Interval: stale readings are discarded by the broker instead of being
+ *   delivered late to offline subscribers.
+ *
+ * Aliases are connection-scoped and are cleared on every (re)connect.
+ */
+class ASCSMqtt5Transport : public MqttTransport {
+public:
+    /**
+     * @param netClient Network client used for the broker connection (not owned).
+     */
+    explicit ASCSMqtt5Transport(Client &netClient);
+    virtual ~ASCSMqtt5Transport() = default;
+
+    void setServer(const char *host, uint16_t port) override;
+    void setCallback(MqttMessageCallback callback) override;
+    bool connect(const char *clientId, const char *user, const char *password) override;
+    bool connected() override;
+    void disconnect() override;
+    bool loop() override;
+    int state() override;
+    bool publish(const char *topic, const uint8_t *payload, size_t length, bool retain,
+                 const MqttPublishOptions &options) override;
+    const char *getProtocolName() const override { return "MQTT 5"; }
+
+    // Number of alias slots negotiated with the broker (0 if aliases are disabled by the broker).
+    uint16_t getTopicAliasMaximum() const { return m_aliasMax; }
+
+private:
+    // Connection state codes reported by state() (MQTT 5 CONNACK reason codes are >= 0x80 on failure)
+    enum : int {
+        STATE_CONNECTED = 0,
+        STATE_DISCONNECTED = -1,
+        STATE_CONNECT_FAILED = -2,
+        STATE_CONNECTION_TIMEOUT = -3,
+        STATE_PROTOCOL_ERROR = -4
+    };
+
+    struct AliasEntry {
+        uint16_t alias = 0; // 0 = slot unused
+        uint32_t hash = 0;  // FNV-1a of the topic, checked before the full compare
+        unsigned long lastUsed = 0; // millis() of last publish using this alias
+        char topic[ASCS_MQTT_TOPIC_MAX_LEN] = {0};
+    };
+
+    // Packet I/O helpers
+    bool writePacket(uint8_t type, size_t bodyLength); // Body must start at m_buffer + header reserve
+    bool readPacket(uint8_t &header, size_t &length, unsigned long timeoutMs);
+    bool readByte(uint8_t &out, unsigned long timeoutMs);
+    void handleIncoming(uint8_t header, size_t length);
+    bool parseConnack(size_t length);
+
+    // Topic alias management: returns the alias to use and whether the topic must be sent too.
+    uint16_t resolveAlias(const char *topic, bool &sendTopic);
+
+    static size_t putVarInt(uint8_t *out, size_t value);
+    static size_t putUtf8(uint8_t *out, const char *str, size_t len);
+
+    Client &m_netClient;
+    const char *m_host = nullptr;
+    uint16_t m_port = 1883;
+    MqttMessageCallback m_callback = nullptr;
+    int m_state = STATE_DISCONNECTED;
+
+    uint16_t m_keepAliveS = ASCS_MQTT5_KEEPALIVE_S;
+    uint16_t m_aliasMax = 0;          // Min(broker Topic Alias Maximum, local slots)
+    uint32_t m_maxPacketSize = ASCS_MQTT5_BUFFER_SIZE;
+    unsigned long m_lastOutbound = 0;
+    unsigned long m_lastInbound = 0;
+    bool m_pingOutstanding = false;
+
+    AliasEntry m_aliases[ASCS_MQTT5_MAX_TOPIC_ALIASES];
+    uint8_t m_buffer[ASCS_MQTT5_BUFFER_SIZE];
+};
+
+#endif // ASCS_MQTT5_TRANSPORT_H
@@ -0,0 +1,333 @@
+#include "ASCSMqttSink.h"
+
+#ifdef ASCS_ROLE_GATEWAY
+#include <WiFi.h>
+#include <ArduinoJson.h>           // For formatting MQTT payload as JSON
+#include "ASCSPubSubTransport.h"   // MQTT 3.1.1 transport (PubSubClient)
+#include "ASCSMqtt5Transport.h"    // MQTT 5 transport (topic aliases, message expiry)
+#include "ASCSTypedReadings.h"     // For typeOf/toInt
+
+// Sets a reading in a JSON object with its type: true/false, an integer, or a number.
+static void setJsonReading(JsonObject &readingsObj, const ASCSBatchRecord &record, const std::string &key, float value) {
+    switch (ASCSTypedReadings::typeOf(&record.types, key)) {
+        case ReadingType::BOOL: readingsObj[key] = value != 0.0f; break;
+        case ReadingType::INT: readingsObj[key] = ASCSTypedReadings::toInt(value); break;
+        default: readingsObj[key] = value; break;
+    }
+}
+
+ASCSMqttSink::ASCSMqttSink(const ASCSConfig &config, const MeshtasticAPI *api, MqttMessageCallback callback)
+    : m_config(config), m_api(api), m_callback(callback) {
+}
+
+ASCSMqttSink::~ASCSMqttSink() {
+    if (m_mqttClient) {
+        m_mqttClient->disconnect();
+        delete m_mqttClient;
+    }
+    delete m_wifiClient;
+}
+
+bool ASCSMqttSink::begin() {
+    // Allocate network clients
+    try {
+        m_wifiClient = new WiFiClient();
+        if (m_config.getMqttUseV5()) {
+            m_mqttClient = new ASCSMqtt5Transport(*m_wifiClient);
+        } else {
+            m_mqttClient = new ASCSPubSubTransport(*m_wifiClient);
+        }
+    } catch (const std::bad_alloc& e) {
+        Log.println(LOG_LEVEL_CRITICAL, "ASCSMqttSink: Failed to allocate memory for network clients!");
+        return false;
+    }
+
+    // Compile the topic template once; publishing then only fills in node/sensor/key.
+    if (!m_topicCache.compile(m_config.getMqttTopicTemplate(), m_config.getMqttBaseTopic(), m_config.getServiceId())) {
+        Log.printf(LOG_LEVEL_WARNING, "ASCSMqttSink: Invalid MQTT topic template '%s' (%s), using default.\n",
+                   m_config.getMqttTopicTemplate().c_str(), m_topicCache.getError().c_str());
+        m_topicCache.compile(ASCS_DEFAULT_MQTT_TOPIC_TEMPLATE, m_config.getMqttBaseTopic(), m_config.getServiceId());
+    }
+    m_batchTopic = m_config.getMqttBaseTopic() + "/batch/" + std::to_string(m_config.getServiceId());
+
+    m_mqttClient->setServer(m_config.getMqttServer().c_str(), m_config.getMqttPort());
+    m_mqttClient->setCallback(m_callback);
+    Log.printf(LOG_LEVEL_INFO, "ASCSMqttSink: Transport %s, broker %s:%d\n", m_mqttClient->getProtocolName(),
+               m_config.getMqttServer().c_str(), m_config.getMqttPort());
+    if (m_batcher.isEnabled()) {
+        Log.printf(LOG_LEVEL_INFO, "ASCSMqttSink: Batching up to %lu records per message on %s\n",
+                   (unsigned long)m_batcher.getMaxRecords(), m_batchTopic.c_str());
+    }
+    return true;
+}
+
+/**
+ * @brief Services the MQTT connection: keepalives when connected, periodic reconnects otherwise.
+ */
+void ASCSMqttSink::loop() {
+    if (!m_mqttClient) return;
+
+    if (m_mqttClient->connected()) {
+        m_mqttClient->loop(); // Let the MQTT client handle keepalives, incoming messages
+        return;
+    }
+
+    // Only attempt reconnection periodically based on configured interval
+    unsigned long now = millis();
+    if (m_lastReconnectAttempt == 0 || now - m_lastReconnectAttempt > m_config.getMqttReconnectIntervalMs()) {
+        connectMQTT(); // Updates m_lastReconnectAttempt
+    }
+}
+
+bool ASCSMqttSink::isReady() {
+    return m_mqttClient && m_mqttClient->connected();
+}
+
+/**
+ * @brief Connects to the MQTT broker using configured credentials. Non-blocking attempt.
+ */
+void ASCSMqttSink::connectMQTT() {
+    // Skip if WiFi is not available
+    if (WiFi.status() != WL_CONNECTED) {
+        Log.println(LOG_LEVEL_DEBUG, "ASCSMqttSink: Cannot connect MQTT, WiFi is down.");
+        return;
+    }
+
+    Log.printf(LOG_LEVEL_INFO, "ASCSMqttSink: Attempting MQTT connection to %s:%d...\n", m_config.getMqttServer().c_str(), m_config.getMqttPort());
+
+    // Create a unique client ID for this node
+    String clientId = "meshtastic-ascs-";
+    clientId += String(m_api->getMyNodeInfo()->node_num, HEX); // Use Meshtastic node ID
+
+    // Attempt connection with or without authentication based on config
+    const std::string &user = m_config.getMqttUser();
+    bool result;
+    if (!user.empty()) {
+        result = m_mqttClient->connect(clientId.c_str(), user.c_str(), m_config.getMqttPassword().c_str());
+    } else {
+        result = m_mqttClient->connect(clientId.c_str(), nullptr, nullptr);
+    }
+
+    if (result) {
+        Log.println(LOG_LEVEL_INFO, "ASCSMqttSink: MQTT connected.");
+        // Subscribe to any command topics if needed
+        // Example: m_mqttClient->subscribe("akita/smartcity/gateway/+/command");
+    } else {
+        // Log detailed error based on the transport's state code
+        Log.printf(LOG_LEVEL_ERROR, "ASCSMqttSink: MQTT connection failed, rc=%d. Check server, port, credentials, client ID, and MQTT buffer size. Will retry later.\n", m_mqttClient->state());
+    }
+    // Record the time of this attempt, regardless of success, for reconnection scheduling
+    m_lastReconnectAttempt = millis();
+}
+
+bool ASCSMqttSink::write(const std::vector<ASCSBatchRecord> &records) {
+    if (!isReady()) return false;
+    if (m_batcher.isEnabled()) {
+        return publishBatch(records);
+    }
+    for (const ASCSBatchRecord &record : records) {
+        if (!publishRecord(record)) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Builds the publish options for a reading.
+ * Message expiry counts from when the reading was taken, so replayed buffered data expires on time.
+ * @param timestampUtc Timestamp of the reading (0 if unknown).
+ */
+MqttPublishOptions ASCSMqttSink::makePublishOptions(uint32_t timestampUtc) const {
+    MqttPublishOptions options;
+    uint32_t expirySec = m_config.getMqttMessageExpirySec();
+    if (expirySec > 0) {
+        uint32_t nowUtc = m_api->getAdjustedTime();
+        uint32_t age = (timestampUtc > 0 && nowUtc > timestampUtc) ? nowUtc - timestampUtc : 0;
+        options.messageExpirySec = age < expirySec ? expirySec - age : 1; // Already stale: expire almost immediately
+    }
+    return options;
+}
+
+/**
+ * @brief Publishes one record.
+ * Builds the topic from the compiled template and the JSON payload.
+ * If the template ends in {key}, each reading is published to its own topic with a plain value payload.
+ * @param record The record to publish.
+ * @return True if the message was successfully published by the MQTT client, false otherwise.
+ */
+bool ASCSMqttSink::publishRecord(const ASCSBatchRecord &record) {
+    // --- Construct MQTT Topic ---
+    // The prefix for this (node, sensor_id) pair is usually served from the topic cache.
+    char topic[ASCS_MQTT_TOPIC_MAX_LEN];
+    size_t prefixLen;
+    if (!m_topicCache.buildPrefix(record.nodeId, record.sensorId.c_str(), topic, sizeof(topic), prefixLen)) {
+        Log.printf(LOG_LEVEL_ERROR, "ASCSMqttSink: MQTT topic for node 0x%lx exceeds %d bytes!\n", (unsigned long)record.nodeId, ASCS_MQTT_TOPIC_MAX_LEN);
+        return false;
+    }
+
+    MqttPublishOptions options = makePublishOptions(record.timestampUtc);
+
+    if (m_topicCache.hasKey()) {
+        // --- One topic per reading: <prefix><key> -> "<value>" ---
+        bool allPublished = true;
+        char valueStr[24];
+        for (const auto& reading : record.readings) {
+            if (!ASCSTopicCache::appendKey(topic, prefixLen, sizeof(topic), reading.first.c_str())) {
+                Log.printf(LOG_LEVEL_ERROR, "ASCSMqttSink: MQTT topic too long for key '%s'. Skipped.\n", reading.first.c_str());
+                allPublished = false;
+                continue;
+            }
+            int valueLen;
+            switch (ASCSTypedReadings::typeOf(&record.types, reading.first)) {
+                case ReadingType::BOOL:
+                    valueLen = snprintf(valueStr, sizeof(valueStr), "%s", reading.second != 0.0f ? "true" : "false");
+                    break;
+                case ReadingType::INT:
+                    valueLen = snprintf(valueStr, sizeof(valueStr), "%ld", (long)ASCSTypedReadings::toInt(reading.second));
+                    break;
+                default:
+                    valueLen = snprintf(valueStr, sizeof(valueStr), "%g", reading.second);
+                    break;
+            }
+            Log.printf(LOG_LEVEL_DEBUG, "ASCSMqttSink: Publishing to MQTT topic: %s = %s\n", topic, valueStr);
+            if (!m_mqttClient->publish(topic, reinterpret_cast<const uint8_t*>(valueStr), valueLen, false, options)) {
+                Log.println(LOG_LEVEL_ERROR, "ASCSMqttSink: MQTT publish failed! Check MQTT buffer size and connection state.");
+                return false; // Remaining readings would fail too; let the caller spill the record
+            }
+        }
+        return allPublished;
+    }
+
+    // --- Construct JSON Payload ---
+    char fromNodeHex[9]; // 8 hex chars + null terminator
+    ASCSTopicCache::formatNodeHex(record.nodeId, fromNodeHex);
+    fromNodeHex[8] = '\0';
+
+    // Estimate JSON size needed from the number of readings.
+    // Base fields + map object overhead + estimated size per map entry + safety buffer
+    const size_t base_size = JSON_OBJECT_SIZE(7); // node_id, sensor_id, timestamp, sequence, priority, interval, readings_obj
+    const size_t estimated_entry_size = 35;       // Avg key len + value representation + quotes, colon, comma
+    const size_t map_capacity = JSON_OBJECT_SIZE(record.readings.size()); // Map object overhead
+    const size_t jsonCapacity = base_size + map_capacity + (record.readings.size() * estimated_entry_size) + 150; // Add safety buffer
+    DynamicJsonDocument doc(jsonCapacity);
+
+    // Populate base fields
+    doc["node_id"] = fromNodeHex;
+    doc["sensor_id"] = record.sensorId; // Can be empty
+    doc["timestamp_utc"] = record.timestampUtc;
+    doc["sequence_num"] = record.sequenceNum;
+    if (record.priority > 0) doc["priority"] = record.priority; // Only for high/critical records
+    if (record.intervalMs > 0) doc["interval_ms"] = record.intervalMs; // Only from Sensors adapting their interval
+
+    // Create nested object for readings, mirroring the readings of the packet (booleans and integers typed)
+    JsonObject readingsObj = doc.createNestedObject("readings");
+    for (const auto& reading : record.readings) {
+        setJsonReading(readingsObj, record, reading.first, reading.second);
+    }
+
+    // Serialize JSON document to string
+    std::string payload;
+    size_t json_len = serializeJson(doc, payload);
+
+    // Check for serialization errors (e.g., buffer too small)
+    if (json_len == 0) {
+        Log.println(LOG_LEVEL_ERROR, "ASCSMqttSink: JSON serialization failed (payload empty)! Increase JSON document capacity?");
+        return false;
+    }
+    if (doc.overflowed()) {
+        Log.println(LOG_LEVEL_WARNING, "ASCSMqttSink: JSON document overflowed during serialization. Payload truncated.");
+        // Publish might still succeed but with incomplete data. Consider returning false.
+    }
+
+    Log.printf(LOG_LEVEL_INFO, "ASCSMqttSink: Publishing to MQTT topic: %s\n", topic);
+    Log.printf(LOG_LEVEL_DEBUG, "ASCSMqttSink: MQTT Payload (%d bytes): %s\n", (int)json_len, payload.c_str());
+
+    // --- Publish to MQTT ---
+    // feed_watchdog_placeholder(); // Feed before potentially blocking network operation
+    bool success = m_mqttClient->publish(topic, reinterpret_cast<const uint8_t*>(payload.data()), payload.length(),
+                                         false, options); // Retain=false for sensor data
+    // feed_watchdog_placeholder(); // Feed after potentially blocking network operation
+
+    if (!success) {
+        // Publish failed. Could be due to the transport's buffer size, network issue, etc.
+        Log.println(LOG_LEVEL_ERROR, "ASCSMqttSink: MQTT publish failed! Check MQTT buffer size and connection state.");
+    }
+    return success;
+}
+
+/**
+ * @brief Publishes several records as a single JSON message on the batch topic.
+ * Payload: {"gateway_id":"<hex>","count":N,"records":[{node_id, sensor_id, timestamp_utc, sequence_num, readings}, ...]}
+ * Each record keeps the same fields as a single-message payload, including its originating node.
+ * @param records The records to publish (at least one).
+ * @return True if the message was successfully published by the MQTT client, false otherwise.
+ */
+bool ASCSMqttSink::publishBatch(const std::vector<ASCSBatchRecord> &records) {
+    if (records.empty()) return true;
+
+    // --- Size the JSON document ---
+    // Slots for every object/array member, plus room for the copied strings (node IDs, sensor IDs, keys).
+    size_t totalReadings = 0;
+    size_t stringBytes = 9; // gateway_id
+    uint32_t newestTimestamp = 0;
+    for (const ASCSBatchRecord &record : records) {
+        totalReadings += record.readings.size();
+        stringBytes += 9 + record.sensorId.length() + 1;
+        for (const auto &reading : record.readings) {
+            stringBytes += reading.first.length() + 1;
+        }
+        if (record.timestampUtc > newestTimestamp) newestTimestamp = record.timestampUtc;
+    }
+    const size_t jsonCapacity = JSON_OBJECT_SIZE(3) + JSON_ARRAY_SIZE(records.size()) +
+                                records.size() * JSON_OBJECT_SIZE(7) + JSON_OBJECT_SIZE(totalReadings) +
+                                stringBytes + 64; // Safety margin
+    DynamicJsonDocument doc(jsonCapacity);
+
+    char nodeHex[9]; // 8 hex chars + null terminator
+    nodeHex[8] = '\0';
+    ASCSTopicCache::formatNodeHex(m_api->getMyNodeInfo()->node_num, nodeHex);
+    doc["gateway_id"] = nodeHex;
+    doc["count"] = records.size();
+    JsonArray recordsArr = doc.createNestedArray("records");
+
+    for (const ASCSBatchRecord &record : records) {
+        JsonObject recordObj = recordsArr.createNestedObject();
+        ASCSTopicCache::formatNodeHex(record.nodeId, nodeHex);
+        recordObj["node_id"] = nodeHex;
+        recordObj["sensor_id"] = record.sensorId;
+        recordObj["timestamp_utc"] = record.timestampUtc;
+        recordObj["sequence_num"] = record.sequenceNum;
+        if (record.priority > 0) recordObj["priority"] = record.priority;
+        if (record.intervalMs > 0) recordObj["interval_ms"] = record.intervalMs;
+        JsonObject readingsObj = recordObj.createNestedObject("readings");
+        for (const auto &reading : record.readings) {
+            setJsonReading(readingsObj, record, reading.first, reading.second);
+        }
+    }
+
+    if (doc.overflowed()) {
+        // Do not publish a partial batch; the caller spills the records instead.
+        Log.printf(LOG_LEVEL_ERROR, "ASCSMqttSink: JSON document overflowed for batch of %d records!\n", (int)records.size());
+        return false;
+    }
+
+    std::string payload;
+    size_t json_len = serializeJson(doc, payload);
+    if (json_len == 0) {
+        Log.println(LOG_LEVEL_ERROR, "ASCSMqttSink: JSON serialization failed for batch (payload empty)!");
+        return false;
+    }
+
+    // The batch stays deliverable as long as its newest reading is fresh.
+    MqttPublishOptions options = makePublishOptions(newestTimestamp);
+
+    Log.printf(LOG_LEVEL_INFO, "ASCSMqttSink: Publishing batch of %d records (%d bytes) to MQTT topic: %s\n",
+               (int)records.size(), (int)json_len, m_batchTopic.c_str());
+    bool success = m_mqttClient->publish(m_batchTopic.c_str(), reinterpret_cast<const uint8_t*>(payload.data()), payload.length(),
+                                         false, options); // Retain=false for sensor data
+    if (!success) {
+        Log.println(LOG_LEVEL_ERROR, "ASCSMqttSink: MQTT batch publish failed! Check MQTT buffer size and connection state.");
+    }
+    return success;
+}
+
+#endif // ASCS_ROLE_GATEWAY
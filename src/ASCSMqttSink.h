@@ -0,0 +1,63 @@
+#ifndef ASCS_MQTT_SINK_H
+#define ASCS_MQTT_SINK_H
+
+#include "meshtastic.h" // For MeshtasticAPI
+#include "interfaces/GatewaySink.h"
+#include "interfaces/MqttTransport.h"
+#include "ASCSTopicCache.h"
+#include "ASCSConfig.h"
+#include <string>
+
+class WiFiClient;
+
+// Spill file of the MQTT sink (framed SmartCityPackets, see AkitaSmartCityServices.h)
+#define ASCS_MQTT_SPILL_FILENAME "/ascs_buffer2.dat"
+
+/**
+ * @brief Gateway sink publishing records as JSON over MQTT (3.1.1 via PubSubClient, or MQTT 5).
+ *
+ * Without batching each record is published to the topic rendered from the 'mqtt_tpl' template
+ * (or one topic per reading if the template ends in {key}). With batching (mqtt_batch > 1)
+ * each batch is one JSON message on "<mqtt_topic>/batch/<service_id>".
+ * Owns the WiFi client and MQTT transport and handles MQTT reconnection.
+ */
+class ASCSMqttSink : public GatewaySink {
+public:
+    /**
+     * @param config Loaded configuration (must outlive the sink).
+     * @param api Meshtastic API, used for the node ID and the current time.
+     * @param callback Handler for incoming MQTT messages.
+     */
+    ASCSMqttSink(const ASCSConfig &config, const MeshtasticAPI *api, MqttMessageCallback callback);
+    virtual ~ASCSMqttSink();
+
+    const char *getSinkName() const override { return "mqtt"; }
+    bool begin() override;
+    void loop() override;
+    bool isReady() override;
+    bool write(const std::vector<ASCSBatchRecord> &records) override;
+    const char *getSpillFilename() const override { return ASCS_MQTT_SPILL_FILENAME; }
+
+    MqttTransport *getTransport() { return m_mqttClient; }
+
+private:
+    void connectMQTT();
+    // Publishes one record to its own topic(s). Returns true on success.
+    bool publishRecord(const ASCSBatchRecord &record);
+    // Publishes several records as one JSON array message on the batch topic. Returns true on success.
+    bool publishBatch(const std::vector<ASCSBatchRecord> &records);
+    // Publish options for a reading taken at 'timestampUtc' (message expiry counted from the reading).
+    MqttPublishOptions makePublishOptions(uint32_t timestampUtc) const;
+
+    const ASCSConfig &m_config;
+    const MeshtasticAPI *m_api;
+    MqttMessageCallback m_callback;
+
+    WiFiClient *m_wifiClient = nullptr;
+    MqttTransport *m_mqttClient = nullptr; // PubSubClient (MQTT 3.1.1) or built-in MQTT 5 client
+    ASCSTopicCache m_topicCache;           // Compiled topic template and per-(node, sensor_id) prefix cache
+    std::string m_batchTopic;              // "<base>/batch/<service_id>"
+    unsigned long m_lastReconnectAttempt = 0;
+};
+
+#endif // ASCS_MQTT_SINK_H
@@ -0,0 +1,90 @@
+#include "ASCSOutboundQueue.h"
+
+void ASCSOutboundQueue::configure(const ASCSLoRaModem &modem, uint32_t dutyPercent) {
+    m_modem = modem;
+    m_duty.configure(dutyPercent);
+}
+
+uint32_t ASCSOutboundQueue::airtimeMs(size_t bytes) const {
+    return ASCSLoRaAirtime::timeOnAirMs(m_modem, bytes + ASCS_LORA_MESH_OVERHEAD);
+}
+
+bool ASCSOutboundQueue::push(ASCSOutboundPacket &&packet, unsigned long now) {
+    size_t cls = (size_t)packet.priority;
+    if (m_packets.size() >= ASCS_OUTBOUND_QUEUE_MAX) {
+        // Make room by dropping the oldest packet of the lowest class, if lower than the new one
+        size_t victim = m_packets.size();
+        for (size_t i = 0; i < m_packets.size(); i++) {
+            if (m_packets[i].priority >= packet.priority) continue;
+            if (victim == m_packets.size() || m_packets[i].priority < m_packets[victim].priority) victim = i;
+        }
+        if (victim == m_packets.size()) {
+            m_stats.dropped[cls]++;
+            return false;
+        }
+        m_stats.dropped[(size_t)m_packets[victim].priority]++;
+        m_packets.erase(m_packets.begin() + victim);
+    }
+    packet.queuedAt = now;
+    packet.attempts = 0;
+    m_packets.push_back(std::move(packet));
+    m_stats.queued[cls]++;
+    if (m_packets.size() > m_stats.depthMax) m_stats.depthMax = (uint32_t)m_packets.size();
+    return true;
+}
+
+size_t ASCSOutboundQueue::headIndex() const {
+    size_t head = 0;
+    for (size_t i = 1; i < m_packets.size(); i++) {
+        if (m_packets[i].priority > m_packets[head].priority) head = i;
+    }
+    return head;
+}
+
+ASCSOutboundPacket *ASCSOutboundQueue::next(unsigned long now) {
+    if (m_packets.empty()) return nullptr;
+    ASCSOutboundPacket &head = m_packets[headIndex()];
+    if (head.attempts > 0 && (long)(now - head.retryAt) < 0) return nullptr;
+    // Critical packets do not wait for the packet on air (the radio queues them right behind it)
+    bool critical = head.priority == MessagePriority::CRITICAL;
+    if (!critical && (long)(now - m_onAirUntil) < 0) return nullptr;
+    if (!m_duty.allows(airtimeMs(head.data.size()), critical, now)) {
+        if (!m_deferring) m_stats.deferred++;
+        m_deferring = true;
+        return nullptr;
+    }
+    m_deferring = false;
+    return &head;
+}
+
+void ASCSOutboundQueue::onSent(unsigned long now) {
+    if (m_packets.empty()) return;
+    size_t head = headIndex();
+    ASCSOutboundPacket &packet = m_packets[head];
+    size_t cls = (size_t)packet.priority;
+    uint32_t waited = (uint32_t)(now - packet.queuedAt);
+    if (waited > m_stats.waitMaxMs[cls]) m_stats.waitMaxMs[cls] = waited;
+    m_stats.sent[cls]++;
+    // The radio sends it after anything still on air
+    uint32_t airtime = airtimeMs(packet.data.size());
+    unsigned long start = (long)(now - m_onAirUntil) < 0 ? m_onAirUntil : now;
+    m_onAirUntil = start + airtime;
+    m_duty.record(airtime, now);
+    m_stats.airtimeMs += airtime;
+    m_packets.erase(m_packets.begin() + head);
+}
+
+void ASCSOutboundQueue::onFailed(unsigned long now) {
+    if (m_packets.empty()) return;
+    size_t head = headIndex();
+    ASCSOutboundPacket &packet = m_packets[head];
+    if (++packet.attempts < ASCS_OUTBOUND_MAX_ATTEMPTS) {
+        // Radio queue full or busy: back off, longer after each failure
+        uint32_t backoff = ASCS_OUTBOUND_RETRY_BASE_MS << (packet.attempts - 1);
+        packet.retryAt = now + (backoff < ASCS_OUTBOUND_RETRY_MAX_MS ? backoff : ASCS_OUTBOUND_RETRY_MAX_MS);
+        m_stats.retries++;
+        return;
+    }
+    m_stats.failed[(size_t)packet.priority]++;
+    m_packets.erase(m_packets.begin() + head);
+}
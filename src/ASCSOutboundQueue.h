@@ -0,0 +1,124 @@
+#ifndef ASCS_OUTBOUND_QUEUE_H
+#define ASCS_OUTBOUND_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "interfaces/MessagePriority.h"
+#include "ASCSLoRaAirtime.h"
+#include "ASCSDutyCycle.h"
+
+// --- Outbound Queue Constants ---
+
+#define ASCS_OUTBOUND_QUEUE_MAX 16          // Encoded packets waiting for the radio (lowest class dropped first)
+#define ASCS_OUTBOUND_MAX_ATTEMPTS 5        // Hand-offs to the radio before a packet is given up
+#define ASCS_OUTBOUND_RETRY_BASE_MS 500     // Wait after the first failed hand-off, doubled after each further one ...
+#define ASCS_OUTBOUND_RETRY_MAX_MS 16000    // ... up to this
+#define ASCS_OUTBOUND_PRIORITY_CLASSES 3
+
+/**
+ * @brief Counters of the outbound queue, per priority class.
+ */
+struct ASCSOutboundStats {
+    uint32_t queued[ASCS_OUTBOUND_PRIORITY_CLASSES] = {};  // Packets accepted
+    uint32_t sent[ASCS_OUTBOUND_PRIORITY_CLASSES] = {};    // Handed to the radio
+    uint32_t dropped[ASCS_OUTBOUND_PRIORITY_CLASSES] = {}; // Pushed out by higher classes, or queue full
+    uint32_t failed[ASCS_OUTBOUND_PRIORITY_CLASSES] = {};  // Given up after ASCS_OUTBOUND_MAX_ATTEMPTS failed hand-offs
+    uint32_t waitMaxMs[ASCS_OUTBOUND_PRIORITY_CLASSES] = {}; // Longest time from queueing to hand-off
+    uint32_t retries = 0;    // Failed hand-offs retried later
+    uint32_t deferred = 0;   // Times the head packet was held back by the duty-cycle budget (once per wait)
+    uint32_t depthMax = 0;   // Most packets queued at once
+    uint64_t airtimeMs = 0;  // Estimated airtime of all packets handed over
+};
+
+/**
+ * @brief An encoded SmartCityPacket waiting to be sent.
+ */
+struct ASCSOutboundPacket {
+    uint32_t toNode = 0;
+    MessagePriority priority = MessagePriority::ROUTINE;
+    unsigned long queuedAt = 0;
+    uint8_t attempts = 0;
+    unsigned long retryAt = 0; // After a failed hand-off: not before this time
+    bool announces = false; // Carries our role and service ID (counts as a discovery announcement once sent)
+    std::vector<uint8_t> data;
+};
+
+/**
+ * @brief Priority-ordered queue between the plugin and the radio.
+ *
+ * Meshtastic's own transmit queue is first in, first out: a packet handed to it waits behind
+ * everything handed over before. So packets are held here and handed over one at a time, each
+ * when the previous one should be on air no more (time on air from the modem settings,
+ * ASCSLoRaAirtime); the radio queue then never holds more than about one packet, and the next
+ * one is picked by class (critical, high, routine), first in, first out within a class.
+ * Critical packets are handed over at once.
+ *
+ * A packet the radio does not take (its queue full) stays at the head and is retried with
+ * exponential backoff, up to ASCS_OUTBOUND_MAX_ATTEMPTS hand-offs. Packets are also held back
+ * while they would exceed the duty-cycle budget of the last hour (ASCSDutyCycle).
+ *
+ * When the queue is full, the oldest packet of the lowest class below the new one is dropped
+ * for it (a routine reading gives way to an alarm, never the reverse).
+ */
+class ASCSOutboundQueue {
+public:
+    ASCSOutboundQueue() = default;
+
+    /**
+     * @param modem Modem settings of the channel (for the time on air).
+     * @param dutyPercent Duty-cycle limit over the last hour, in percent (0 = no limit).
+     */
+    void configure(const ASCSLoRaModem &modem, uint32_t dutyPercent);
+
+    /**
+     * @brief Queues a packet (moved from).
+     * @return False if it was dropped (queue full of packets of its class or higher).
+     */
+    bool push(ASCSOutboundPacket &&packet, unsigned long now);
+
+    /**
+     * @brief The packet to hand to the radio now, or nullptr (queue empty, the head waiting to be retried
+     * or over the duty-cycle budget, or the last one still on air and the head not critical).
+     * Stays queued until onSent()/onFailed().
+     */
+    ASCSOutboundPacket *next(unsigned long now);
+
+    /**
+     * @brief The packet from next() was handed to the radio: removes it, and waits for its airtime.
+     */
+    void onSent(unsigned long now);
+
+    /**
+     * @brief The radio did not take the packet from next(): it is retried after a backoff, or dropped
+     * after ASCS_OUTBOUND_MAX_ATTEMPTS.
+     */
+    void onFailed(unsigned long now);
+
+    /**
+     * @brief Time on air of a packet of 'bytes' encoded bytes (with the Meshtastic overhead).
+     */
+    uint32_t airtimeMs(size_t bytes) const;
+
+    /**
+     * @brief Airtime handed to the radio within the last hour.
+     */
+    uint32_t getAirtimeLastHourMs(unsigned long now) { return m_duty.usedMs(now); }
+    uint32_t getDutyBudgetMs() const { return m_duty.getBudgetMs(); }
+
+    size_t size() const { return m_packets.size(); }
+    bool empty() const { return m_packets.empty(); }
+    const ASCSOutboundStats &getStats() const { return m_stats; }
+
+private:
+    size_t headIndex() const; // Highest class, oldest first
+
+    std::vector<ASCSOutboundPacket> m_packets; // In queueing order
+    unsigned long m_onAirUntil = 0;            // Estimated end of the last packet handed over
+    ASCSLoRaModem m_modem;
+    ASCSDutyCycle m_duty;
+    bool m_deferring = false;                  // The head is held back by the duty cycle (counted once per wait)
+    ASCSOutboundStats m_stats;
+};
+
+#endif // ASCS_OUTBOUND_QUEUE_H
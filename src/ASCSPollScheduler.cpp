@@ -0,0 +1,138 @@
+#include "ASCSPollScheduler.h"
+
+void ASCSPollScheduler::configure(uint32_t intervalMs, uint32_t batchMax, uint32_t airtimePct) {
+    m_intervalMs = intervalMs;
+    m_batchMax = batchMax < 1 ? 1 : (batchMax > ASCS_POLL_MAX_BATCH ? ASCS_POLL_MAX_BATCH : batchMax);
+    m_airtimePct = airtimePct > 100 ? 100 : airtimePct;
+    m_nodes.clear();
+    m_nodes.reserve(ASCS_POLL_MAX_NODES);
+    m_cursor = 0;
+    m_tokensMs = 2 * batchCost(m_batchMax); // Start with a full bucket
+    m_deferring = false;
+    m_answersUntil = 0;
+}
+
+void ASCSPollScheduler::addNode(uint32_t nodeId, unsigned long now) {
+    for (PolledNode &node : m_nodes) {
+        if (node.nodeId == nodeId) {
+            node.lastSeen = now;
+            return;
+        }
+    }
+    if (m_nodes.size() >= ASCS_POLL_MAX_NODES) {
+        size_t oldest = 0;
+        for (size_t i = 1; i < m_nodes.size(); i++) {
+            if ((long)(m_nodes[i].lastSeen - m_nodes[oldest].lastSeen) < 0) oldest = i;
+        }
+        if (m_nodes[oldest].awaiting) m_stats.missed++;
+        m_nodes.erase(m_nodes.begin() + oldest);
+        if (m_cursor > oldest) m_cursor--;
+    }
+    m_nodes.push_back({nodeId, now, now, now, now, false, false});
+}
+
+void ASCSPollScheduler::removeNode(uint32_t nodeId) {
+    for (size_t i = 0; i < m_nodes.size(); i++) {
+        if (m_nodes[i].nodeId != nodeId) continue;
+        m_nodes.erase(m_nodes.begin() + i);
+        if (m_cursor > i) m_cursor--;
+        return;
+    }
+}
+
+void ASCSPollScheduler::expire(unsigned long now, uint32_t timeoutMs) {
+    for (size_t i = m_nodes.size(); i-- > 0;) {
+        if (now - m_nodes[i].lastSeen <= timeoutMs) continue;
+        if (m_nodes[i].awaiting) m_stats.missed++;
+        m_nodes.erase(m_nodes.begin() + i);
+        if (m_cursor > i) m_cursor--;
+    }
+}
+
+uint32_t ASCSPollScheduler::batchCost(size_t count) const {
+    return ASCS_POLL_REQUEST_AIRTIME_MS + (uint32_t)count * ASCS_POLL_REPLY_AIRTIME_MS;
+}
+
+void ASCSPollScheduler::refill(unsigned long now) {
+    unsigned long elapsed = now - m_lastRefill;
+    m_lastRefill = now;
+    uint32_t capacity = 2 * batchCost(m_batchMax);
+    uint64_t added = (uint64_t)elapsed * m_airtimePct / 100;
+    if (m_airtimePct == 0 || added >= capacity - m_tokensMs) {
+        m_tokensMs = capacity; // No limit, or idle long enough to fill the bucket
+    } else {
+        m_tokensMs += (uint32_t)added;
+    }
+}
+
+size_t ASCSPollScheduler::nextBatch(unsigned long now, uint32_t *nodes) {
+    if (!isEnabled() || m_nodes.empty()) return 0;
+    if ((long)(now - m_answersUntil) < 0) return 0; // Our own request would collide with the answers to the last one
+
+    // Due sensors, and how long the longest-waiting one has been due
+    size_t due = 0;
+    unsigned long longestWait = 0;
+    for (const PolledNode &node : m_nodes) {
+        long overdue = (long)(now - node.dueAt);
+        if (overdue < 0) continue;
+        due++;
+        if ((unsigned long)overdue > longestWait) longestWait = (unsigned long)overdue;
+    }
+    if (due == 0) return 0;
+    if (due < m_batchMax && longestWait < ASCS_POLL_BATCH_WAIT_MS) return 0; // Wait for a fuller batch
+
+    size_t count = due < m_batchMax ? due : m_batchMax;
+    refill(now);
+    if (m_tokensMs < batchCost(count)) {
+        if (!m_deferring) m_stats.deferred++;
+        m_deferring = true;
+        return 0;
+    }
+    m_deferring = false;
+    m_tokensMs -= batchCost(count);
+
+    // Round-robin from the cursor, so no sensor is starved when more are due than fit
+    size_t taken = 0;
+    size_t index = m_cursor % m_nodes.size();
+    for (size_t checked = 0; checked < m_nodes.size() && taken < count; checked++) {
+        PolledNode &node = m_nodes[index];
+        index = (index + 1) % m_nodes.size();
+        if ((long)(now - node.dueAt) < 0) continue;
+        if (node.awaiting) m_stats.missed++; // Last poll never answered
+        m_stats.waitSumMs += now - node.dueAt;
+        node.lastPoll = now;
+        node.dueAt = now + m_intervalMs;
+        node.awaiting = true;
+        nodes[taken++] = node.nodeId;
+    }
+    m_cursor = index;
+    m_answersUntil = now + ASCS_POLL_REQUEST_AIRTIME_MS + (uint32_t)taken * ASCS_POLL_REPLY_SPACING_MS;
+    m_stats.requests++;
+    m_stats.polls += (uint32_t)taken;
+    return taken;
+}
+
+bool ASCSPollScheduler::onReply(uint32_t nodeId, unsigned long now) {
+    for (PolledNode &node : m_nodes) {
+        if (node.nodeId != nodeId) continue;
+        node.lastSeen = now;
+        if (!node.awaiting) return false; // Sent on its own (not polled recently)
+        uint32_t latency = (uint32_t)(now - node.lastPoll);
+        node.awaiting = false;
+        node.replied = true;
+        node.lastReply = now;
+        m_stats.replies++;
+        m_stats.latencySumMs += latency;
+        if (latency > m_stats.latencyMaxMs) m_stats.latencyMaxMs = latency;
+        return true;
+    }
+    return false;
+}
+
+size_t ASCSPollScheduler::getCoveredCount(unsigned long now) const {
+    size_t covered = 0;
+    for (const PolledNode &node : m_nodes) {
+        if (node.replied && now - node.lastReply <= 2UL * m_intervalMs) covered++;
+    }
+    return covered;
+}
@@ -0,0 +1,122 @@
+#ifndef ASCS_POLL_SCHEDULER_H
+#define ASCS_POLL_SCHEDULER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// --- Poll Mode Constants ---
+
+#define ASCS_POLL_MAX_NODES 128           // Polled sensors tracked by a gateway (least recently seen is evicted)
+#define ASCS_POLL_MAX_BATCH 8             // Sensors named in one PollRequest (max_count in SmartCity.options)
+#define ASCS_POLL_BATCH_WAIT_MS 10000     // A due sensor waits up to this long for others to fill a batch
+#define ASCS_POLL_REPLY_SPACING_MS 1500   // Delay between the answers of consecutive sensors of one request
+#define ASCS_POLL_REQUEST_AIRTIME_MS 400  // Estimated airtime of a PollRequest (for the airtime budget)
+#define ASCS_POLL_REPLY_AIRTIME_MS 700    // Estimated airtime of an answer (SensorData, default preset)
+#define ASCS_POLL_FALLBACK_INTERVALS 3    // Sensors send on their own after this many poll intervals without a poll
+
+/**
+ * @brief Counters of the gateway poll scheduler (published as gateway metrics).
+ */
+struct ASCSPollStats {
+    uint32_t requests = 0;      // PollRequests sent
+    uint32_t polls = 0;         // Sensors named in them
+    uint32_t replies = 0;       // Polls answered
+    uint32_t missed = 0;        // Polls still unanswered when the sensor was polled again or forgotten
+    uint32_t deferred = 0;      // Batches held back because the airtime budget was used up
+    uint64_t waitSumMs = 0;     // Sum of time from a sensor being due to its poll (batching, budget)
+    uint64_t latencySumMs = 0;  // Sum of time from a poll to its answer
+    uint32_t latencyMaxMs = 0;
+};
+
+/**
+ * @brief Gateway schedule for Sensors in poll mode (`poll_mode`).
+ *
+ * Each known sensor is due once per poll interval. Due sensors are taken round-robin, so a
+ * sensor is not starved when not all due ones fit in a batch, and named together in one
+ * PollRequest. A batch is sent when it is full or its oldest sensor has waited
+ * ASCS_POLL_BATCH_WAIT_MS for more to become due, and not before the answers to the previous
+ * request are in (the gateway cannot receive while it transmits).
+ *
+ * Polls and their expected answers are paid from an airtime budget (a token bucket in ms of
+ * airtime, refilled at 'airtimePct' of the elapsed time), so a large district cannot take more
+ * than its share of the channel: sensors are then polled less often than the interval, which
+ * shows in the wait statistics.
+ */
+class ASCSPollScheduler {
+public:
+    ASCSPollScheduler() = default;
+
+    /**
+     * @param intervalMs Poll interval per sensor (0 disables polling).
+     * @param batchMax Max sensors per request (1 .. ASCS_POLL_MAX_BATCH).
+     * @param airtimePct Share of channel time (percent) for requests and answers (0 = no limit).
+     */
+    void configure(uint32_t intervalMs, uint32_t batchMax, uint32_t airtimePct);
+
+    bool isEnabled() const { return m_intervalMs > 0; }
+    uint32_t getInterval() const { return m_intervalMs; }
+
+    /**
+     * @brief A sensor in poll mode announced itself. Adds it (due now) or refreshes it.
+     */
+    void addNode(uint32_t nodeId, unsigned long now);
+
+    /**
+     * @brief Stops polling a sensor (e.g., it sends to another gateway now).
+     */
+    void removeNode(uint32_t nodeId);
+
+    /**
+     * @brief Forgets sensors neither heard nor answering for 'timeoutMs'.
+     */
+    void expire(unsigned long now, uint32_t timeoutMs);
+
+    /**
+     * @brief Takes the next batch of sensors to poll, if one should be sent now.
+     * @param nodes Filled with up to ASCS_POLL_MAX_BATCH node IDs.
+     * @return Number of sensors to name in a PollRequest now (0 = nothing to send).
+     */
+    size_t nextBatch(unsigned long now, uint32_t *nodes);
+
+    /**
+     * @brief SensorData arrived from 'nodeId'.
+     * @return True if it answers a poll.
+     */
+    bool onReply(uint32_t nodeId, unsigned long now);
+
+    /**
+     * @brief Sensors that answered a poll within the last two intervals.
+     */
+    size_t getCoveredCount(unsigned long now) const;
+
+    size_t getNodeCount() const { return m_nodes.size(); }
+    const ASCSPollStats &getStats() const { return m_stats; }
+
+private:
+    struct PolledNode {
+        uint32_t nodeId;
+        unsigned long lastSeen;  // Last announcement or answer
+        unsigned long dueAt;     // Next poll due
+        unsigned long lastPoll;
+        unsigned long lastReply;
+        bool awaiting;           // Polled, answer not received yet
+        bool replied;            // Answered at least once
+    };
+
+    void refill(unsigned long now);
+    uint32_t batchCost(size_t count) const;
+
+    uint32_t m_intervalMs = 0;
+    uint32_t m_batchMax = 1;
+    uint32_t m_airtimePct = 0;
+    std::vector<PolledNode> m_nodes;
+    size_t m_cursor = 0;        // Round-robin position: the next batch starts here
+    uint32_t m_tokensMs = 0;    // Airtime budget left
+    unsigned long m_lastRefill = 0;
+    bool m_deferring = false;   // The last batch was held back (counted once per wait)
+    unsigned long m_answersUntil = 0; // End of the answer window of the last request
+    ASCSPollStats m_stats;
+};
+
+#endif // ASCS_POLL_SCHEDULER_H
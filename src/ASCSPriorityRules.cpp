@@ -0,0 +1,40 @@
+#include "ASCSPriorityRules.h"
+#include "ASCSConfigList.h"
+
+void ASCSPriorityRules::configure(const std::string &rules) {
+    m_rules.clear();
+
+    // The comma-separated "prefix:class" list
+    for (const std::string &entry : ASCSConfigList::split(rules)) {
+        std::string prefix, level;
+        if (!ASCSConfigList::splitPair(entry, prefix, level)) continue;
+        MessagePriority priority = MessagePriority::ROUTINE;
+        if (level.find("critical") != std::string::npos) {
+            priority = MessagePriority::CRITICAL;
+        } else if (level.find("high") != std::string::npos) {
+            priority = MessagePriority::HIGH;
+        }
+        m_rules.push_back({prefix, priority});
+    }
+}
+
+MessagePriority ASCSPriorityRules::classify(const std::map<std::string, float> &readings, MessagePriority base /*= ROUTINE*/) const {
+    MessagePriority priority = base;
+    for (const auto &reading : readings) {
+        if (reading.second == 0.0f) continue; // Contact closed, alarm cleared
+        for (const Rule &rule : m_rules) {
+            if (rule.priority > priority && reading.first.compare(0, rule.prefix.length(), rule.prefix) == 0) {
+                priority = rule.priority;
+            }
+        }
+    }
+    return priority;
+}
+
+const char *ASCSPriorityRules::name(MessagePriority priority) {
+    switch (priority) {
+        case MessagePriority::CRITICAL: return "critical";
+        case MessagePriority::HIGH: return "high";
+        default: return "routine";
+    }
+}
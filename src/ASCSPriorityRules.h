@@ -0,0 +1,39 @@
+#ifndef ASCS_PRIORITY_RULES_H
+#define ASCS_PRIORITY_RULES_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "interfaces/MessagePriority.h"
+
+/**
+ * @brief Priority of sensor readings from their keys (`prio_keys`).
+ *
+ * Rules are comma-separated "prefix:class" entries, class one of "critical", "high" or "routine"
+ * (e.g., "alarm:critical,door_open:critical,flood:critical,battery_low:high"). A reading whose
+ * key starts with a prefix and whose value is non-zero (alarm contacts report 1.0 when active)
+ * raises the priority of its packet to that class.
+ */
+class ASCSPriorityRules {
+public:
+    ASCSPriorityRules() = default;
+
+    void configure(const std::string &rules);
+
+    /**
+     * @brief Highest class of any rule matching an active reading, at least 'base'.
+     */
+    MessagePriority classify(const std::map<std::string, float> &readings, MessagePriority base = MessagePriority::ROUTINE) const;
+
+    static const char *name(MessagePriority priority);
+
+private:
+    struct Rule {
+        std::string prefix;
+        MessagePriority priority;
+    };
+
+    std::vector<Rule> m_rules;
+};
+
+#endif // ASCS_PRIORITY_RULES_H
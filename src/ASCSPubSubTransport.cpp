@@ -0,0 +1,59 @@
+#include "ASCSPubSubTransport.h"
+
+#ifdef ASCS_ROLE_GATEWAY
+#include <PubSubClient.h>
+#include <string.h>
+
+ASCSPubSubTransport::ASCSPubSubTransport(Client &netClient) {
+    m_client = new PubSubClient(netClient);
+    // PubSubClient defaults to 256 bytes, too small for JSON payloads with several readings or batches
+    m_client->setBufferSize(ASCS_MQTT_MAX_PACKET_SIZE);
+}
+
+ASCSPubSubTransport::~ASCSPubSubTransport() {
+    delete m_client;
+}
+
+void ASCSPubSubTransport::setServer(const char *host, uint16_t port) {
+    m_client->setServer(host, port);
+}
+
+void ASCSPubSubTransport::setCallback(MqttMessageCallback callback) {
+    m_client->setCallback(callback);
+}
+
+bool ASCSPubSubTransport::connect(const char *clientId, const char *user, const char *password) {
+    if (user) {
+        return m_client->connect(clientId, user, password);
+    }
+    return m_client->connect(clientId);
+}
+
+bool ASCSPubSubTransport::connected() {
+    return m_client->connected();
+}
+
+void ASCSPubSubTransport::disconnect() {
+    m_client->disconnect();
+}
+
+bool ASCSPubSubTransport::loop() {
+    return m_client->loop();
+}
+
+int ASCSPubSubTransport::state() {
+    return m_client->state();
+}
+
+bool ASCSPubSubTransport::publish(const char *topic, const uint8_t *payload, size_t length, bool retain,
+                                  const MqttPublishOptions & /*options*/) {
+    if (!m_client->publish(topic, payload, length, retain)) {
+        return false;
+    }
+    // Fixed header + remaining length + topic length prefix + topic + payload (QoS 0, no packet ID)
+    size_t remaining = 2 + strlen(topic) + length;
+    recordPublish(1 + varIntSize(remaining) + remaining);
+    return true;
+}
+
+#endif // ASCS_ROLE_GATEWAY
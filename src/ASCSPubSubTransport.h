@@ -0,0 +1,36 @@
+#ifndef ASCS_PUBSUB_TRANSPORT_H
+#define ASCS_PUBSUB_TRANSPORT_H
+
+#include "interfaces/MqttTransport.h"
+
+class Client;
+class PubSubClient;
+
+/**
+ * @brief MQTT 3.1.1 transport backed by the PubSubClient library.
+ * Topic aliases and message expiry are not available in 3.1.1 and are ignored.
+ */
+class ASCSPubSubTransport : public MqttTransport {
+public:
+    /**
+     * @param netClient Network client used for the broker connection (not owned).
+     */
+    explicit ASCSPubSubTransport(Client &netClient);
+    virtual ~ASCSPubSubTransport();
+
+    void setServer(const char *host, uint16_t port) override;
+    void setCallback(MqttMessageCallback callback) override;
+    bool connect(const char *clientId, const char *user, const char *password) override;
+    bool connected() override;
+    void disconnect() override;
+    bool loop() override;
+    int state() override;
+    bool publish(const char *topic, const uint8_t *payload, size_t length, bool retain,
+                 const MqttPublishOptions &options) override;
+    const char *getProtocolName() const override { return "MQTT 3.1.1"; }
+
+private:
+    PubSubClient *m_client = nullptr;
+};
+
+#endif // ASCS_PUBSUB_TRANSPORT_H
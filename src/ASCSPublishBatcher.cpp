@@ -0,0 +1,60 @@
+#include "ASCSPublishBatcher.h"
+
+#include <string.h>
+
+void ASCSBatchRecord::toSensorData(SensorData &sensorData) const {
+    strncpy(sensorData.sensor_id, sensorId.c_str(), sizeof(sensorData.sensor_id) - 1);
+    sensorData.sensor_id[sizeof(sensorData.sensor_id) - 1] = '\0';
+    sensorData.timestamp_utc = timestampUtc;
+    sensorData.sequence_num = sequenceNum;
+    sensorData.priority = priority;
+    sensorData.interval_ms = intervalMs;
+}
+
+void ASCSPublishBatcher::configure(uint32_t maxRecords, uint32_t windowMs) {
+    m_maxRecords = maxRecords > ASCS_BATCH_MAX_RECORDS_LIMIT ? ASCS_BATCH_MAX_RECORDS_LIMIT : maxRecords;
+    m_windowMs = windowMs;
+    clear();
+    if (isEnabled()) {
+        m_records.reserve(m_maxRecords);
+    }
+}
+
+bool ASCSPublishBatcher::add(ASCSBatchRecord &&record, unsigned long now) {
+    size_t recordBytes = estimateRecordBytes(record);
+    if (!m_records.empty() && m_estimatedBytes + recordBytes > ASCS_BATCH_MAX_PAYLOAD_BYTES) {
+        return false; // Close the current batch first
+    }
+    if (m_records.empty()) {
+        m_openedAt = now;
+        m_estimatedBytes = ASCS_BATCH_ENVELOPE_BYTES;
+    }
+    m_records.push_back(std::move(record));
+    m_estimatedBytes += recordBytes;
+    return true;
+}
+
+bool ASCSPublishBatcher::isFull() const {
+    return m_records.size() >= m_maxRecords || m_estimatedBytes >= ASCS_BATCH_MAX_PAYLOAD_BYTES;
+}
+
+bool ASCSPublishBatcher::isDue(unsigned long now) const {
+    if (m_records.empty()) return false;
+    return isFull() || now - m_openedAt >= m_windowMs;
+}
+
+void ASCSPublishBatcher::clear() {
+    m_records.clear();
+    m_estimatedBytes = 0;
+}
+
+size_t ASCSPublishBatcher::estimateRecordBytes(const ASCSBatchRecord &record) {
+    // {"node_id":"xxxxxxxx","sensor_id":"","timestamp_utc":4294967295,"sequence_num":4294967295,"readings":{}},
+    size_t bytes = 105 + record.sensorId.length();
+    if (record.priority) bytes += 15;   // "priority":255,
+    if (record.intervalMs) bytes += 25; // "interval_ms":4294967295,
+    for (const auto &reading : record.readings) {
+        bytes += reading.first.length() + 19; // "key": + up to 15 chars of float (e.g. -1.23456789e-38) + comma
+    }
+    return bytes;
+}
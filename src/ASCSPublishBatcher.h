@@ -0,0 +1,115 @@
+#ifndef ASCS_PUBLISH_BATCHER_H
+#define ASCS_PUBLISH_BATCHER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "generated_proto/SmartCity.pb.h" // For SensorData
+#include "interfaces/ReadingType.h"
+
+// --- Publish Batcher Constants ---
+
+#define ASCS_BATCH_MAX_RECORDS_LIMIT 64 // Upper bound for the configured records per batch
+#define ASCS_BATCH_MAX_PAYLOAD_BYTES 3840 // Max estimated serialized size of one batch (fits ASCS_MQTT_MAX_PACKET_SIZE with topic and headers)
+#define ASCS_BATCH_ENVELOPE_BYTES 64      // {"gateway_id":"xxxxxxxx","count":NN,"records":[]} around the records
+
+/**
+ * @brief One SensorData record queued for a batch, with its originating node.
+ * Owns copies of everything it needs, so records outlive the packet they came from.
+ */
+struct ASCSBatchRecord {
+    uint32_t nodeId = 0;
+    std::string sensorId;
+    uint32_t timestampUtc = 0;
+    uint32_t sequenceNum = 0;
+    uint8_t priority = 0; // MessagePriority of the packet (critical records skip batches and rate limits)
+    uint32_t intervalMs = 0; // Adaptive read interval of the Sensor (0 = not adapting)
+    std::map<std::string, float> readings;
+    ReadingTypes types; // Readings sent as booleans or integers
+
+    /**
+     * @brief Fills a SensorData struct with the scalar fields of this record.
+     * The readings fields are left untouched (the caller arms the map callbacks).
+     */
+    void toSensorData(SensorData &sensorData) const;
+};
+
+/**
+ * @brief Collects SensorData records on the gateway until a batch is full or its window expires.
+ *
+ * A batch is closed when any of these limits is reached:
+ * - the configured record count,
+ * - the configured window (measured from the first record of the batch),
+ * - ASCS_BATCH_MAX_PAYLOAD_BYTES of estimated serialized payload.
+ *
+ * The batcher only stores records and decides when to flush; the owner serializes and
+ * publishes them and then calls clear().
+ */
+class ASCSPublishBatcher {
+public:
+    ASCSPublishBatcher() = default;
+
+    /**
+     * @brief Sets the batch limits. Clears any pending records.
+     * @param maxRecords Max records per batch (0 or 1 disables batching; capped at ASCS_BATCH_MAX_RECORDS_LIMIT).
+     * @param windowMs Max time (ms) the first record of a batch waits before the batch is due.
+     */
+    void configure(uint32_t maxRecords, uint32_t windowMs);
+
+    /**
+     * @brief Whether batching is enabled (more than one record per batch).
+     */
+    bool isEnabled() const { return m_maxRecords > 1; }
+
+    uint32_t getMaxRecords() const { return m_maxRecords; }
+
+    /**
+     * @brief Adds a record to the open batch.
+     * @param record The record to add (moved from).
+     * @param now Current millis(), used to start the window on the first record.
+     * @return False if the batch is non-empty and the record would exceed the payload limit;
+     *         the caller should flush and add it again. A record is always accepted into an empty batch.
+     */
+    bool add(ASCSBatchRecord &&record, unsigned long now);
+
+    /**
+     * @brief Whether the open batch reached its record count or payload limit.
+     */
+    bool isFull() const;
+
+    /**
+     * @brief Whether the open batch should be flushed now (full, or window elapsed).
+     */
+    bool isDue(unsigned long now) const;
+
+    bool empty() const { return m_records.empty(); }
+    size_t size() const { return m_records.size(); }
+    const std::vector<ASCSBatchRecord> &records() const { return m_records; }
+
+    /**
+     * @brief Estimated serialized size of the open batch in bytes, including the envelope (upper bound).
+     */
+    size_t getEstimatedBytes() const { return m_estimatedBytes; }
+
+    /**
+     * @brief Discards the open batch. Call after it has been published or buffered.
+     */
+    void clear();
+
+    /**
+     * @brief Upper-bound estimate of the serialized JSON size of one record.
+     * Assumes worst-case number formatting, so a batch accepted by add() always fits the packet buffer.
+     */
+    static size_t estimateRecordBytes(const ASCSBatchRecord &record);
+
+private:
+    std::vector<ASCSBatchRecord> m_records;
+    uint32_t m_maxRecords = 0;
+    uint32_t m_windowMs = 0;
+    size_t m_estimatedBytes = 0;
+    unsigned long m_openedAt = 0; // millis() when the first record of the open batch was added
+};
+
+#endif // ASCS_PUBLISH_BATCHER_H
@@ -0,0 +1,104 @@
+#include "ASCSRateLimiter.h"
+#include "ASCSConfigList.h"
+
+void ASCSRateLimiter::configure(uint32_t ratePerMin, uint32_t burst, const std::string &exemptPrefixes) {
+    m_ratePerMin = ratePerMin;
+    m_burst = burst > 0 ? burst : 1;
+    m_nodes.clear();
+    m_pendingCount = 0;
+
+    m_exemptPrefixes = ASCSConfigList::split(exemptPrefixes);
+}
+
+bool ASCSRateLimiter::isExempt(const ASCSBatchRecord &record) const {
+    if (record.priority >= (uint8_t)MessagePriority::CRITICAL) return true;
+    for (const auto &reading : record.readings) {
+        for (const std::string &prefix : m_exemptPrefixes) {
+            if (reading.first.compare(0, prefix.length(), prefix) == 0) return true;
+        }
+    }
+    return false;
+}
+
+void ASCSRateLimiter::refill(NodeBucket &bucket, unsigned long now) const {
+    unsigned long elapsed = now - bucket.lastRefill;
+    bucket.lastRefill = now;
+    bucket.tokens += (float)elapsed * (float)m_ratePerMin / 60000.0f;
+    if (bucket.tokens > (float)m_burst) bucket.tokens = (float)m_burst;
+}
+
+ASCSRateLimiter::NodeBucket &ASCSRateLimiter::getBucket(uint32_t nodeId, unsigned long now) {
+    auto it = m_nodes.find(nodeId);
+    if (it != m_nodes.end()) return it->second;
+
+    if (m_nodes.size() >= ASCS_RATE_MAX_NODES) {
+        // Evict the least recently seen node (its held records are lost)
+        auto oldest = m_nodes.begin();
+        for (auto candidate = m_nodes.begin(); candidate != m_nodes.end(); ++candidate) {
+            if (now - candidate->second.lastSeen > now - oldest->second.lastSeen) oldest = candidate;
+        }
+        m_stats.dropped += oldest->second.pending.size();
+        m_pendingCount -= oldest->second.pending.size();
+        m_nodes.erase(oldest);
+    }
+
+    NodeBucket &bucket = m_nodes[nodeId];
+    bucket.tokens = (float)m_burst; // New nodes start with a full bucket
+    bucket.lastRefill = now;
+    bucket.lastSeen = now;
+    return bucket;
+}
+
+bool ASCSRateLimiter::admit(ASCSBatchRecord &record, unsigned long now) {
+    if (!isEnabled()) return true;
+
+    if (isExempt(record)) {
+        m_stats.exempt++;
+        return true;
+    }
+
+    NodeBucket &bucket = getBucket(record.nodeId, now);
+    bucket.lastSeen = now;
+    refill(bucket, now);
+
+    // Within budget, and nothing older from this node still waiting
+    if (bucket.pending.empty() && bucket.tokens >= 1.0f) {
+        bucket.tokens -= 1.0f;
+        m_stats.admitted++;
+        return true;
+    }
+
+    // Over budget: keep only the latest value per sensor
+    m_stats.rateLimited++;
+    auto held = bucket.pending.find(record.sensorId);
+    if (held != bucket.pending.end()) {
+        held->second = std::move(record);
+        m_stats.coalesced++;
+        return false;
+    }
+    if (bucket.pending.size() >= ASCS_RATE_MAX_PENDING_PER_NODE) {
+        m_stats.dropped++;
+        return false;
+    }
+    std::string key = record.sensorId;
+    bucket.pending.emplace(std::move(key), std::move(record));
+    m_pendingCount++;
+    return false;
+}
+
+void ASCSRateLimiter::releaseReady(unsigned long now, std::vector<ASCSBatchRecord> &out) {
+    for (auto &node : m_nodes) {
+        NodeBucket &bucket = node.second;
+        if (bucket.pending.empty()) continue;
+
+        refill(bucket, now);
+        while (!bucket.pending.empty() && bucket.tokens >= 1.0f) {
+            auto first = bucket.pending.begin();
+            out.push_back(std::move(first->second));
+            bucket.pending.erase(first);
+            bucket.tokens -= 1.0f;
+            m_pendingCount--;
+            m_stats.released++;
+        }
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef ASCS_RATE_LIMITER_H
+#define ASCS_RATE_LIMITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "ASCSPublishBatcher.h" // For ASCSBatchRecord
+#include "interfaces/MessagePriority.h"
+
+// --- Rate Limiter Constants ---
+
+#define ASCS_RATE_MAX_NODES 64            // Max origin nodes tracked at once (least recently seen is evicted)
+#define ASCS_RATE_MAX_PENDING_PER_NODE 8  // Max distinct sensor IDs held per node while over budget
+
+/**
+ * @brief Counters of the gateway rate limiter (published as gateway metrics).
+ */
+struct ASCSRateLimiterStats {
+    uint32_t admitted = 0;    // Records passed through immediately (within budget)
+    uint32_t exempt = 0;      // Records passed through because they carry an exempt (alarm) key
+    uint32_t rateLimited = 0; // Records that arrived over budget and were held
+    uint32_t coalesced = 0;   // Held records replaced by a newer value of the same sensor (older value dropped)
+    uint32_t released = 0;    // Held records passed on once tokens were available again
+    uint32_t dropped = 0;     // Held records lost (pending limit reached or node evicted)
+};
+
+/**
+ * @brief Per-origin-node token buckets for the gateway output path.
+ *
+ * Each origin node gets 'burst' tokens, refilled at 'ratePerMin' tokens per minute; every
+ * record passed on costs one token. While a node is over budget, only its latest record per
+ * sensor ID is kept and released once tokens are available again, so a misconfigured node
+ * cannot crowd out the uplink (or the spill files) of all other nodes.
+ *
+ * Records with a reading key starting with one of the exempt prefixes (e.g., "alarm"), or sent
+ * as critical, are always passed through and do not use tokens.
+ */
+class ASCSRateLimiter {
+public:
+    ASCSRateLimiter() = default;
+
+    /**
+     * @brief Sets the limits. Clears all tracked nodes and held records.
+     * @param ratePerMin Tokens added per minute per node (0 disables rate limiting).
+     * @param burst Bucket depth (records a node may send back-to-back). At least 1.
+     * @param exemptPrefixes Comma-separated reading key prefixes that bypass the limiter.
+     */
+    void configure(uint32_t ratePerMin, uint32_t burst, const std::string &exemptPrefixes);
+
+    bool isEnabled() const { return m_ratePerMin > 0; }
+
+    /**
+     * @brief Offers a record received from 'record.nodeId'.
+     * @param record The record; moved from if it is held.
+     * @param now Current millis().
+     * @return True if the caller should pass the record on now. False if it was held
+     *         (released later by releaseReady()) or dropped.
+     */
+    bool admit(ASCSBatchRecord &record, unsigned long now);
+
+    /**
+     * @brief Whether any node has held records waiting for tokens.
+     */
+    bool hasPending() const { return m_pendingCount > 0; }
+
+    /**
+     * @brief Moves held records of nodes that have tokens again into 'out' (one token each).
+     * @param now Current millis().
+     * @param out Released records are appended here.
+     */
+    void releaseReady(unsigned long now, std::vector<ASCSBatchRecord> &out);
+
+    const ASCSRateLimiterStats &getStats() const { return m_stats; }
+    size_t getTrackedNodes() const { return m_nodes.size(); }
+    size_t getPendingCount() const { return m_pendingCount; }
+
+    /**
+     * @brief Whether the record carries a reading whose key starts with an exempt prefix.
+     */
+    bool isExempt(const ASCSBatchRecord &record) const;
+
+private:
+    struct NodeBucket {
+        float tokens = 0;
+        unsigned long lastRefill = 0;
+        unsigned long lastSeen = 0;
+        std::map<std::string, ASCSBatchRecord> pending; // Latest held record per sensor ID
+    };
+
+    void refill(NodeBucket &bucket, unsigned long now) const;
+    // Returns the bucket of 'nodeId', creating it (full) and evicting the least recently seen node if needed.
+    NodeBucket &getBucket(uint32_t nodeId, unsigned long now);
+
+    uint32_t m_ratePerMin = 0;
+    uint32_t m_burst = 1;
+    std::vector<std::string> m_exemptPrefixes;
+    std::map<uint32_t, NodeBucket> m_nodes;
+    size_t m_pendingCount = 0; // Held records across all nodes
+    ASCSRateLimiterStats m_stats;
+};
+
+#endif // ASCS_RATE_LIMITER_H
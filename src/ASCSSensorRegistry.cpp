@@ -0,0 +1,192 @@
+#include "ASCSSensorRegistry.h"
+#include "ASCSSyncSensorAdapter.h"
+#include <exception>
+
+bool ASCSSensorRegistry::add(std::unique_ptr<AsyncSensorInterface> sensor, uint32_t intervalMs, uint32_t phaseMs, uint32_t windowMs /*= 0*/) {
+    if (!sensor || m_sensors.size() >= ASCS_SENSOR_MAX_SENSORS) return false;
+    m_sensors.push_back({std::move(sensor), intervalMs, phaseMs, intervalMs, 0, windowMs, 0, ASCSWindowStats()});
+    return true;
+}
+
+bool ASCSSensorRegistry::add(std::unique_ptr<SensorInterface> sensor, uint32_t intervalMs, uint32_t phaseMs, uint32_t windowMs /*= 0*/) {
+    if (!sensor) return false;
+    return add(std::unique_ptr<AsyncSensorInterface>(new ASCSSyncSensorAdapter(std::move(sensor))), intervalMs, phaseMs, windowMs);
+}
+
+void ASCSSensorRegistry::schedule(unsigned long anchor, uint32_t defaultIntervalMs) {
+    for (Entry &entry : m_sensors) {
+        entry.intervalMs = entry.configuredIntervalMs ? entry.configuredIntervalMs : defaultIntervalMs;
+        if (entry.intervalMs == 0) entry.intervalMs = 1; // Misconfigured: read every loop rather than never
+        entry.nextDue = anchor + entry.phaseMs;
+        entry.windowStart = entry.nextDue; // First window starts with the first sample
+    }
+}
+
+void ASCSSensorRegistry::setDefaultInterval(uint32_t defaultIntervalMs) {
+    if (defaultIntervalMs == 0) defaultIntervalMs = 1;
+    for (Entry &entry : m_sensors) {
+        if (entry.configuredIntervalMs) continue;
+        unsigned long lastDue = entry.nextDue - entry.intervalMs;
+        entry.intervalMs = defaultIntervalMs;
+        entry.nextDue = lastDue + defaultIntervalMs;
+    }
+}
+
+bool ASCSSensorRegistry::takeDue(unsigned long now, uint32_t mergeWindowMs, std::vector<size_t> &due) {
+    due.clear();
+    bool anyDue = false;
+    for (const Entry &entry : m_sensors) {
+        if ((long)(now - entry.nextDue) >= 0) anyDue = true;
+    }
+    if (!anyDue) return false;
+
+    for (size_t i = 0; i < m_sensors.size(); i++) {
+        Entry &entry = m_sensors[i];
+        if ((long)(now + mergeWindowMs - entry.nextDue) < 0) continue;
+        due.push_back(i);
+        // Next reading on the sensor's own schedule (skipping any missed while the node was busy)
+        do {
+            entry.nextDue += entry.intervalMs;
+        } while ((long)(now - entry.nextDue) >= 0);
+    }
+    m_stats.rounds++;
+    m_stats.reads += (uint32_t)due.size();
+    return true;
+}
+
+void ASCSSensorRegistry::takeAll(std::vector<size_t> &due) {
+    due.clear();
+    for (size_t i = 0; i < m_sensors.size(); i++) due.push_back(i);
+    m_stats.rounds++;
+    m_stats.reads += (uint32_t)due.size();
+}
+
+void ASCSSensorRegistry::startRound(const std::vector<size_t> &sensors, unsigned long now, bool flush /*= false*/) {
+    m_round.clear();
+    m_roundActive = true;
+    m_roundFlush = flush;
+    m_roundStart = now;
+    for (size_t index : sensors) {
+        m_round.push_back({index, SensorReadStatus::PENDING, false, {}});
+        bool started = false;
+        try {
+            started = m_sensors[index].sensor->startRead();
+        } catch (...) {
+            started = false; // A throwing driver only fails its own read
+        }
+        if (!started) m_round.back().status = SensorReadStatus::FAILED;
+    }
+}
+
+bool ASCSSensorRegistry::pollRound(unsigned long now, std::vector<ASCSSensorResult> &results, std::vector<size_t> &failed) {
+    if (!m_roundActive) return false;
+
+    bool pending = false;
+    for (RoundRead &read : m_round) {
+        if (read.status != SensorReadStatus::PENDING) continue;
+        AsyncSensorInterface &sensor = *m_sensors[read.index].sensor;
+        try {
+            read.status = sensor.pollRead(read.readings);
+        } catch (...) {
+            read.status = SensorReadStatus::FAILED;
+        }
+        if (read.status == SensorReadStatus::PENDING) {
+            if (now - m_roundStart < sensor.getReadTimeoutMs()) {
+                pending = true;
+            } else {
+                read.status = SensorReadStatus::FAILED; // Give up, so one hung sensor does not hold back the others
+                read.timedOut = true;
+            }
+        }
+    }
+    if (pending) return false;
+
+    // All reads finished: hand over the results in round order
+    results.clear();
+    failed.clear();
+    for (RoundRead &read : m_round) {
+        Entry &entry = m_sensors[read.index];
+        if (read.status == SensorReadStatus::DONE && entry.windowMs > 0) {
+            // Windowed: the sample only updates the statistics, until the next one would fall outside the window
+            entry.stats.add(read.readings);
+            bool windowEnds = (long)(now + entry.intervalMs - entry.windowStart) >= (long)entry.windowMs;
+            if (!windowEnds && !m_roundFlush) continue;
+            if (entry.stats.getCount() == 0) continue;
+            if (m_roundFlush) {
+                entry.windowStart = now + entry.intervalMs; // Next window starts with the next sample
+            } else {
+                do {
+                    entry.windowStart += entry.windowMs; // Stay on the window grid
+                } while ((long)(now + entry.intervalMs - entry.windowStart) >= (long)entry.windowMs);
+            }
+            entry.stats.summarize(m_summaryOutputs, read.readings);
+            m_stats.summaries++;
+        }
+        if (read.status == SensorReadStatus::DONE) {
+            ASCSSensorResult result;
+            result.sensorId = entry.sensor->getSensorId();
+            result.priority = entry.sensor->getPriority(read.readings);
+            for (const auto &reading : read.readings) {
+                ReadingType type = entry.sensor->getReadingType(reading.first);
+                if (type != ReadingType::FLOAT) result.types[reading.first] = type;
+            }
+            result.readings = std::move(read.readings);
+            results.push_back(std::move(result));
+        } else {
+            failed.push_back(read.index);
+            if (read.timedOut) {
+                m_stats.timeouts++;
+            } else {
+                m_stats.failed++;
+            }
+        }
+    }
+    m_round.clear();
+    m_roundActive = false;
+    uint32_t roundMs = (uint32_t)(now - m_roundStart);
+    if (roundMs > m_stats.roundMaxMs) m_stats.roundMaxMs = roundMs;
+    return true;
+}
+
+size_t ASCSSensorRegistry::readingsSize(const std::map<std::string, float> &readings, size_t keyPrefix,
+                                        const ReadingTypes *types /*= nullptr*/) {
+    return ASCSTypedReadings::encodedSize(readings, types, keyPrefix);
+}
+
+// Both maps of a packet (values and types) are combined and split the same way
+template <typename Value>
+static void combineKeys(const std::string &sensorId, const std::map<std::string, Value> &values, std::map<std::string, Value> &combined) {
+    for (const auto &value : values) {
+        combined[sensorId + ASCS_COMBINED_KEY_SEPARATOR + value.first] = value.second;
+    }
+}
+
+template <typename Value>
+static void splitKeys(const std::map<std::string, Value> &combined, std::map<std::string, std::map<std::string, Value>> &perSensor) {
+    for (const auto &value : combined) {
+        size_t separator = value.first.rfind(ASCS_COMBINED_KEY_SEPARATOR);
+        if (separator == std::string::npos) {
+            perSensor[""][value.first] = value.second;
+        } else {
+            perSensor[value.first.substr(0, separator)][value.first.substr(separator + 1)] = value.second;
+        }
+    }
+}
+
+void ASCSSensorRegistry::combine(const std::string &sensorId, const std::map<std::string, float> &readings,
+                                 std::map<std::string, float> &combined) {
+    combineKeys(sensorId, readings, combined);
+}
+
+void ASCSSensorRegistry::combine(const std::string &sensorId, const ReadingTypes &types, ReadingTypes &combined) {
+    combineKeys(sensorId, types, combined);
+}
+
+void ASCSSensorRegistry::split(const std::map<std::string, float> &combined,
+                               std::map<std::string, std::map<std::string, float>> &perSensor) {
+    splitKeys(combined, perSensor);
+}
+
+void ASCSSensorRegistry::split(const ReadingTypes &combined, std::map<std::string, ReadingTypes> &perSensor) {
+    splitKeys(combined, perSensor);
+}
@@ -0,0 +1,197 @@
+#ifndef ASCS_SENSOR_REGISTRY_H
+#define ASCS_SENSOR_REGISTRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "interfaces/SensorInterface.h"
+#include "interfaces/AsyncSensorInterface.h"
+#include "ASCSWindowStats.h"
+#include "ASCSTypedReadings.h"
+
+// --- Sensor Registry Constants ---
+
+#define ASCS_SENSOR_MAX_SENSORS 8          // Sensors one node can hold
+#define ASCS_COMBINED_SENSOR_ID "+"        // sensor_id of a packet combining several sensors
+#define ASCS_COMBINED_KEY_SEPARATOR '/'    // Combined packets key readings as "<sensor_id>/<key>"
+#define ASCS_SENSOR_PACKET_BUDGET 180      // Max estimated encoded bytes of readings per packet (rest goes in another)
+
+/**
+ * @brief Counters of the sensor registry (logged with the service table cleanup).
+ */
+struct ASCSSensorRegistryStats {
+    uint32_t rounds = 0; // Times one or more sensors were due and read together
+    uint32_t reads = 0;  // Sensor reads (several per round when schedules line up)
+    uint32_t failed = 0; // Reads that failed (startRead()/pollRead() failure or exception)
+    uint32_t timeouts = 0; // Reads still pending after the sensor's read timeout
+    uint32_t roundMaxMs = 0; // Longest round, from starting the reads to the last one done
+    uint32_t summaries = 0; // Window summaries handed over (sensors with a summary window)
+};
+
+/**
+ * @brief Readings of one sensor, as read in a round.
+ */
+struct ASCSSensorResult {
+    std::string sensorId;
+    std::map<std::string, float> readings;
+    ReadingTypes types;  // Keys the sensor sends as BOOL or INT (getReadingType())
+    MessagePriority priority = MessagePriority::ROUTINE; // As reported by the sensor (getPriority())
+};
+
+/**
+ * @brief The sensors attached to one node, each read on its own schedule.
+ *
+ * Each sensor has an interval and a phase: it is first due at anchor + phase (schedule()),
+ * then every interval. Due times advance by the interval, not from the time of the read, so
+ * loop latency does not accumulate and sensors whose intervals are multiples of each other stay
+ * lined up.
+ *
+ * takeDue() returns every sensor that is due, plus those due within a merge window: these are
+ * read early, so their readings go out in the same packet instead of a packet each. Their due
+ * times stay on their own schedule.
+ *
+ * The sensors of a round are read asynchronously (AsyncSensorInterface): startRound() starts
+ * every read, pollRound() checks the pending ones on each loop() and returns the results once all
+ * are done, failed or timed out. Synchronous sensors are wrapped in ASCSSyncSensorAdapter.
+ *
+ * A sensor with a summary window is sampled every interval, but its samples only go into
+ * running statistics (ASCSWindowStats); once per window they are handed over as derived keys
+ * ("<key>_mean", "<key>_max", ...), so the sample rate is independent of the report rate.
+ *
+ * A packet with readings of several sensors has sensor_id ASCS_COMBINED_SENSOR_ID and keys
+ * "<sensor_id>/<key>" (combine()); the gateway splits it into one record per sensor (split()).
+ * Reading keys should therefore not contain the separator.
+ */
+class ASCSSensorRegistry {
+public:
+    ASCSSensorRegistry() = default;
+
+    /**
+     * @param sensor The sensor (ownership is taken).
+     * @param intervalMs Read interval (0 = the default interval given to schedule()).
+     * @param phaseMs Offset of the first reading after the anchor.
+     * @param windowMs Summary window: readings are summarized over it instead of handed over
+     *                 one by one (0 = every reading).
+     * @return False if the sensor is null or the registry is full.
+     */
+    bool add(std::unique_ptr<AsyncSensorInterface> sensor, uint32_t intervalMs, uint32_t phaseMs, uint32_t windowMs = 0);
+
+    /**
+     * @brief Adds a synchronous sensor (wrapped in ASCSSyncSensorAdapter).
+     */
+    bool add(std::unique_ptr<SensorInterface> sensor, uint32_t intervalMs, uint32_t phaseMs, uint32_t windowMs = 0);
+
+    /**
+     * @brief Derived keys of window summaries (ASCS_STATS_* flags).
+     */
+    void setSummaryOutputs(uint8_t outputs) { m_summaryOutputs = outputs; }
+
+    void clear() {
+        m_sensors.clear();
+        m_round.clear();
+    }
+    bool empty() const { return m_sensors.empty(); }
+    size_t size() const { return m_sensors.size(); }
+
+    /**
+     * @brief (Re)starts all schedules: each sensor is first due at anchor + its phase.
+     * @param defaultIntervalMs Interval of sensors added with interval 0 (e.g., `read_int`).
+     */
+    void schedule(unsigned long anchor, uint32_t defaultIntervalMs);
+
+    /**
+     * @brief Changes the interval of the sensors added with interval 0 (adaptive `read_int`).
+     * Their next reading is due the new interval after their last one.
+     */
+    void setDefaultInterval(uint32_t defaultIntervalMs);
+
+    /**
+     * @brief Takes the sensors to read now.
+     * @param now Current millis().
+     * @param mergeWindowMs Sensors due within this time are read now too (0 = only those due).
+     * @param due Filled with the indexes of the sensors to read.
+     * @return True if any sensor is due.
+     */
+    bool takeDue(unsigned long now, uint32_t mergeWindowMs, std::vector<size_t> &due);
+
+    /**
+     * @brief Takes all sensors (e.g., to answer a poll). Schedules are not changed.
+     */
+    void takeAll(std::vector<size_t> &due);
+
+    /**
+     * @brief Starts reading the given sensors (a round already in progress is abandoned).
+     * @param sensors Indexes from takeDue()/takeAll().
+     * @param flush Hand over the summaries of windowed sensors so far (e.g., answering a poll).
+     */
+    void startRound(const std::vector<size_t> &sensors, unsigned long now, bool flush = false);
+
+    /**
+     * @brief Whether a round was started and not all of its reads are finished yet.
+     */
+    bool isReading() const { return m_roundActive; }
+
+    /**
+     * @brief Polls the pending reads of the round.
+     * @param results Filled with the readings of the sensors read successfully, in round order,
+     *                once the round is finished (windowed sensors only when their window ends).
+     * @param failed Filled with the indexes of the sensors whose read failed or timed out.
+     * @return True when the round just finished (results are valid), false while reads are pending.
+     */
+    bool pollRound(unsigned long now, std::vector<ASCSSensorResult> &results, std::vector<size_t> &failed);
+
+    /**
+     * @brief Encoded size of readings in SensorData, with keys 'keyPrefix' bytes longer (ASCSTypedReadings::encodedSize()).
+     */
+    static size_t readingsSize(const std::map<std::string, float> &readings, size_t keyPrefix, const ReadingTypes *types = nullptr);
+
+    /**
+     * @brief Adds a sensor's readings to a combined packet's map, keyed "<sensorId>/<key>".
+     */
+    static void combine(const std::string &sensorId, const std::map<std::string, float> &readings,
+                        std::map<std::string, float> &combined);
+    static void combine(const std::string &sensorId, const ReadingTypes &types, ReadingTypes &combined);
+
+    /**
+     * @brief Splits a combined packet's readings back per sensor (at the last separator of each key).
+     * Keys without a separator are kept under an empty sensor ID.
+     */
+    static void split(const std::map<std::string, float> &combined, std::map<std::string, std::map<std::string, float>> &perSensor);
+    static void split(const ReadingTypes &combined, std::map<std::string, ReadingTypes> &perSensor);
+
+    AsyncSensorInterface &getSensor(size_t index) { return *m_sensors[index].sensor; }
+    uint32_t getInterval(size_t index) const { return m_sensors[index].intervalMs; }
+    const ASCSSensorRegistryStats &getStats() const { return m_stats; }
+
+private:
+    struct Entry {
+        std::unique_ptr<AsyncSensorInterface> sensor;
+        uint32_t configuredIntervalMs; // As added (0 = default)
+        uint32_t phaseMs;
+        uint32_t intervalMs;           // In effect
+        unsigned long nextDue;
+        uint32_t windowMs;             // Summary window (0 = every reading)
+        unsigned long windowStart;
+        ASCSWindowStats stats;
+    };
+
+    struct RoundRead {
+        size_t index;
+        SensorReadStatus status;
+        bool timedOut;
+        std::map<std::string, float> readings;
+    };
+
+    std::vector<Entry> m_sensors;
+    std::vector<RoundRead> m_round; // Reads of the current round, in start order
+    bool m_roundActive = false;
+    bool m_roundFlush = false;
+    uint8_t m_summaryOutputs = ASCS_STATS_MEAN | ASCS_STATS_MAX;
+    unsigned long m_roundStart = 0;
+    ASCSSensorRegistryStats m_stats;
+};
+
+#endif // ASCS_SENSOR_REGISTRY_H
@@ -0,0 +1,111 @@
+#include "ASCSServiceSnapshot.h"
+
+namespace {
+
+void putU32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+uint32_t getU32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+int8_t clampInt8(float v) {
+    if (v < -128.0f) return -128;
+    if (v > 127.0f) return 127;
+    return (int8_t)(v < 0 ? v - 0.5f : v + 0.5f);
+}
+
+// Visits the entries a snapshot holds: routing roles, most recently seen first, up to the max.
+template <typename F>
+void forEachSnapshotEntry(const ASCSServiceTable &table, F visit) {
+    size_t count = 0;
+    table.forEach([&](const ASCSServiceEntry &entry) {
+        if (count >= ASCS_SERVICE_SNAPSHOT_MAX_ENTRIES || !ASCSServiceTable::isRoutingRole(entry.role)) return;
+        visit(entry);
+        count++;
+    });
+}
+
+} // namespace
+
+size_t ASCSServiceSnapshot::encode(const ASCSServiceTable &table, unsigned long now, uint8_t *buffer, size_t size) {
+    if (size < ASCS_SERVICE_SNAPSHOT_HEADER_SIZE) return 0;
+    size_t count = 0;
+    uint8_t *p = buffer + ASCS_SERVICE_SNAPSHOT_HEADER_SIZE;
+    forEachSnapshotEntry(table, [&](const ASCSServiceEntry &entry) {
+        if ((size_t)(p - buffer) + ASCS_SERVICE_SNAPSHOT_RECORD_SIZE > size) return;
+        unsigned long ageS = (now - entry.lastSeen) / 1000;
+        if (ageS > 0xFFFF) ageS = 0xFFFF;
+        float hops = entry.link.hops * 16.0f;
+        putU32(p, entry.nodeId);
+        putU32(p + 4, entry.serviceId);
+        p[8] = (uint8_t)ageS;
+        p[9] = (uint8_t)(ageS >> 8);
+        p[10] = (uint8_t)entry.role;
+        p[11] = (uint8_t)(entry.link.samples > 0xFF ? 0xFF : entry.link.samples);
+        p[12] = (uint8_t)clampInt8(entry.link.rssi);
+        p[13] = (uint8_t)clampInt8(entry.link.snr * 4.0f);
+        p[14] = (uint8_t)(hops > 255.0f ? 255 : (uint8_t)(hops + 0.5f));
+        uint32_t capacity = entry.capacity > 0xFFFF ? 0xFFFF : entry.capacity;
+        p[15] = (uint8_t)capacity;
+        p[16] = (uint8_t)(capacity >> 8);
+        p += ASCS_SERVICE_SNAPSHOT_RECORD_SIZE;
+        count++;
+    });
+    buffer[0] = ASCS_SERVICE_SNAPSHOT_VERSION;
+    buffer[1] = (uint8_t)count;
+    return (size_t)(p - buffer);
+}
+
+size_t ASCSServiceSnapshot::decode(const uint8_t *buffer, size_t length, ASCSServiceTable &table, unsigned long now, uint32_t timeoutMs) {
+    if (length < ASCS_SERVICE_SNAPSHOT_HEADER_SIZE || buffer[0] != ASCS_SERVICE_SNAPSHOT_VERSION) return 0;
+    size_t count = buffer[1];
+    if (length < ASCS_SERVICE_SNAPSHOT_HEADER_SIZE + count * ASCS_SERVICE_SNAPSHOT_RECORD_SIZE) return 0;
+
+    // Records are most recently seen first; restore oldest first to rebuild the recency order
+    size_t restored = 0;
+    for (size_t i = count; i-- > 0;) {
+        const uint8_t *p = buffer + ASCS_SERVICE_SNAPSHOT_HEADER_SIZE + i * ASCS_SERVICE_SNAPSHOT_RECORD_SIZE;
+        uint32_t ageMs = ((uint32_t)p[8] | ((uint32_t)p[9] << 8)) * 1000;
+        if (ageMs < timeoutMs / 2) ageMs = timeoutMs / 2; // Downtime unknown: at least half expired
+        if (ageMs > timeoutMs) continue;
+
+        ASCSServiceEntry entry;
+        entry.nodeId = getU32(p);
+        entry.serviceId = getU32(p + 4);
+        entry.role = (ServiceDiscovery_Role)p[10];
+        if (!ASCSServiceTable::isRoutingRole(entry.role)) continue;
+        entry.lastSeen = now - ageMs;
+        entry.link.samples = p[11];
+        entry.link.rssi = (int8_t)p[12];
+        entry.link.snr = (int8_t)p[13] / 4.0f;
+        entry.link.hops = p[14] / 16.0f;
+        entry.capacity = (uint32_t)p[15] | ((uint32_t)p[16] << 8);
+        if (entry.link.samples > 0) {
+            entry.link.cost = ASCSLinkStats::expectedTransmissions(entry.link.rssi, entry.link.snr, entry.link.hops);
+        }
+        table.restore(entry);
+        restored++;
+    }
+    return restored;
+}
+
+uint32_t ASCSServiceSnapshot::signature(const ASCSServiceTable &table) {
+    // Sum of per-entry FNV-1a hashes: independent of the recency order, which changes all the time
+    auto fnv = [](uint32_t hash, uint32_t v) {
+        for (int i = 0; i < 4; i++) {
+            hash ^= (uint8_t)(v >> (8 * i));
+            hash *= 16777619u;
+        }
+        return hash;
+    };
+    uint32_t sum = 0;
+    forEachSnapshotEntry(table, [&](const ASCSServiceEntry &entry) {
+        sum += fnv(fnv(fnv(fnv(2166136261u, entry.nodeId), (uint32_t)entry.role), entry.serviceId), entry.capacity);
+    });
+    return fnv(sum, table.getBestGateway());
+}
@@ -0,0 +1,55 @@
+#ifndef ASCS_SERVICE_SNAPSHOT_H
+#define ASCS_SERVICE_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ASCSServiceTable.h"
+
+// --- Service Table Snapshot Constants ---
+
+#define ASCS_SERVICE_SNAPSHOT_NAMESPACE "ascs_svc"      // Preferences namespace (separate from the config)
+#define ASCS_SERVICE_SNAPSHOT_KEY "table"
+#define ASCS_SERVICE_SNAPSHOT_VERSION 2 // 2: gateway capacity added
+#define ASCS_SERVICE_SNAPSHOT_MAX_ENTRIES 32            // Gateways/Aggregators kept, most recently seen first
+#define ASCS_SERVICE_SNAPSHOT_HEADER_SIZE 2             // Version, entry count
+#define ASCS_SERVICE_SNAPSHOT_RECORD_SIZE 17
+#define ASCS_SERVICE_SNAPSHOT_MAX_SIZE (ASCS_SERVICE_SNAPSHOT_HEADER_SIZE + ASCS_SERVICE_SNAPSHOT_MAX_ENTRIES * ASCS_SERVICE_SNAPSHOT_RECORD_SIZE)
+#define ASCS_SERVICE_SNAPSHOT_CHECK_INTERVAL_MS 60000   // How often the table is compared with the last snapshot
+
+/**
+ * @brief Compact binary snapshot of the routing part of the service table (Gateways and
+ * Aggregators), so a node restarted by a watchdog reset or firmware update does not start
+ * with an empty routing view.
+ *
+ * Layout (little-endian): version (1), count (1), then per entry: node ID (4), service ID (4),
+ * age in seconds (2), role (1), link samples (1, capped), RSSI dBm (1, signed),
+ * SNR in 1/4 dB (1, signed), average hops in 1/16 (1), advertised capacity (2, capped).
+ * Snapshots of another version are ignored.
+ *
+ * The time a node was off is unknown (there may be no valid clock), so restored entries are
+ * treated as at least half expired: a gateway that is still there is heard again well before
+ * they time out, one that has gone away is dropped within half the service timeout.
+ */
+class ASCSServiceSnapshot {
+public:
+    /**
+     * @brief Writes the Gateways and Aggregators of 'table' to 'buffer'.
+     * @param size Buffer size, ASCS_SERVICE_SNAPSHOT_MAX_SIZE is always enough.
+     * @return Bytes written.
+     */
+    static size_t encode(const ASCSServiceTable &table, unsigned long now, uint8_t *buffer, size_t size);
+
+    /**
+     * @brief Adds the entries of a snapshot to 'table', skipping those that would have timed out.
+     * @return Number of entries restored (0 if the snapshot is invalid or of another version).
+     */
+    static size_t decode(const uint8_t *buffer, size_t length, ASCSServiceTable &table, unsigned long now, uint32_t timeoutMs);
+
+    /**
+     * @brief Hash of what encode() stores, apart from ages and link metrics (plus the best
+     * gateway): the snapshot only needs rewriting when it changes, which limits flash wear.
+     */
+    static uint32_t signature(const ASCSServiceTable &table);
+};
+
+#endif // ASCS_SERVICE_SNAPSHOT_H
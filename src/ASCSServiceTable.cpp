@@ -0,0 +1,307 @@
+#include "ASCSServiceTable.h"
+
+#include <math.h>
+
+ASCSServiceTable::ASCSServiceTable(size_t capacity) {
+    if (capacity == 0) capacity = 1;
+    if (capacity >= ASCS_SERVICE_TABLE_NIL) capacity = ASCS_SERVICE_TABLE_NIL - 1;
+
+    size_t slots = 2;
+    m_hashShift = 31;
+    while (slots < capacity * 2) { // Keep the load factor at or below 50%
+        slots <<= 1;
+        m_hashShift--;
+    }
+    m_entries.resize(capacity);
+    m_slots.resize(slots);
+    m_slotMask = slots - 1;
+    clear();
+}
+
+void ASCSServiceTable::clear() {
+    for (Slot &slot : m_slots) {
+        slot.index = ASCS_SERVICE_TABLE_NIL;
+    }
+    // Chain all entries into the free list
+    for (size_t i = 0; i < m_entries.size(); i++) {
+        m_entries[i].lruNext = (i + 1 < m_entries.size()) ? (uint16_t)(i + 1) : ASCS_SERVICE_TABLE_NIL;
+    }
+    m_freeHead = m_entries.empty() ? ASCS_SERVICE_TABLE_NIL : 0;
+    m_lruHead = m_lruTail = ASCS_SERVICE_TABLE_NIL;
+    for (size_t r = 0; r < ASCS_SERVICE_TABLE_ROLES; r++) {
+        m_roleHead[r] = ASCS_SERVICE_TABLE_NIL;
+        m_roleCount[r] = 0;
+    }
+    m_size = 0;
+    m_best = ASCS_SERVICE_TABLE_NIL;
+}
+
+size_t ASCSServiceTable::homeSlot(uint32_t nodeId) const {
+    // Fibonacci hashing: node IDs are often sequential or share high bytes
+    return (size_t)((uint32_t)(nodeId * 2654435769u) >> m_hashShift);
+}
+
+size_t ASCSServiceTable::probe(uint32_t nodeId) const {
+    size_t pos = homeSlot(nodeId);
+    while (m_slots[pos].index != ASCS_SERVICE_TABLE_NIL && m_slots[pos].nodeId != nodeId) {
+        pos = (pos + 1) & m_slotMask;
+    }
+    return pos;
+}
+
+void ASCSServiceTable::eraseSlot(size_t pos) {
+    // Backward-shift deletion: move later members of the probe run into the hole (no tombstones)
+    size_t hole = pos;
+    size_t next = (pos + 1) & m_slotMask;
+    while (m_slots[next].index != ASCS_SERVICE_TABLE_NIL) {
+        size_t home = homeSlot(m_slots[next].nodeId);
+        // Move if the entry's home is not in the (cyclic) range (hole, next]
+        if (((next - home) & m_slotMask) >= ((next - hole) & m_slotMask)) {
+            m_slots[hole] = m_slots[next];
+            hole = next;
+        }
+        next = (next + 1) & m_slotMask;
+    }
+    m_slots[hole].index = ASCS_SERVICE_TABLE_NIL;
+}
+
+// --- Intrusive lists ---
+
+void ASCSServiceTable::lruUnlink(uint16_t index) {
+    Node &node = m_entries[index];
+    if (node.lruPrev != ASCS_SERVICE_TABLE_NIL) m_entries[node.lruPrev].lruNext = node.lruNext;
+    else m_lruHead = node.lruNext;
+    if (node.lruNext != ASCS_SERVICE_TABLE_NIL) m_entries[node.lruNext].lruPrev = node.lruPrev;
+    else m_lruTail = node.lruPrev;
+}
+
+void ASCSServiceTable::lruPushFront(uint16_t index) {
+    Node &node = m_entries[index];
+    node.lruPrev = ASCS_SERVICE_TABLE_NIL;
+    node.lruNext = m_lruHead;
+    if (m_lruHead != ASCS_SERVICE_TABLE_NIL) m_entries[m_lruHead].lruPrev = index;
+    else m_lruTail = index;
+    m_lruHead = index;
+}
+
+void ASCSServiceTable::roleUnlink(uint16_t index) {
+    Node &node = m_entries[index];
+    size_t r = roleIndex(node.entry.role);
+    if (node.rolePrev != ASCS_SERVICE_TABLE_NIL) m_entries[node.rolePrev].roleNext = node.roleNext;
+    else m_roleHead[r] = node.roleNext;
+    if (node.roleNext != ASCS_SERVICE_TABLE_NIL) m_entries[node.roleNext].rolePrev = node.rolePrev;
+    m_roleCount[r]--;
+}
+
+void ASCSServiceTable::rolePushFront(uint16_t index) {
+    Node &node = m_entries[index];
+    size_t r = roleIndex(node.entry.role);
+    node.rolePrev = ASCS_SERVICE_TABLE_NIL;
+    node.roleNext = m_roleHead[r];
+    if (m_roleHead[r] != ASCS_SERVICE_TABLE_NIL) m_entries[m_roleHead[r]].rolePrev = index;
+    m_roleHead[r] = index;
+    m_roleCount[r]++;
+}
+
+// --- Public API ---
+
+bool ASCSServiceTable::update(uint32_t nodeId, ServiceDiscovery_Role role, uint32_t serviceId, unsigned long now,
+                              const ASCSLinkSample *link) {
+    size_t pos = probe(nodeId);
+    uint16_t index = m_slots[pos].index;
+
+    if (index != ASCS_SERVICE_TABLE_NIL) {
+        // --- Refresh existing entry ---
+        Node &node = m_entries[index];
+        lruUnlink(index);
+        roleUnlink(index);
+        node.entry.role = role;
+        node.entry.serviceId = serviceId;
+        node.entry.lastSeen = now;
+        if (link) node.entry.link.add(*link);
+        lruPushFront(index);
+        rolePushFront(index);
+        reconsiderBest(index);
+        return false;
+    }
+
+    // --- New entry: make room if full ---
+    if (m_freeHead == ASCS_SERVICE_TABLE_NIL) {
+        removeAt(m_lruTail); // Evict the least recently seen node
+        m_evictions++;
+        pos = probe(nodeId); // Deletion may have shifted the probe run
+    }
+    index = m_freeHead;
+    m_freeHead = m_entries[index].lruNext;
+
+    Node &node = m_entries[index];
+    node.entry.nodeId = nodeId;
+    node.entry.role = role;
+    node.entry.serviceId = serviceId;
+    node.entry.lastSeen = now;
+    node.entry.capacity = 0;
+    node.entry.routeCost = 0;
+    node.entry.routeVia = 0;
+    node.entry.link.reset();
+    if (link) node.entry.link.add(*link);
+    m_slots[pos].nodeId = nodeId;
+    m_slots[pos].index = index;
+    lruPushFront(index);
+    rolePushFront(index);
+    m_size++;
+    reconsiderBest(index);
+    return true;
+}
+
+void ASCSServiceTable::restore(const ASCSServiceEntry &entry) {
+    update(entry.nodeId, entry.role, entry.serviceId, entry.lastSeen);
+    uint16_t index = m_slots[probe(entry.nodeId)].index;
+    m_entries[index].entry.link = entry.link;
+    m_entries[index].entry.capacity = entry.capacity;
+    reconsiderBest(index);
+}
+
+void ASCSServiceTable::setCapacity(uint32_t nodeId, uint32_t capacity) {
+    uint16_t index = m_slots[probe(nodeId)].index;
+    if (index != ASCS_SERVICE_TABLE_NIL) m_entries[index].entry.capacity = capacity;
+}
+
+void ASCSServiceTable::setRoute(uint32_t nodeId, float cost, uint32_t via) {
+    uint16_t index = m_slots[probe(nodeId)].index;
+    if (index == ASCS_SERVICE_TABLE_NIL) return;
+    m_entries[index].entry.routeCost = cost;
+    m_entries[index].entry.routeVia = via;
+}
+
+const ASCSServiceEntry *ASCSServiceTable::find(uint32_t nodeId) const {
+    uint16_t index = m_slots[probe(nodeId)].index;
+    return index != ASCS_SERVICE_TABLE_NIL ? &m_entries[index].entry : nullptr;
+}
+
+bool ASCSServiceTable::remove(uint32_t nodeId) {
+    uint16_t index = m_slots[probe(nodeId)].index;
+    if (index == ASCS_SERVICE_TABLE_NIL) return false;
+    removeAt(index);
+    return true;
+}
+
+void ASCSServiceTable::removeAt(uint16_t index) {
+    eraseSlot(probe(m_entries[index].entry.nodeId));
+    lruUnlink(index);
+    roleUnlink(index);
+    m_entries[index].lruNext = m_freeHead;
+    m_freeHead = index;
+    m_size--;
+    if (index == m_best) {
+        rescanBest(); // Fall back to the next best gateway
+        if (m_best != ASCS_SERVICE_TABLE_NIL) m_gatewaySwitches++;
+    }
+}
+
+// --- Best gateway ---
+
+void ASCSServiceTable::rescanBest() {
+    uint16_t best = ASCS_SERVICE_TABLE_NIL;
+    for (uint16_t i = m_roleHead[ServiceDiscovery_Role_GATEWAY]; i != ASCS_SERVICE_TABLE_NIL; i = m_entries[i].roleNext) {
+        if (best == ASCS_SERVICE_TABLE_NIL || m_entries[i].entry.link.cost < m_entries[best].entry.link.cost) best = i;
+    }
+    m_best = best;
+}
+
+void ASCSServiceTable::reconsiderBest(uint16_t index) {
+    const ASCSServiceEntry &entry = m_entries[index].entry;
+
+    if (entry.role != ServiceDiscovery_Role_GATEWAY) {
+        if (index == m_best) {
+            rescanBest(); // No longer a gateway
+            if (m_best != ASCS_SERVICE_TABLE_NIL) m_gatewaySwitches++;
+        }
+        return;
+    }
+    if (m_best == ASCS_SERVICE_TABLE_NIL) {
+        m_best = index;
+        return;
+    }
+
+    if (index == m_best) {
+        // The current gateway's cost changed: switch only if another one is clearly cheaper
+        uint16_t candidate = ASCS_SERVICE_TABLE_NIL;
+        for (uint16_t i = m_roleHead[ServiceDiscovery_Role_GATEWAY]; i != ASCS_SERVICE_TABLE_NIL; i = m_entries[i].roleNext) {
+            if (i == m_best) continue;
+            if (candidate == ASCS_SERVICE_TABLE_NIL || m_entries[i].entry.link.cost < m_entries[candidate].entry.link.cost) candidate = i;
+        }
+        if (candidate != ASCS_SERVICE_TABLE_NIL &&
+            m_entries[candidate].entry.link.cost < entry.link.cost * (1.0f - m_switchHysteresis)) {
+            m_best = candidate;
+            m_gatewaySwitches++;
+        }
+    } else if (entry.link.cost < m_entries[m_best].entry.link.cost * (1.0f - m_switchHysteresis)) {
+        m_best = index;
+        m_gatewaySwitches++;
+    }
+}
+
+uint32_t ASCSServiceTable::getBestGateway() const {
+    return m_best != ASCS_SERVICE_TABLE_NIL ? m_entries[m_best].entry.nodeId : 0;
+}
+
+uint32_t ASCSServiceTable::getHashedGateway(uint32_t key, float maxCostRatio) const {
+    float cheapest = 0;
+    for (uint16_t i = m_roleHead[ServiceDiscovery_Role_GATEWAY]; i != ASCS_SERVICE_TABLE_NIL; i = m_entries[i].roleNext) {
+        float cost = m_entries[i].entry.link.cost;
+        if (cheapest == 0 || cost < cheapest) cheapest = cost;
+    }
+
+    uint32_t chosen = 0;
+    float bestScore = -1.0f;
+    for (uint16_t i = m_roleHead[ServiceDiscovery_Role_GATEWAY]; i != ASCS_SERVICE_TABLE_NIL; i = m_entries[i].roleNext) {
+        const ASCSServiceEntry &gateway = m_entries[i].entry;
+        if (gateway.link.cost > cheapest * maxCostRatio) continue;
+
+        // murmur3 finalizer of key and gateway ID; top 24 bits mapped to (0, 1), exact in a float
+        uint32_t h = key ^ (gateway.nodeId * 0x9E3779B1u);
+        h ^= h >> 16;
+        h *= 0x85EBCA6Bu;
+        h ^= h >> 13;
+        h *= 0xC2B2AE35u;
+        h ^= h >> 16;
+        float u = ((float)(h >> 8) + 0.5f) / 16777216.0f;
+        float weight = (float)(gateway.capacity ? gateway.capacity : ASCS_GATEWAY_DEFAULT_CAPACITY);
+        float score = weight / -logf(u);
+        if (score > bestScore) {
+            bestScore = score;
+            chosen = gateway.nodeId;
+        }
+    }
+    return chosen;
+}
+
+uint32_t ASCSServiceTable::getBestAggregatorRoute(uint32_t self, float &cost) const {
+    uint32_t chosen = 0;
+    for (uint16_t i = m_roleHead[ServiceDiscovery_Role_AGGREGATOR]; i != ASCS_SERVICE_TABLE_NIL; i = m_entries[i].roleNext) {
+        float total;
+        if (!aggregatorRouteCost(m_entries[i].entry, self, total)) continue;
+        if (chosen == 0 || total < cost) { // Most recently seen wins ties
+            chosen = m_entries[i].entry.nodeId;
+            cost = total;
+        }
+    }
+    return chosen;
+}
+
+bool ASCSServiceTable::getRouteCost(uint32_t nodeId, uint32_t self, float &cost) const {
+    const ASCSServiceEntry *entry = find(nodeId);
+    if (!entry) return false;
+    if (entry->role == ServiceDiscovery_Role_GATEWAY) {
+        cost = entry->link.cost;
+        return true;
+    }
+    return entry->role == ServiceDiscovery_Role_AGGREGATOR && aggregatorRouteCost(*entry, self, cost);
+}
+
+bool ASCSServiceTable::aggregatorRouteCost(const ASCSServiceEntry &aggregator, uint32_t self, float &cost) {
+    // Split horizon: a route leading back through us would loop
+    if (aggregator.routeCost <= 0 || aggregator.routeVia == self || aggregator.nodeId == self) return false;
+    cost = aggregator.link.cost + aggregator.routeCost;
+    return cost <= ASCS_ROUTE_MAX_COST;
+}
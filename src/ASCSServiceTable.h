@@ -0,0 +1,236 @@
+#ifndef ASCS_SERVICE_TABLE_H
+#define ASCS_SERVICE_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "generated_proto/SmartCity.pb.h" // For ServiceDiscovery_Role
+#include "ASCSLinkMetrics.h"
+
+// --- Service Table Constants ---
+
+#ifndef ASCS_SERVICE_TABLE_CAPACITY
+#define ASCS_SERVICE_TABLE_CAPACITY 256 // Max nodes remembered; the least recently seen is evicted when full
+#endif
+#define ASCS_SERVICE_TABLE_ROLES 4      // Role index size (UNKNOWN, SENSOR, AGGREGATOR, GATEWAY)
+#define ASCS_SERVICE_TABLE_NIL 0xFFFF   // "No entry" in the index and linked lists
+#define ASCS_DEFAULT_GATEWAY_SWITCH_HYSTERESIS 0.2f // Min relative cost gain before switching gateways
+#define ASCS_GATEWAY_HASH_MAX_COST_RATIO 2.0f // Hashed selection: only gateways at most this much costlier than the cheapest
+#define ASCS_GATEWAY_DEFAULT_CAPACITY 100     // Weight of a gateway that does not advertise one
+#define ASCS_ROUTE_MAX_COST 64.0f             // Routes costlier than this (expected transmissions) count as broken
+
+/**
+ * @brief One discovered node.
+ */
+struct ASCSServiceEntry {
+    uint32_t nodeId = 0;
+    ServiceDiscovery_Role role = ServiceDiscovery_Role_UNKNOWN;
+    uint32_t serviceId = 0;
+    unsigned long lastSeen = 0; // millis() of the last message/discovery
+    ASCSLinkStats link;         // Link quality towards this node (from packets received from it)
+    uint32_t capacity = 0;      // Gateways: advertised weight for hashed selection (0 = not stated)
+    float routeCost = 0;        // Aggregators: advertised cost of their route to a gateway (0 = no route)
+    uint32_t routeVia = 0;      // Aggregators: next hop of that route
+};
+
+/**
+ * @brief Fixed-capacity table of discovered nodes, allocated once at construction.
+ *
+ * - Lookup: open-addressing hash index (linear probing, at most 50% load) of compact
+ *   {nodeId, entry index} slots, so a probe rarely leaves one cache line.
+ * - Recency list: entries are kept in lastSeen order. The tail is the least recently seen
+ *   node, which is evicted when the table is full and is the only place expiry has to look.
+ * - Role index: one list per role, most recently seen first.
+ * - Best gateway: the gateway with the lowest link cost (expected transmissions), kept up to
+ *   date on every update and removal, so it is found in O(1). A different gateway only takes
+ *   over if its cost is lower by more than the switch hysteresis, which avoids flapping
+ *   between gateways of similar quality.
+ *
+ * Entries are never moved, so the index and lists can refer to them by position.
+ */
+class ASCSServiceTable {
+public:
+    /**
+     * @param capacity Max entries (at most 65534).
+     */
+    explicit ASCSServiceTable(size_t capacity = ASCS_SERVICE_TABLE_CAPACITY);
+
+    /**
+     * @brief Inserts or refreshes a node, making it the most recently seen.
+     * Evicts the least recently seen node if the table is full.
+     * @param link Link quality of the packet this update came from, or nullptr if unknown.
+     * @return True if the node was not in the table before.
+     */
+    bool update(uint32_t nodeId, ServiceDiscovery_Role role, uint32_t serviceId, unsigned long now,
+                const ASCSLinkSample *link = nullptr);
+
+    /**
+     * @brief Inserts or replaces a node with the given lastSeen and link stats (e.g., from a snapshot).
+     * The node becomes the most recently seen, so restore several nodes oldest first.
+     */
+    void restore(const ASCSServiceEntry &entry);
+
+    /**
+     * @brief Sets the advertised capacity of a known node (only ServiceDiscovery carries it).
+     */
+    void setCapacity(uint32_t nodeId, uint32_t capacity);
+
+    /**
+     * @brief Sets the advertised gateway route of a known aggregator (only ServiceDiscovery carries it).
+     * @param cost Route cost from the aggregator to a gateway (0 = no route).
+     * @param via The aggregator's next hop on that route.
+     */
+    void setRoute(uint32_t nodeId, float cost, uint32_t via);
+
+    /**
+     * @return The entry of 'nodeId', or nullptr if unknown.
+     */
+    const ASCSServiceEntry *find(uint32_t nodeId) const;
+
+    /**
+     * @return True if the node was in the table.
+     */
+    bool remove(uint32_t nodeId);
+
+    /**
+     * @brief Removes all entries not seen for more than 'timeoutMs'. Only expired entries are visited.
+     * @param onExpired Called with each entry before it is removed.
+     * @return Number of removed entries.
+     */
+    template <typename F>
+    size_t expire(unsigned long now, uint32_t timeoutMs, F onExpired) {
+        size_t removed = 0;
+        while (m_lruTail != ASCS_SERVICE_TABLE_NIL) {
+            const ASCSServiceEntry &oldest = m_entries[m_lruTail].entry;
+            if (now - oldest.lastSeen <= timeoutMs) break; // Everything before the tail is newer
+            onExpired(oldest);
+            remove(oldest.nodeId);
+            removed++;
+        }
+        return removed;
+    }
+
+    /**
+     * @brief Node ID of the gateway with the lowest link cost (with hysteresis), or 0 if none is known. O(1).
+     */
+    uint32_t getBestGateway() const;
+
+    /**
+     * @brief Gateway for 'key' (e.g., the asking node's ID) by weighted rendezvous hashing.
+     *
+     * Each gateway scores capacity / -ln(hash(key, gateway)) and the highest score wins, so keys
+     * spread over the gateways in proportion to their capacity. When a gateway joins or leaves,
+     * only the keys it wins or won move; all others keep their gateway. Gateways whose link cost
+     * exceeds the cheapest one's by more than 'maxCostRatio' are not considered. O(gateways).
+     * @return Node ID, or 0 if no gateway is known.
+     */
+    uint32_t getHashedGateway(uint32_t key, float maxCostRatio = ASCS_GATEWAY_HASH_MAX_COST_RATIO) const;
+
+    /**
+     * @brief Aggregator with the cheapest route to a gateway: our link cost to it plus its advertised
+     * route cost. Aggregators whose route leads back through 'self' are skipped (split horizon), as
+     * are routes costlier than ASCS_ROUTE_MAX_COST. O(aggregators).
+     * @param cost Set to the total route cost if one is found.
+     * @return Node ID, or 0 if no aggregator has a route.
+     */
+    uint32_t getBestAggregatorRoute(uint32_t self, float &cost) const;
+
+    /**
+     * @brief Cost of reaching a gateway through 'nodeId': the link cost of a gateway, or the route
+     * cost of an aggregator by the rules of getBestAggregatorRoute().
+     * @return False if 'nodeId' is unknown or offers no usable route.
+     */
+    bool getRouteCost(uint32_t nodeId, uint32_t self, float &cost) const;
+
+    /**
+     * @brief Sets the min relative cost gain (e.g., 0.2 = 20% cheaper) for switching to another gateway.
+     */
+    void setSwitchHysteresis(float fraction) { m_switchHysteresis = fraction; }
+
+    /**
+     * @brief Number of times the best gateway changed from one gateway to another.
+     */
+    uint32_t getGatewaySwitches() const { return m_gatewaySwitches; }
+
+    /**
+     * @brief Calls 'visit' for each node of 'role', most recently seen first.
+     */
+    template <typename F>
+    void forEachOfRole(ServiceDiscovery_Role role, F visit) const {
+        for (uint16_t i = m_roleHead[roleIndex(role)]; i != ASCS_SERVICE_TABLE_NIL; i = m_entries[i].roleNext) {
+            visit(m_entries[i].entry);
+        }
+    }
+
+    /**
+     * @brief Calls 'visit' for each node, most recently seen first.
+     */
+    template <typename F>
+    void forEach(F visit) const {
+        for (uint16_t i = m_lruHead; i != ASCS_SERVICE_TABLE_NIL; i = m_entries[i].lruNext) {
+            visit(m_entries[i].entry);
+        }
+    }
+
+    /**
+     * @brief Whether traffic is routed through nodes of 'role' (gateways and aggregators).
+     */
+    static bool isRoutingRole(ServiceDiscovery_Role role) {
+        return role == ServiceDiscovery_Role_GATEWAY || role == ServiceDiscovery_Role_AGGREGATOR;
+    }
+
+    size_t size() const { return m_size; }
+    size_t getCapacity() const { return m_entries.size(); }
+    size_t getRoleCount(ServiceDiscovery_Role role) const { return m_roleCount[roleIndex(role)]; }
+    uint32_t getEvictions() const { return m_evictions; }
+
+    void clear();
+
+private:
+    struct Node {
+        ASCSServiceEntry entry;
+        uint16_t lruPrev, lruNext;   // Recency list (free list uses lruNext)
+        uint16_t rolePrev, roleNext; // List of the entry's role
+    };
+    struct Slot {
+        uint32_t nodeId;
+        uint16_t index; // Entry position, ASCS_SERVICE_TABLE_NIL if the slot is empty
+    };
+
+    static size_t roleIndex(ServiceDiscovery_Role role) {
+        return (size_t)role < ASCS_SERVICE_TABLE_ROLES ? (size_t)role : 0;
+    }
+    size_t homeSlot(uint32_t nodeId) const;
+    // Position of the slot holding 'nodeId', or the empty slot where it would go.
+    size_t probe(uint32_t nodeId) const;
+    void eraseSlot(size_t pos);
+    void removeAt(uint16_t index);
+    // Re-evaluates the best gateway after entry 'index' changed.
+    void reconsiderBest(uint16_t index);
+    // Picks the cheapest gateway (most recently seen on ties), or none.
+    void rescanBest();
+    // Route cost through an aggregator (link plus advertised cost); false if it has no usable route.
+    static bool aggregatorRouteCost(const ASCSServiceEntry &aggregator, uint32_t self, float &cost);
+
+    void lruUnlink(uint16_t index);
+    void lruPushFront(uint16_t index);
+    void roleUnlink(uint16_t index);
+    void rolePushFront(uint16_t index);
+
+    std::vector<Node> m_entries;
+    std::vector<Slot> m_slots; // Power of two, at least twice the capacity
+    size_t m_slotMask = 0;
+    uint8_t m_hashShift = 31;  // 32 - log2(slot count)
+    size_t m_size = 0;
+    uint16_t m_freeHead = ASCS_SERVICE_TABLE_NIL;
+    uint16_t m_lruHead = ASCS_SERVICE_TABLE_NIL;
+    uint16_t m_lruTail = ASCS_SERVICE_TABLE_NIL;
+    uint16_t m_roleHead[ASCS_SERVICE_TABLE_ROLES];
+    size_t m_roleCount[ASCS_SERVICE_TABLE_ROLES];
+    uint32_t m_evictions = 0;
+    uint16_t m_best = ASCS_SERVICE_TABLE_NIL; // Entry of the best gateway
+    float m_switchHysteresis = ASCS_DEFAULT_GATEWAY_SWITCH_HYSTERESIS;
+    uint32_t m_gatewaySwitches = 0;
+};
+
+#endif // ASCS_SERVICE_TABLE_H
@@ -0,0 +1,175 @@
+#include "ASCSStoreForward.h"
+
+void ASCSStoreForward::configure(uint32_t maxPackets, uint32_t flushIntervalMs, uint32_t seed) {
+    m_maxPackets = maxPackets > ASCS_STORE_MAX_PACKETS ? ASCS_STORE_MAX_PACKETS : maxPackets;
+    m_flushIntervalMs = flushIntervalMs;
+    m_random = seed ? seed : 1;
+    m_flushing = false;
+}
+
+uint32_t ASCSStoreForward::nextRandom() {
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 17;
+    m_random ^= m_random << 5;
+    return m_random;
+}
+
+bool ASCSStoreForward::makeRoom(size_t length, MessagePriority priority) {
+    while (!m_packets.empty() && (m_packets.size() >= m_maxPackets || m_bytes + length > ASCS_STORE_MAX_BYTES)) {
+        // The oldest packet of the lowest class, if not above the new one (newer readings replace older ones)
+        size_t victim = m_packets.size();
+        for (size_t i = 0; i < m_packets.size(); i++) {
+            if (m_packets[i].priority > priority) continue;
+            if (victim == m_packets.size() || m_packets[i].priority < m_packets[victim].priority) victim = i;
+        }
+        if (victim == m_packets.size()) return false;
+        m_bytes -= m_packets[victim].data.size();
+        m_packets.erase(m_packets.begin() + victim);
+        m_stats.dropped++;
+    }
+    return true;
+}
+
+bool ASCSStoreForward::push(const uint8_t *data, size_t length, MessagePriority priority) {
+    if (!isEnabled() || length == 0 || length > ASCS_STORE_MAX_BYTES || length > 0xFFFF) return false;
+    if (!makeRoom(length, priority)) {
+        m_stats.dropped++;
+        return false;
+    }
+    m_packets.push_back({priority, std::vector<uint8_t>(data, data + length)});
+    m_bytes += length;
+    m_dirty = true;
+    m_stats.stored++;
+    if (m_packets.size() > m_stats.depthMax) m_stats.depthMax = (uint32_t)m_packets.size();
+    return true;
+}
+
+size_t ASCSStoreForward::peekBatch(unsigned long now, std::vector<std::pair<MessagePriority, std::vector<uint8_t>>> &batch) {
+    batch.clear();
+    if (m_packets.empty()) {
+        m_flushing = false;
+        return 0;
+    }
+    if (!m_flushing) {
+        // Route just came back: first batch at a random offset, so nodes regaining it together spread out
+        m_flushing = true;
+        m_nextFlush = now + (m_flushIntervalMs ? nextRandom() % m_flushIntervalMs : 0);
+    }
+    if ((long)(now - m_nextFlush) < 0) return 0;
+    m_nextFlush = now + m_flushIntervalMs;
+
+    size_t count = 0, bytes = 0;
+    while (count < m_packets.size() && count < ASCS_STORE_FLUSH_BATCH) {
+        size_t more = ASCS_STORE_BATCH_ENTRY_OVERHEAD + m_packets[count].data.size();
+        if (count > 0 && bytes + more > ASCS_STORE_BATCH_MAX_BYTES) break;
+        bytes += more;
+        count++;
+    }
+    for (size_t i = 0; i < count; i++) {
+        batch.emplace_back(m_packets[i].priority, m_packets[i].data);
+    }
+    return count;
+}
+
+void ASCSStoreForward::commitBatch(size_t count) {
+    if (count > m_packets.size()) count = m_packets.size();
+    for (size_t i = 0; i < count; i++) {
+        m_bytes -= m_packets[i].data.size();
+    }
+    m_packets.erase(m_packets.begin(), m_packets.begin() + count);
+    m_stats.flushed += (uint32_t)count;
+    m_dirty = true;
+}
+
+size_t ASCSStoreForward::putVarint(uint8_t *buffer, size_t value) {
+    size_t pos = 0;
+    while (value >= 0x80) {
+        buffer[pos++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buffer[pos++] = (uint8_t)value;
+    return pos;
+}
+
+bool ASCSStoreForward::getVarint(const uint8_t *data, size_t length, size_t &pos, size_t &value) {
+    value = 0;
+    for (unsigned shift = 0; pos < length && shift < 21; shift += 7) { // Lengths here stay far below 2^21
+        uint8_t byte = data[pos++];
+        value |= (size_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+size_t ASCSStoreForward::encodeBatch(const std::vector<std::pair<MessagePriority, std::vector<uint8_t>>> &batch, uint8_t *buffer,
+                                     size_t size) {
+    uint8_t length[5];
+    size_t inner = 0;
+    for (const auto &packet : batch) inner += 1 + putVarint(length, packet.second.size()) + packet.second.size();
+    if (1 + putVarint(length, inner) + inner > size) return 0;
+
+    size_t pos = 0;
+    buffer[pos++] = ASCS_STORE_BATCH_TAG;
+    pos += putVarint(buffer + pos, inner);
+    for (const auto &packet : batch) {
+        buffer[pos++] = ASCS_STORE_BATCH_PACKET_TAG;
+        pos += putVarint(buffer + pos, packet.second.size());
+        for (uint8_t byte : packet.second) buffer[pos++] = byte;
+    }
+    return pos;
+}
+
+bool ASCSStoreForward::splitBatch(const uint8_t *data, size_t length, std::vector<std::pair<const uint8_t *, size_t>> &packets) {
+    packets.clear();
+    size_t pos = 0, inner = 0;
+    if (length == 0 || data[pos++] != ASCS_STORE_BATCH_TAG) return false;
+    if (!getVarint(data, length, pos, inner) || pos + inner != length) return false;
+    while (pos < length) {
+        size_t size = 0;
+        if (data[pos++] != ASCS_STORE_BATCH_PACKET_TAG) return false;
+        if (!getVarint(data, length, pos, size) || pos + size > length) return false;
+        packets.emplace_back(data + pos, size);
+        pos += size;
+    }
+    return !packets.empty();
+}
+
+size_t ASCSStoreForward::encode(uint8_t *buffer, size_t size) const {
+    if (size < ASCS_STORE_HEADER_SIZE) return 0;
+    size_t pos = ASCS_STORE_HEADER_SIZE;
+    uint8_t count = 0;
+    for (const Stored &packet : m_packets) {
+        size_t length = packet.data.size();
+        if (pos + ASCS_STORE_RECORD_HEADER_SIZE + length > size || count == 0xFF) break;
+        buffer[pos++] = (uint8_t)packet.priority;
+        buffer[pos++] = (uint8_t)(length & 0xFF);
+        buffer[pos++] = (uint8_t)(length >> 8);
+        for (uint8_t byte : packet.data) buffer[pos++] = byte;
+        count++;
+    }
+    buffer[0] = ASCS_STORE_VERSION;
+    buffer[1] = count;
+    return pos;
+}
+
+size_t ASCSStoreForward::decode(const uint8_t *buffer, size_t length) {
+    if (length < ASCS_STORE_HEADER_SIZE || buffer[0] != ASCS_STORE_VERSION) return 0;
+    size_t count = buffer[1];
+    size_t pos = ASCS_STORE_HEADER_SIZE;
+    size_t restored = 0;
+    for (size_t i = 0; i < count && pos + ASCS_STORE_RECORD_HEADER_SIZE <= length; i++) {
+        uint8_t priority = buffer[pos];
+        size_t size = buffer[pos + 1] | ((size_t)buffer[pos + 2] << 8);
+        pos += ASCS_STORE_RECORD_HEADER_SIZE;
+        if (pos + size > length) break; // Truncated
+        if (priority > (uint8_t)MessagePriority::CRITICAL) priority = (uint8_t)MessagePriority::CRITICAL;
+        if (push(buffer + pos, size, (MessagePriority)priority)) {
+            m_stats.stored--; // Counted as restored, not as newly stored
+            restored++;
+        }
+        pos += size;
+    }
+    m_stats.restored += (uint32_t)restored;
+    m_dirty = false; // Same as in NVS
+    return restored;
+}
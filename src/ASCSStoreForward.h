@@ -0,0 +1,155 @@
+#ifndef ASCS_STORE_FORWARD_H
+#define ASCS_STORE_FORWARD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "interfaces/MessagePriority.h"
+
+// --- Store-and-Forward Constants ---
+
+#define ASCS_STORE_MAX_PACKETS 64         // Upper limit of `sf_max`
+#define ASCS_STORE_MAX_BYTES 3072         // Encoded packets held (also the largest NVS snapshot)
+#define ASCS_STORE_FLUSH_BATCH 4          // Held packets sent together in one StoredBatch per flush interval ...
+#define ASCS_STORE_BATCH_MAX_BYTES 200    // ... as far as they fit (Meshtastic payload limit 233 bytes)
+#define ASCS_STORE_BATCH_ENTRY_OVERHEAD 3 // Field tag and length of each packet in a StoredBatch
+#define ASCS_STORE_BATCH_TAG 0x2A         // SmartCityPacket.stored (field 5, length-delimited)
+#define ASCS_STORE_BATCH_PACKET_TAG 0x0A  // StoredBatch.packets (field 1, length-delimited)
+#define ASCS_STORE_NAMESPACE "ascs_sf"    // Preferences namespace of the persisted packets
+#define ASCS_STORE_KEY "queue"
+#define ASCS_STORE_VERSION 1
+#define ASCS_STORE_HEADER_SIZE 2          // Version, packet count
+#define ASCS_STORE_RECORD_HEADER_SIZE 3   // Per packet: priority (1), length (2)
+#define ASCS_STORE_SAVE_INTERVAL_MS 60000 // How often a changed queue is written to NVS
+#define ASCS_STORE_SNAPSHOT_MAX_SIZE (ASCS_STORE_HEADER_SIZE + ASCS_STORE_MAX_BYTES + ASCS_STORE_MAX_PACKETS * ASCS_STORE_RECORD_HEADER_SIZE)
+
+/**
+ * @brief Counters of the store-and-forward queue (logged with the service table cleanup).
+ */
+struct ASCSStoreStats {
+    uint32_t stored = 0;   // Packets held because no gateway was known
+    uint32_t flushed = 0;  // Handed to the outbound queue once a route was known again
+    uint32_t dropped = 0;  // Pushed out by newer (or higher-class) packets when full
+    uint32_t restored = 0; // Read back from NVS after a restart
+    uint32_t depthMax = 0;
+};
+
+/**
+ * @brief Encoded SensorData packets held on a Sensor or Aggregator while no route to a gateway
+ * is known, instead of broadcasting them (Sensor) or dropping them (Aggregator).
+ *
+ * Once a route is known again, the packets are sent to it oldest first: one batch per flush
+ * interval, with as many packets as fit in one StoredBatch (up to ASCS_STORE_FLUSH_BATCH), so a
+ * batch shares one preamble and header on air and a district of nodes coming back together does
+ * not swamp the channel (the interval starts at a random offset per node). Each packet keeps its
+ * own timestamp and sequence number.
+ *
+ * Bounded by count (`sf_max`) and ASCS_STORE_MAX_BYTES; when full, the oldest packet of the
+ * lowest class not above the new one is dropped. The queue is written to NVS when it has changed
+ * (at most once per ASCS_STORE_SAVE_INTERVAL_MS), so held readings survive a restart.
+ *
+ * Layout (little-endian): version (1), count (1), then per packet: priority (1), length (2), bytes.
+ *
+ * A batch goes out as a SmartCityPacket with a StoredBatch, framed by encodeBatch() and split
+ * again by splitBatch() rather than through nanopb callbacks, which nanopb clears when it decodes
+ * a oneof member.
+ */
+class ASCSStoreForward {
+public:
+    ASCSStoreForward() = default;
+
+    /**
+     * @param maxPackets Packets held (0 disables the store, capped at ASCS_STORE_MAX_PACKETS).
+     * @param flushIntervalMs Time between flush batches.
+     * @param seed Per-node value for the random offset of the first batch (e.g., the node number).
+     */
+    void configure(uint32_t maxPackets, uint32_t flushIntervalMs, uint32_t seed);
+
+    bool isEnabled() const { return m_maxPackets > 0; }
+
+    /**
+     * @brief Holds an encoded packet.
+     * @return False if it was dropped (store disabled, too large, or full of higher-class packets).
+     */
+    bool push(const uint8_t *data, size_t length, MessagePriority priority);
+
+    /**
+     * @brief Copies the next flush batch if one is due, oldest first. The packets stay held until
+     * commitBatch(); if the batch cannot be sent, it is offered again at the next flush.
+     * @param batch Filled with up to ASCS_STORE_FLUSH_BATCH packets (priority, bytes) that together fit
+     *              in ASCS_STORE_BATCH_MAX_BYTES of StoredBatch (always at least one).
+     * @return Number of packets in the batch.
+     */
+    size_t peekBatch(unsigned long now, std::vector<std::pair<MessagePriority, std::vector<uint8_t>>> &batch);
+
+    /**
+     * @brief Removes the oldest 'count' packets, after the batch from peekBatch() was sent.
+     */
+    void commitBatch(size_t count);
+
+    /**
+     * @brief Encodes a batch as a SmartCityPacket with a StoredBatch.
+     * @return Bytes written, 0 if it does not fit in 'size'.
+     */
+    static size_t encodeBatch(const std::vector<std::pair<MessagePriority, std::vector<uint8_t>>> &batch, uint8_t *buffer,
+                              size_t size);
+
+    /**
+     * @brief Splits a received payload into the packets of its StoredBatch.
+     * @param packets Filled with (pointer into 'data', length) of each packet.
+     * @return False if the payload is not a well-formed StoredBatch.
+     */
+    static bool splitBatch(const uint8_t *data, size_t length, std::vector<std::pair<const uint8_t *, size_t>> &packets);
+
+    /**
+     * @brief No route any more: the next flush starts a random offset after the route is back.
+     */
+    void onRouteLost() { m_flushing = false; }
+
+    /**
+     * @brief Writes the held packets to 'buffer'.
+     * @param size Buffer size, ASCS_STORE_SNAPSHOT_MAX_SIZE is always enough.
+     * @return Bytes written.
+     */
+    size_t encode(uint8_t *buffer, size_t size) const;
+
+    /**
+     * @brief Appends the packets of a snapshot (another version is ignored).
+     * @return Number of packets restored.
+     */
+    size_t decode(const uint8_t *buffer, size_t length);
+
+    /**
+     * @brief Whether the packets changed since the last markSaved().
+     */
+    bool isDirty() const { return m_dirty; }
+    void markSaved() { m_dirty = false; }
+
+    size_t size() const { return m_packets.size(); }
+    size_t bytes() const { return m_bytes; }
+    bool empty() const { return m_packets.empty(); }
+    const ASCSStoreStats &getStats() const { return m_stats; }
+
+private:
+    struct Stored {
+        MessagePriority priority;
+        std::vector<uint8_t> data;
+    };
+
+    bool makeRoom(size_t length, MessagePriority priority);
+    static size_t putVarint(uint8_t *buffer, size_t value);
+    static bool getVarint(const uint8_t *data, size_t length, size_t &pos, size_t &value);
+    uint32_t nextRandom();
+
+    std::vector<Stored> m_packets; // Oldest first
+    size_t m_bytes = 0;
+    uint32_t m_maxPackets = 0;
+    uint32_t m_flushIntervalMs = 0;
+    uint32_t m_random = 1;          // xorshift32 state
+    bool m_flushing = false;        // A route is known and flush batches are scheduled
+    unsigned long m_nextFlush = 0;
+    bool m_dirty = false;
+    ASCSStoreStats m_stats;
+};
+
+#endif // ASCS_STORE_FORWARD_H
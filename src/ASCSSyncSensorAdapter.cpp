@@ -0,0 +1,15 @@
+#include "ASCSSyncSensorAdapter.h"
+
+bool ASCSSyncSensorAdapter::startRead() {
+    m_readings.clear();
+    m_status = m_sensor->readData(m_readings) ? SensorReadStatus::DONE : SensorReadStatus::FAILED;
+    return m_status == SensorReadStatus::DONE;
+}
+
+SensorReadStatus ASCSSyncSensorAdapter::pollRead(std::map<std::string, float> &readings) {
+    SensorReadStatus status = m_status;
+    if (status == SensorReadStatus::DONE) readings.swap(m_readings);
+    m_readings.clear();
+    m_status = SensorReadStatus::FAILED; // Each result is handed over once
+    return status;
+}
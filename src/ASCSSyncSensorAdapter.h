@@ -0,0 +1,31 @@
+#ifndef ASCS_SYNC_SENSOR_ADAPTER_H
+#define ASCS_SYNC_SENSOR_ADAPTER_H
+
+#include <memory>
+#include "interfaces/SensorInterface.h"
+#include "interfaces/AsyncSensorInterface.h"
+
+/**
+ * @brief Drives a synchronous SensorInterface through the asynchronous read interface.
+ *
+ * startRead() calls readData() (which blocks for as long as the driver does) and keeps the
+ * result; the following pollRead() hands it over.
+ */
+class ASCSSyncSensorAdapter : public AsyncSensorInterface {
+public:
+    explicit ASCSSyncSensorAdapter(std::unique_ptr<SensorInterface> sensor) : m_sensor(std::move(sensor)) {}
+
+    bool startRead() override;
+    SensorReadStatus pollRead(std::map<std::string, float> &readings) override;
+    std::string getSensorId() override { return m_sensor->getSensorId(); }
+    MessagePriority getPriority(const std::map<std::string, float> &readings) override { return m_sensor->getPriority(readings); }
+    SensorEventQueue *getEventQueue() override { return m_sensor->getEventQueue(); }
+    ReadingType getReadingType(const std::string &key) override { return m_sensor->getReadingType(key); }
+
+private:
+    std::unique_ptr<SensorInterface> m_sensor;
+    std::map<std::string, float> m_readings;
+    SensorReadStatus m_status = SensorReadStatus::FAILED;
+};
+
+#endif // ASCS_SYNC_SENSOR_ADAPTER_H
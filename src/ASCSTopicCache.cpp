@@ -0,0 +1,188 @@
+#include "ASCSTopicCache.h"
+
+#include <string.h>
+
+ASCSTopicCache::ASCSTopicCache() {
+    // Cache entries are value-initialized as invalid
+}
+
+bool ASCSTopicCache::compile(const std::string &topicTemplate, const std::string &baseTopic, uint32_t serviceId) {
+    std::vector<Segment> segments;
+    bool hasKey = false;
+    std::string literal; // Accumulates static text between dynamic placeholders
+
+    size_t pos = 0;
+    while (pos < topicTemplate.length()) {
+        char c = topicTemplate[pos];
+        if (c != '{') {
+            if (hasKey) {
+                // Nothing may follow {key}; the prefix must be everything before it.
+                m_error = "{key} must be last";
+                return false;
+            }
+            literal += c;
+            pos++;
+            continue;
+        }
+
+        size_t close = topicTemplate.find('}', pos);
+        if (close == std::string::npos) {
+            m_error = "unterminated placeholder";
+            return false;
+        }
+        std::string name = topicTemplate.substr(pos + 1, close - pos - 1);
+        pos = close + 1;
+
+        if (hasKey) {
+            // Nothing may follow {key}; the prefix must be everything before it.
+            m_error = "{key} must be last";
+            return false;
+        }
+
+        if (name == "base") {
+            literal += baseTopic; // Static, resolved now
+        } else if (name == "service") {
+            literal += std::to_string(serviceId); // Static, resolved now
+        } else if (name == "node" || name == "sensor") {
+            if (!literal.empty()) {
+                segments.push_back({SEGMENT_LITERAL, literal});
+                literal.clear();
+            }
+            segments.push_back({name == "node" ? SEGMENT_NODE : SEGMENT_SENSOR, std::string()});
+        } else if (name == "key") {
+            if (!literal.empty()) {
+                segments.push_back({SEGMENT_LITERAL, literal});
+                literal.clear();
+            }
+            hasKey = true;
+        } else {
+            m_error = "unknown placeholder {" + name + "}";
+            return false;
+        }
+    }
+
+    if (!literal.empty()) {
+        segments.push_back({SEGMENT_LITERAL, literal});
+    }
+
+    m_segments.swap(segments);
+    m_hasKey = hasKey;
+    m_error.clear();
+    clearCache();
+    return true;
+}
+
+bool ASCSTopicCache::buildPrefix(uint32_t nodeId, const char *sensorId, char *out, size_t outSize, size_t &length) {
+    if (!sensorId) sensorId = "";
+    CacheEntry *set = &m_cache[setFor(nodeId, sensorId)];
+
+    CacheEntry *victim = &set[0];
+    for (size_t way = 0; way < ASCS_TOPIC_CACHE_WAYS; way++) {
+        CacheEntry &entry = set[way];
+        if (!entry.valid) {
+            if (victim->valid) victim = &entry;
+            continue;
+        }
+        if (entry.nodeId == nodeId && entry.sensorId == sensorId) {
+            // Hit: the hot path is a single copy of the pre-rendered prefix
+            if (entry.prefix.length() + 1u > outSize) return false;
+            memcpy(out, entry.prefix.c_str(), entry.prefix.length() + 1u); // Includes null terminator
+            entry.lastUsed = ++m_useCounter;
+            m_hits++;
+            length = entry.prefix.length();
+            return true;
+        }
+        if (victim->valid && m_useCounter - entry.lastUsed > m_useCounter - victim->lastUsed) victim = &entry; // Less recently used
+    }
+
+    m_misses++;
+    size_t len;
+    if (!renderPrefix(nodeId, sensorId, out, outSize, len)) return false;
+    length = len;
+
+    // Only cache pairs whose sensor_id is shorter than ASCS_TOPIC_CACHE_SENSOR_ID_LEN; longer IDs are rendered every time.
+    if (strlen(sensorId) < ASCS_TOPIC_CACHE_SENSOR_ID_LEN) {
+        victim->valid = true;
+        victim->nodeId = nodeId;
+        victim->lastUsed = ++m_useCounter;
+        victim->sensorId = sensorId;
+        victim->prefix.assign(out, len);
+    }
+    return true;
+}
+
+bool ASCSTopicCache::appendKey(char *out, size_t prefixLen, size_t outSize, const char *key) {
+    size_t keyLen = strlen(key);
+    if (prefixLen + keyLen + 1 > outSize) return false;
+    memcpy(out + prefixLen, key, keyLen + 1); // Includes null terminator
+    return true;
+}
+
+void ASCSTopicCache::formatNodeHex(uint32_t nodeId, char *out) {
+    static const char hexDigits[] = "0123456789abcdef";
+    for (int i = 7; i >= 0; i--) {
+        out[i] = hexDigits[nodeId & 0x0F];
+        nodeId >>= 4;
+    }
+}
+
+bool ASCSTopicCache::renderPrefix(uint32_t nodeId, const char *sensorId, char *out, size_t outSize, size_t &length) const {
+    size_t len = 0;
+    for (const Segment &segment : m_segments) {
+        switch (segment.type) {
+            case SEGMENT_LITERAL: {
+                size_t textLen = segment.literal.length();
+                if (len + textLen + 1 > outSize) return false;
+                memcpy(out + len, segment.literal.c_str(), textLen);
+                len += textLen;
+                break;
+            }
+            case SEGMENT_NODE:
+                if (len + 8 + 1 > outSize) return false;
+                formatNodeHex(nodeId, out + len);
+                len += 8;
+                break;
+            case SEGMENT_SENSOR: {
+                size_t idLen = strlen(sensorId);
+                if (idLen == 0) {
+                    // Collapse the level entirely, matching the legacy ".../<node>" topic when no sensor_id is set
+                    if (len > 0 && out[len - 1] == '/') len--;
+                    break;
+                }
+                if (len + idLen + 1 > outSize) return false;
+                memcpy(out + len, sensorId, idLen);
+                len += idLen;
+                break;
+            }
+        }
+    }
+    if (outSize == 0) return false;
+    out[len] = '\0';
+    length = len;
+    return true;
+}
+
+size_t ASCSTopicCache::setFor(uint32_t nodeId, const char *sensorId) {
+    // FNV-1a over the node ID and sensor ID
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < 4; i++) {
+        hash ^= (nodeId >> (i * 8)) & 0xFF;
+        hash *= 16777619u;
+    }
+    for (const char *p = sensorId; *p; ++p) {
+        hash ^= (uint8_t)*p;
+        hash *= 16777619u;
+    }
+    return (hash & (ASCS_TOPIC_CACHE_SIZE / ASCS_TOPIC_CACHE_WAYS - 1)) * ASCS_TOPIC_CACHE_WAYS;
+}
+
+void ASCSTopicCache::clearCache() {
+    for (CacheEntry &entry : m_cache) {
+        entry.valid = false;
+        std::string().swap(entry.sensorId); // Releases the heap as well
+        std::string().swap(entry.prefix);
+    }
+    m_useCounter = 0;
+    m_hits = 0;
+    m_misses = 0;
+}
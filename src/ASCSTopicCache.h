@@ -0,0 +1,125 @@
+#ifndef ASCS_TOPIC_CACHE_H
+#define ASCS_TOPIC_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// --- Topic Template / Cache Constants ---
+
+#define ASCS_MQTT_TOPIC_MAX_LEN 128 // Max length of a rendered MQTT topic (including null terminator)
+#ifndef ASCS_TOPIC_CACHE_SIZE
+#define ASCS_TOPIC_CACHE_SIZE 256   // (node, sensor_id) prefixes kept rendered (power of two; ~150 bytes each with strings)
+#endif
+#define ASCS_TOPIC_CACHE_WAYS 8     // Entries per set (a set is picked by hash; the least recently used entry is replaced)
+#define ASCS_TOPIC_CACHE_SENSOR_ID_LEN 40 // Max sensor_id length cached (matches SensorData.sensor_id); longer ones are rendered every time
+
+/**
+ * @brief Compiled MQTT topic template with a bounded cache of rendered prefixes.
+ *
+ * A template such as "{base}/{service}/{node}/{sensor}/{key}" is parsed once by compile().
+ * Static placeholders ({base}, {service}) are baked into literal segments at that point, so
+ * only {node}, {sensor} and {key} are resolved per publish.
+ *
+ * Everything before {key} is the "prefix" of a topic. Prefixes are rendered once per
+ * (node, sensor_id) pair and kept in a set-associative cache with LRU replacement, sized for a
+ * gateway's whole district (ASCS_TOPIC_CACHE_SIZE pairs), so building a topic on the publish
+ * path costs a hash lookup, one memcpy of the prefix and an append of the key. With more
+ * active pairs than entries, the pairs heard least recently are rendered again.
+ */
+class ASCSTopicCache {
+public:
+    ASCSTopicCache();
+
+    /**
+     * @brief Parses a topic template and resolves its static placeholders.
+     * Supported placeholders: {base}, {service}, {node}, {sensor}, {key}.
+     * {key} is optional but, if present, must be the last element of the template.
+     * Clears any previously cached prefixes.
+     * @param topicTemplate The template string (e.g., "{base}/sensor/{service}/{node}/{sensor}").
+     * @param baseTopic Value substituted for {base}.
+     * @param serviceId Value substituted for {service}.
+     * @return True if the template was valid, false otherwise (the previous template is kept, getError() says why).
+     */
+    bool compile(const std::string &topicTemplate, const std::string &baseTopic, uint32_t serviceId);
+
+    /**
+     * @brief Why the last compile() failed (empty after a successful one).
+     */
+    const std::string &getError() const { return m_error; }
+
+    /**
+     * @brief Whether the compiled template ends in {key} (one topic per reading).
+     */
+    bool hasKey() const { return m_hasKey; }
+
+    /**
+     * @brief Writes the topic prefix for a (node, sensor_id) pair into 'out'.
+     * Uses the cache when possible, rendering and caching the prefix on a miss.
+     * @param nodeId Originating Node ID.
+     * @param sensorId Sensor ID from the packet (may be empty).
+     * @param out Destination buffer.
+     * @param outSize Size of 'out' in bytes.
+     * @param length Set to the length of the prefix written (excluding null terminator); may be 0,
+     *               e.g. for the template "{key}".
+     * @return False if the prefix does not fit in 'out'.
+     */
+    bool buildPrefix(uint32_t nodeId, const char *sensorId, char *out, size_t outSize, size_t &length);
+
+    /**
+     * @brief Appends a reading key to a prefix previously written by buildPrefix().
+     * @param out Buffer containing the prefix.
+     * @param prefixLen Length of the prefix in 'out'.
+     * @param outSize Size of 'out' in bytes.
+     * @param key The reading key to append.
+     * @return False if the topic does not fit in 'out'.
+     */
+    static bool appendKey(char *out, size_t prefixLen, size_t outSize, const char *key);
+
+    /**
+     * @brief Formats a Node ID as 8 lowercase hex characters (no null terminator written).
+     */
+    static void formatNodeHex(uint32_t nodeId, char *out);
+
+    // Cache statistics (useful for diagnostics)
+    uint32_t getHits() const { return m_hits; }
+    uint32_t getMisses() const { return m_misses; }
+
+private:
+    // Dynamic element types of a compiled template
+    enum SegmentType : uint8_t {
+        SEGMENT_LITERAL,
+        SEGMENT_NODE,
+        SEGMENT_SENSOR
+    };
+
+    struct Segment {
+        SegmentType type;
+        std::string literal; // Only used for SEGMENT_LITERAL
+    };
+
+    struct CacheEntry {
+        bool valid = false;
+        uint32_t nodeId = 0;
+        uint32_t lastUsed = 0; // m_useCounter at the last hit or fill (LRU within the set)
+        std::string sensorId;
+        std::string prefix;    // Rendered prefix (heap only as long as needed)
+    };
+
+    // Renders the prefix without consulting the cache, setting 'length'. Returns false on overflow.
+    bool renderPrefix(uint32_t nodeId, const char *sensorId, char *out, size_t outSize, size_t &length) const;
+    // First entry of the set of a (node, sensor_id) pair
+    static size_t setFor(uint32_t nodeId, const char *sensorId);
+    void clearCache();
+
+    std::vector<Segment> m_segments; // Compiled prefix (everything before {key})
+    bool m_hasKey = false;
+    std::string m_error; // Reason the last compile() failed
+    CacheEntry m_cache[ASCS_TOPIC_CACHE_SIZE];
+    uint32_t m_useCounter = 0;
+    uint32_t m_hits = 0;
+    uint32_t m_misses = 0;
+};
+
+#endif // ASCS_TOPIC_CACHE_H
@@ -0,0 +1,69 @@
+#include "ASCSTrickleTimer.h"
+
+void ASCSTrickleTimer::configure(uint32_t intervalMinMs, uint32_t intervalMaxMs, uint32_t redundancy, uint32_t maxSilenceMs) {
+    m_intervalMin = intervalMinMs > 0 ? intervalMinMs : 1;
+    m_intervalMax = intervalMaxMs > m_intervalMin ? intervalMaxMs : m_intervalMin;
+    m_redundancy = redundancy;
+    m_maxSilence = maxSilenceMs;
+}
+
+void ASCSTrickleTimer::start(unsigned long now) {
+    m_interval = m_intervalMin;
+    beginInterval(now);
+}
+
+void ASCSTrickleTimer::reset(unsigned long now) {
+    if (m_interval == m_intervalMin) return; // Already fast; restarting would only delay the due time
+    m_stats.resets++;
+    start(now);
+}
+
+bool ASCSTrickleTimer::poll(unsigned long now) {
+    if (m_interval == 0) start(now); // Not started yet
+
+    bool send = false;
+    if (!m_dueDone && now - m_intervalStart >= m_dueOffset) {
+        m_dueDone = true;
+        bool silentTooLong = m_maxSilence > 0 && (!m_everSent || now - m_lastSent >= m_maxSilence);
+        if (m_hasTraffic && now - m_lastTraffic < m_interval) {
+            m_stats.replaced++; // Neighbours heard our role within the last interval anyway
+        } else if (m_redundancy == 0 || m_heard < m_redundancy || silentTooLong) {
+            send = true;
+            m_everSent = true;
+            m_lastSent = now;
+            m_stats.sent++;
+        } else {
+            m_stats.suppressed++;
+        }
+    }
+
+    if (now - m_intervalStart >= m_interval) {
+        // Interval over: double it (up to the max) and pick the next due time
+        m_interval = (m_interval > m_intervalMax / 2) ? m_intervalMax : m_interval * 2;
+        beginInterval(now);
+    }
+    return send;
+}
+
+void ASCSTrickleTimer::noteAnnounced(unsigned long now) {
+    m_hasTraffic = true;
+    m_lastTraffic = now;
+    m_everSent = true;
+    m_lastSent = now;
+}
+
+void ASCSTrickleTimer::beginInterval(unsigned long now) {
+    m_intervalStart = now;
+    m_heard = 0;
+    m_dueDone = false;
+    uint32_t half = m_interval / 2;
+    m_dueOffset = half + (m_interval - half > 0 ? nextRandom() % (m_interval - half) : 0);
+}
+
+uint32_t ASCSTrickleTimer::nextRandom() {
+    // xorshift32: enough to spread due times; no need for the hardware RNG here
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 17;
+    m_random ^= m_random << 5;
+    return m_random;
+}
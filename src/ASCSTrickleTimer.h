@@ -0,0 +1,104 @@
+#ifndef ASCS_TRICKLE_TIMER_H
+#define ASCS_TRICKLE_TIMER_H
+
+#include <stdint.h>
+
+/**
+ * @brief Counters of the discovery timer (logged with the service table cleanup).
+ */
+struct ASCSTrickleStats {
+    uint32_t sent = 0;       // Announcements due and sent
+    uint32_t suppressed = 0; // Announcements skipped because enough matching ones were heard
+    uint32_t resets = 0;     // Returns to the fastest interval after a topology change
+    uint32_t replaced = 0;   // Announcements not needed because other traffic carried our role recently
+};
+
+/**
+ * @brief Trickle-style timer (RFC 6206) for the periodic service discovery announcement.
+ *
+ * - Each interval I, the announcement is due at a random time in [I/2, I). It is skipped if
+ *   'redundancy' matching announcements (hearConsistent()) were heard in the interval so far.
+ * - At the end of each interval, I doubles up to the max interval: a stable mesh quickly goes
+ *   quiet.
+ * - reset() (topology change, e.g., a new, changed or lost gateway) returns to the min interval,
+ *   so news spreads fast.
+ * - start() begins at the min interval with a random due time, so nodes that power up together
+ *   (e.g., after a city-wide power restore) do not all announce at the same moment.
+ *
+ * An announcement is never skipped as redundant if the last one is older than 'maxSilenceMs',
+ * so neighbours do not time the node out of their service tables.
+ *
+ * Other packets carrying the node's role and service ID (noteAnnounced()) count as
+ * announcements: a standalone one is only sent after a full interval without such traffic.
+ */
+class ASCSTrickleTimer {
+public:
+    ASCSTrickleTimer() = default;
+
+    /**
+     * @param intervalMinMs Fastest interval (after start or reset).
+     * @param intervalMaxMs Slowest interval. Values below 'intervalMinMs' are raised to it.
+     * @param redundancy Matching announcements per interval that make ours redundant (0 = never skip).
+     * @param maxSilenceMs Longest time without an announcement (0 = no limit).
+     */
+    void configure(uint32_t intervalMinMs, uint32_t intervalMaxMs, uint32_t redundancy, uint32_t maxSilenceMs);
+
+    /**
+     * @brief Seeds the due time randomization. Use something unique to the node (e.g., its node number).
+     */
+    void seed(uint32_t value) { m_random = value ? value : 1; }
+
+    /**
+     * @brief Begins the first (fastest) interval.
+     */
+    void start(unsigned long now);
+
+    /**
+     * @brief Topology changed: restarts at the fastest interval unless already there.
+     */
+    void reset(unsigned long now);
+
+    /**
+     * @brief An announcement carrying the same information as ours was heard.
+     */
+    void hearConsistent() { m_heard++; }
+
+    /**
+     * @brief Our role and service ID went out in another packet (e.g., piggybacked on SensorData).
+     */
+    void noteAnnounced(unsigned long now);
+
+    /**
+     * @brief Advances the timer.
+     * @return True if the announcement is due now and should be sent.
+     */
+    bool poll(unsigned long now);
+
+    uint32_t getInterval() const { return m_interval; }
+    // Time of the next due announcement (millis()), which may still be skipped.
+    unsigned long getNextDue() const { return m_intervalStart + m_dueOffset; }
+    const ASCSTrickleStats &getStats() const { return m_stats; }
+
+private:
+    void beginInterval(unsigned long now);
+    uint32_t nextRandom();
+
+    uint32_t m_intervalMin = 10000;
+    uint32_t m_intervalMax = 300000;
+    uint32_t m_redundancy = 0;
+    uint32_t m_maxSilence = 0;
+
+    uint32_t m_interval = 0;
+    unsigned long m_intervalStart = 0;
+    uint32_t m_dueOffset = 0;     // Due time within the current interval
+    bool m_dueDone = true;        // Due time of the current interval already handled
+    uint32_t m_heard = 0;         // Matching announcements heard in the current interval
+    bool m_everSent = false;
+    unsigned long m_lastSent = 0;     // Last announcement, standalone or carried by other traffic
+    bool m_hasTraffic = false;
+    unsigned long m_lastTraffic = 0;  // Last noteAnnounced()
+    uint32_t m_random = 1;        // xorshift32 state
+    ASCSTrickleStats m_stats;
+};
+
+#endif // ASCS_TRICKLE_TIMER_H
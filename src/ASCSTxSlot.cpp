@@ -0,0 +1,87 @@
+#include "ASCSTxSlot.h"
+
+void ASCSTxSlot::configure(uint32_t nodeId, uint32_t serviceId, uint32_t periodMs, uint32_t slotMs) {
+    m_nodeId = nodeId;
+    m_serviceId = serviceId;
+    m_periodMs = periodMs;
+    m_slotMs = slotMs;
+    m_slots = (slotMs > 0 && slotMs < periodMs) ? periodMs / slotMs : 0;
+    m_salt = 0;
+    m_slot = m_slots > 1 ? slotFor(nodeId, serviceId, m_salt, m_slots) : 0;
+}
+
+void ASCSTxSlot::reslot() {
+    if (!isEnabled()) return;
+    uint32_t previous = m_slot;
+    do { // A different salt may hash to the same slot
+        m_slot = slotFor(m_nodeId, m_serviceId, ++m_salt, m_slots);
+    } while (m_slot == previous);
+}
+
+uint32_t ASCSTxSlot::slotFor(uint32_t nodeId, uint32_t serviceId, uint32_t salt, uint32_t slots) {
+    // murmur3 finalizer: sequential node IDs land in unrelated slots
+    uint32_t h = nodeId ^ (serviceId * 0x9E3779B1u) ^ (salt * 0x85EBCA6Bu);
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return slots > 0 ? h % slots : 0;
+}
+
+unsigned long ASCSTxSlot::nextSlot(unsigned long after, unsigned long now, uint32_t utcSeconds) const {
+    if (!isEnabled()) return after;
+
+    // Position of 'now' within the read interval
+    uint32_t phase = (utcSeconds >= ASCS_TX_SLOT_UTC_VALID)
+                         ? (uint32_t)(((uint64_t)utcSeconds * 1000) % m_periodMs)
+                         : (uint32_t)(now % m_periodMs);
+    // millis() at which the current interval started, then our slot in it
+    unsigned long slotStart = now - phase + getOffsetMs();
+    while ((long)(slotStart - after) < 0) slotStart += m_periodMs;
+    while ((long)(slotStart - after) >= (long)m_periodMs) slotStart -= m_periodMs;
+    return slotStart;
+}
+
+bool ASCSSlotLossMonitor::onReading(uint32_t nodeId, uint32_t sequence, unsigned long now) {
+    if (m_lossPct == 0) return false;
+
+    auto it = m_nodes.find(nodeId);
+    if (it == m_nodes.end()) {
+        if (m_nodes.size() >= ASCS_SLOT_MONITOR_MAX_NODES) {
+            auto oldest = m_nodes.begin();
+            for (auto candidate = m_nodes.begin(); candidate != m_nodes.end(); ++candidate) {
+                if (now - candidate->second.lastSeen > now - oldest->second.lastSeen) oldest = candidate;
+            }
+            m_nodes.erase(oldest);
+        }
+        NodeWindow &node = m_nodes[nodeId];
+        node.lastSequence = sequence;
+        node.lastSeen = now;
+        return false;
+    }
+
+    NodeWindow &node = it->second;
+    node.lastSeen = now;
+    if (sequence <= node.lastSequence) {
+        // Duplicate, or the sensor restarted its sequence (reboot): start a new window
+        if (sequence < node.lastSequence) {
+            node.expected = node.received = 0;
+            node.lastSequence = sequence;
+        }
+        return false;
+    }
+    uint32_t sent = sequence - node.lastSequence;
+    node.lastSequence = sequence;
+    node.expected = (uint16_t)(node.expected + (sent < ASCS_SLOT_MONITOR_WINDOW ? sent : ASCS_SLOT_MONITOR_WINDOW));
+    node.received++;
+    if (node.expected < ASCS_SLOT_MONITOR_WINDOW) return false;
+
+    bool lossy = (uint32_t)(node.expected - node.received) * 100 >= m_lossPct * node.expected;
+    node.expected = node.received = 0;
+    if (!lossy || (node.reported && now - node.lastReport < ASCS_SLOT_MONITOR_HOLDOFF_MS)) return false;
+    node.reported = true;
+    node.lastReport = now;
+    m_reports++;
+    return true;
+}
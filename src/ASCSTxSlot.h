@@ -0,0 +1,109 @@
+#ifndef ASCS_TX_SLOT_H
+#define ASCS_TX_SLOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+
+// --- Transmit Slot Constants ---
+
+#define ASCS_TX_SLOT_UTC_VALID 1600000000UL // UTC seconds below this mean the clock is not set yet
+#define ASCS_SLOT_MONITOR_MAX_NODES 64      // Sensors tracked by the gateway's loss monitor (least recently seen is evicted)
+#define ASCS_SLOT_MONITOR_WINDOW 20         // Readings a sensor should have sent before its loss is judged
+#define ASCS_SLOT_MONITOR_HOLDOFF_MS 1800000 // Min time between two reslot requests to one sensor
+
+/**
+ * @brief A Sensor's transmit slot within its read interval.
+ *
+ * The read interval is divided into slots of 'slotMs'. Each sensor reads (and transmits) at the
+ * start of one slot, picked by a hash of its node ID, service ID and a salt, so sensors that power
+ * up together (e.g., after a city-wide power restore) spread over the interval instead of all
+ * transmitting at the same moment, and stay spread: the slot is re-aligned on every read, so loop
+ * latency does not accumulate. reslot() changes the salt to move to another slot (e.g., when the
+ * gateway reports that this sensor's readings get lost).
+ *
+ * Slots are counted from the UTC epoch while the mesh time is set (so they line up across nodes
+ * and reboots), otherwise from boot.
+ */
+class ASCSTxSlot {
+public:
+    ASCSTxSlot() = default;
+
+    /**
+     * @param periodMs Read interval.
+     * @param slotMs Slot width (0 or >= periodMs: no slots, free-running).
+     */
+    void configure(uint32_t nodeId, uint32_t serviceId, uint32_t periodMs, uint32_t slotMs);
+
+    bool isEnabled() const { return m_slots > 1; }
+
+    /**
+     * @brief Moves to another slot (a different salt).
+     */
+    void reslot();
+
+    /**
+     * @brief Start of the first slot of ours at or after 'after'.
+     * @param after A millis() value.
+     * @param now Current millis(), at which 'utcSeconds' was read.
+     * @param utcSeconds Current UTC time, or 0 if unknown (slots are then counted from boot).
+     */
+    unsigned long nextSlot(unsigned long after, unsigned long now, uint32_t utcSeconds) const;
+
+    uint32_t getSlot() const { return m_slot; }
+    uint32_t getSlotCount() const { return m_slots; }
+    uint32_t getOffsetMs() const { return m_slot * m_slotMs; }
+
+    /**
+     * @brief Slot of a node (0 .. slots-1), by a hash of its IDs and the salt.
+     */
+    static uint32_t slotFor(uint32_t nodeId, uint32_t serviceId, uint32_t salt, uint32_t slots);
+
+private:
+    uint32_t m_nodeId = 0;
+    uint32_t m_serviceId = 0;
+    uint32_t m_periodMs = 0;
+    uint32_t m_slotMs = 0;
+    uint32_t m_slots = 0;
+    uint32_t m_salt = 0;
+    uint32_t m_slot = 0;
+};
+
+/**
+ * @brief Gateway side: watches the sequence numbers arriving from each sensor and reports those
+ * that lose too many readings, so they can be asked to move to another transmit slot.
+ */
+class ASCSSlotLossMonitor {
+public:
+    ASCSSlotLossMonitor() = default;
+
+    /**
+     * @param lossPct Loss (percent of the readings sent) that triggers a report (0 = never).
+     */
+    void configure(uint32_t lossPct) { m_lossPct = lossPct; }
+
+    /**
+     * @brief Records a reading that arrived.
+     * @return True if the sensor lost at least the configured share of its last
+     *         ASCS_SLOT_MONITOR_WINDOW readings (at most once per ASCS_SLOT_MONITOR_HOLDOFF_MS).
+     */
+    bool onReading(uint32_t nodeId, uint32_t sequence, unsigned long now);
+
+    uint32_t getReports() const { return m_reports; }
+
+private:
+    struct NodeWindow {
+        uint32_t lastSequence = 0;
+        uint16_t expected = 0; // Readings sent in the current window (from sequence numbers)
+        uint16_t received = 0;
+        unsigned long lastSeen = 0;
+        unsigned long lastReport = 0;
+        bool reported = false;
+    };
+
+    uint32_t m_lossPct = 0;
+    std::map<uint32_t, NodeWindow> m_nodes;
+    uint32_t m_reports = 0;
+};
+
+#endif // ASCS_TX_SLOT_H
@@ -0,0 +1,135 @@
+#include "ASCSTypedReadings.h"
+#include <math.h>
+
+ReadingType ASCSTypedReadings::typeOf(const ReadingTypes *types, const std::string &key) {
+    if (!types || types->empty()) return ReadingType::FLOAT;
+    auto type = types->find(key);
+    return type == types->end() ? ReadingType::FLOAT : type->second;
+}
+
+int ASCSTypedReadings::channelIndex(const std::string &key, size_t &nameLength) {
+    size_t separator = key.rfind(ASCS_BOOL_CHANNEL_SEPARATOR);
+    if (separator == std::string::npos || separator == 0) return -1;
+    size_t digits = key.length() - separator - 1;
+    if (digits == 0 || digits > 2 || (digits > 1 && key[separator + 1] == '0')) return -1; // No leading zeros
+    int index = 0;
+    for (size_t i = separator + 1; i < key.length(); i++) {
+        if (key[i] < '0' || key[i] > '9') return -1;
+        index = index * 10 + (key[i] - '0');
+    }
+    if (index >= ASCS_BOOL_GROUP_MAX) return -1;
+    nameLength = separator;
+    return index;
+}
+
+void ASCSTypedReadings::packBools(const std::map<std::string, float> &readings, const ReadingTypes &types,
+                                  std::vector<ASCSBoolGroup> &groups) {
+    groups.clear();
+    // Channels by name: bits set, indexes present
+    struct Channels {
+        uint32_t bits = 0;
+        uint32_t present = 0;
+    };
+    std::map<std::string, Channels> channels;
+    for (const auto &type : types) {
+        if (type.second != ReadingType::BOOL) continue;
+        auto reading = readings.find(type.first);
+        if (reading == readings.end()) continue;
+        size_t nameLength;
+        int index = channelIndex(type.first, nameLength);
+        if (index < 0) {
+            ASCSBoolGroup single;
+            single.key = type.first;
+            single.bits = reading->second != 0.0f ? 1 : 0;
+            groups.push_back(single);
+            continue;
+        }
+        Channels &group = channels[type.first.substr(0, nameLength)];
+        group.present |= 1UL << index;
+        if (reading->second != 0.0f) group.bits |= 1UL << index;
+    }
+
+    for (const auto &name : channels) {
+        uint32_t present = name.second.present;
+        if ((present & (present + 1)) == 0) {
+            // Indexes 0..n-1 without gaps: one bitfield
+            ASCSBoolGroup group;
+            group.key = name.first;
+            group.bits = name.second.bits;
+            while (present) {
+                group.count++;
+                present >>= 1;
+            }
+            groups.push_back(group);
+            continue;
+        }
+        for (int index = 0; index < ASCS_BOOL_GROUP_MAX; index++) {
+            if (!(present & (1UL << index))) continue;
+            ASCSBoolGroup single;
+            single.key = name.first + ASCS_BOOL_CHANNEL_SEPARATOR + std::to_string(index);
+            single.bits = (name.second.bits >> index) & 1;
+            groups.push_back(single);
+        }
+    }
+}
+
+void ASCSTypedReadings::unpackBools(const ASCSBoolGroup &group, std::map<std::string, float> &readings, ReadingTypes &types) {
+    if (group.count == 0) {
+        readings[group.key] = (group.bits & 1) ? 1.0f : 0.0f;
+        types[group.key] = ReadingType::BOOL;
+        return;
+    }
+    uint32_t count = group.count > ASCS_BOOL_GROUP_MAX ? ASCS_BOOL_GROUP_MAX : group.count;
+    for (uint32_t index = 0; index < count; index++) {
+        std::string key = group.key + ASCS_BOOL_CHANNEL_SEPARATOR + std::to_string(index);
+        readings[key] = ((group.bits >> index) & 1) ? 1.0f : 0.0f;
+        types[key] = ReadingType::BOOL;
+    }
+}
+
+int32_t ASCSTypedReadings::toInt(float value) {
+    if (!(value == value)) return 0; // NaN
+    if (value >= 2147483647.0f) return INT32_MAX;
+    if (value <= -2147483648.0f) return INT32_MIN;
+    return (int32_t)lroundf(value);
+}
+
+size_t ASCSTypedReadings::varintSize(uint32_t value) {
+    size_t bytes = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        bytes++;
+    }
+    return bytes;
+}
+
+size_t ASCSTypedReadings::encodedSize(const std::map<std::string, float> &readings, const ReadingTypes *types, size_t keyPrefix /*= 0*/) {
+    size_t bytes = 0;
+    for (const auto &reading : readings) {
+        size_t key = 1 + varintSize(keyPrefix + reading.first.length()) + keyPrefix + reading.first.length();
+        size_t entry;
+        switch (typeOf(types, reading.first)) {
+            case ReadingType::BOOL:
+                continue; // Counted with their group below
+            case ReadingType::INT: {
+                int32_t value = toInt(reading.second);
+                entry = key + 1 + varintSize(((uint32_t)value << 1) ^ (uint32_t)(value >> 31)); // Zigzag
+                break;
+            }
+            default:
+                entry = key + 5; // Tag + float
+                break;
+        }
+        bytes += 1 + varintSize(entry) + entry; // Field tag + length + entry
+    }
+    if (types && !types->empty()) {
+        std::vector<ASCSBoolGroup> groups;
+        packBools(readings, *types, groups);
+        for (const ASCSBoolGroup &group : groups) {
+            size_t entry = 1 + varintSize(keyPrefix + group.key.length()) + keyPrefix + group.key.length() +
+                           1 + varintSize(group.bits) + 1 + varintSize(group.count);
+            bytes += 1 + varintSize(entry) + entry;
+        }
+    }
+    return bytes;
+}
@@ -0,0 +1,68 @@
+#ifndef ASCS_TYPED_READINGS_H
+#define ASCS_TYPED_READINGS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "interfaces/ReadingType.h"
+
+// --- Typed Readings Constants ---
+
+#define ASCS_BOOL_GROUP_MAX 32             // Channels in one bitfield (bits of SensorData.bools.bits)
+#define ASCS_BOOL_CHANNEL_SEPARATOR '_'    // Boolean channels are keyed "<name>_<index>"
+
+/**
+ * @brief Boolean readings in one bitfield (SensorData.bools entry).
+ */
+struct ASCSBoolGroup {
+    std::string key;    // The boolean's key, or the name of channels "<key>_0".."<key>_<count-1>"
+    uint32_t bits = 0;  // Bit n = channel n (a single boolean: bit 0)
+    uint32_t count = 0; // Channels; 0 = the single boolean 'key'
+};
+
+/**
+ * @brief Encoding of typed readings (ReadingType) in SensorData.
+ *
+ * FLOAT readings stay in the `readings` map (4 bytes plus key). INT readings go in `ints` as
+ * zigzag varints. BOOL readings go in `bools`: channels keyed "<name>_0" .. "<name>_<n-1>" (e.g.
+ * the 16 bays of a parking row) share one entry holding the name once and a bitfield, so they
+ * cost a few bytes instead of n map entries. Channels only group when their indexes run from 0
+ * without gaps (at most ASCS_BOOL_GROUP_MAX); other booleans get an entry each.
+ */
+class ASCSTypedReadings {
+public:
+    /**
+     * @brief Type of a key ('types' may be null: everything is FLOAT).
+     */
+    static ReadingType typeOf(const ReadingTypes *types, const std::string &key);
+
+    /**
+     * @brief Groups the BOOL readings into bitfields (in key order).
+     */
+    static void packBools(const std::map<std::string, float> &readings, const ReadingTypes &types, std::vector<ASCSBoolGroup> &groups);
+
+    /**
+     * @brief Adds the booleans of a received group to the readings (1.0 / 0.0), typed BOOL.
+     */
+    static void unpackBools(const ASCSBoolGroup &group, std::map<std::string, float> &readings, ReadingTypes &types);
+
+    /**
+     * @brief Value of an INT reading: rounded to the nearest whole number and clamped to int32.
+     */
+    static int32_t toInt(float value);
+
+    /**
+     * @brief Encoded size in SensorData of the readings (readings, bools and ints fields), with keys
+     * 'keyPrefix' bytes longer (combined packets).
+     */
+    static size_t encodedSize(const std::map<std::string, float> &readings, const ReadingTypes *types, size_t keyPrefix = 0);
+
+private:
+    // Channel index of a key "<name>_<index>" (-1 if it has none); 'nameLength' is set to the length of <name>
+    static int channelIndex(const std::string &key, size_t &nameLength);
+    static size_t varintSize(uint32_t value);
+};
+
+#endif // ASCS_TYPED_READINGS_H
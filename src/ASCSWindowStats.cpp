@@ -0,0 +1,70 @@
+#include "ASCSWindowStats.h"
+#include "ASCSConfigList.h"
+#include <math.h>
+
+uint8_t ASCSWindowStats::parseOutputs(const std::string &outputs) {
+    uint8_t flags = 0;
+    for (const std::string &name : ASCSConfigList::split(outputs)) {
+        if (name == "mean") flags |= ASCS_STATS_MEAN;
+        else if (name == "min") flags |= ASCS_STATS_MIN;
+        else if (name == "max") flags |= ASCS_STATS_MAX;
+        else if (name == "std") flags |= ASCS_STATS_STD;
+        else if (name == "n") flags |= ASCS_STATS_COUNT;
+    }
+    return flags ? flags : ASCS_STATS_MEAN; // Nothing recognized: at least the mean
+}
+
+void ASCSWindowStats::add(const std::map<std::string, float> &readings) {
+    for (const auto &reading : readings) {
+        float value = reading.second;
+        if (isnan(value)) continue;
+        KeyStats *stats = nullptr;
+        for (KeyStats &candidate : m_keys) {
+            if (candidate.key == reading.first) {
+                stats = &candidate;
+                break;
+            }
+        }
+        if (!stats) {
+            m_keys.push_back({reading.first, 0, 0.0f, 0.0f, value, value});
+            stats = &m_keys.back();
+        }
+        if (stats->count == 0) {
+            stats->min = value; // First sample of the window
+            stats->max = value;
+        }
+        // Welford: update the mean and the squared deviations in one pass
+        stats->count++;
+        float delta = value - stats->mean;
+        stats->mean += delta / (float)stats->count;
+        stats->m2 += delta * (value - stats->mean);
+        if (value < stats->min) stats->min = value;
+        if (value > stats->max) stats->max = value;
+    }
+}
+
+uint32_t ASCSWindowStats::getCount() const {
+    uint32_t count = 0;
+    for (const KeyStats &stats : m_keys) {
+        if (stats.count > count) count = stats.count;
+    }
+    return count;
+}
+
+void ASCSWindowStats::summarize(uint8_t outputs, std::map<std::string, float> &summary) {
+    summary.clear();
+    for (KeyStats &stats : m_keys) {
+        if (stats.count == 0) continue;
+        if (outputs & ASCS_STATS_MEAN) summary[stats.key + "_mean"] = stats.mean;
+        if (outputs & ASCS_STATS_MIN) summary[stats.key + "_min"] = stats.min;
+        if (outputs & ASCS_STATS_MAX) summary[stats.key + "_max"] = stats.max;
+        if (outputs & ASCS_STATS_STD) summary[stats.key + "_std"] = stats.count > 1 ? sqrtf(stats.m2 / (float)(stats.count - 1)) : 0.0f;
+        if (outputs & ASCS_STATS_COUNT) summary[stats.key + "_n"] = (float)stats.count;
+    }
+    // Next window: keep the keys (no reallocation), reset their accumulators
+    for (KeyStats &stats : m_keys) {
+        stats.count = 0;
+        stats.mean = 0.0f;
+        stats.m2 = 0.0f;
+    }
+}
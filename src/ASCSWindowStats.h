@@ -0,0 +1,64 @@
+#ifndef ASCS_WINDOW_STATS_H
+#define ASCS_WINDOW_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// --- Window Statistics Constants ---
+
+#define ASCS_STATS_MEAN  0x01 // "<key>_mean"
+#define ASCS_STATS_MIN   0x02 // "<key>_min"
+#define ASCS_STATS_MAX   0x04 // "<key>_max"
+#define ASCS_STATS_STD   0x08 // "<key>_std" (sample standard deviation)
+#define ASCS_STATS_COUNT 0x10 // "<key>_n" (samples in the window)
+
+/**
+ * @brief Running statistics of a sensor's readings over a window, per reading key.
+ *
+ * Each key keeps count, mean and sum of squared deviations (Welford's update, stable in single
+ * precision), minimum and maximum: constant memory however many samples the window holds.
+ * summarize() turns them into derived keys ("noise_db_mean", "noise_db_max", ...) and starts
+ * the next window.
+ */
+class ASCSWindowStats {
+public:
+    ASCSWindowStats() = default;
+
+    /**
+     * @brief Parses a comma-separated list of outputs ("mean,min,max,std,n") into ASCS_STATS_* flags.
+     */
+    static uint8_t parseOutputs(const std::string &outputs);
+
+    /**
+     * @brief Adds one sample of every key in 'readings'.
+     */
+    void add(const std::map<std::string, float> &readings);
+
+    /**
+     * @brief Samples in the current window (of the key with the most).
+     */
+    uint32_t getCount() const;
+
+    /**
+     * @brief Writes the derived keys of the window to 'summary' (after clearing it) and starts a new window.
+     * @param outputs ASCS_STATS_* flags.
+     */
+    void summarize(uint8_t outputs, std::map<std::string, float> &summary);
+
+private:
+    struct KeyStats {
+        std::string key;
+        uint32_t count;
+        float mean;
+        float m2; // Sum of squared deviations from the mean
+        float min;
+        float max;
+    };
+
+    std::vector<KeyStats> m_keys;
+};
+
+#endif // ASCS_WINDOW_STATS_H
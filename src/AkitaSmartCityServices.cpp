@@ -9,13 +9,10 @@
 // Required Libraries (conditional includes for Gateway role)
 #ifdef ASCS_ROLE_GATEWAY
 #include <WiFi.h>          // For WiFi connectivity
-#include <PubSubClient.h>  // For MQTT client
-#include <ArduinoJson.h>   // For formatting MQTT payload as JSON
-
-// Choose ONE filesystem library:
-#include <SPIFFS.h>        // Option 1: Default ESP32 filesystem
-// #include <LittleFS.h>   // Option 2: Often preferred on ESP32 for wear leveling
-#define FileSystem SPIFFS  // Define which filesystem to use (SPIFFS or LittleFS)
+#include "ASCSFileSystem.h" // Filesystem for spill files (SPIFFS or LittleFS)
+#include "ASCSMqttSink.h"          // MQTT output
+#include "ASCSLineProtocolSink.h"  // InfluxDB line protocol over TCP
+#include "ASCSFileSink.h"          // Append-only local file
 #endif
 
 // Nanopb includes
@@ -94,6 +91,12 @@ bool AkitaSmartCityServices::encode_map_callback(pb_ostream_t *stream, const pb_
 
     // Iterate through the map elements as long as encoding is successful
     while (context->encode_successful && context->map_iterator != map_to_encode.end()) {
+        // Booleans and whole numbers typed as such go in the 'bools' and 'ints' fields instead
+        if (ASCSTypedReadings::typeOf(context->types_ptr, context->map_iterator->first) != ReadingType::FLOAT) {
+            ++(context->map_iterator);
+            continue;
+        }
+
         // Define the structure of the submessage (map entry) - must match the implicit structure expected by map fields
         // message MapStringFloatEntry { string key = 1; float value = 2; }
         struct Entry {
@@ -202,21 +205,163 @@ bool AkitaSmartCityServices::decode_map_callback(pb_istream_t *stream, const pb_
     return true; // Successfully decoded this entry
 }
 
+// message BoolChannels { string key = 1; uint32 bits = 2; uint32 count = 3; }
+struct BoolChannelsEntry {
+    pb_callback_t key;
+    uint32_t bits;
+    uint32_t count;
+};
+static const pb_field_t bool_channels_fields[] = {
+    PB_FIELD(  1, STRING  , REQUIRED, CALLBACK, 0, 0, 0),
+    PB_FIELD(  2, UINT32  , REQUIRED, STATIC  , OTHER, BoolChannelsEntry, key, 0),
+    PB_FIELD(  3, UINT32  , REQUIRED, STATIC  , OTHER, BoolChannelsEntry, bits, 0),
+    PB_LAST_FIELD
+};
+
+// Entry of map<string, sint32>: { string key = 1; sint32 value = 2; }
+struct IntEntry {
+    pb_callback_t key;
+    int32_t value;
+};
+static const pb_field_t int_entry_fields[] = {
+    PB_FIELD(  1, STRING  , REQUIRED, CALLBACK, 0, 0, 0),
+    PB_FIELD(  2, SINT32  , REQUIRED, STATIC  , OTHER, IntEntry, key, 0),
+    PB_LAST_FIELD
+};
+
+/**
+ * @brief Nanopb ENCODE callback for the 'bools' field: one BoolChannels entry per bitfield
+ * (ASCSTypedReadings::packBools()).
+ */
+bool AkitaSmartCityServices::encode_bools_callback(pb_ostream_t *stream, const pb_field_t *field, void * const *arg) {
+    MapCallbackContext* context = static_cast<MapCallbackContext*>(*arg);
+    if (!context || !context->map_ptr) return false;
+    if (!context->types_ptr || context->types_ptr->empty()) return true; // No typed readings
+
+    std::vector<ASCSBoolGroup> groups;
+    ASCSTypedReadings::packBools(*context->map_ptr, *context->types_ptr, groups);
+    for (const ASCSBoolGroup &group : groups) {
+        BoolChannelsEntry entry;
+        entry.key.funcs.encode = pb_encode_string_helper;
+        entry.key.arg = (void*)&group.key;
+        entry.bits = group.bits;
+        entry.count = group.count;
+        if (!pb_encode_tag_for_field(stream, field) || !pb_encode_submessage(stream, bool_channels_fields, &entry)) {
+            Log.printf(LOG_LEVEL_ERROR, "ASCS Nanopb Encode Bools: Failed to encode '%s': %s\n", group.key.c_str(), PB_GET_ERROR(stream));
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Nanopb DECODE callback for the 'bools' field: adds each channel to the map as 1.0/0.0, typed BOOL.
+ */
+bool AkitaSmartCityServices::decode_bools_callback(pb_istream_t *stream, const pb_field_t *field, void **arg) {
+    MapCallbackContext* context = static_cast<MapCallbackContext*>(*arg);
+    if (!context || !context->map_ptr || !context->types_ptr) return false;
+
+    std::string key;
+    BoolChannelsEntry entry;
+    entry.key.funcs.decode = pb_decode_string_helper;
+    entry.key.arg = &key;
+    entry.bits = 0;
+    entry.count = 0;
+    if (!pb_decode(stream, bool_channels_fields, &entry)) {
+        Log.printf(LOG_LEVEL_ERROR, "ASCS Nanopb Decode Bools: Failed to decode entry: %s\n", PB_GET_ERROR(stream));
+        return false;
+    }
+
+    ASCSBoolGroup group;
+    group.key = key;
+    group.bits = entry.bits;
+    group.count = entry.count;
+    try {
+        ASCSTypedReadings::unpackBools(group, *context->map_ptr, *context->types_ptr);
+    } catch (const std::bad_alloc& e) {
+        Log.printf(LOG_LEVEL_ERROR, "ASCS Nanopb Decode Bools: Failed to allocate memory for '%s'\n", key.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Nanopb ENCODE callback for the 'ints' field: the INT readings as zigzag varints.
+ */
+bool AkitaSmartCityServices::encode_ints_callback(pb_ostream_t *stream, const pb_field_t *field, void * const *arg) {
+    MapCallbackContext* context = static_cast<MapCallbackContext*>(*arg);
+    if (!context || !context->map_ptr) return false;
+    if (!context->types_ptr || context->types_ptr->empty()) return true; // No typed readings
+
+    for (const auto &type : *context->types_ptr) {
+        if (type.second != ReadingType::INT) continue;
+        auto reading = context->map_ptr->find(type.first);
+        if (reading == context->map_ptr->end()) continue;
+        IntEntry entry;
+        entry.key.funcs.encode = pb_encode_string_helper;
+        entry.key.arg = (void*)&reading->first;
+        entry.value = ASCSTypedReadings::toInt(reading->second);
+        if (!pb_encode_tag_for_field(stream, field) || !pb_encode_submessage(stream, int_entry_fields, &entry)) {
+            Log.printf(LOG_LEVEL_ERROR, "ASCS Nanopb Encode Ints: Failed to encode '%s': %s\n", reading->first.c_str(), PB_GET_ERROR(stream));
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Nanopb DECODE callback for the 'ints' field: adds the entry to the map, typed INT.
+ */
+bool AkitaSmartCityServices::decode_ints_callback(pb_istream_t *stream, const pb_field_t *field, void **arg) {
+    MapCallbackContext* context = static_cast<MapCallbackContext*>(*arg);
+    if (!context || !context->map_ptr || !context->types_ptr) return false;
+
+    std::string key;
+    IntEntry entry;
+    entry.key.funcs.decode = pb_decode_string_helper;
+    entry.key.arg = &key;
+    entry.value = 0;
+    if (!pb_decode(stream, int_entry_fields, &entry)) {
+        Log.printf(LOG_LEVEL_ERROR, "ASCS Nanopb Decode Ints: Failed to decode entry: %s\n", PB_GET_ERROR(stream));
+        return false;
+    }
+    try {
+        (*context->map_ptr)[key] = (float)entry.value;
+        (*context->types_ptr)[key] = ReadingType::INT;
+    } catch (const std::bad_alloc& e) {
+        Log.printf(LOG_LEVEL_ERROR, "ASCS Nanopb Decode Ints: Failed to allocate memory for '%s'\n", key.c_str());
+        return false;
+    }
+    return true;
+}
+
+void AkitaSmartCityServices::setReadingsEncoder(SensorData &sensorData, MapCallbackContext &context) {
+    sensorData.readings.funcs.encode = encode_map_callback;
+    sensorData.readings.arg = &context;
+    sensorData.bools.funcs.encode = encode_bools_callback;
+    sensorData.bools.arg = &context;
+    sensorData.ints.funcs.encode = encode_ints_callback;
+    sensorData.ints.arg = &context;
+}
+
+void AkitaSmartCityServices::setReadingsDecoder(SensorData &sensorData, MapCallbackContext &context) {
+    sensorData.readings.funcs.decode = decode_map_callback;
+    sensorData.readings.arg = &context;
+    sensorData.bools.funcs.decode = decode_bools_callback;
+    sensorData.bools.arg = &context;
+    sensorData.ints.funcs.decode = decode_ints_callback;
+    sensorData.ints.arg = &context;
+}
+
 
 // --- Constructor / Destructor ---
 
 AkitaSmartCityServices::AkitaSmartCityServices(const char *name) : MeshtasticPlugin(name) {
-    // Initialize pointers to null
-    m_wifiClient = nullptr;
-    m_mqttClient = nullptr;
     s_instance = this; // Set static instance pointer for MQTT callback
 }
 
 AkitaSmartCityServices::~AkitaSmartCityServices() {
-    // Clean up dynamically allocated resources
-    delete m_mqttClient;
-    delete m_wifiClient;
-    // unique_ptr for m_sensor handles its own deletion
+    // unique_ptrs in m_sensors and m_sinks handle their own deletion
     if (s_instance == this) {
         s_instance = nullptr; // Clear static instance if this was the one
     }
@@ -235,24 +380,55 @@ void AkitaSmartCityServices::init(const MeshtasticAPI *api) {
                getName(), m_config.getNodeRole(), m_config.getServiceId(), m_config.getTargetNodeId(),
                m_config.getSensorReadIntervalMs(), m_config.getDiscoveryIntervalMs());
 
+    // Gateway selection: required cost gain before switching to another gateway
+    m_serviceTable.setSwitchHysteresis(m_config.getGatewaySwitchPct() / 100.0f);
+    m_hashGatewaySelection = (m_config.getGatewaySelection() == "hash");
+    if (m_hashGatewaySelection) {
+        Log.printf(LOG_LEVEL_INFO, "[%s] Gateway selection: hashed over all usable gateways (weighted by capacity).\n", getName());
+    } else if (m_config.getGatewaySelection() != "cost") {
+        Log.printf(LOG_LEVEL_WARNING, "[%s] Unknown gw_select '%s', using 'cost'.\n", getName(), m_config.getGatewaySelection().c_str());
+    }
+
+    // Gateways/Aggregators known before the restart, so data can go out as unicast right away
+    restoreServiceTable();
+
+    // Sensors and Aggregators hold data while no gateway is known (also across a restart)
+    if (m_config.getNodeRole() == ServiceDiscovery_Role_SENSOR || m_config.getNodeRole() == ServiceDiscovery_Role_AGGREGATOR) {
+        m_store.configure(m_config.getStoreMaxPackets(), m_config.getStoreFlushMs(), m_api->getMyNodeInfo()->node_num);
+        restoreStoredPackets();
+    }
+
+    // Sensors read in their own slot of the read interval, so a mass power-up does not make them all transmit together
+    if (m_config.getNodeRole() == ServiceDiscovery_Role_SENSOR) {
+        m_txSlot.configure(m_api->getMyNodeInfo()->node_num, m_config.getServiceId(), m_config.getSensorReadIntervalMs(), m_config.getTxSlotMs());
+        m_adaptive.configure(m_config.getSensorReadIntervalMs(), m_config.getSensorReadMinMs(), m_config.getSensorReadMaxMs(),
+                             m_config.getBatteryLowMv());
+        // Each sensor's schedule starts at our slot (plus its phase); free-running: one read interval after boot
+        scheduleSensors(m_txSlot.isEnabled() ? millis() : millis() + m_config.getSensorReadIntervalMs());
+        m_sensors.setSummaryOutputs(ASCSWindowStats::parseOutputs(m_config.getSensorStatsOutputs()));
+        m_deadband.configure(m_config.getSensorDeadbands(), m_config.getSensorHeartbeatMs());
+        m_events.configure(m_config.getEventDebounceMs());
+        m_priorityRules.configure(m_config.getPriorityKeys());
+        if (m_deadband.isEnabled()) {
+            Log.printf(LOG_LEVEL_INFO, "[%s] Deadbands '%s', heartbeat %lu ms.\n", getName(), m_config.getSensorDeadbands().c_str(),
+                       (unsigned long)m_config.getSensorHeartbeatMs());
+        }
+        if (m_adaptive.isEnabled()) {
+            Log.printf(LOG_LEVEL_INFO, "[%s] Adaptive read interval %lu..%lu ms (battery low below %lu mV).\n", getName(),
+                       (unsigned long)m_config.getSensorReadMinMs(), (unsigned long)m_config.getSensorReadMaxMs(),
+                       (unsigned long)m_config.getBatteryLowMv());
+        }
+        if (m_txSlot.isEnabled()) {
+            Log.printf(LOG_LEVEL_INFO, "[%s] Transmit slot %lu of %lu (offset %lu ms), %d sensor(s).\n", getName(),
+                       (unsigned long)m_txSlot.getSlot(), (unsigned long)m_txSlot.getSlotCount(),
+                       (unsigned long)m_txSlot.getOffsetMs(), (int)m_sensors.size());
+        }
+    }
+
     // Initialize network clients and filesystem if this node is a Gateway
     if (m_config.getNodeRole() == ServiceDiscovery_Role_GATEWAY) {
         #ifdef ASCS_ROLE_GATEWAY
             Log.println(LOG_LEVEL_INFO, "[%s] Initializing Gateway components...", getName());
-            // Allocate network clients
-            try {
-                m_wifiClient = new WiFiClient();
-                m_mqttClient = new PubSubClient(*m_wifiClient);
-            } catch (const std::bad_alloc& e) {
-                 Log.println(LOG_LEVEL_CRITICAL, "[%s] Failed to allocate memory for network clients!", getName());
-                 // Cannot proceed as Gateway without clients
-                 return;
-            }
-
-            m_mqttClient->setServer(m_config.getMqttServer().c_str(), m_config.getMqttPort());
-            m_mqttClient->setCallback(mqttCallback); // Set static callback
-            // Increase MQTT buffer size if needed for larger JSON payloads
-            // m_mqttClient->setBufferSize(512); // Example: 512 bytes
 
             // Initialize Filesystem for buffering
             // Note: Filesystem must be initialized *before* first use (e.g., in main setup())
@@ -261,17 +437,27 @@ void AkitaSmartCityServices::init(const MeshtasticAPI *api) {
                  Log.println(LOG_LEVEL_ERROR, "[%s] Filesystem not mounted! Gateway buffering disabled.", getName());
             } else {
                  Log.println(LOG_LEVEL_INFO, "[%s] Filesystem ready for buffering.", getName());
-                 // Optional: Check buffer file size, potentially clear if corrupted or too large on boot?
-                 // File file = FileSystem.open(ASCS_GATEWAY_BUFFER_FILENAME, FILE_READ);
-                 // if (file && file.size() > ASCS_GATEWAY_BUFFER_MAX_SIZE * 1.1) { // Example check
-                 //    Log.println(LOG_LEVEL_WARNING, "[%s] Buffer file seems too large, clearing.", getName());
-                 //    file.close();
-                 //    FileSystem.remove(ASCS_GATEWAY_BUFFER_FILENAME);
-                 // } else if (file) {
-                 //    file.close();
-                 // }
+                 // Optional: Check spill file sizes, potentially clear if corrupted or too large on boot?
             }
 
+            // Create the outputs (MQTT, line protocol, local file) listed in 'gw_sinks'
+            createGatewaySinks();
+            // Records buffered by an older firmware are replayed through the sinks' spill files
+            migrateLegacyBuffer();
+
+            // Per-origin-node rate limiting (protects the uplink from a misconfigured node)
+            m_rateLimiter.configure(m_config.getGatewayRatePerMin(), m_config.getGatewayRateBurst(), m_config.getGatewayExemptKeys());
+            if (m_rateLimiter.isEnabled()) {
+                Log.printf(LOG_LEVEL_INFO, "[%s] Rate limit: %lu records/min per node, burst %lu, exempt keys '%s'.\n", getName(),
+                           (unsigned long)m_config.getGatewayRatePerMin(), (unsigned long)m_config.getGatewayRateBurst(),
+                           m_config.getGatewayExemptKeys().c_str());
+            }
+            m_lastMetricsTime = millis();
+            // Sensors losing many readings are asked to move to another transmit slot
+            m_slotMonitor.configure(m_config.getGatewayReslotPct());
+            m_pollScheduler.configure(m_config.getGatewayPollIntervalMs(), m_config.getGatewayPollBatch(),
+                                      m_config.getGatewayPollAirtimePct());
+
             connectWiFi(); // Initial connection attempt (can block briefly)
         #else
             // This code block will only be reached if the role is set to Gateway in preferences,
@@ -281,9 +467,25 @@ void AkitaSmartCityServices::init(const MeshtasticAPI *api) {
         #endif
     }
 
-    // Send initial service discovery announcement regardless of role
-    sendServiceDiscovery();
-    m_lastDiscoverySendTime = millis();
+    // Outbound queue: time on air from the channel's modem settings, own airtime within the duty cycle
+    ASCSLoRaModem modem;
+    if (!ASCSLoRaAirtime::parse(m_config.getModem(), modem)) {
+        Log.printf(LOG_LEVEL_WARNING, "[%s] Unknown modem '%s', estimating airtime for LongFast.\n", getName(), m_config.getModem().c_str());
+    }
+    m_outbound.configure(modem, m_config.getDutyCyclePct());
+    Log.printf(LOG_LEVEL_INFO, "[%s] Modem SF%d/%lu Hz/4:%d (%lu ms for 50 bytes), duty cycle %lu%%.\n", getName(),
+               modem.spreadingFactor, (unsigned long)modem.bandwidthHz, modem.codingRate,
+               (unsigned long)m_outbound.airtimeMs(50), (unsigned long)m_config.getDutyCyclePct());
+
+    // Start the discovery timer regardless of role. The first announcement goes out after a
+    // random delay, so nodes powering up together (e.g., after a power restore) do not collide.
+    m_discoveryTimer.configure(m_config.getDiscoveryMinIntervalMs(), m_config.getDiscoveryIntervalMs(),
+                               m_config.getDiscoveryRedundancy(), m_config.getServiceTimeoutMs() / 3);
+    m_discoveryTimer.seed(m_api->getMyNodeInfo()->node_num);
+    m_discoveryTimer.start(millis());
+    Log.printf(LOG_LEVEL_INFO, "[%s] First discovery announcement in %lu ms (interval %lu..%lu ms).\n", getName(),
+               m_discoveryTimer.getNextDue() - millis(), (unsigned long)m_config.getDiscoveryMinIntervalMs(),
+               (unsigned long)m_config.getDiscoveryIntervalMs());
     m_lastServiceCleanupTime = millis();
     m_lastBufferProcessTime = millis(); // Initialize buffer processing timer
 
@@ -303,29 +505,94 @@ void AkitaSmartCityServices::loop() {
     // --- Role-Specific Periodic Actions ---
     ServiceDiscovery_Role current_role = m_config.getNodeRole();
 
-    if (current_role == ServiceDiscovery_Role_SENSOR && m_sensor != nullptr) {
-        if (now - m_lastSensorReadTime >= m_config.getSensorReadIntervalMs()) {
-            runSensorLogic();
-            m_lastSensorReadTime = now;
-            work_done = true;
+    if (current_role == ServiceDiscovery_Role_SENSOR && !m_sensors.empty()) {
+        bool polled = m_config.getPollMode() && m_pollIntervalMs > 0 &&
+                      now - m_lastPollTime < (unsigned long)ASCS_POLL_FALLBACK_INTERVALS * m_pollIntervalMs;
+        if (m_pollIntervalMs > 0 && !polled) {
+            // Polls stopped (gateway restarted or gone): send on our own again, and announce soon so a gateway polls us
+            Log.printf(LOG_LEVEL_INFO, "[%s] No poll for %lu ms, sending on our own.\n", getName(), now - m_lastPollTime);
+            m_pollIntervalMs = 0;
+            m_discoveryTimer.reset(now);
+        }
+        // State changes posted by the sensors (e.g., from an interrupt) go out now, whatever the schedule
+        if (pollSensorEvents(now)) work_done = true;
+        if (m_sensors.isReading()) {
+            // Reads in progress: check them without waiting for slow sensors, send once all are done
+            if (pollSensorReads(now)) work_done = true;
+        } else if (m_pollReplyPending) {
+            // Poll mode: answer our gateway's poll in our turn
+            if ((long)(now - m_pollReplyTime) >= 0) {
+                m_pollReplyPending = false;
+                m_sensors.takeAll(m_dueSensors); // Latest reading of every sensor
+                runSensorLogic(m_dueSensors, m_pollReplyTo);
+                m_lastSensorReadTime = now;
+                work_done = true;
+            }
+        } else if (polled) {
+            // The gateway decides when we send
+        } else {
+            if (m_txSlot.isEnabled() && !m_slotOnUtc && m_api->getAdjustedTime() >= ASCS_TX_SLOT_UTC_VALID) {
+                // Mesh time is known now: move to our slot counted from the UTC epoch, like the other nodes
+                scheduleSensors(m_lastSensorReadTime ? m_lastSensorReadTime + m_config.getSensorReadIntervalMs() / 2 : now);
+                Log.printf(LOG_LEVEL_INFO, "[%s] Mesh time set, transmit slot aligned to it.\n", getName());
+            }
+            // Every sensor due now, and those due shortly (read early, sent in the same packet)
+            if (m_sensors.takeDue(now, m_config.getSensorMergeWindowMs(), m_dueSensors)) {
+                runSensorLogic(m_dueSensors);
+                m_lastSensorReadTime = now;
+                work_done = true;
+            }
         }
     } else if (current_role == ServiceDiscovery_Role_GATEWAY) {
         #ifdef ASCS_ROLE_GATEWAY
             // Check network connections periodically
             checkWiFiConnection();
-            checkMQTTConnection(); // Handles reconnection attempts
-
-            // Process MQTT messages if connected
-            if (m_mqttClient && m_mqttClient->connected()) {
-                 if(m_mqttClient->loop()) work_done = true; // Let MQTT client handle keepalives, incoming messages
-
-                 // Process the message buffer if MQTT is connected
-                 // Check reasonably often, but not necessarily every loop iteration
-                 if (now - m_lastBufferProcessTime > 5000) { // Check buffer every 5 seconds
-                     processBufferedPackets(); // Attempt to send one buffered packet
-                     m_lastBufferProcessTime = now;
-                     work_done = true; // Assume buffer processing is work
-                 }
+
+            // Pass on records held by the rate limiter once their node has tokens again
+            if (m_rateLimiter.hasPending()) {
+                m_releasedRecords.clear();
+                m_rateLimiter.releaseReady(now, m_releasedRecords);
+                for (const ASCSBatchRecord &record : m_releasedRecords) {
+                    dispatchToSinks(record);
+                    work_done = true;
+                }
+            }
+
+            // Poll the next batch of sensors in poll mode (round-robin, within the airtime budget)
+            uint32_t pollNodes[ASCS_POLL_MAX_BATCH];
+            size_t pollCount = m_pollScheduler.nextBatch(now, pollNodes);
+            if (pollCount > 0) {
+                sendPollRequest(pollNodes, pollCount);
+                work_done = true;
+            }
+
+            // Periodic gateway metrics record (rate limiter and sink counters)
+            if (m_config.getGatewayMetricsIntervalMs() > 0 && now - m_lastMetricsTime >= m_config.getGatewayMetricsIntervalMs()) {
+                publishGatewayMetrics();
+                m_lastMetricsTime = now;
+                work_done = true;
+            }
+
+            for (auto &sink : m_sinks) {
+                sink->loop(); // Reconnects, keepalives, incoming messages
+
+                // Close the open batch once its window has elapsed (writes it, or spills it if unavailable)
+                if (sink->getBatcher().isDue(now)) {
+                    flushSinkBatch(*sink);
+                    work_done = true;
+                }
+            }
+
+            // Replay spill files of sinks that are available again.
+            // Check reasonably often, but not necessarily every loop iteration
+            if (now - m_lastBufferProcessTime > ASCS_GATEWAY_BUFFER_CHECK_MS) {
+                bool morePending = false;
+                for (auto &sink : m_sinks) {
+                    if (processBufferedPackets(*sink)) morePending = true;
+                }
+                // While a replay is in progress, continue on the next loop iteration
+                m_lastBufferProcessTime = morePending ? now - ASCS_GATEWAY_BUFFER_CHECK_MS : now;
+                work_done = true; // Assume buffer processing is work
             }
         #endif
     }
@@ -333,10 +600,19 @@ void AkitaSmartCityServices::loop() {
 
     // --- General Periodic Actions ---
 
-    // Periodic Service Discovery broadcast
-    if (now - m_lastDiscoverySendTime >= m_config.getDiscoveryIntervalMs()) {
+    // Service Discovery broadcast (Trickle timer: skipped if redundant, slower while the mesh is stable)
+    if (m_discoveryTimer.poll(now)) {
         sendServiceDiscovery();
-        m_lastDiscoverySendTime = now;
+        work_done = true;
+    }
+
+    // Discovery query while no gateway is known, and replies to other nodes' queries
+    if (runDiscoveryQuery(now)) {
+        work_done = true;
+    }
+    uint32_t querier;
+    while (m_discoveryReplies.popDue(now, querier)) {
+        sendServiceDiscovery(querier);
         work_done = true;
     }
 
@@ -348,6 +624,23 @@ void AkitaSmartCityServices::loop() {
         work_done = true;
     }
 
+    // Packets held while no gateway was known, once there is a route again
+    if (flushStoredPackets(now)) {
+        work_done = true;
+    }
+
+    // Hand queued packets to the radio, highest priority first
+    if (serviceOutboundQueue(now)) {
+        work_done = true;
+    }
+
+    // Persist the routing part of the service table when it has changed
+    if (now - m_lastSnapshotCheckTime >= ASCS_SERVICE_SNAPSHOT_CHECK_INTERVAL_MS) {
+        m_lastSnapshotCheckTime = now;
+        if (saveServiceTable()) work_done = true;
+        if (saveStoredPackets()) work_done = true;
+    }
+
     // --- Feed Watchdog Again (Optional) ---
     // If the loop did significant work, feeding again ensures responsiveness
     // if (work_done) {
@@ -368,19 +661,46 @@ bool AkitaSmartCityServices::handleReceived(const meshPacket &packet) {
                getName(), ASCS_PORT_NUM, packet.from, packet.decoded.payloadlen,
                packet.rx_rssi, packet.rx_snr); // Log signal quality
 
+    // Link quality of the last hop and hops travelled (hop_start is 0 on firmware that does not report it)
+    ASCSLinkSample link;
+    link.rssi = packet.rx_rssi;
+    link.snr = packet.rx_snr;
+    link.hops = (packet.hop_start > 0 && packet.hop_start >= packet.hop_limit) ? (int8_t)(packet.hop_start - packet.hop_limit) : -1;
+
+    // Readings a node held during a gateway outage, several per transmission: handled one by one
+    std::vector<std::pair<const uint8_t *, size_t>> held;
+    if (ASCSStoreForward::splitBatch(packet.decoded.payload, packet.decoded.payloadlen, held)) {
+        Log.printf(LOG_LEVEL_DEBUG, "[%s] Handling StoredBatch from 0x%lx (%d packets)\n", getName(), packet.from, (int)held.size());
+        bool handled = true;
+        for (size_t i = 0; i < held.size(); i++) {
+            // One transmission: only the first packet counts as a link sample of the sender
+            handled = handlePayload(held[i].first, held[i].second, packet, link, i == 0) && handled;
+        }
+        return handled;
+    }
+    return handlePayload(packet.decoded.payload, packet.decoded.payloadlen, packet, link, true);
+}
+
+/**
+ * @brief Decodes one SmartCityPacket received in 'packet' (its payload, or one packet of a StoredBatch) and routes it.
+ * @param refreshSender Whether SensorData refreshes the sender's service table entry and link metrics.
+ */
+bool AkitaSmartCityServices::handlePayload(const uint8_t *data, size_t length, const meshPacket &packet, const ASCSLinkSample &link,
+                                           bool refreshSender) {
     // Prepare for decoding
     SmartCityPacket scp = SmartCityPacket_init_zero;
-    pb_istream_t stream = pb_istream_from_buffer(packet.decoded.payload, packet.decoded.payloadlen);
+    pb_istream_t stream = pb_istream_from_buffer(data, length);
 
     // Prepare context for decoding the map field if the payload is SensorData
     MapCallbackContext decode_context;
     std::map<std::string, float> decoded_readings; // Temporary map to store decoded readings
+    ReadingTypes decoded_types;                    // Which of them arrived as booleans or integers
     decode_context.map_ptr = &decoded_readings;
+    decode_context.types_ptr = &decoded_types;
 
-    // Assign the decode callback function to the 'readings' field descriptor within the packet structure
-    // This tells nanopb to use our function when it encounters the 'readings' field (tag 3) inside SensorData.
-    scp.payload.sensor_data.readings.funcs.decode = decode_map_callback;
-    scp.payload.sensor_data.readings.arg = &decode_context; // Pass our context struct
+    // Assign the decode callbacks to the readings fields within the packet structure
+    // This tells nanopb to use our functions when it encounters 'readings', 'bools' or 'ints' inside SensorData.
+    setReadingsDecoder(scp.payload.sensor_data, decode_context);
 
     // Attempt to decode the main SmartCityPacket
     if (pb_decode(&stream, SmartCityPacket_fields, &scp)) {
@@ -390,23 +710,35 @@ bool AkitaSmartCityServices::handleReceived(const meshPacket &packet) {
         switch (scp.which_payload) {
             case SmartCityPacket_discovery_tag:
                 Log.printf(LOG_LEVEL_DEBUG, "[%s] Handling ServiceDiscovery from 0x%lx\n", getName(), packet.from);
-                handleServiceDiscovery(scp.payload.discovery, packet.from);
+                handleServiceDiscovery(scp.payload.discovery, packet.from, packet.to, link);
                 break;
 
             case SmartCityPacket_sensor_data_tag:
                 // SensorData payload was decoded into scp.payload.sensor_data
                 // The map field 'readings' was populated into 'decoded_readings' via the callback.
-                // Now, handle the received sensor data, potentially passing the decoded map along.
                 Log.printf(LOG_LEVEL_DEBUG, "[%s] Handling SensorData from 0x%lx (Map size: %d)\n",
                            getName(), packet.from, decoded_readings.size());
 
-                // ** Important: Pass the decoded map data to the handler **
-                // Modify handleSensorData or subsequent functions (runGatewayLogic etc.)
-                // to accept the decoded map for processing (e.g., MQTT publishing).
-                // For now, we call the existing handleSensorData which only takes the base struct.
-                // This means the map data isn't directly used downstream yet in this structure.
-                // --> Refactoring needed to pass 'decoded_readings' down if required by MQTT publishing etc. <--
-                handleSensorData(scp.payload.sensor_data, packet.from);
+                // Data traffic refreshes the sender's service table entry like a discovery announcement
+                if (!refreshSender) {
+                    // Not the first packet of a StoredBatch: the sender was already refreshed
+                } else if (scp.payload.sensor_data.sender_role != ServiceDiscovery_Role_UNKNOWN) {
+                    handleServiceInfo(packet.from, scp.payload.sensor_data.sender_role, scp.payload.sensor_data.sender_service_id, link);
+                } else if (const ASCSServiceEntry *known = m_serviceTable.find(packet.from)) {
+                    // Older firmware without sender info: still proves the known node is alive
+                    updateServiceTable(packet.from, known->role, known->serviceId, &link);
+                }
+
+                // Pass the decoded map down so Gateways can publish it and Aggregators/buffers can re-encode it.
+                // Data relayed by Aggregators names its origin; the transmitting node is only the last hop.
+                handleSensorData(scp.payload.sensor_data, decoded_readings, decoded_types,
+                                 scp.payload.sensor_data.origin_node ? scp.payload.sensor_data.origin_node : packet.from);
+                break;
+
+            case SmartCityPacket_poll_tag:
+                Log.printf(LOG_LEVEL_DEBUG, "[%s] Handling PollRequest from 0x%lx (%d nodes)\n", getName(), packet.from,
+                           (int)scp.payload.poll.nodes_count);
+                handlePollRequest(scp.payload.poll, packet.from);
                 break;
 
             // case SmartCityPacket_config_tag: // Placeholder for future remote config
@@ -432,17 +764,43 @@ bool AkitaSmartCityServices::handleReceived(const meshPacket &packet) {
 // --- Public Configuration Methods ---
 
 /**
- * @brief Assigns the sensor implementation object.
+ * @brief Assigns the sensor implementation object (replacing any added before), read every `read_int`.
  */
 void AkitaSmartCityServices::setSensor(std::unique_ptr<SensorInterface> sensor) {
-    m_sensor = std::move(sensor); // Take ownership
-    if (m_sensor) {
-        Log.println(LOG_LEVEL_INFO, "[%s] Sensor implementation set.", getName());
+    m_sensors.clear();
+    if (sensor) {
+        addSensor(std::move(sensor));
     } else {
         Log.println(LOG_LEVEL_WARNING, "[%s] Sensor implementation set to null.", getName());
     }
 }
 
+/**
+ * @brief Adds a sensor implementation with its own read interval and phase.
+ */
+bool AkitaSmartCityServices::addSensor(std::unique_ptr<SensorInterface> sensor, uint32_t intervalMs /*= 0*/, uint32_t phaseMs /*= 0*/,
+                                       uint32_t windowMs /*= 0*/) {
+    if (!sensor) return addSensor(std::unique_ptr<AsyncSensorInterface>(), intervalMs, phaseMs, windowMs);
+    // Read through the asynchronous interface like the others (readData() still blocks)
+    return addSensor(std::unique_ptr<AsyncSensorInterface>(new ASCSSyncSensorAdapter(std::move(sensor))), intervalMs, phaseMs, windowMs);
+}
+
+/**
+ * @brief Adds a non-blocking sensor implementation with its own read interval and phase.
+ */
+bool AkitaSmartCityServices::addSensor(std::unique_ptr<AsyncSensorInterface> sensor, uint32_t intervalMs /*= 0*/, uint32_t phaseMs /*= 0*/,
+                                       uint32_t windowMs /*= 0*/) {
+    std::string sensorId = sensor ? sensor->getSensorId() : std::string();
+    if (!m_sensors.add(std::move(sensor), intervalMs, phaseMs, windowMs)) {
+        Log.printf(LOG_LEVEL_WARNING, "[%s] Sensor '%s' not added (null, or %d sensors already).\n", getName(), sensorId.c_str(),
+                   ASCS_SENSOR_MAX_SENSORS);
+        return false;
+    }
+    Log.printf(LOG_LEVEL_INFO, "[%s] Sensor '%s' added (interval %lu ms, phase %lu ms, summary window %lu ms).\n", getName(),
+               sensorId.c_str(), (unsigned long)intervalMs, (unsigned long)phaseMs, (unsigned long)windowMs);
+    return true;
+}
+
 /**
  * @brief Returns the currently configured node role.
  */
@@ -475,8 +833,7 @@ void AkitaSmartCityServices::connectWiFi() {
 
     if (WiFi.status() == WL_CONNECTED) {
         Log.printf(LOG_LEVEL_INFO, "[%s] WiFi connected. IP: %s\n", getName(), WiFi.localIP().toString().c_str());
-        // Attempt MQTT connection now that WiFi is established
-        connectMQTT();
+        // Network sinks connect from their loop() now that WiFi is established
     } else {
         Log.println(LOG_LEVEL_ERROR, "[%s] WiFi connection failed!", getName());
         WiFi.disconnect(true); // Disconnect explicitly
@@ -500,87 +857,7 @@ void AkitaSmartCityServices::checkWiFiConnection() {
 }
 
 /**
- * @brief Connects to the MQTT broker using configured credentials. Non-blocking attempt.
- */
-void AkitaSmartCityServices::connectMQTT() {
-    // Skip if client not initialized or already connected
-    if (!m_mqttClient || m_mqttClient->connected()) return;
-    // Skip if WiFi is not available
-    if (WiFi.status() != WL_CONNECTED) {
-        Log.println(LOG_LEVEL_WARNING, "[%s] Cannot connect MQTT, WiFi is down.", getName());
-        return;
-    }
-
-    Log.printf(LOG_LEVEL_INFO, "[%s] Attempting MQTT connection to %s:%d...\n", getName(), m_config.getMqttServer().c_str(), m_config.getMqttPort());
-
-    // Create a unique client ID for this node
-    String clientId = "meshtastic-ascs-";
-    clientId += String(m_api->getMyNodeInfo()->node_num, HEX); // Use Meshtastic node ID
-
-    // Get credentials from config
-    std::string user = m_config.getMqttUser();
-    std::string pass = m_config.getMqttPassword();
-    bool result;
-
-    // Set buffer size if needed BEFORE connecting (adjust based on expected payload size)
-    // m_mqttClient->setBufferSize(512);
-
-    // Attempt connection with or without authentication based on config
-    if (!user.empty()) {
-        result = m_mqttClient->connect(clientId.c_str(), user.c_str(), pass.c_str());
-    } else {
-        result = m_mqttClient->connect(clientId.c_str());
-    }
-
-    if (result) {
-        Log.println(LOG_LEVEL_INFO, "[%s] MQTT connected.", getName());
-        m_gatewayBufferActive = false; // Clear buffer flag on successful connect
-        m_lastBufferProcessTime = millis(); // Trigger buffer processing check soon
-        // Subscribe to any command topics if needed
-        // Example: m_mqttClient->subscribe("akita/smartcity/gateway/+/command");
-    } else {
-        // Log detailed error based on PubSubClient state code
-        Log.printf(LOG_LEVEL_ERROR, "[%s] MQTT connection failed, rc=%d. Check server, port, credentials, client ID, and MQTT buffer size. Will retry later.\n", getName(), m_mqttClient->state());
-        m_gatewayBufferActive = true; // Activate buffering since connection failed
-    }
-    // Record the time of this attempt, regardless of success, for reconnection scheduling
-    m_lastMqttReconnectAttempt = millis();
-}
-
-/**
- * @brief Checks MQTT connection status and attempts reconnect periodically if disconnected.
- */
-void AkitaSmartCityServices::checkMQTTConnection() {
-    if (m_config.getNodeRole() != ServiceDiscovery_Role_GATEWAY || !m_mqttClient) return;
-
-    if (!m_mqttClient->connected()) {
-        // Ensure buffering is active if we detect disconnection
-        if (!m_gatewayBufferActive) {
-             Log.println(LOG_LEVEL_WARNING, "[%s] MQTT detected disconnected, activating buffering.", getName());
-             m_gatewayBufferActive = true;
-        }
-
-        unsigned long now = millis();
-        // Only attempt reconnection periodically based on configured interval
-        if (now - m_lastMqttReconnectAttempt > m_config.getMqttReconnectIntervalMs()) {
-             Log.println(LOG_LEVEL_WARNING, "[%s] MQTT disconnected. Attempting periodic reconnect...", getName());
-             connectMQTT(); // Attempt reconnection (updates m_lastMqttReconnectAttempt)
-        }
-    } else {
-        // MQTT is connected
-        // If we were buffering previously, log that we've reconnected and stopped buffering.
-        // The actual processing of the buffer happens in the main loop based on m_lastBufferProcessTime.
-        if (m_gatewayBufferActive) {
-             Log.println(LOG_LEVEL_INFO, "[%s] MQTT reconnected, buffering stopped (pending buffer processing).", getName());
-             m_gatewayBufferActive = false; // Allow direct publishing again
-        }
-    }
-    // Note: m_mqttClient->loop() is called in the main plugin loop() to handle keepalives etc.
-}
-
-
-/**
- * @brief Static MQTT message callback handler. Required by PubSubClient.
+ * @brief Static MQTT message callback handler. Registered with the MQTT transport.
  * Routes the call to the instance method if available.
  */
 void AkitaSmartCityServices::mqttCallback(char *topic, byte *payload, unsigned int length) {
@@ -607,36 +884,105 @@ void AkitaSmartCityServices::mqttCallback(char *topic, byte *payload, unsigned i
 // necessary code wasn't included via the ASCS_ROLE_GATEWAY build flag.
 void AkitaSmartCityServices::connectWiFi() {}
 void AkitaSmartCityServices::checkWiFiConnection() {}
-void AkitaSmartCityServices::connectMQTT() {}
-void AkitaSmartCityServices::checkMQTTConnection() {}
 void AkitaSmartCityServices::mqttCallback(char*, byte*, unsigned int) {}
 #endif // ASCS_ROLE_GATEWAY
 
 /**
  * @brief Handles received ServiceDiscovery messages. Updates the local service table.
  */
-void AkitaSmartCityServices::handleServiceDiscovery(const ServiceDiscovery &discovery, uint32_t fromNode) {
-    // Update our table of known nodes and their advertised roles/services
-    updateServiceTable(fromNode, discovery.node_role, discovery.service_id);
+void AkitaSmartCityServices::handleServiceDiscovery(const ServiceDiscovery &discovery, uint32_t fromNode, uint32_t toNode, const ASCSLinkSample &link) {
+    handleServiceInfo(fromNode, discovery.node_role, discovery.service_id, link);
+    if (discovery.node_role == ServiceDiscovery_Role_GATEWAY) {
+        m_serviceTable.setCapacity(fromNode, discovery.capacity); // Weight for hashed gateway selection
+    } else if (discovery.node_role == ServiceDiscovery_Role_AGGREGATOR) {
+        m_serviceTable.setRoute(fromNode, discovery.route_cost, discovery.route_via); // Multi-tier forwarding
+    }
+    checkRouteChange();
+
+    ServiceDiscovery_Role myRole = m_config.getNodeRole();
+    if (discovery.reslot && toNode == m_api->getMyNodeInfo()->node_num && m_txSlot.isEnabled()) {
+        // Our gateway misses many of our readings: try another slot (not before half an interval after the last reading)
+        m_txSlot.reslot();
+        scheduleSensors(m_lastSensorReadTime + m_config.getSensorReadIntervalMs() / 2);
+        Log.printf(LOG_LEVEL_INFO, "[%s] Gateway 0x%lx reports lost readings, moving to transmit slot %lu.\n", getName(), fromNode,
+                   (unsigned long)m_txSlot.getSlot());
+    }
+    if (myRole == ServiceDiscovery_Role_SENSOR) return; // Sensors have no route to offer
+
+    // Gateways answer queries directly; Aggregators only while they have a route, which the reply
+    // advertises (route_cost/route_via), so nodes that hear no gateway still find a path
+    float routeCost = 0;
+    bool canReply = (myRole == ServiceDiscovery_Role_GATEWAY) || findRouteNextHop(routeCost) != 0;
+
+    if (myRole == ServiceDiscovery_Role_GATEWAY && discovery.node_role == ServiceDiscovery_Role_SENSOR && m_pollScheduler.isEnabled()) {
+        // Poll the sensors in poll mode that send to us (or have no gateway yet)
+        if (discovery.polled && (discovery.route_via == 0 || discovery.route_via == m_api->getMyNodeInfo()->node_num)) {
+            m_pollScheduler.addNode(fromNode, millis());
+        } else {
+            m_pollScheduler.removeNode(fromNode);
+        }
+    }
+
+    if (discovery.query) {
+        if (!canReply) return;
+        // Someone without a gateway asks: answer after a delay (better paths first, so gateways before Aggregators)
+        float cost = ASCSLinkStats::expectedTransmissions((float)link.rssi, link.snr, link.hops > 0 ? link.hops : 0) + routeCost;
+        uint32_t delay = ASCSDiscoveryReplies::replyDelayMs(cost, (uint32_t)random(ASCS_DISCOVERY_REPLY_WINDOW_MS));
+        if (m_discoveryReplies.schedule(fromNode, millis(), delay)) {
+            Log.printf(LOG_LEVEL_DEBUG, "[%s] Discovery query from 0x%lx, replying in %lu ms\n", getName(), fromNode, (unsigned long)delay);
+        }
+    } else if ((discovery.node_role == ServiceDiscovery_Role_GATEWAY || myRole == ServiceDiscovery_Role_AGGREGATOR) &&
+               toNode != ASCS_BROADCAST_ADDR && toNode != m_api->getMyNodeInfo()->node_num) {
+        // Overheard another node's reply to a query (only delivered if the firmware passes on packets
+        // for other nodes): ours may no longer be needed. Gateways only yield to other gateways.
+        // Otherwise the reply delays alone spread answers.
+        m_discoveryReplies.overheard(toNode);
+    }
+}
+
+/**
+ * @brief Processes a node's role and service ID, from a discovery announcement or piggybacked on SensorData.
+ * Updates the service table and feeds the discovery timer.
+ */
+void AkitaSmartCityServices::handleServiceInfo(uint32_t fromNode, ServiceDiscovery_Role role, uint32_t serviceId, const ASCSLinkSample &link) {
+    // Update our table of known nodes and their advertised roles/services (and the link towards them)
+    bool changed = updateServiceTable(fromNode, role, serviceId, &link);
+
+    if (changed) {
+        // A gateway or aggregator appeared or changed: announce quickly again so routes converge fast
+        m_discoveryTimer.reset(millis());
+    } else if (role == m_config.getNodeRole() && serviceId == m_config.getServiceId()) {
+        // A known neighbour offering the same role and service: our own announcement adds little
+        m_discoveryTimer.hearConsistent();
+    }
 }
 
 /**
  * @brief Handles received SensorData messages. Routes to role-specific logic.
+ * @param readings The readings map decoded from the packet (kept alive for re-encoding).
  */
-void AkitaSmartCityServices::handleSensorData(const SensorData &sensorData, uint32_t fromNode) {
+void AkitaSmartCityServices::handleSensorData(const SensorData &sensorData, std::map<std::string, float> &readings, ReadingTypes &types,
+                                              uint32_t fromNode) {
     // Create the full packet wrapper to pass to role-specific handlers
     // This ensures Aggregators/Gateways have the complete packet for forwarding/buffering.
     SmartCityPacket packet = SmartCityPacket_init_zero;
     packet.which_payload = SmartCityPacket_sensor_data_tag;
     packet.payload.sensor_data = sensorData; // Copy the received sensor data
 
+    // The copied readings fields still carry the decode callbacks. Re-arm them for encoding
+    // from the decoded map and types so forwarding and buffering re-encode the readings correctly.
+    MapCallbackContext encode_context;
+    encode_context.map_ptr = &readings;
+    encode_context.types_ptr = &types;
+    setReadingsEncoder(packet.payload.sensor_data, encode_context);
+
     // Route based on the role of *this* node
     switch (m_config.getNodeRole()) {
         case ServiceDiscovery_Role_AGGREGATOR:
             runAggregatorLogic(packet, fromNode); // Pass the full packet
             break;
         case ServiceDiscovery_Role_GATEWAY:
-            runGatewayLogic(packet, fromNode); // Pass the full packet
+            runGatewayLogic(packet, readings, types, fromNode); // Pass the full packet and decoded readings
             break;
         case ServiceDiscovery_Role_SENSOR:
             // Sensors typically don't process sensor data from others, but log it.
@@ -649,224 +995,621 @@ void AkitaSmartCityServices::handleSensorData(const SensorData &sensorData, uint
 }
 
 /**
- * @brief Encodes and sends a SmartCityPacket over the Meshtastic network.
+ * @brief Handles a Gateway's PollRequest. A Sensor in poll mode that is named in it answers with a
+ * fresh reading, the n-th named sensor after n reply spacings, so the answers do not collide.
+ * Polls from a gateway other than ours are ignored (it forgets us after the service timeout).
+ */
+void AkitaSmartCityServices::handlePollRequest(const PollRequest &poll, uint32_t fromNode) {
+    if (m_config.getNodeRole() != ServiceDiscovery_Role_SENSOR || !m_config.getPollMode()) return;
+
+    uint32_t myNode = m_api->getMyNodeInfo()->node_num;
+    for (pb_size_t i = 0; i < poll.nodes_count; i++) {
+        if (poll.nodes[i] != myNode) continue;
+        uint32_t gateway = findGatewayNode();
+        if (gateway != 0 && gateway != fromNode) {
+            Log.printf(LOG_LEVEL_DEBUG, "[%s] Poll from 0x%lx ignored, we send to 0x%lx.\n", getName(), fromNode, gateway);
+            return;
+        }
+        unsigned long now = millis();
+        m_lastPollTime = now;
+        m_pollIntervalMs = poll.interval_ms;
+        m_pollReplyPending = true;
+        m_pollReplyTime = now + i * ASCS_POLL_REPLY_SPACING_MS;
+        m_pollReplyTo = fromNode;
+        Log.printf(LOG_LEVEL_DEBUG, "[%s] Polled by 0x%lx, answering in %lu ms.\n", getName(), fromNode,
+                   (unsigned long)(i * ASCS_POLL_REPLY_SPACING_MS));
+        return;
+    }
+}
+
+/**
+ * @brief Encodes a SmartCityPacket and queues it for the Meshtastic network.
  * @param toNode Destination Node ID (use ASCS_BROADCAST_ADDR for broadcast).
  * @param packet The SmartCityPacket to send (must have callbacks set if map data is present).
- * @return True if the packet was successfully queued for transmission, false otherwise.
+ * @param priority Class in the outbound queue; critical packets are handed to the radio at once.
+ * @return True if the packet was queued (or sent), false if encoding failed or the queue had no room.
  */
-bool AkitaSmartCityServices::sendMessage(uint32_t toNode, const SmartCityPacket &packet) {
+bool AkitaSmartCityServices::sendMessage(uint32_t toNode, const SmartCityPacket &packet, MessagePriority priority /*= ROUTINE*/) {
     // Allocate buffer for the encoded packet
     uint8_t buffer[ASCS_GATEWAY_MAX_PACKET_SIZE]; // Use defined max size for consistency
-    pb_ostream_t stream = pb_ostream_from_buffer(buffer, sizeof(buffer));
+    size_t encoded_len = encodePacket(packet, buffer, sizeof(buffer));
+    if (encoded_len == 0) return false;
+
+    Log.printf(LOG_LEVEL_DEBUG, "[%s] Queueing packet (type %d, %s) to 0x%lx, size %d bytes\n",
+               getName(), packet.which_payload, ASCSPriorityRules::name(priority), toNode, encoded_len);
+    bool announces = packet.which_payload == SmartCityPacket_sensor_data_tag &&
+                     packet.payload.sensor_data.sender_role != ServiceDiscovery_Role_UNKNOWN;
+    return queueEncoded(toNode, buffer, encoded_len, priority, announces);
+}
+
+/**
+ * @brief Encodes a SmartCityPacket.
+ * @param packet The packet (must have callbacks set if map data is present).
+ * @return Encoded length, 0 if encoding failed or the result is not a valid packet size.
+ */
+size_t AkitaSmartCityServices::encodePacket(const SmartCityPacket &packet, uint8_t *buffer, size_t size) {
+    pb_ostream_t stream = pb_ostream_from_buffer(buffer, size);
 
     // --- Nanopb Encoding ---
     // IMPORTANT: If the packet contains SensorData with a map, the calling function
-    // (e.g., runSensorLogic) MUST have already set the .funcs.encode and .arg fields
+    // (e.g., sendReadings) MUST have already set the .funcs.encode and .arg fields
     // on the packet.payload.sensor_data.readings field before calling sendMessage.
     // This function assumes the packet is fully prepared for encoding.
+    if (!pb_encode(&stream, SmartCityPacket_fields, &packet)) {
+        Log.printf(LOG_LEVEL_ERROR, "[%s] Failed to encode SmartCityPacket: %s\n", getName(), PB_GET_ERROR(&stream));
+        return 0;
+    }
 
-    if (pb_encode(&stream, SmartCityPacket_fields, &packet)) {
-        // Encoding successful
-        size_t encoded_len = stream.bytes_written;
-        Log.printf(LOG_LEVEL_DEBUG, "[%s] Sending packet (type %d) to 0x%lx, size %d bytes\n",
-                   getName(), packet.which_payload, toNode, encoded_len);
-
-        // Sanity check encoded size
-        if (encoded_len == 0 || encoded_len > ASCS_GATEWAY_MAX_PACKET_SIZE) {
-            Log.printf(LOG_LEVEL_ERROR, "[%s] Invalid encoded packet size (%d)!\n", getName(), encoded_len);
-            return false;
-        }
-
-        // Get the primary Meshtastic interface to send data
-        MeshInterface *iface = m_api->getPrimaryInterface();
-        if (iface) {
-            // --- Watchdog Feed ---
-            // Feed watchdog before potentially blocking radio transmission
-            // feed_watchdog_placeholder();
+    // Sanity check encoded size
+    size_t encoded_len = stream.bytes_written;
+    if (encoded_len == 0 || encoded_len > ASCS_GATEWAY_MAX_PACKET_SIZE) {
+        Log.printf(LOG_LEVEL_ERROR, "[%s] Invalid encoded packet size (%d)!\n", getName(), encoded_len);
+        return 0;
+    }
+    return encoded_len;
+}
 
-            // Send the data using the Meshtastic API
-            // Use default ACK behavior (usually WANT_ACK=1 for directed messages)
-            // Hop Limit 0 usually means use default (e.g., 3 hops)
-            bool success = iface->sendData(toNode, buffer, encoded_len, ASCS_PORT_NUM, Data_WANT_ACK_DEFAULT, 0);
+/**
+ * @brief Puts an encoded packet in the outbound queue and hands what can go to the radio.
+ * @param announces The packet carries our role and service ID (SensorData sender info).
+ * @return True if the packet was queued (or sent), false if the queue had no room.
+ */
+bool AkitaSmartCityServices::queueEncoded(uint32_t toNode, const uint8_t *data, size_t length, MessagePriority priority,
+                                          bool announces) {
+    ASCSOutboundPacket outbound;
+    outbound.toNode = toNode;
+    outbound.priority = priority;
+    outbound.announces = announces;
+    outbound.data.assign(data, data + length);
+    if (!m_outbound.push(std::move(outbound), millis())) {
+        Log.printf(LOG_LEVEL_WARNING, "[%s] Outbound queue full of %s or higher packets, dropping packet to 0x%lx.\n", getName(),
+                   ASCSPriorityRules::name(priority), toNode);
+        return false;
+    }
 
-            // --- Watchdog Feed ---
-            // Feed watchdog again after transmission attempt
-            // feed_watchdog_placeholder();
+    // Send right away if the radio should be free (or the packet is critical)
+    serviceOutboundQueue(millis());
+    return true;
+}
 
-            if (!success) {
-                Log.println(LOG_LEVEL_WARNING, "[%s] Meshtastic sendData failed (queue full or radio busy?).", getName());
-            }
-            return success; // Return status from sendData
+/**
+ * @brief Hands queued packets to the radio: the highest class first, each when the packet handed
+ * over before should be on air no more, so Meshtastic's first-in-first-out queue stays short.
+ * @return True if a packet was handed over.
+ */
+bool AkitaSmartCityServices::serviceOutboundQueue(unsigned long now) {
+    // Get the primary Meshtastic interface to send data
+    MeshInterface *iface = m_api->getPrimaryInterface();
+    if (!iface) {
+        if (!m_outbound.empty()) Log.println(LOG_LEVEL_ERROR, "[%s] Failed to get primary mesh interface!", getName());
+        return false;
+    }
 
-        } else {
-            Log.println(LOG_LEVEL_ERROR, "[%s] Failed to get primary mesh interface!", getName());
-            return false; // Cannot send without interface
+    bool sent = false;
+    while (ASCSOutboundPacket *packet = m_outbound.next(now)) {
+        // --- Watchdog Feed ---
+        // Feed watchdog before potentially blocking radio transmission
+        // feed_watchdog_placeholder();
+
+        // Send the data using the Meshtastic API
+        // Use default ACK behavior (usually WANT_ACK=1 for directed messages)
+        // Hop Limit 0 usually means use default (e.g., 3 hops)
+        bool success = iface->sendData(packet->toNode, packet->data.data(), packet->data.size(), ASCS_PORT_NUM, Data_WANT_ACK_DEFAULT, 0);
+        if (!success) {
+            // Stays queued and is retried after a backoff
+            Log.printf(LOG_LEVEL_WARNING, "[%s] Meshtastic sendData failed (queue full or radio busy?), %s packet to 0x%lx, attempt %d/%d.\n",
+                       getName(), ASCSPriorityRules::name(packet->priority), packet->toNode, packet->attempts + 1,
+                       ASCS_OUTBOUND_MAX_ATTEMPTS);
+            m_outbound.onFailed(now);
+            break;
         }
-
-    } else {
-        // Encoding failed
-        Log.printf(LOG_LEVEL_ERROR, "[%s] Failed to encode SmartCityPacket: %s\n", getName(), PB_GET_ERROR(&stream));
-        return false;
+        if (packet->announces) noteAnnouncedTraffic(packet->toNode);
+        m_outbound.onSent(now);
+        sent = true;
     }
+    return sent;
 }
 
 /**
  * @brief Sends a Service Discovery announcement packet.
- * @param toNode Destination address (defaults to broadcast).
+ * @param toNode Destination address (defaults to broadcast; a node for a reply to its query).
+ * @param query True to ask Gateways in range to reply (runDiscoveryQuery()).
+ * @param reslot True to ask the Sensor 'toNode' to move to another transmit slot (Gateway).
  */
-void AkitaSmartCityServices::sendServiceDiscovery(uint32_t toNode /*= ASCS_BROADCAST_ADDR*/) {
-    Log.printf(LOG_LEVEL_DEBUG, "[%s] Sending Service Discovery to 0x%lx\n", getName(), toNode);
+void AkitaSmartCityServices::sendServiceDiscovery(uint32_t toNode /*= ASCS_BROADCAST_ADDR*/, bool query /*= false*/, bool reslot /*= false*/) {
+    Log.printf(LOG_LEVEL_DEBUG, "[%s] Sending Service Discovery %s to 0x%lx\n", getName(),
+               query ? "query" : (reslot ? "reslot request" : "announcement"), toNode);
     // Create the packet payload
     SmartCityPacket packet = SmartCityPacket_init_zero;
     packet.which_payload = SmartCityPacket_discovery_tag;
     packet.payload.discovery.node_role = m_config.getNodeRole();
     packet.payload.discovery.service_id = m_config.getServiceId();
+    packet.payload.discovery.query = query;
+    packet.payload.discovery.reslot = reslot;
+    if (m_config.getNodeRole() == ServiceDiscovery_Role_GATEWAY) {
+        packet.payload.discovery.capacity = m_config.getGatewayWeight();
+    } else if (m_config.getNodeRole() == ServiceDiscovery_Role_AGGREGATOR) {
+        // Our route to a gateway, so Aggregators further out can forward through us (0 = none)
+        float cost = 0;
+        uint32_t nextHop = findRouteNextHop(cost);
+        packet.payload.discovery.route_cost = nextHop ? cost : 0;
+        packet.payload.discovery.route_via = nextHop;
+        m_routeNextHop = nextHop;
+        m_routeCost = packet.payload.discovery.route_cost;
+    } else if (m_config.getNodeRole() == ServiceDiscovery_Role_SENSOR && m_config.getPollMode()) {
+        // Asks our gateway (only) to poll us
+        packet.payload.discovery.polled = true;
+        packet.payload.discovery.route_via = findGatewayNode();
+    }
 
     // Send the packet
     sendMessage(toNode, packet);
 }
 
+/**
+ * @brief Broadcasts a PollRequest naming the given sensors (from ASCSPollScheduler::nextBatch()).
+ * @param nodes Sensors to poll, answering in this order.
+ * @param count Number of sensors (at most ASCS_POLL_MAX_BATCH).
+ */
+void AkitaSmartCityServices::sendPollRequest(const uint32_t *nodes, size_t count) {
+    SmartCityPacket packet = SmartCityPacket_init_zero;
+    packet.which_payload = SmartCityPacket_poll_tag;
+    for (size_t i = 0; i < count && i < ASCS_POLL_MAX_BATCH; i++) {
+        packet.payload.poll.nodes[packet.payload.poll.nodes_count++] = nodes[i];
+    }
+    packet.payload.poll.interval_ms = m_pollScheduler.getInterval();
+    Log.printf(LOG_LEVEL_DEBUG, "[%s] Polling %d sensor(s), first 0x%lx\n", getName(), (int)count, nodes[0]);
+    sendMessage(ASCS_BROADCAST_ADDR, packet);
+}
+
+/**
+ * @brief Sends a discovery query if this Sensor/Aggregator knows no route to a gateway.
+ * The first query after boot (or after losing the last gateway) waits a short random delay, so a
+ * mesh-wide power-up does not query all at once. Unanswered queries are repeated with doubling
+ * delays, a few times only: a node without a gateway in range would otherwise query forever.
+ * Gateways that come up later are still found through their announcements.
+ * @return True if a query was sent.
+ */
+bool AkitaSmartCityServices::runDiscoveryQuery(unsigned long now) {
+    ServiceDiscovery_Role role = m_config.getNodeRole();
+    float cost;
+    bool needsGateway = (role == ServiceDiscovery_Role_SENSOR || role == ServiceDiscovery_Role_AGGREGATOR) &&
+                        (m_config.getTargetNodeId() == 0 || m_config.getTargetNodeId() == ASCS_BROADCAST_ADDR) &&
+                        findRouteNextHop(cost) == 0;
+    if (!needsGateway) {
+        m_queryActive = false;
+        return false;
+    }
+    if (!m_queryActive) {
+        m_queryActive = true;
+        m_queriesLeft = ASCS_DISCOVERY_QUERY_MAX_TRIES;
+        m_lastQueryTime = now;
+        m_queryDelayMs = (uint32_t)random(ASCS_DISCOVERY_QUERY_JITTER_MS);
+        return false;
+    }
+    if (m_queriesLeft == 0 || now - m_lastQueryTime < m_queryDelayMs) return false;
+
+    Log.printf(LOG_LEVEL_INFO, "[%s] No gateway known, sending discovery query.\n", getName());
+    sendServiceDiscovery(ASCS_BROADCAST_ADDR, true);
+    m_discoveryTimer.noteAnnounced(now); // The query carries our role as well
+    m_queriesLeft--;
+    m_lastQueryTime = now;
+    m_queryDelayMs = ASCS_DISCOVERY_QUERY_RETRY_MS << (ASCS_DISCOVERY_QUERY_MAX_TRIES - 1 - m_queriesLeft);
+    return true;
+}
+
+/**
+ * @brief Counts a sent packet carrying our role and service ID as a discovery announcement.
+ * A Sensor's entry only matters to the node it sends data to, so any send counts. Gateways and
+ * Aggregators are routed through by all neighbours, so only their broadcasts count.
+ * @param toNode Destination of the sent packet.
+ */
+void AkitaSmartCityServices::noteAnnouncedTraffic(uint32_t toNode) {
+    if (toNode == ASCS_BROADCAST_ADDR || !ASCSServiceTable::isRoutingRole(m_config.getNodeRole())) {
+        m_discoveryTimer.noteAnnounced(millis());
+    }
+}
+
 /**
  * @brief Sends sensor data, determining the destination automatically if not configured.
  * Assumes the SensorData struct has been fully prepared (including map callbacks if needed).
  * @param sensorData The prepared SensorData message to send.
+ * @param toNode Destination overriding 'target_node' and discovery (e.g., the polling gateway), or 0.
  */
-void AkitaSmartCityServices::sendSensorData(const SensorData &sensorData) {
+void AkitaSmartCityServices::sendSensorData(const SensorData &sensorData, uint32_t toNode /*= 0*/) {
     // Determine the target node ID
-    uint32_t target = m_config.getTargetNodeId();
+    uint32_t target = toNode ? toNode : m_config.getTargetNodeId();
 
-    // If no specific target is configured (0), try to find a gateway via discovery
+    // If no specific target is configured (0), try to find a gateway (or an Aggregator routing to one) via discovery
     if (target == 0 || target == ASCS_BROADCAST_ADDR) {
-        target = findGatewayNode(); // Find best known gateway from service table
+        float cost;
+        target = findRouteNextHop(cost); // Best known gateway, or the Aggregator with the cheapest route
         if (target != 0) {
-            Log.printf(LOG_LEVEL_DEBUG, "[%s] No target configured, using discovered Gateway 0x%lx\n", getName(), target);
+            Log.printf(LOG_LEVEL_DEBUG, "[%s] No target configured, using discovered next hop 0x%lx (cost %.2f)\n", getName(), target, cost);
         }
     }
 
-    // If still no target found (no specific config, no gateway discovered), broadcast
-    if (target == 0) {
-        target = ASCS_BROADCAST_ADDR;
-        Log.println(LOG_LEVEL_DEBUG, "[%s] No gateway found, broadcasting sensor data.", getName());
-    }
-
     // Create the packet wrapper
     SmartCityPacket packet = SmartCityPacket_init_zero;
     packet.which_payload = SmartCityPacket_sensor_data_tag;
     // Assign the already-prepared SensorData struct (MUST have callbacks set by caller if map used)
     packet.payload.sensor_data = sensorData;
+    // Piggyback our role and service ID, so receivers need no separate discovery announcement
+    packet.payload.sensor_data.sender_role = m_config.getNodeRole();
+    packet.payload.sensor_data.sender_service_id = m_config.getServiceId();
 
-    // Send the packet
-    sendMessage(target, packet);
+    MessagePriority priority = sensorData.priority >= (uint32_t)MessagePriority::CRITICAL ? MessagePriority::CRITICAL
+                                                                                           : (MessagePriority)sensorData.priority;
+
+    // If still no target found (no specific config, no route discovered), hold the readings until
+    // a gateway is known again. Alarms (and everything, with `sf_max` 0) are broadcast: a gateway
+    // we have not discovered yet may be in range.
+    if (target == 0) {
+        if (priority != MessagePriority::CRITICAL && storePacket(packet, priority)) {
+            Log.printf(LOG_LEVEL_DEBUG, "[%s] No gateway found, holding sensor data (%d packet(s) held).\n", getName(), (int)m_store.size());
+            return;
+        }
+        target = ASCS_BROADCAST_ADDR;
+        Log.println(LOG_LEVEL_DEBUG, "[%s] No gateway found, broadcasting sensor data.", getName());
+    }
+
+    // Send the packet (alarms ahead of routine readings)
+    sendMessage(target, packet, priority);
 }
 
 
 // --- Role-Specific Logic ---
 
 /**
- * @brief Performs actions for the Sensor role: reads sensor, prepares data, sends.
+ * @brief Performs actions for the Sensor role: starts reading the given sensors.
+ * The reads are asynchronous (AsyncSensorInterface); pollSensorReads() sends the readings.
+ * @param sensors Indexes of the sensors to read (ASCSSensorRegistry::takeDue()/takeAll()).
+ * @param toNode Destination as in sendSensorData() (0 = configured or discovered).
  */
-void AkitaSmartCityServices::runSensorLogic() {
+void AkitaSmartCityServices::runSensorLogic(const std::vector<size_t> &sensors, uint32_t toNode /*= 0*/) {
     // Check if a sensor implementation has been provided
-    if (!m_sensor) {
+    if (m_sensors.empty()) {
         Log.println(LOG_LEVEL_WARNING, "[%s] Sensor role active, but no sensor implementation provided!", getName());
         return;
     }
 
-    Log.println(LOG_LEVEL_DEBUG, "[%s] Reading sensor data...", getName());
-    SensorData data = SensorData_init_zero; // Initialize proto struct
-    std::map<std::string, float> readingsMap; // Temporary map to hold readings
-
     // --- Watchdog Feed ---
-    // Feed before potentially long sensor read
+    // Feed before potentially long (synchronous) sensor reads
     // feed_watchdog_placeholder();
 
-    // Attempt to read data from the sensor implementation
-    bool read_success = false;
-    try {
-        read_success = m_sensor->readData(readingsMap);
-    } catch (const std::exception& e) {
-         Log.printf(LOG_LEVEL_ERROR, "[%s] Exception during sensor read: %s\n", getName(), e.what());
-         read_success = false;
-    } catch (...) {
-          Log.println(LOG_LEVEL_ERROR, "[%s] Unknown exception during sensor read!", getName());
-          read_success = false;
+    Log.printf(LOG_LEVEL_DEBUG, "[%s] Starting reads of %d sensor(s)...\n", getName(), (int)sensors.size());
+    m_sensorReadsTo = toNode;
+    m_sensors.startRound(sensors, millis(), toNode != 0); // A poll answer includes the summaries so far
+    pollSensorReads(millis()); // Synchronous sensors are done already
+}
+
+/**
+ * @brief Checks the reads started by runSensorLogic(). Once all are finished (done, failed or timed
+ * out), sends the readings in as few packets as they fit in: readings of several sensors go out in
+ * one combined packet (ASCSSensorRegistry::combine()).
+ * @return True if the reads finished (and the readings were sent).
+ */
+bool AkitaSmartCityServices::pollSensorReads(unsigned long now) {
+    std::vector<ASCSSensorResult> results;
+    std::vector<size_t> failed;
+    if (!m_sensors.pollRound(now, results, failed)) return false;
+
+    for (size_t index : failed) {
+        Log.printf(LOG_LEVEL_ERROR, "[%s] Failed to read sensor '%s'.\n", getName(), m_sensors.getSensor(index).getSensorId().c_str());
+        // Consider sending a status message indicating sensor failure?
+    }
+    Log.printf(LOG_LEVEL_DEBUG, "[%s] Sensor reads finished: %d ok, %d failed.\n", getName(), (int)results.size(), (int)failed.size());
+
+    // Battery voltage, if a sensor reports one (before the deadbands drop unchanged readings)
+    uint32_t batteryMv = 0;
+    for (const ASCSSensorResult &result : results) {
+        auto battery = result.readings.find(ASCS_BATTERY_KEY);
+        if (battery != result.readings.end() && battery->second > 0.0f) batteryMv = (uint32_t)(battery->second * 1000.0f + 0.5f);
     }
 
+    // Readings that stayed within their deadbands are not sent (a poll is always answered)
+    bool anyRead = !results.empty();
+    float excess = 0.0f; // Largest move of a reading, in deadbands (adaptive read interval)
+    size_t kept = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        float moved = 0.0f;
+        bool send = m_deadband.check(results[i].sensorId, results[i].readings, now, m_sensorReadsTo != 0, &moved);
+        if (moved > excess) excess = moved;
+        if (!send) continue;
+        if (kept != i) results[kept] = std::move(results[i]);
+        kept++;
+    }
+    if (kept < results.size()) {
+        Log.printf(LOG_LEVEL_DEBUG, "[%s] %d sensor(s) unchanged, not sent.\n", getName(), (int)(results.size() - kept));
+        results.resize(kept);
+    }
+
+    // Read faster while readings change, slower while stable or on low battery (the gateway times polls)
+    if (m_adaptive.isEnabled() && m_sensorReadsTo == 0 && anyRead) {
+        adaptReadInterval(excess, batteryMv);
+    }
+
+    // Priority from the sensor and the reading keys (`prio_keys`); alarms go first, in packets of their own class
+    for (ASCSSensorResult &result : results) {
+        result.priority = m_priorityRules.classify(result.readings, result.priority);
+    }
+    std::stable_sort(results.begin(), results.end(),
+                     [](const ASCSSensorResult &a, const ASCSSensorResult &b) { return a.priority > b.priority; });
 
     // --- Watchdog Feed ---
-    // Feed after potentially long sensor read
     // feed_watchdog_placeholder();
 
-    if (read_success) {
-        Log.printf(LOG_LEVEL_DEBUG, "[%s] Sensor read successful (%d readings).\n", getName(), readingsMap.size());
+    // Pack the results into as few packets as fit: a single sensor keeps its plain sensor ID and keys
+    size_t first = 0;
+    while (first < results.size()) {
+        size_t last = first + 1; // One past the last result in this packet
+        size_t bytes = ASCSSensorRegistry::readingsSize(results[first].readings, results[first].sensorId.length() + 1,
+                                                        &results[first].types);
+        while (last < results.size() && results[last].priority == results[first].priority) {
+            size_t more = ASCSSensorRegistry::readingsSize(results[last].readings, results[last].sensorId.length() + 1,
+                                                           &results[last].types);
+            if (bytes + more > ASCS_SENSOR_PACKET_BUDGET) break;
+            bytes += more;
+            last++;
+        }
 
-        // Populate standard SensorData fields
-        strncpy(data.sensor_id, m_sensor->getSensorId().c_str(), sizeof(data.sensor_id) - 1);
-        data.sensor_id[sizeof(data.sensor_id) - 1] = '\0'; // Ensure null termination
+        if (last - first == 1) {
+            sendReadings(results[first].sensorId, results[first].readings, m_sensorReadsTo, results[first].priority,
+                         &results[first].types);
+        } else {
+            std::map<std::string, float> combined;
+            ReadingTypes combinedTypes;
+            for (size_t i = first; i < last; i++) {
+                ASCSSensorRegistry::combine(results[i].sensorId, results[i].readings, combined);
+                ASCSSensorRegistry::combine(results[i].sensorId, results[i].types, combinedTypes);
+            }
+            Log.printf(LOG_LEVEL_DEBUG, "[%s] Sending readings of %d sensors in one packet.\n", getName(), (int)(last - first));
+            sendReadings(ASCS_COMBINED_SENSOR_ID, combined, m_sensorReadsTo, results[first].priority, &combinedTypes);
+        }
+        first = last;
+    }
+    return true;
+}
 
-        // Use Meshtastic's time (can be GPS or RTC synchronized)
-        data.timestamp_utc = m_api->getAdjustedTime();
-        // Increment sequence number for this sensor node
-        data.sequence_num = ++m_sensorSequenceNum;
+/**
+ * @brief Takes the events waiting in the sensors' queues and sends those of each sensor that is not
+ * within its debounce time (ASCSEventDebouncer), in a packet of their own: at least HIGH priority,
+ * not waiting for a transmit slot. The deadbands count them as sent, so the next read does not
+ * repeat them.
+ * @return True if any events were sent.
+ */
+bool AkitaSmartCityServices::pollSensorEvents(unsigned long now) {
+    for (size_t i = 0; i < m_sensors.size(); i++) {
+        SensorEventQueue *queue = m_sensors.getSensor(i).getEventQueue();
+        if (queue && !queue->empty()) m_events.drain(i, *queue);
+    }
+
+    bool sent = false;
+    size_t index;
+    std::map<std::string, float> readings;
+    while (m_events.takeReady(now, index, readings)) {
+        AsyncSensorInterface &sensor = m_sensors.getSensor(index);
+        std::string sensorId = sensor.getSensorId();
+        MessagePriority priority = m_priorityRules.classify(readings, sensor.getPriority(readings));
+        if (priority < MessagePriority::HIGH) priority = MessagePriority::HIGH;
+        ReadingTypes types;
+        for (const auto &reading : readings) {
+            ReadingType type = sensor.getReadingType(reading.first);
+            if (type != ReadingType::FLOAT) types[reading.first] = type;
+        }
+        m_deadband.note(sensorId, readings, now);
+        Log.printf(LOG_LEVEL_DEBUG, "[%s] Sending %d event reading(s) of sensor '%s'.\n", getName(), (int)readings.size(), sensorId.c_str());
+        sendReadings(sensorId, readings, 0, priority, &types);
+        sent = true;
+    }
+    return sent;
+}
 
-        // ** Prepare the map field for encoding **
-        MapCallbackContext encode_context;
-        encode_context.map_ptr = &readingsMap; // Point context to our map containing the readings
-        data.readings.funcs.encode = encode_map_callback; // Set the callback function for the 'readings' field
-        data.readings.arg = &encode_context; // Pass our context struct as the argument
+/**
+ * @brief Builds a SensorData packet (timestamp, next sequence number) from readings and sends it.
+ * @param sensorId Sensor ID of the packet (ASCS_COMBINED_SENSOR_ID for readings of several sensors).
+ * @param readings The readings (kept alive for encoding).
+ * @param toNode Destination as in sendSensorData().
+ * @param priority Priority class of the packet.
+ * @param types Readings sent as booleans or integers (null: all floats).
+ */
+void AkitaSmartCityServices::sendReadings(const std::string &sensorId, std::map<std::string, float> &readings, uint32_t toNode,
+                                          MessagePriority priority /*= ROUTINE*/, ReadingTypes *types /*= nullptr*/) {
+    SensorData data = SensorData_init_zero; // Initialize proto struct
 
-        // Now the 'data' struct is fully prepared, including the setup for map encoding.
-        // Send the prepared SensorData.
-        sendSensorData(data);
+    // Populate standard SensorData fields
+    strncpy(data.sensor_id, sensorId.c_str(), sizeof(data.sensor_id) - 1);
+    data.sensor_id[sizeof(data.sensor_id) - 1] = '\0'; // Ensure null termination
+
+    // Use Meshtastic's time (can be GPS or RTC synchronized)
+    data.timestamp_utc = m_api->getAdjustedTime();
+    // Increment sequence number for this sensor node
+    data.sequence_num = ++m_sensorSequenceNum;
+    data.priority = (uint32_t)priority;
+    if (m_adaptive.isEnabled()) data.interval_ms = m_adaptive.getIntervalMs(); // Lets the gateway tell a slow Sensor from a lost one
+
+    // ** Prepare the map field for encoding **
+    MapCallbackContext encode_context;
+    encode_context.map_ptr = &readings; // Point context to our map containing the readings
+    encode_context.types_ptr = types;   // Booleans and integers go in their own fields
+    setReadingsEncoder(data, encode_context); // Set the callback functions for the readings fields
+
+    // Now the 'data' struct is fully prepared, including the setup for map encoding.
+    // Send the prepared SensorData.
+    sendSensorData(data, toNode);
+}
 
-    } else {
-        Log.println(LOG_LEVEL_ERROR, "[%s] Failed to read sensor data.", getName());
-        // Consider sending a status message indicating sensor failure?
-    }
+/**
+ * @brief Starts the sensor schedules at our first transmit slot after 'after' (slotted), or at 'after'.
+ */
+void AkitaSmartCityServices::scheduleSensors(unsigned long after) {
+    uint32_t utc = m_api->getAdjustedTime();
+    m_slotOnUtc = utc >= ASCS_TX_SLOT_UTC_VALID;
+    unsigned long anchor = m_txSlot.isEnabled() ? m_txSlot.nextSlot(after, millis(), utc) : after;
+    m_sensors.schedule(anchor, m_adaptive.getIntervalMs());
+}
+
+/**
+ * @brief Adapts the read interval of the sensors on `read_int` after a round of reads: shorter
+ * while readings move several deadbands between reads, longer while they stay within them or the
+ * battery is low. Without deadbands there is no measure of change, and only the battery moves it.
+ */
+void AkitaSmartCityServices::adaptReadInterval(float excess, uint32_t batteryMv) {
+    bool adapted = m_adaptive.onBattery(batteryMv);
+    if (m_deadband.isEnabled() && m_adaptive.onRound(excess)) adapted = true;
+    if (!adapted) return;
+    m_sensors.setDefaultInterval(m_adaptive.getIntervalMs());
+    Log.printf(LOG_LEVEL_INFO, "[%s] Read interval now %lu ms (%s).\n", getName(), (unsigned long)m_adaptive.getIntervalMs(),
+               m_adaptive.isBatteryLow() ? "battery low" : excess > 1.0f ? "readings changing" : "readings stable");
 }
 
 /**
  * @brief Performs actions for the Aggregator role: forwards received sensor packets.
+ * Data goes to a gateway in range, or to the Aggregator with the cheapest advertised route to one
+ * (multi-tier forwarding). Each forward increments SensorData.relay_hops; packets that reached
+ * ASCS_AGGREGATOR_MAX_RELAY_HOPS are dropped, so a transient routing loop cannot keep them alive.
  * @param packet The full SmartCityPacket containing SensorData received from another node.
  * @param fromNode The Node ID of the original sender.
  */
 void AkitaSmartCityServices::runAggregatorLogic(const SmartCityPacket &packet, uint32_t fromNode) {
     Log.printf(LOG_LEVEL_INFO, "[%s] Aggregator received sensor data from 0x%lx.\n", getName(), fromNode);
 
-    // Determine the target gateway
+    if (packet.payload.sensor_data.relay_hops >= ASCS_AGGREGATOR_MAX_RELAY_HOPS) {
+        Log.printf(LOG_LEVEL_WARNING, "[%s] Data from 0x%lx already relayed %lu times (routing loop?). Dropping.\n",
+                   getName(), fromNode, (unsigned long)packet.payload.sensor_data.relay_hops);
+        return;
+    }
+
+    // Determine the next hop
     uint32_t targetGateway = m_config.getTargetNodeId(); // Use configured target first
     if (targetGateway == 0 || targetGateway == ASCS_BROADCAST_ADDR) {
-        targetGateway = findGatewayNode(); // Try to find one via discovery
+        float cost;
+        targetGateway = findRouteNextHop(cost); // Try to find one via discovery
         if (targetGateway != 0) {
-            Log.printf(LOG_LEVEL_DEBUG, "[%s] Aggregator using discovered gateway 0x%lx\n", getName(), targetGateway);
+            Log.printf(LOG_LEVEL_DEBUG, "[%s] Aggregator using discovered next hop 0x%lx (cost %.2f)\n", getName(), targetGateway, cost);
         }
     }
 
-    // Forward the packet if a target gateway is known
+    // Forward the *exact same* packet received.
+    // Assumes the packet is ready for re-transmission (map callbacks might need reset if re-encoding).
+    // For simple forwarding, sending the original encoded bytes might be more efficient if possible,
+    // but requires modifying handleReceived and sendMessage. Sending the decoded packet is simpler.
+    // The sender info describes the transmitting node, so it is replaced with ours.
+    SmartCityPacket forwarded = packet;
+    forwarded.payload.sensor_data.origin_node = fromNode; // Unchanged if already relayed
+    forwarded.payload.sensor_data.relay_hops++;
+    forwarded.payload.sensor_data.sender_role = m_config.getNodeRole();
+    forwarded.payload.sensor_data.sender_service_id = m_config.getServiceId();
+    // Higher classes leave our queue first (priority as set by the originating Sensor)
+    uint32_t priority = packet.payload.sensor_data.priority;
+    MessagePriority forwardPriority = priority >= (uint32_t)MessagePriority::CRITICAL ? MessagePriority::CRITICAL : (MessagePriority)priority;
+
+    // Forward the packet if a next hop is known
     if (targetGateway != 0 && targetGateway != ASCS_BROADCAST_ADDR) {
-        Log.printf(LOG_LEVEL_INFO, "[%s] Aggregator forwarding data from 0x%lx to Gateway 0x%lx\n", getName(), fromNode, targetGateway);
-        // Forward the *exact same* packet received.
-        // Assumes the packet is ready for re-transmission (map callbacks might need reset if re-encoding).
-        // For simple forwarding, sending the original encoded bytes might be more efficient if possible,
-        // but requires modifying handleReceived and sendMessage. Sending the decoded packet is simpler.
-        sendMessage(targetGateway, packet);
+        Log.printf(LOG_LEVEL_INFO, "[%s] Aggregator forwarding data from 0x%lx to 0x%lx\n", getName(), fromNode, targetGateway);
+        sendMessage(targetGateway, forwarded, forwardPriority);
+    } else if (storePacket(forwarded, forwardPriority)) {
+        // No route known: hold it until there is one again (broadcasting would flood the mesh)
+        Log.printf(LOG_LEVEL_INFO, "[%s] No route to a gateway known, holding data from 0x%lx (%d packet(s) held).\n", getName(),
+                   fromNode, (int)m_store.size());
     } else {
-        // No target gateway known, drop the packet to avoid broadcast storms.
-        Log.printf(LOG_LEVEL_WARNING, "[%s] Aggregator received data from 0x%lx, but no target gateway known. Dropping.\n", getName(), fromNode);
+        // No route known, drop the packet to avoid broadcast storms.
+        Log.printf(LOG_LEVEL_WARNING, "[%s] Aggregator received data from 0x%lx, but no route to a gateway known. Dropping.\n", getName(), fromNode);
     }
 }
 
 /**
  * @brief Performs actions for the Gateway role: publishes or buffers received sensor packets.
  * @param packet The full SmartCityPacket containing SensorData received from another node.
+ * @param readings The decoded readings map of the packet.
  * @param fromNode The Node ID of the original sender.
  */
-void AkitaSmartCityServices::runGatewayLogic(const SmartCityPacket &packet, uint32_t fromNode) {
+void AkitaSmartCityServices::runGatewayLogic(const SmartCityPacket &packet, const std::map<std::string, float> &readings,
+                                             const ReadingTypes &types, uint32_t fromNode) {
     Log.printf(LOG_LEVEL_INFO, "[%s] Gateway received sensor data from 0x%lx.\n", getName(), fromNode);
 
     #ifdef ASCS_ROLE_GATEWAY
-        // Pass the packet and originating node ID to the publish/buffer logic
-        publishMqttOrBuffer(packet, fromNode);
+        // Ensure the packet contains sensor data
+        if (packet.which_payload != SmartCityPacket_sensor_data_tag) {
+             Log.println(LOG_LEVEL_WARNING, "[%s] Attempted to dispatch non-SensorData packet.", getName());
+             return;
+        }
+
+        // Decode once into a self-contained record shared by all sinks
+        ASCSBatchRecord record;
+        record.nodeId = fromNode;
+        record.sensorId = packet.payload.sensor_data.sensor_id;
+        record.timestampUtc = packet.payload.sensor_data.timestamp_utc;
+        record.sequenceNum = packet.payload.sensor_data.sequence_num;
+        record.priority = (uint8_t)(packet.payload.sensor_data.priority > 255 ? 255 : packet.payload.sensor_data.priority);
+        record.intervalMs = packet.payload.sensor_data.interval_ms;
+        record.readings = readings;
+        record.types = types;
+
+        if (m_pollScheduler.onReply(fromNode, millis())) {
+            Log.printf(LOG_LEVEL_DEBUG, "[%s] Node 0x%lx answered its poll.\n", getName(), fromNode);
+        }
+
+        // Gaps in the sequence numbers: readings lost on the way, often to collisions in the sensor's slot
+        if (m_slotMonitor.onReading(fromNode, record.sequenceNum, millis())) {
+            Log.printf(LOG_LEVEL_INFO, "[%s] Node 0x%lx loses many readings, asking it to change its transmit slot.\n", getName(), fromNode);
+            sendServiceDiscovery(fromNode, false, true);
+        }
+
+        // Readings of several sensors in one packet: one record per sensor from here on
+        std::vector<ASCSBatchRecord> records;
+        if (record.sensorId == ASCS_COMBINED_SENSOR_ID) {
+            std::map<std::string, std::map<std::string, float>> perSensor;
+            std::map<std::string, ReadingTypes> perSensorTypes;
+            ASCSSensorRegistry::split(readings, perSensor);
+            ASCSSensorRegistry::split(types, perSensorTypes);
+            for (auto &sensor : perSensor) {
+                ASCSBatchRecord part;
+                part.nodeId = record.nodeId;
+                part.sensorId = sensor.first;
+                part.timestampUtc = record.timestampUtc;
+                part.sequenceNum = record.sequenceNum;
+                part.priority = record.priority;
+                part.intervalMs = record.intervalMs;
+                part.readings = std::move(sensor.second);
+                auto partTypes = perSensorTypes.find(sensor.first);
+                if (partTypes != perSensorTypes.end()) part.types = std::move(partTypes->second);
+                records.push_back(std::move(part));
+            }
+        } else {
+            records.push_back(std::move(record));
+        }
+
+        for (ASCSBatchRecord &output : records) {
+            // Per-origin rate limit: over budget, only the latest value per sensor is held for later
+            if (!m_rateLimiter.admit(output, millis())) {
+                Log.printf(LOG_LEVEL_DEBUG, "[%s] Node 0x%lx over its rate budget, record held/coalesced.\n", getName(), fromNode);
+                continue;
+            }
+
+            // Pass the record to the gateway outputs
+            dispatchToSinks(output);
+        }
     #else
         // Should not happen if role check is done correctly, but log defensively.
         Log.println(LOG_LEVEL_WARNING, "[%s] Gateway logic called, but support not compiled in!", getName());
@@ -880,16 +1623,33 @@ void AkitaSmartCityServices::runGatewayLogic(const SmartCityPacket &packet, uint
  * @param nodeId The Node ID of the discovered node.
  * @param role The advertised role of the node.
  * @param serviceId The advertised service ID of the node.
+ * @param link Signal quality and hop count of the packet received from the node, or nullptr if unknown.
+ * @return True if a gateway or aggregator is new or changed its role or service ID (a topology change).
+ *         New sensors do not count; nothing is routed through them.
  */
-void AkitaSmartCityServices::updateServiceTable(uint32_t nodeId, ServiceDiscovery_Role role, uint32_t serviceId) {
+bool AkitaSmartCityServices::updateServiceTable(uint32_t nodeId, ServiceDiscovery_Role role, uint32_t serviceId, const ASCSLinkSample *link) {
     // Ignore discovery messages from ourselves
-    if (nodeId == m_api->getMyNodeInfo()->node_num) return;
+    if (nodeId == m_api->getMyNodeInfo()->node_num) return false;
 
     unsigned long now = millis();
-    // Use operator[] to insert or update the entry for the given nodeId
-    m_serviceTable[nodeId] = {role, serviceId, now};
-    Log.printf(LOG_LEVEL_DEBUG, "[%s] Updated service table for node 0x%lx: Role=%d, ServiceID=%lu, LastSeen=%lu\n",
-               getName(), nodeId, role, serviceId, now);
+    uint32_t previousGateway = m_serviceTable.getBestGateway();
+    const ASCSServiceEntry *known = m_serviceTable.find(nodeId);
+    bool changed = (known == nullptr) || known->role != role || known->serviceId != serviceId;
+    bool routing = ASCSServiceTable::isRoutingRole(role) || (known && ASCSServiceTable::isRoutingRole(known->role));
+    // Insert or refresh the entry (evicts the least recently seen node if the table is full).
+    // This also keeps the best gateway current, so findGatewayNode() needs no scan.
+    bool isNew = m_serviceTable.update(nodeId, role, serviceId, now, link);
+    Log.printf(LOG_LEVEL_DEBUG, "[%s] %s service table entry for node 0x%lx: Role=%d, ServiceID=%lu, LastSeen=%lu (%d/%d)\n",
+               getName(), isNew ? "Added" : "Updated", nodeId, role, serviceId, now,
+               (int)m_serviceTable.size(), (int)m_serviceTable.getCapacity());
+
+    uint32_t bestGateway = m_serviceTable.getBestGateway();
+    if (bestGateway != previousGateway && bestGateway != 0) {
+        const ASCSServiceEntry *entry = m_serviceTable.find(bestGateway);
+        Log.printf(LOG_LEVEL_INFO, "[%s] Best gateway is now 0x%lx (cost %.2f, previous 0x%lx).\n",
+                   getName(), bestGateway, entry ? entry->link.cost : 0.0f, previousGateway);
+    }
+    return changed && routing;
 }
 
 /**
@@ -897,259 +1657,604 @@ void AkitaSmartCityServices::updateServiceTable(uint32_t nodeId, ServiceDiscover
  */
 void AkitaSmartCityServices::cleanupServiceTable() {
     unsigned long now = millis();
-    int removedCount = 0;
-    // Iterate through the map and erase elements that have timed out
-    for (auto it = m_serviceTable.begin(); it != m_serviceTable.end(); /* no increment here */) {
-        // Check if the entry's lastSeen time is older than the timeout period
-        if (now - it->second.lastSeen > m_config.getServiceTimeoutMs()) {
-            Log.printf(LOG_LEVEL_INFO, "[%s] Service timed out for node 0x%lx (Role: %d)\n", getName(), it->first, it->second.role);
-            // Erase the element and update the iterator to the next valid element
-            it = m_serviceTable.erase(it);
-            removedCount++;
-        } else {
-            // If not timed out, move to the next element
-            ++it;
-        }
-    }
+    // Entries are kept in lastSeen order, so only the timed-out ones are visited
+    bool lostRoute = false;
+    size_t removedCount = m_serviceTable.expire(now, m_config.getServiceTimeoutMs(), [this, &lostRoute](const ASCSServiceEntry &entry) {
+        Log.printf(LOG_LEVEL_INFO, "[%s] Service timed out for node 0x%lx (Role: %d)\n", getName(), entry.nodeId, entry.role);
+        if (ASCSServiceTable::isRoutingRole(entry.role)) lostRoute = true;
+    });
     // Log if any entries were removed
     if (removedCount > 0) {
-        Log.printf(LOG_LEVEL_DEBUG, "[%s] Removed %d timed-out service(s).\n", getName(), removedCount);
+        Log.printf(LOG_LEVEL_DEBUG, "[%s] Removed %d timed-out service(s).\n", getName(), (int)removedCount);
+    }
+    if (lostRoute) {
+        m_discoveryTimer.reset(now); // A lost gateway/aggregator is a topology change
+    }
+    checkRouteChange();
+    if (m_pollScheduler.isEnabled()) {
+        m_pollScheduler.expire(now, m_config.getServiceTimeoutMs()); // Polled sensors neither announcing nor answering
+    }
+
+    const ASCSTrickleStats &discovery = m_discoveryTimer.getStats();
+    Log.printf(LOG_LEVEL_DEBUG, "[%s] Discovery: interval %lu ms, %lu sent, %lu skipped as redundant, %lu replaced by data, %lu resets\n",
+               getName(), (unsigned long)m_discoveryTimer.getInterval(), (unsigned long)discovery.sent,
+               (unsigned long)discovery.suppressed, (unsigned long)discovery.replaced, (unsigned long)discovery.resets);
+    const ASCSDiscoveryReplyStats &replies = m_discoveryReplies.getStats();
+    if (replies.scheduled > 0) {
+        Log.printf(LOG_LEVEL_DEBUG, "[%s] Discovery queries answered: %lu, replies suppressed: %lu\n", getName(),
+                   (unsigned long)replies.sent, (unsigned long)replies.suppressed);
+    }
+
+    if (m_config.getNodeRole() == ServiceDiscovery_Role_SENSOR && !m_sensors.empty()) {
+        const ASCSSensorRegistryStats &sensors = m_sensors.getStats();
+        Log.printf(LOG_LEVEL_DEBUG, "[%s] Sensors: %lu reads in %lu rounds (%d sensors), %lu failed, %lu timed out, longest round %lu ms, %lu summaries\n",
+                   getName(), (unsigned long)sensors.reads, (unsigned long)sensors.rounds, (int)m_sensors.size(),
+                   (unsigned long)sensors.failed, (unsigned long)sensors.timeouts, (unsigned long)sensors.roundMaxMs,
+                   (unsigned long)sensors.summaries);
+        if (m_deadband.isEnabled()) {
+            const ASCSDeadbandStats &deadband = m_deadband.getStats();
+            Log.printf(LOG_LEVEL_DEBUG, "[%s] Deadbands: %lu sent, %lu heartbeats, %lu suppressed\n", getName(),
+                       (unsigned long)deadband.sent, (unsigned long)deadband.heartbeats, (unsigned long)deadband.suppressed);
+        }
+        if (m_adaptive.isEnabled()) {
+            const ASCSAdaptiveStats &adaptive = m_adaptive.getStats();
+            Log.printf(LOG_LEVEL_DEBUG, "[%s] Read interval %lu ms: %lu times shortened, %lu lengthened, battery low %lu times%s\n",
+                       getName(), (unsigned long)m_adaptive.getIntervalMs(), (unsigned long)adaptive.shortened,
+                       (unsigned long)adaptive.lengthened, (unsigned long)adaptive.batteryLow, m_adaptive.isBatteryLow() ? " (now)" : "");
+        }
+        const ASCSEventStats &events = m_events.getStats();
+        if (events.events > 0 || events.dropped > 0) {
+            Log.printf(LOG_LEVEL_DEBUG, "[%s] Sensor events: %lu in %lu packets (%lu coalesced), %lu dropped (queue full), longest wait %lu ms\n",
+                       getName(), (unsigned long)events.events, (unsigned long)events.packets, (unsigned long)events.coalesced,
+                       (unsigned long)events.dropped, (unsigned long)events.maxLatencyMs);
+        }
+    }
+
+    if (m_store.isEnabled()) {
+        const ASCSStoreStats &store = m_store.getStats();
+        Log.printf(LOG_LEVEL_DEBUG, "[%s] Held for a gateway: %d now (max %lu), %lu held, %lu sent, %lu dropped, %lu restored\n",
+                   getName(), (int)m_store.size(), (unsigned long)store.depthMax, (unsigned long)store.stored,
+                   (unsigned long)store.flushed, (unsigned long)store.dropped, (unsigned long)store.restored);
     }
+
+    const ASCSOutboundStats &outbound = m_outbound.getStats();
+    Log.printf(LOG_LEVEL_DEBUG, "[%s] Outbound queue: %d queued (max %lu), %lu retries, airtime last hour %lu ms of %lu ms, %lu held back by duty cycle\n",
+               getName(), (int)m_outbound.size(), (unsigned long)outbound.depthMax, (unsigned long)outbound.retries,
+               (unsigned long)m_outbound.getAirtimeLastHourMs(now), (unsigned long)m_outbound.getDutyBudgetMs(),
+               (unsigned long)outbound.deferred);
+    for (int i = ASCS_OUTBOUND_PRIORITY_CLASSES - 1; i >= 0; i--) {
+        if (outbound.queued[i] == 0) continue;
+        Log.printf(LOG_LEVEL_DEBUG, "[%s] Outbound %s: %lu sent, %lu dropped, %lu failed, longest wait %lu ms\n", getName(),
+                   ASCSPriorityRules::name((MessagePriority)i), (unsigned long)outbound.sent[i],
+                   (unsigned long)outbound.dropped[i], (unsigned long)outbound.failed[i], (unsigned long)outbound.waitMaxMs[i]);
+    }
+
+    logGatewayScores();
 }
 
 /**
- * @brief Finds the "best" known gateway node from the service table.
- * Current Strategy: Returns the Node ID of the most recently seen gateway.
- * @return Node ID of the best gateway, or 0 if none are known/active.
+ * @brief Restores the Gateways and Aggregators saved before the last restart (watchdog reset,
+ * firmware update, power loss). Entries that would have timed out are skipped.
  */
-uint32_t AkitaSmartCityServices::findGatewayNode() {
-    uint32_t bestGateway = 0;
-    unsigned long latestSeen = 0;
-
-    // Iterate through the service table
-    for (const auto& pair : m_serviceTable) {
-        // Check if the node's role is Gateway
-        if (pair.second.role == ServiceDiscovery_Role_GATEWAY) {
-            // If this gateway was seen more recently than the current best, update
-            if (pair.second.lastSeen > latestSeen) {
-                latestSeen = pair.second.lastSeen;
-                bestGateway = pair.first; // pair.first is the Node ID (the map key)
-            }
-            // Future Enhancement: Could add more complex logic here, e.g.,
-            // - Prefer gateways with a specific service ID.
-            // - Check NodeDB for signal quality (RSSI/SNR) and prefer stronger signals.
-            // - Implement round-robin or load balancing if multiple gateways are available.
+void AkitaSmartCityServices::restoreServiceTable() {
+    Preferences prefs;
+    if (!prefs.begin(ASCS_SERVICE_SNAPSHOT_NAMESPACE, true)) { // Read-only; fails if never written
+        return;
+    }
+    uint8_t buffer[ASCS_SERVICE_SNAPSHOT_MAX_SIZE];
+    size_t length = prefs.getBytesLength(ASCS_SERVICE_SNAPSHOT_KEY);
+    if (length > 0 && length <= sizeof(buffer)) {
+        length = prefs.getBytes(ASCS_SERVICE_SNAPSHOT_KEY, buffer, sizeof(buffer));
+        size_t restored = ASCSServiceSnapshot::decode(buffer, length, m_serviceTable, millis(), m_config.getServiceTimeoutMs());
+        Log.printf(LOG_LEVEL_INFO, "[%s] Restored %d service(s) from snapshot, best gateway 0x%lx.\n", getName(),
+                   (int)restored, m_serviceTable.getBestGateway());
+    }
+    prefs.end();
+    m_snapshotSignature = ASCSServiceSnapshot::signature(m_serviceTable);
+}
+
+/**
+ * @brief Writes the service table snapshot to NVS, but only if the set of Gateways/Aggregators
+ * or the best gateway changed since the last write (ages and link metrics alone do not count).
+ * @return True if a snapshot was written.
+ */
+bool AkitaSmartCityServices::saveServiceTable() {
+    uint32_t signature = ASCSServiceSnapshot::signature(m_serviceTable);
+    if (signature == m_snapshotSignature) return false;
+
+    uint8_t buffer[ASCS_SERVICE_SNAPSHOT_MAX_SIZE];
+    size_t length = ASCSServiceSnapshot::encode(m_serviceTable, millis(), buffer, sizeof(buffer));
+    Preferences prefs;
+    if (!prefs.begin(ASCS_SERVICE_SNAPSHOT_NAMESPACE, false)) {
+        Log.printf(LOG_LEVEL_ERROR, "[%s] Failed to open Preferences for the service table snapshot!\n", getName());
+        return false;
+    }
+    bool ok = prefs.putBytes(ASCS_SERVICE_SNAPSHOT_KEY, buffer, length) == length;
+    prefs.end();
+    if (!ok) {
+        Log.printf(LOG_LEVEL_WARNING, "[%s] Writing the service table snapshot failed.\n", getName());
+        return false;
+    }
+    m_snapshotSignature = signature;
+    Log.printf(LOG_LEVEL_DEBUG, "[%s] Service table snapshot written (%d bytes).\n", getName(), (int)length);
+    return true;
+}
+
+/**
+ * @brief Restores the packets held for a gateway before the last restart (Sensors/Aggregators).
+ */
+void AkitaSmartCityServices::restoreStoredPackets() {
+    Preferences prefs;
+    if (!prefs.begin(ASCS_STORE_NAMESPACE, true)) { // Read-only; fails if never written
+        return;
+    }
+    size_t length = prefs.getBytesLength(ASCS_STORE_KEY);
+    if (length > 0 && length <= ASCS_STORE_SNAPSHOT_MAX_SIZE) {
+        std::vector<uint8_t> buffer(length);
+        length = prefs.getBytes(ASCS_STORE_KEY, buffer.data(), buffer.size());
+        size_t restored = m_store.decode(buffer.data(), length);
+        if (restored > 0) {
+            Log.printf(LOG_LEVEL_INFO, "[%s] Restored %d held packet(s) from before the restart.\n", getName(), (int)restored);
         }
     }
-    // Return the Node ID of the best gateway found, or 0 if none were found/active
-    return bestGateway;
+    prefs.end();
 }
 
+/**
+ * @brief Writes the held packets to NVS if they changed since the last write (checked with the
+ * service table snapshot, so at most once per ASCS_STORE_SAVE_INTERVAL_MS).
+ * @return True if written.
+ */
+bool AkitaSmartCityServices::saveStoredPackets() {
+    if (!m_store.isDirty()) return false;
+
+    std::vector<uint8_t> buffer(ASCS_STORE_SNAPSHOT_MAX_SIZE); // Too large for the loop task's stack
+    size_t length = m_store.encode(buffer.data(), buffer.size());
+    Preferences prefs;
+    if (!prefs.begin(ASCS_STORE_NAMESPACE, false)) {
+        Log.printf(LOG_LEVEL_ERROR, "[%s] Failed to open Preferences for held packets!\n", getName());
+        return false;
+    }
+    bool ok = prefs.putBytes(ASCS_STORE_KEY, buffer.data(), length) == length; // Header only once all were sent
+    prefs.end();
+    if (!ok) {
+        Log.printf(LOG_LEVEL_WARNING, "[%s] Writing held packets failed.\n", getName());
+        return false;
+    }
+    m_store.markSaved();
+    Log.printf(LOG_LEVEL_DEBUG, "[%s] Held packets written (%d packets, %d bytes).\n", getName(), (int)m_store.size(), (int)length);
+    return true;
+}
 
-// --- MQTT Publishing & Buffering (Gateway Role) ---
-#ifdef ASCS_ROLE_GATEWAY
+/**
+ * @brief Holds a SensorData packet (with its readings callbacks set) until a route to a gateway is known.
+ * @return False if the store is disabled (`sf_max` 0) or the packet could not be held.
+ */
+bool AkitaSmartCityServices::storePacket(const SmartCityPacket &packet, MessagePriority priority) {
+    if (!m_store.isEnabled()) return false;
+    uint8_t buffer[ASCS_GATEWAY_MAX_PACKET_SIZE];
+    size_t length = encodePacket(packet, buffer, sizeof(buffer));
+    return length > 0 && m_store.push(buffer, length, priority);
+}
 
 /**
- * @brief Decides whether to publish a received packet directly via MQTT or buffer it.
- * Buffering occurs if MQTT is disconnected or if actively processing the buffer.
- * @param packet The received SmartCityPacket (must contain SensorData).
- * @param fromNode The originating Node ID of the packet.
+ * @brief Once a route to a gateway is known again, sends the held packets to it, oldest first: one
+ * StoredBatch of up to ASCS_STORE_FLUSH_BATCH packets per `sf_flush_ms`, while the outbound queue
+ * has room for live data.
+ * @return True if packets were sent.
  */
-void AkitaSmartCityServices::publishMqttOrBuffer(const SmartCityPacket &packet, uint32_t fromNode) {
-    // Ensure the MQTT client is initialized
-    if (!m_mqttClient) {
-        Log.println(LOG_LEVEL_ERROR, "[%s] MQTT client not initialized! Cannot publish or buffer.", getName());
-        return;
+bool AkitaSmartCityServices::flushStoredPackets(unsigned long now) {
+    if (m_store.empty()) return false;
+
+    uint32_t target = m_config.getTargetNodeId();
+    if (target == 0 || target == ASCS_BROADCAST_ADDR) {
+        float cost;
+        target = findRouteNextHop(cost);
     }
-    // Ensure the packet contains sensor data
-    if (packet.which_payload != SmartCityPacket_sensor_data_tag) {
-         Log.println(LOG_LEVEL_WARNING, "[%s] Attempted to publish/buffer non-SensorData packet.", getName());
-         return;
-    }
-
-    // Check MQTT connection status and buffering flag
-    if (m_mqttClient->connected() && !m_gatewayBufferActive) {
-        // --- Attempt Direct Publish ---
-        Log.println(LOG_LEVEL_DEBUG, "[%s] MQTT connected. Attempting direct publish...", getName());
-        // ** Need access to the decoded map data here **
-        // This requires refactoring how decoded map data is passed down.
-        // Placeholder: Call publishMqtt with only the base SensorData struct.
-        // This will result in the map data being missing in the JSON payload.
-        if (!publishMqtt(packet.payload.sensor_data, fromNode)) {
-            // Direct publish failed (e.g., MQTT buffer full, network issue despite connection)
-            Log.println(LOG_LEVEL_WARNING, "[%s] Direct MQTT publish failed! Activating buffering.", getName());
-            m_gatewayBufferActive = true; // Start buffering subsequent messages
-            bufferPacket(packet); // Buffer the current failed packet
-        } else {
-            // Direct publish successful
-            Log.println(LOG_LEVEL_DEBUG, "[%s] Direct MQTT publish successful.", getName());
+    if (target == 0) {
+        m_store.onRouteLost();
+        return false;
+    }
+    if (m_outbound.size() >= ASCS_OUTBOUND_QUEUE_MAX / 2) return false; // Live data first
+
+    // The packets stay in the store until queued: a full outbound queue must not lose them
+    if (m_store.peekBatch(now, m_storeBatch) == 0) return false;
+    if (m_storeBatch.size() == 1) {
+        if (!queueEncoded(target, m_storeBatch[0].second.data(), m_storeBatch[0].second.size(), m_storeBatch[0].first, true)) {
+            Log.printf(LOG_LEVEL_WARNING, "[%s] Failed to send held packet, kept for the next flush.\n", getName());
+            return false;
         }
     } else {
-        // --- Buffer Packet ---
-        // Reason: MQTT not connected OR currently processing buffer (avoids interleaved sends)
-        if (!m_gatewayBufferActive) {
-            // Log the start of buffering only once when the state changes
-            Log.println(LOG_LEVEL_INFO, "[%s] MQTT disconnected or buffer active. Buffering packet.", getName());
-            m_gatewayBufferActive = true; // Ensure flag is set
-        } else {
-             Log.println(LOG_LEVEL_DEBUG, "[%s] Buffering packet (MQTT disconnected or buffer active).", getName());
+        uint8_t buffer[ASCS_GATEWAY_MAX_PACKET_SIZE];
+        size_t length = ASCSStoreForward::encodeBatch(m_storeBatch, buffer, sizeof(buffer));
+        MessagePriority priority = MessagePriority::ROUTINE;
+        for (const auto &held : m_storeBatch) {
+            if (held.first > priority) priority = held.first;
+        }
+        if (length == 0 || !queueEncoded(target, buffer, length, priority, true)) {
+            Log.printf(LOG_LEVEL_WARNING, "[%s] Failed to send %d held packets, kept for the next flush.\n", getName(),
+                       (int)m_storeBatch.size());
+            return false;
         }
-        bufferPacket(packet); // Add the packet to the buffer file
     }
+    m_store.commitBatch(m_storeBatch.size());
+    Log.printf(LOG_LEVEL_INFO, "[%s] Sent %d held packet(s) to 0x%lx, %d left.\n", getName(), (int)m_storeBatch.size(), target,
+               (int)m_store.size());
+    return true;
 }
 
+/**
+ * @brief Logs the link metrics and expected transmission cost of every known gateway.
+ * Called with each service table cleanup, so gateway choices can be checked from the serial log.
+ */
+void AkitaSmartCityServices::logGatewayScores() {
+    uint32_t best = m_serviceTable.getBestGateway();
+    uint32_t selected = findGatewayNode();
+    m_serviceTable.forEachOfRole(ServiceDiscovery_Role_GATEWAY, [this, selected](const ASCSServiceEntry &entry) {
+        Log.printf(LOG_LEVEL_INFO, "[%s] Gateway 0x%lx: cost %.2f (RSSI %.0f dBm, SNR %.1f dB, hops %.1f, %u samples), capacity %lu%s\n",
+                   getName(), entry.nodeId, entry.link.cost, entry.link.rssi, entry.link.snr, entry.link.hops,
+                   (unsigned)entry.link.samples, (unsigned long)entry.capacity, entry.nodeId == selected ? " <- selected" : "");
+    });
+    if (best != 0 && !m_hashGatewaySelection) {
+        Log.printf(LOG_LEVEL_INFO, "[%s] Gateway switches since boot: %lu\n", getName(), (unsigned long)m_serviceTable.getGatewaySwitches());
+    }
+}
 
 /**
- * @brief Performs the actual MQTT publication of sensor data.
- * Constructs the topic and JSON payload.
- * @param sensorData The SensorData struct to publish.
- * @param fromNode The originating Node ID.
- * @return True if the message was successfully published by the MQTT client, false otherwise.
+ * @brief Finds the "best" known gateway node from the service table.
+ * 'gw_select' = "cost" (default): the gateway with the lowest expected transmission cost,
+ * estimated from EWMA RSSI/SNR of the last hop and the hop count of packets received from it.
+ * Another gateway only takes over when it is cheaper by more than 'gw_switch_pct' percent.
+ * The table maintains this incrementally on every update, so this is O(1) and safe to call
+ * for every sensor send and aggregator forward.
+ * 'gw_select' = "hash": spreads nodes over all gateways with a usable link, weighted by their
+ * advertised capacity (rendezvous hashing on our node ID, see getHashedGateway()), so several
+ * gateways covering one district share the load. O(gateways).
+ * @return Node ID of the best gateway, or 0 if none are known/active.
  */
-bool AkitaSmartCityServices::publishMqtt(const SensorData &sensorData, uint32_t fromNode) {
-    // Double-check connection (should be called by publishMqttOrBuffer which already checks)
-    if (!m_mqttClient || !m_mqttClient->connected()) {
-        Log.println(LOG_LEVEL_WARNING, "[%s] publishMqtt called but client not connected.", getName());
-        return false;
+uint32_t AkitaSmartCityServices::findGatewayNode() {
+    if (m_hashGatewaySelection) {
+        return m_serviceTable.getHashedGateway(m_api->getMyNodeInfo()->node_num);
     }
+    return m_serviceTable.getBestGateway();
+}
 
-    // --- Construct MQTT Topic ---
-    char fromNodeHex[9]; // 8 hex chars + null terminator
-    snprintf(fromNodeHex, sizeof(fromNodeHex), "%08lx", fromNode); // Format Node ID as hex string
-
-    std::string topic = m_config.getMqttBaseTopic();
-    topic += "/sensor/"; // Assume data originates from a sensor conceptually
-    topic += std::to_string(m_config.getServiceId()); // Use Gateway's service ID for topic structure
-    topic += "/";
-    topic += fromNodeHex; // Add originating node ID
-    // Add sensor ID from the packet if available
-    if (strlen(sensorData.sensor_id) > 0) {
-        topic += "/";
-        topic += sensorData.sensor_id;
-    }
-
-    // --- Construct JSON Payload ---
-    // Estimate JSON size needed. Adjust capacity as needed based on typical map size.
-    // Base fields + map object overhead + estimated size per map entry + safety buffer
-    const int base_size = JSON_OBJECT_SIZE(5); // node_id, sensor_id, timestamp, sequence, readings_obj
-    const int estimated_entry_size = 35;       // Avg key len + value representation + quotes, colon, comma
-    const int map_capacity = JSON_OBJECT_SIZE(sensorData.readings_count); // Map object overhead
-    const int jsonCapacity = base_size + map_capacity + (sensorData.readings_count * estimated_entry_size) + 150; // Add safety buffer
-    StaticJsonDocument<jsonCapacity> doc; // Increase size if publish fails due to truncation!
-
-    // Populate base fields
-    doc["node_id"] = fromNodeHex;
-    doc["sensor_id"] = sensorData.sensor_id; // Can be empty
-    doc["timestamp_utc"] = sensorData.timestamp_utc;
-    doc["sequence_num"] = sensorData.sequence_num;
-
-    // Add Meshtastic metadata (optional, requires NodeDB lookup)
-    // NodeInfo *ni = m_api->getNode(fromNode);
-    // if (ni) {
-    //    JsonObject meta = doc.createNestedObject("meshtastic_meta");
-    //    meta["rssi"] = ni->radio.rssi;
-    //    meta["snr"] = ni->radio.snr;
-    //    meta["hops_away"] = ni->hops_away;
-    // }
+/**
+ * @brief Finds the next hop towards a gateway for sent and forwarded data: the cheaper of the
+ * gateway from findGatewayNode() (its link cost) and the Aggregator with the cheapest route (our
+ * link cost to it plus its advertised route cost). The current next hop is kept while it still
+ * has a route, unless another is cheaper by more than 'gw_switch_pct' percent. O(aggregators).
+ * @param cost Set to the expected transmissions to reach a gateway over the returned hop.
+ * @return Node ID of the next hop, or 0 if no route is known.
+ */
+uint32_t AkitaSmartCityServices::findRouteNextHop(float &cost) {
+    uint32_t self = m_api->getMyNodeInfo()->node_num;
+    uint32_t nextHop = findGatewayNode();
+    if (nextHop != 0) {
+        const ASCSServiceEntry *gateway = m_serviceTable.find(nextHop);
+        cost = gateway ? gateway->link.cost : ASCS_LINK_UNKNOWN_COST;
+    }
+    float viaCost = 0;
+    uint32_t via = m_serviceTable.getBestAggregatorRoute(self, viaCost);
+    if (via != 0 && (nextHop == 0 || viaCost < cost)) {
+        nextHop = via;
+        cost = viaCost;
+    }
+
+    // Hysteresis against flapping between next hops of similar cost (findGatewayNode() has its own between gateways)
+    const ASCSServiceEntry *current = (nextHop != m_nextHop && m_nextHop != 0) ? m_serviceTable.find(m_nextHop) : nullptr;
+    bool betweenGateways = current && current->role == ServiceDiscovery_Role_GATEWAY && nextHop != via;
+    float currentCost;
+    if (current && !betweenGateways && m_serviceTable.getRouteCost(m_nextHop, self, currentCost) &&
+        cost >= currentCost * (1.0f - m_config.getGatewaySwitchPct() / 100.0f)) {
+        nextHop = m_nextHop;
+        cost = currentCost;
+    }
+    m_nextHop = nextHop;
+    return nextHop;
+}
 
-    // Create nested object for readings
-    JsonObject readingsObj = doc.createNestedObject("readings");
-
-    // --- Populate Readings Object ---
-    // ** CRITICAL DEPENDENCY: Access to the decoded map data **
-    // This requires the decoded map (e.g., 'decoded_readings' from handleReceived)
-    // to be passed down to this function. Without it, the map data cannot be added.
-    // Placeholder logic assumes map data is unavailable here due to current structure.
-    if (sensorData.readings_count > 0) {
-        // If we had access to `const std::map<std::string, float>& readingsMap`:
-        // for (const auto& pair : readingsMap) {
-        //     readingsObj[pair.first] = pair.second;
-        // }
-        // Without access, add a status note:
-        readingsObj["status"] = "Map data processing requires refactoring to pass decoded map here.";
-        Log.println(LOG_LEVEL_WARNING, "[%s] Cannot add map readings to JSON: Decoded map data not available in publishMqtt context.", getName());
-    } else {
-        readingsObj["status"] = "Map data unavailable or empty in source packet.";
+/**
+ * @brief Aggregators: announces quickly again (Trickle reset) if our route to a gateway changed
+ * since it was last advertised: a different next hop, or a cost change of more than
+ * ASCS_AGGREGATOR_ROUTE_CHANGE. Aggregators further out then learn the new route fast.
+ */
+void AkitaSmartCityServices::checkRouteChange() {
+    if (m_config.getNodeRole() != ServiceDiscovery_Role_AGGREGATOR) return;
+    float cost = 0;
+    uint32_t nextHop = findRouteNextHop(cost);
+    if (nextHop == 0) cost = 0;
+    float delta = cost > m_routeCost ? cost - m_routeCost : m_routeCost - cost;
+    bool changed = nextHop != m_routeNextHop || delta > m_routeCost * ASCS_AGGREGATOR_ROUTE_CHANGE;
+    if (!changed) return;
+    Log.printf(LOG_LEVEL_INFO, "[%s] Route to a gateway now via 0x%lx (cost %.2f, previous 0x%lx, cost %.2f).\n",
+               getName(), nextHop, cost, m_routeNextHop, m_routeCost);
+    m_routeNextHop = nextHop;
+    m_routeCost = cost;
+    m_discoveryTimer.reset(millis());
+}
+
+
+// --- Gateway Output: Sinks, Batching & Spill Files (Gateway Role) ---
+#ifdef ASCS_ROLE_GATEWAY
+
+/**
+ * @brief Creates the sinks listed in the 'gw_sinks' config (comma-separated: mqtt, lp, file).
+ * Each sink gets its own batching limits; sinks that fail to start are skipped.
+ */
+void AkitaSmartCityServices::createGatewaySinks() {
+    for (const std::string &name : ASCSConfigList::split(m_config.getGatewaySinks())) {
+        std::unique_ptr<GatewaySink> sink;
+        uint32_t batchMax = 0;
+        uint32_t batchWindowMs = 0;
+        if (name == "mqtt") {
+            sink.reset(new ASCSMqttSink(m_config, m_api, mqttCallback));
+            batchMax = m_config.getMqttBatchMaxRecords();
+            batchWindowMs = m_config.getMqttBatchWindowMs();
+        } else if (name == "lp") {
+            sink.reset(new ASCSLineProtocolSink(m_config.getLpHost(), (uint16_t)m_config.getLpPort(),
+                                                m_config.getLpMeasurement(), m_config.getServiceId()));
+            batchMax = m_config.getLpBatchMaxRecords();
+            batchWindowMs = m_config.getLpBatchWindowMs();
+        } else if (name == "file") {
+            sink.reset(new ASCSFileSink(m_config.getFilePath(), m_config.getFileMaxBytes(),
+                                        m_config.getLpMeasurement(), m_config.getServiceId()));
+            batchMax = m_config.getFileBatchMaxRecords();
+            batchWindowMs = m_config.getFileBatchWindowMs();
+        } else {
+            Log.printf(LOG_LEVEL_WARNING, "[%s] Unknown gateway sink '%s' in gw_sinks. Ignored.\n", getName(), name.c_str());
+            continue;
+        }
+
+        sink->getBatcher().configure(batchMax, batchWindowMs);
+        if (!sink->begin()) {
+            Log.printf(LOG_LEVEL_ERROR, "[%s] Gateway sink '%s' failed to start. Disabled.\n", getName(), name.c_str());
+            continue;
+        }
+        Log.printf(LOG_LEVEL_INFO, "[%s] Gateway sink '%s' ready (batch %lu records / %lu ms).\n", getName(), name.c_str(),
+                   (unsigned long)sink->getBatcher().getMaxRecords(), (unsigned long)batchWindowMs);
+        m_sinks.push_back(std::move(sink));
     }
-    // --- End Populate Readings ---
 
+    if (m_sinks.empty()) {
+        Log.println(LOG_LEVEL_ERROR, "[%s] No gateway sinks configured! Received data will be discarded.", getName());
+    }
+}
 
-    // Serialize JSON document to string
-    std::string payload;
-    size_t json_len = serializeJson(doc, payload);
+/**
+ * @brief Offers a record to every sink.
+ * Per sink, the record is added to its open batch (or written directly without batching).
+ * If the sink is unavailable, or still replaying its spill file, the record is spilled instead
+ * so that records reach the sink in order.
+ * @param record The record (decoded SensorData with its originating node).
+ */
+void AkitaSmartCityServices::dispatchToSinks(const ASCSBatchRecord &record) {
+    unsigned long now = millis();
+    for (auto &sinkPtr : m_sinks) {
+        GatewaySink &sink = *sinkPtr;
+        ASCSPublishBatcher &batcher = sink.getBatcher();
+
+        // --- Backpressure: sink unavailable or replay pending ---
+        if (!sink.isReady() || sink.isSpilling()) {
+            spillRecord(sink, record);
+            continue;
+        }
 
-    // Check for serialization errors (e.g., buffer too small)
-    if (json_len == 0) {
-        Log.println(LOG_LEVEL_ERROR, "[%s] JSON serialization failed (payload empty)! Increase StaticJsonDocument capacity?", getName());
-        return false;
+        // --- No batching, or an alarm that must not wait for the batch window: write directly ---
+        if (!batcher.isEnabled() || record.priority >= (uint8_t)MessagePriority::CRITICAL) {
+            std::vector<ASCSBatchRecord> single(1, record);
+            if (!writeToSink(sink, single)) {
+                Log.printf(LOG_LEVEL_WARNING, "[%s] Write to sink '%s' failed! Spilling.\n", getName(), sink.getSinkName());
+                spillRecord(sink, record);
+            }
+            continue;
+        }
+
+        // --- Add to the open batch ---
+        ASCSBatchRecord copy = record;
+        if (!batcher.add(std::move(copy), now)) {
+            // Would exceed the payload limit: close the current batch and start a new one.
+            // (A rejected record is left untouched by add().)
+            flushSinkBatch(sink);
+            batcher.add(std::move(copy), now);
+        }
+        if (batcher.isFull()) {
+            flushSinkBatch(sink);
+        }
     }
-     if (doc.overflowed()) {
-         Log.println(LOG_LEVEL_WARNING, "[%s] StaticJsonDocument overflowed during serialization. Payload truncated.", getName());
-         // Publish might still succeed but with incomplete data. Consider returning false.
-     }
+}
 
+/**
+ * @brief Sends the gateway's own counters through all sinks as one record.
+ * The record uses this gateway's node ID and sensor ID ASCS_GATEWAY_METRICS_SENSOR_ID, so it
+ * arrives like any sensor reading (MQTT JSON, line protocol, file). Counters are totals since boot,
+ * so a metrics record lost while a sink is down (it may not fit a spill frame) loses no information.
+ */
+void AkitaSmartCityServices::publishGatewayMetrics() {
+    ASCSBatchRecord record;
+    record.nodeId = m_api->getMyNodeInfo()->node_num;
+    record.sensorId = ASCS_GATEWAY_METRICS_SENSOR_ID;
+    record.timestampUtc = m_api->getAdjustedTime();
+    record.sequenceNum = m_metricsSequenceNum++;
+
+    const ASCSRateLimiterStats &rl = m_rateLimiter.getStats();
+    record.readings["rl_admitted"] = rl.admitted;
+    record.readings["rl_exempt"] = rl.exempt;
+    record.readings["rl_limited"] = rl.rateLimited;
+    record.readings["rl_coalesced"] = rl.coalesced;
+    record.readings["rl_released"] = rl.released;
+    record.readings["rl_dropped"] = rl.dropped;
+    record.readings["rl_pending"] = m_rateLimiter.getPendingCount();
+
+    if (m_pollScheduler.isEnabled()) {
+        const ASCSPollStats &poll = m_pollScheduler.getStats();
+        unsigned long now = millis();
+        record.readings["poll_nodes"] = m_pollScheduler.getNodeCount();
+        record.readings["poll_covered"] = m_pollScheduler.getCoveredCount(now); // Answered within two intervals
+        record.readings["poll_requests"] = poll.requests;
+        record.readings["poll_sent"] = poll.polls;
+        record.readings["poll_replies"] = poll.replies;
+        record.readings["poll_missed"] = poll.missed;
+        record.readings["poll_deferred"] = poll.deferred;
+        record.readings["poll_wait_ms"] = poll.polls ? (float)poll.waitSumMs / poll.polls : 0.0f;
+        record.readings["poll_latency_ms"] = poll.replies ? (float)poll.latencySumMs / poll.replies : 0.0f;
+        record.readings["poll_latency_max_ms"] = poll.latencyMaxMs;
+    }
+
+    const ASCSOutboundStats &outbound = m_outbound.getStats();
+    uint32_t dropped = 0, failed = 0;
+    for (int i = 0; i < ASCS_OUTBOUND_PRIORITY_CLASSES; i++) {
+        dropped += outbound.dropped[i];
+        failed += outbound.failed[i];
+    }
+    record.readings["tx_queue"] = m_outbound.size();
+    record.readings["tx_queue_max"] = outbound.depthMax;
+    record.readings["tx_dropped"] = dropped;
+    record.readings["tx_failed"] = failed;
+    record.readings["tx_retries"] = outbound.retries;
+    record.readings["tx_deferred"] = outbound.deferred;
+    record.readings["tx_air_ms_h"] = m_outbound.getAirtimeLastHourMs(millis());
+
+    for (auto &sink : m_sinks) {
+        const GatewaySinkStats &stats = sink->getStats();
+        std::string prefix = std::string(sink->getSinkName()) + "_";
+        record.readings[prefix + "written"] = stats.recordsWritten;
+        record.readings[prefix + "failures"] = stats.writeFailures;
+        record.readings[prefix + "spilled"] = stats.recordsSpilled;
+        record.readings[prefix + "dropped"] = stats.recordsDropped;
+    }
+
+    Log.printf(LOG_LEVEL_DEBUG, "[%s] Gateway metrics: limited=%lu coalesced=%lu released=%lu pending=%d\n", getName(),
+               (unsigned long)rl.rateLimited, (unsigned long)rl.coalesced, (unsigned long)rl.released, (int)m_rateLimiter.getPendingCount());
+    dispatchToSinks(record);
+}
 
-    Log.printf(LOG_LEVEL_INFO, "[%s] Publishing to MQTT topic: %s\n", getName(), topic.c_str());
-    Log.printf(LOG_LEVEL_DEBUG, "[%s] MQTT Payload (%d bytes): %s\n", getName(), json_len, payload.c_str());
+/**
+ * @brief Writes records to a sink and updates its counters.
+ * @return True if the sink accepted all records.
+ */
+bool AkitaSmartCityServices::writeToSink(GatewaySink &sink, const std::vector<ASCSBatchRecord> &records) {
+    GatewaySinkStats &stats = sink.getStats();
+    if (sink.write(records)) {
+        stats.writes++;
+        stats.recordsWritten += records.size();
+        return true;
+    }
+    stats.writeFailures++;
+    return false;
+}
 
-    // --- Publish to MQTT ---
-    // feed_watchdog_placeholder(); // Feed before potentially blocking network operation
-    bool success = m_mqttClient->publish(topic.c_str(), payload.c_str(), false); // Retain=false for sensor data
-    // feed_watchdog_placeholder(); // Feed after potentially blocking network operation
+/**
+ * @brief Closes the sink's open batch: writes it, or spills its records if the sink
+ * is unavailable or the write fails, so nothing is lost.
+ */
+void AkitaSmartCityServices::flushSinkBatch(GatewaySink &sink) {
+    ASCSPublishBatcher &batcher = sink.getBatcher();
+    if (batcher.empty()) return;
 
-    if (!success) {
-        // Publish failed. Could be due to buffer size in PubSubClient, network issue, etc.
-        Log.println(LOG_LEVEL_ERROR, "[%s] MQTT publish failed! Check PubSubClient buffer size and connection state.", getName());
+    if (sink.isReady() && !sink.isSpilling() && writeToSink(sink, batcher.records())) {
+        batcher.clear();
+        return;
+    }
+
+    Log.printf(LOG_LEVEL_WARNING, "[%s] Could not write batch to sink '%s', spilling %d records.\n",
+               getName(), sink.getSinkName(), (int)batcher.size());
+    for (const ASCSBatchRecord &record : batcher.records()) {
+        spillRecord(sink, record);
+    }
+    batcher.clear();
+}
+
+/**
+ * @brief Re-encodes a record as a SensorData packet and appends it to the sink's spill file.
+ * Records for sinks without a spill file are dropped and counted.
+ * @param sink The sink that could not take the record.
+ * @param record The record to spill.
+ */
+void AkitaSmartCityServices::spillRecord(GatewaySink &sink, const ASCSBatchRecord &record) {
+    const char *filename = sink.getSpillFilename();
+    if (!filename) {
+        sink.getStats().recordsDropped++;
+        Log.printf(LOG_LEVEL_DEBUG, "[%s] Sink '%s' unavailable, record dropped.\n", getName(), sink.getSinkName());
+        return;
+    }
+
+    SmartCityPacket packet = SmartCityPacket_init_zero;
+    packet.which_payload = SmartCityPacket_sensor_data_tag;
+    record.toSensorData(packet.payload.sensor_data);
+
+    // The encode callbacks need mutable maps; this path only runs when the sink is unavailable.
+    std::map<std::string, float> readings = record.readings;
+    ReadingTypes types = record.types;
+    MapCallbackContext encode_context;
+    encode_context.map_ptr = &readings;
+    encode_context.types_ptr = &types;
+    setReadingsEncoder(packet.payload.sensor_data, encode_context);
+
+    if (bufferPacket(packet, record.nodeId, filename)) {
+        sink.getStats().recordsSpilled++;
+        if (!sink.isSpilling()) {
+            Log.printf(LOG_LEVEL_INFO, "[%s] Sink '%s' unavailable, spilling to %s.\n", getName(), sink.getSinkName(), filename);
+            sink.setSpilling(true); // Keep order: later records go to the spill file until it is replayed
+        }
+    } else {
+        sink.getStats().recordsDropped++;
     }
-    return success;
 }
 
 
 /**
- * @brief Appends an encoded SmartCityPacket to the buffer file on the filesystem.
- * Uses simple framing: [uint16_t length][packet_bytes].
+ * @brief Appends an encoded SmartCityPacket to a spill file on the filesystem.
+ * Uses simple framing: [uint32_t fromNode][uint16_t length][packet_bytes].
  * @param packet The SmartCityPacket to buffer (assumes map callbacks are set if needed).
+ * @param fromNode The originating Node ID, kept so replayed packets are attributed correctly.
+ * @param filename The spill file to append to.
+ * @return True if the packet was written.
  */
-void AkitaSmartCityServices::bufferPacket(const SmartCityPacket &packet) {
-    Log.println(LOG_LEVEL_INFO, "[%s] Buffering packet...", getName());
+bool AkitaSmartCityServices::bufferPacket(const SmartCityPacket &packet, uint32_t fromNode, const char *filename) {
+    Log.printf(LOG_LEVEL_DEBUG, "[%s] Buffering packet to %s...\n", getName(), filename);
 
     // Encode the packet into a temporary buffer
     uint8_t buffer[ASCS_GATEWAY_MAX_PACKET_SIZE];
     pb_ostream_t stream = pb_ostream_from_buffer(buffer, sizeof(buffer));
 
     // --- Encoding preparation for map (if sensor data) ---
-    // This part is tricky when buffering. We need the original map data to re-encode.
-    // If the packet originated from the mesh, its map field callbacks might be set,
-    // but the associated 'arg' (pointing to the original map) might be invalid now.
-    // Safest Approach: The caller (publishMqttOrBuffer) should ideally pass the
-    // original std::map along if buffering might occur.
-    // Current Simplification: Assume the packet passed in might have valid callbacks/arg
-    // if it came directly from runSensorLogic (unlikely for gateway buffer).
-    // If it came from the mesh, the map data will likely NOT be encoded correctly here.
-    // --> This needs refinement based on how map data is managed through the call stack. <--
+    // handleSensorData re-arms the readings field with encode callbacks pointing at the
+    // decoded map, so the readings are re-encoded along with the rest of the packet.
 
     if (!pb_encode(&stream, SmartCityPacket_fields, &packet)) {
         Log.printf(LOG_LEVEL_ERROR, "[%s] Failed to encode packet for buffering: %s\n", getName(), PB_GET_ERROR(&stream));
-        return; // Cannot buffer if encoding fails
+        return false; // Cannot buffer if encoding fails
     }
 
     size_t len = stream.bytes_written;
     // Validate encoded length
     if (len == 0 || len > ASCS_GATEWAY_MAX_PACKET_SIZE) {
         Log.printf(LOG_LEVEL_ERROR, "[%s] Invalid encoded packet size (%d) for buffering.\n", getName(), len);
-        return;
+        return false;
     }
+    return appendFrame(filename, fromNode, buffer, len);
+}
 
+/**
+ * @brief Appends one frame ([uint32_t fromNode][uint16_t length][packet_bytes]) to a spill file.
+ * @param filename The spill file to append to.
+ * @param fromNode The originating Node ID of the packet.
+ * @param buffer The encoded SmartCityPacket.
+ * @param len Length of the encoded packet (1 to ASCS_GATEWAY_MAX_PACKET_SIZE).
+ * @return True if the whole frame was written.
+ */
+bool AkitaSmartCityServices::appendFrame(const char *filename, uint32_t fromNode, const uint8_t *buffer, size_t len) {
     // Open buffer file in append mode
-    File file = FileSystem.open(ASCS_GATEWAY_BUFFER_FILENAME, FILE_APPEND);
+    File file = FileSystem.open(filename, FILE_APPEND);
     if (!file) {
         Log.println(LOG_LEVEL_ERROR, "[%s] Failed to open buffer file for append!", getName());
-        return; // Cannot buffer if file cannot be opened
+        return false; // Cannot buffer if file cannot be opened
     }
 
     // Check if adding this packet exceeds the max buffer size
     // Add size of length prefix + packet length
-    if (file.size() + sizeof(uint16_t) + len > ASCS_GATEWAY_BUFFER_MAX_SIZE) {
+    if (file.size() + ASCS_GATEWAY_BUFFER_FRAME_HEADER + len > ASCS_GATEWAY_BUFFER_MAX_SIZE) {
         Log.println(LOG_LEVEL_WARNING, "[%s] Buffer file full (or would exceed limit). Packet dropped.", getName());
         // --- TODO: Implement Buffer Management ---
         // Options:
@@ -1157,16 +2262,19 @@ void AkitaSmartCityServices::bufferPacket(const SmartCityPacket &packet) {
         // 2. Drop Current: Simply don't write the new packet (as done here).
         // 3. Circular Buffer File: More complex but efficient.
         file.close();
-        return;
+        return false;
     }
 
-    // Write length prefix (uint16_t)
+    // Write frame header: originating node (uint32_t) and length prefix (uint16_t)
+    uint8_t header[ASCS_GATEWAY_BUFFER_FRAME_HEADER];
     uint16_t msg_len = (uint16_t)len;
-    size_t written = file.write((uint8_t*)&msg_len, sizeof(uint16_t));
-    if (written != sizeof(uint16_t)) {
-         Log.println(LOG_LEVEL_ERROR, "[%s] Failed to write length prefix to buffer file!", getName());
+    memcpy(header, &fromNode, sizeof(uint32_t));
+    memcpy(header + sizeof(uint32_t), &msg_len, sizeof(uint16_t));
+    size_t written = file.write(header, sizeof(header));
+    if (written != sizeof(header)) {
+         Log.println(LOG_LEVEL_ERROR, "[%s] Failed to write frame header to buffer file!", getName());
          file.close();
-         return;
+         return false;
     }
 
     // Write actual packet data
@@ -1174,33 +2282,88 @@ void AkitaSmartCityServices::bufferPacket(const SmartCityPacket &packet) {
     file.close(); // Close file immediately after writing
 
     if (written == len) {
-        Log.printf(LOG_LEVEL_INFO, "[%s] Packet buffered (%d bytes).\n", getName(), len);
+        Log.printf(LOG_LEVEL_DEBUG, "[%s] Packet buffered (%d bytes).\n", getName(), len);
+        return true;
     } else {
         // This indicates a potentially serious filesystem issue
         Log.printf(LOG_LEVEL_ERROR, "[%s] Failed to write full packet data to buffer file! Wrote %d/%d bytes.\n", getName(), written, len);
         // Consider attempting to truncate the file to remove partial write?
+        return false;
+    }
+}
+
+/**
+ * @brief Moves the records of the buffer file of older firmware into the spill files of the sinks.
+ * That file was framed as [uint16_t length][packet_bytes] without the originating node, so its
+ * records are replayed with node ID 0 (as the old firmware did). Each record is appended to the
+ * spill file of every sink that has one, and those sinks start replaying before live records.
+ * The old file is removed afterwards; records that do not fit a spill file are dropped and logged.
+ */
+void AkitaSmartCityServices::migrateLegacyBuffer() {
+    if (!FileSystem.exists(ASCS_GATEWAY_LEGACY_BUFFER_FILENAME)) return;
+
+    File file = FileSystem.open(ASCS_GATEWAY_LEGACY_BUFFER_FILENAME, FILE_READ);
+    if (!file) {
+        Log.printf(LOG_LEVEL_ERROR, "[%s] Failed to open buffer file in old format (%s).\n", getName(), ASCS_GATEWAY_LEGACY_BUFFER_FILENAME);
+        return;
     }
+    Log.printf(LOG_LEVEL_INFO, "[%s] Migrating buffer file in old format (%s) to the sink spill files...\n", getName(), ASCS_GATEWAY_LEGACY_BUFFER_FILENAME);
+
+    uint8_t buffer[ASCS_GATEWAY_MAX_PACKET_SIZE];
+    int migrated = 0;
+    int dropped = 0;
+    while (file.available() >= (int)sizeof(uint16_t)) {
+        uint16_t msg_len;
+        if (file.read((uint8_t*)&msg_len, sizeof(uint16_t)) != sizeof(uint16_t)) break;
+        if (msg_len == 0 || msg_len > ASCS_GATEWAY_MAX_PACKET_SIZE || file.available() < msg_len ||
+            file.read(buffer, msg_len) != msg_len) {
+            Log.printf(LOG_LEVEL_ERROR, "[%s] Buffer file in old format is corrupted after %d record(s). Rest discarded.\n", getName(), migrated);
+            break;
+        }
+
+        bool written = false;
+        for (auto &sink : m_sinks) {
+            const char *filename = sink->getSpillFilename();
+            if (!filename) continue;
+            if (appendFrame(filename, 0, buffer, msg_len)) {
+                sink->getStats().recordsSpilled++;
+                sink->setSpilling(true); // Replay the old records before any live ones
+                written = true;
+            } else {
+                sink->getStats().recordsDropped++;
+            }
+        }
+        if (written) migrated++; else dropped++;
+    }
+    file.close();
+
+    FileSystem.remove(ASCS_GATEWAY_LEGACY_BUFFER_FILENAME);
+    Log.printf(LOG_LEVEL_INFO, "[%s] Migrated %d buffered record(s) (node 0), %d dropped.\n", getName(), migrated, dropped);
 }
 
 /**
- * @brief Reads the next length-prefixed packet from the beginning of the buffer file.
+ * @brief Reads the next framed packet from the current position of the buffer file.
  * @param file An open File handle for the buffer file (read mode).
  * @param buffer Buffer to store the packet data.
  * @param len Output parameter: Stores the length of the packet read.
+ * @param fromNode Output parameter: Stores the originating Node ID of the packet.
  * @return True if a packet was successfully read, false otherwise (EOF, error, corruption).
  */
-bool AkitaSmartCityServices::readPacketFromBuffer(File &file, uint8_t* buffer, size_t &len) {
-    // Ensure file is valid and has enough data for at least the length prefix
-    if (!file || file.available() < sizeof(uint16_t)) {
+bool AkitaSmartCityServices::readPacketFromBuffer(File &file, uint8_t* buffer, size_t &len, uint32_t &fromNode) {
+    // Ensure file is valid and has enough data for at least the frame header
+    if (!file || file.available() < (int)ASCS_GATEWAY_BUFFER_FRAME_HEADER) {
         return false;
     }
 
-    // Read the 16-bit length prefix
-    uint16_t msg_len;
-    if (file.read((uint8_t*)&msg_len, sizeof(uint16_t)) != sizeof(uint16_t)) {
-        Log.println(LOG_LEVEL_ERROR, "[%s] Failed to read length prefix from buffer.", getName());
+    // Read the frame header: originating node and 16-bit length prefix
+    uint8_t header[ASCS_GATEWAY_BUFFER_FRAME_HEADER];
+    if (file.read(header, sizeof(header)) != sizeof(header)) {
+        Log.println(LOG_LEVEL_ERROR, "[%s] Failed to read frame header from buffer.", getName());
         return false; // Read error
     }
+    uint16_t msg_len;
+    memcpy(&fromNode, header, sizeof(uint32_t));
+    memcpy(&msg_len, header + sizeof(uint32_t), sizeof(uint16_t));
 
     // Validate the read length
     if (msg_len == 0 || msg_len > ASCS_GATEWAY_MAX_PACKET_SIZE) {
@@ -1227,53 +2390,31 @@ bool AkitaSmartCityServices::readPacketFromBuffer(File &file, uint8_t* buffer, s
 }
 
 /**
- * @brief Removes the first packet from the buffer file.
+ * @brief Removes the first 'bytes' bytes (one or more whole frames) from a spill file.
  * This is a basic implementation that copies the remaining data to a temporary file
- * and then replaces the original file. This can be slow for large buffers.
+ * and then replaces the original file. Removing a whole batch of frames at once
+ * keeps this to one copy per replayed batch.
+ * @param filename The spill file.
+ * @param bytes Number of bytes to remove from the front of the file.
  */
-void AkitaSmartCityServices::removePacketFromBuffer() {
-    Log.println(LOG_LEVEL_DEBUG, "[%s] Removing processed packet from buffer file...", getName());
+void AkitaSmartCityServices::removeFromBufferFront(const char *filename, size_t bytes) {
+    Log.printf(LOG_LEVEL_DEBUG, "[%s] Removing %d processed bytes from buffer file...\n", getName(), (int)bytes);
     // feed_watchdog_placeholder(); // Feed watchdog before potentially long file I/O
 
     // Open the buffer file for reading
-    File readFile = FileSystem.open(ASCS_GATEWAY_BUFFER_FILENAME, FILE_READ);
+    File readFile = FileSystem.open(filename, FILE_READ);
     if (!readFile) {
-        Log.println(LOG_LEVEL_ERROR, "[%s] Failed to open buffer for reading (removePacket).", getName());
+        Log.println(LOG_LEVEL_ERROR, "[%s] Failed to open buffer for reading (removeFromBufferFront).", getName());
         return; // Cannot proceed
     }
 
-    // Read the length of the first packet to know how much to skip
-    uint16_t msg_len;
-    if (readFile.read((uint8_t*)&msg_len, sizeof(uint16_t)) != sizeof(uint16_t)) {
-        Log.println(LOG_LEVEL_ERROR, "[%s] Failed to read length prefix for removal. Buffer might be empty or corrupted.", getName());
-        readFile.close();
-        // If buffer was likely just empty, maybe try deleting it?
-        if (readFile.size() < sizeof(uint16_t)) {
-             FileSystem.remove(ASCS_GATEWAY_BUFFER_FILENAME);
-        }
-        return;
-    }
-
-    // Validate length again
-     if (msg_len == 0 || msg_len > ASCS_GATEWAY_MAX_PACKET_SIZE) {
-          Log.printf(LOG_LEVEL_ERROR, "[%s] Invalid packet length (%d) found during removal. Aborting removal.\n", getName(), msg_len);
-          readFile.close();
-          // Consider clearing the buffer file if corruption is suspected.
-          // FileSystem.remove(ASCS_GATEWAY_BUFFER_FILENAME);
-          return;
-     }
-
-
-    // Calculate the starting position of the *next* packet
-    size_t nextPacketPos = sizeof(uint16_t) + msg_len;
     size_t totalSize = readFile.size();
 
-    // If the position of the next packet is at or beyond the file size,
-    // it means we just removed the last (or only) packet.
-    if (nextPacketPos >= totalSize) {
+    // If the removed range covers the whole file, the buffer is now empty.
+    if (bytes >= totalSize) {
         readFile.close(); // Close the read handle
         // Delete the buffer file as it's now empty
-        if (!FileSystem.remove(ASCS_GATEWAY_BUFFER_FILENAME)) {
+        if (!FileSystem.remove(filename)) {
             Log.println(LOG_LEVEL_ERROR, "[%s] Failed to remove empty buffer file.", getName());
         } else {
             Log.println(LOG_LEVEL_DEBUG, "[%s] Buffer file empty after removal, deleted.", getName());
@@ -1282,7 +2423,8 @@ void AkitaSmartCityServices::removePacketFromBuffer() {
     }
 
     // --- Copy remaining data to a temporary file ---
-    const char* tempFilename = "/ascs_buffer.tmp";
+    std::string tempPath = std::string(filename) + ".tmp";
+    const char* tempFilename = tempPath.c_str();
     File writeFile = FileSystem.open(tempFilename, FILE_WRITE); // Open temp file for writing
     if (!writeFile) {
         Log.println(LOG_LEVEL_ERROR, "[%s] Failed to open temp buffer file for writing!", getName());
@@ -1290,8 +2432,8 @@ void AkitaSmartCityServices::removePacketFromBuffer() {
         return; // Cannot proceed
     }
 
-    // Seek the read file handle past the packet we are removing
-    readFile.seek(nextPacketPos, SeekSet);
+    // Seek the read file handle past the frames we are removing
+    readFile.seek(bytes, SeekSet);
 
     // Buffer for copying data
     uint8_t copyBuf[128];
@@ -1323,17 +2465,17 @@ void AkitaSmartCityServices::removePacketFromBuffer() {
     Log.printf(LOG_LEVEL_DEBUG, "[%s] Copied %d bytes to temporary buffer file.\n", getName(), bytesCopied);
 
     // --- Replace original buffer file with the temporary file ---
-    if (!FileSystem.remove(ASCS_GATEWAY_BUFFER_FILENAME)) {
+    if (!FileSystem.remove(filename)) {
         Log.println(LOG_LEVEL_ERROR, "[%s] Failed to remove original buffer file during replace.", getName());
         // Attempt to remove the temp file as well to avoid leaving it orphaned
         FileSystem.remove(tempFilename);
     } else {
         // Original removed, now rename temp file to the original name
-        if (!FileSystem.rename(tempFilename, ASCS_GATEWAY_BUFFER_FILENAME)) {
+        if (!FileSystem.rename(tempFilename, filename)) {
             Log.println(LOG_LEVEL_ERROR, "[%s] Failed to rename temp buffer file to original name!", getName());
             // This is problematic - buffer might be lost or corrupted
         } else {
-            Log.println(LOG_LEVEL_DEBUG, "[%s] Buffer file updated successfully after packet removal.", getName());
+            Log.println(LOG_LEVEL_DEBUG, "[%s] Buffer file updated successfully after removal.", getName());
         }
     }
      // feed_watchdog_placeholder(); // Feed watchdog after potentially long file I/O
@@ -1341,126 +2483,144 @@ void AkitaSmartCityServices::removePacketFromBuffer() {
 
 
 /**
- * @brief Attempts to read, decode, publish, and remove one packet from the buffer file.
- * Called periodically when MQTT is connected.
+ * @brief Attempts to read, decode, write, and remove records from a sink's spill file.
+ * Without batching one record is replayed per call. With batching, up to one full batch
+ * of records is read and written with a single sink write.
+ * Called periodically while the sink is ready.
+ * @param sink The sink whose spill file is replayed.
+ * @return True if records remain in the spill file (caller should check again soon).
  */
-void AkitaSmartCityServices::processBufferedPackets() {
-    // Only process if MQTT is connected and client is initialized
-    if (!m_mqttClient || !m_mqttClient->connected()) {
-        return;
+bool AkitaSmartCityServices::processBufferedPackets(GatewaySink &sink) {
+    const char *filename = sink.getSpillFilename();
+    // Only process if the sink has a spill file and can accept writes
+    if (!filename || !sink.isReady()) {
+        return false;
     }
 
-    // Open buffer file for reading
-    File file = FileSystem.open(ASCS_GATEWAY_BUFFER_FILENAME, FILE_READ);
+    // Open spill file for reading
+    File file = FileSystem.open(filename, FILE_READ);
     // Check if file exists and is not empty
     if (!file || file.size() == 0) {
         if (file) file.close(); // Close if opened but empty
-        // Buffer is empty, ensure buffering flag is off
-        if (m_gatewayBufferActive) {
-             Log.println(LOG_LEVEL_INFO, "[%s] Buffer is empty, stopping buffer processing.", getName());
-             m_gatewayBufferActive = false;
+        // Spill file is empty, new records can go to the sink directly again
+        if (sink.isSpilling()) {
+             Log.printf(LOG_LEVEL_INFO, "[%s] Spill file of sink '%s' is empty, resuming direct writes.\n", getName(), sink.getSinkName());
+             sink.setSpilling(false);
         }
-        return; // Nothing to process
+        return false; // Nothing to process
     }
 
-    // Log only once when starting to process a non-empty buffer
-    if (!m_gatewayBufferActive) {
-        Log.println(LOG_LEVEL_INFO, "[%s] Processing buffered packets...", getName());
-        m_gatewayBufferActive = true; // Set flag to indicate buffer processing is active
+    // Log only once when starting to process a non-empty spill file
+    if (!sink.isSpilling()) {
+        Log.printf(LOG_LEVEL_INFO, "[%s] Replaying spilled records to sink '%s'...\n", getName(), sink.getSinkName());
+        sink.setSpilling(true); // Keep live records behind the spilled ones
     }
 
-    // Buffer for reading packet data
+    // --- Read up to one batch of packets from the front of the file ---
+    // A separate batcher with the same limits, so replay never mixes with the open live batch.
+    const ASCSPublishBatcher &liveBatch = sink.getBatcher();
+    ASCSPublishBatcher replayBatch;
+    replayBatch.configure(liveBatch.isEnabled() ? liveBatch.getMaxRecords() : 1, 0);
+    size_t consumedBytes = 0;   // Bytes of whole frames read (written or discarded)
+    bool readFailed = false;
+    unsigned long now = millis();
+
     uint8_t buffer[ASCS_GATEWAY_MAX_PACKET_SIZE];
     size_t len;
+    uint32_t fromNode;
 
-    // --- Read the first packet from the file ---
-    if (readPacketFromBuffer(file, buffer, len)) {
-        file.close(); // Close the read handle BEFORE attempting to publish/remove
+    while (!replayBatch.isFull()) {
+        if (!readPacketFromBuffer(file, buffer, len, fromNode)) {
+            readFailed = (file.available() > 0); // Leftover bytes that are not a valid frame
+            break;
+        }
 
         // --- Decode the packet ---
         SmartCityPacket scp = SmartCityPacket_init_zero;
         pb_istream_t stream = pb_istream_from_buffer(buffer, len);
 
         // Prepare context for decoding map fields
+        ASCSBatchRecord record;
         MapCallbackContext decode_context;
-        std::map<std::string, float> decoded_readings; // Temporary map for decoded readings
-        decode_context.map_ptr = &decoded_readings;
-        scp.payload.sensor_data.readings.funcs.decode = decode_map_callback;
-        scp.payload.sensor_data.readings.arg = &decode_context;
-
-        if (pb_decode(&stream, SmartCityPacket_fields, &scp)) {
-            // --- Packet Decoded Successfully ---
-            if (scp.which_payload == SmartCityPacket_sensor_data_tag) {
-                // --- TODO: Retrieve original 'fromNode' ---
-                // The current buffer format ONLY stores the packet bytes.
-                // The originating node ID is lost.
-                // Required Changes:
-                // 1. bufferPacket: Write `uint32_t fromNode` *before* the length/packet.
-                // 2. readPacketFromBuffer: Read `fromNode` *before* reading length/packet.
-                // 3. removePacketFromBuffer: Account for the extra 4 bytes of `fromNode` when calculating offsets/copying.
-
-                // Placeholder: Use 0 as fromNode until buffer format is fixed
-                uint32_t fromNode = 0; // <--- FIX REQUIRED
-                Log.println(LOG_LEVEL_WARNING, "[%s] Cannot determine originating node for buffered packet! Using 0.", getName());
-
-                // --- Attempt to publish the decoded packet ---
-                // Pass the decoded SensorData struct. Map data access still needs refactoring in publishMqtt.
-                if (publishMqtt(scp.payload.sensor_data, fromNode)) {
-                    // --- Publish Successful: Remove from buffer ---
-                    Log.println(LOG_LEVEL_DEBUG, "[%s] Successfully published buffered packet.", getName());
-                    removePacketFromBuffer();
-                    // Immediately try to process the next packet in the buffer if MQTT is still connected
-                    // Reschedule the buffer check very soon by adjusting the timer.
-                    m_lastBufferProcessTime = millis() - m_config.getMqttReconnectIntervalMs(); // Check again quickly
-                } else {
-                    // Publish failed even though MQTT *was* connected.
-                    // Could be temporary issue, MQTT buffer size, etc.
-                    Log.println(LOG_LEVEL_WARNING, "[%s] Failed to publish buffered packet. MQTT issue? Stopping buffer processing for now.", getName());
-                    // Stop processing buffer for this cycle to avoid hammering a potentially failing connection.
-                    // The packet remains at the front of the buffer. Will retry on next check interval.
-                    m_gatewayBufferActive = false; // Allow direct publish attempts again if connection recovers
-                }
-            } else {
-                // Packet in buffer is not SensorData (shouldn't normally happen)
-                Log.println(LOG_LEVEL_WARNING, "[%s] Buffered packet is not SensorData. Discarding.", getName());
-                removePacketFromBuffer(); // Remove unexpected packet type
-            }
-        } else {
+        decode_context.map_ptr = &record.readings;
+        decode_context.types_ptr = &record.types;
+        setReadingsDecoder(scp.payload.sensor_data, decode_context);
+
+        if (!pb_decode(&stream, SmartCityPacket_fields, &scp)) {
             // --- Decoding Failed ---
             Log.printf(LOG_LEVEL_ERROR, "[%s] Failed to decode buffered packet: %s. Discarding corrupted data.\n", getName(), PB_GET_ERROR(&stream));
-            removePacketFromBuffer(); // Remove the corrupted packet
+            consumedBytes += ASCS_GATEWAY_BUFFER_FRAME_HEADER + len; // Remove the corrupted packet
+            continue;
         }
-    } else {
-        // --- Reading Failed ---
-        file.close(); // Close the file handle
-        Log.println(LOG_LEVEL_ERROR, "[%s] Failed to read packet from buffer file. File might be corrupted or empty.", getName());
-        // Consider clearing the buffer file if reading consistently fails?
-        // FileSystem.remove(ASCS_GATEWAY_BUFFER_FILENAME);
-        m_gatewayBufferActive = false; // Stop trying if read fails
-    }
-
-    // Final check: If buffer processing was active but file is now empty, clear the flag
-    if (m_gatewayBufferActive) {
-        file = FileSystem.open(ASCS_GATEWAY_BUFFER_FILENAME, FILE_READ);
-        if (!file || file.size() == 0) {
-            if (file) file.close();
-             Log.println(LOG_LEVEL_INFO, "[%s] Buffer processing complete (buffer empty).", getName());
-             m_gatewayBufferActive = false;
-        } else {
-            if (file) file.close();
-            // Buffer still has data, flag remains true, will process next time
+        if (scp.which_payload != SmartCityPacket_sensor_data_tag) {
+            // Packet in buffer is not SensorData (shouldn't normally happen)
+            Log.println(LOG_LEVEL_WARNING, "[%s] Buffered packet is not SensorData. Discarding.", getName());
+            consumedBytes += ASCS_GATEWAY_BUFFER_FRAME_HEADER + len; // Remove unexpected packet type
+            continue;
+        }
+
+        record.nodeId = fromNode;
+        record.sensorId = scp.payload.sensor_data.sensor_id;
+        record.timestampUtc = scp.payload.sensor_data.timestamp_utc;
+        record.sequenceNum = scp.payload.sensor_data.sequence_num;
+        record.priority = (uint8_t)(scp.payload.sensor_data.priority > 255 ? 255 : scp.payload.sensor_data.priority);
+        record.intervalMs = scp.payload.sensor_data.interval_ms;
+
+        // Leave the frame in the file if it would push the batch over the payload limit
+        if (!replayBatch.add(std::move(record), now)) {
+            break;
         }
+        consumedBytes += ASCS_GATEWAY_BUFFER_FRAME_HEADER + len;
+    }
+    file.close(); // Close the read handle BEFORE attempting to write/remove
+
+    const std::vector<ASCSBatchRecord> &records = replayBatch.records();
+    if (records.empty()) {
+        if (consumedBytes > 0) {
+            removeFromBufferFront(filename, consumedBytes); // Only discarded packets were read
+        } else if (readFailed) {
+            // --- Reading Failed ---
+            Log.printf(LOG_LEVEL_ERROR, "[%s] Failed to read packet from %s. File might be corrupted.\n", getName(), filename);
+            // Consider clearing the spill file if reading consistently fails?
+            // FileSystem.remove(filename);
+            return false; // Stop trying this cycle
+        }
+    } else if (writeToSink(sink, records)) {
+        // --- Write Successful: Remove from spill file ---
+        Log.printf(LOG_LEVEL_DEBUG, "[%s] Replayed %d spilled record(s) to sink '%s'.\n", getName(), (int)records.size(), sink.getSinkName());
+        removeFromBufferFront(filename, consumedBytes);
+    } else {
+        // Write failed even though the sink reported ready.
+        // The records remain at the front of the spill file. Will retry on next check interval.
+        Log.printf(LOG_LEVEL_WARNING, "[%s] Failed to replay spilled records to sink '%s'. Retrying later.\n", getName(), sink.getSinkName());
+        return false;
+    }
+
+    // Check whether more frames remain
+    file = FileSystem.open(filename, FILE_READ);
+    bool morePending = file && file.size() > 0;
+    if (file) file.close();
+    if (!morePending) {
+        Log.printf(LOG_LEVEL_INFO, "[%s] Spill file of sink '%s' replayed completely.\n", getName(), sink.getSinkName());
+        sink.setSpilling(false);
     }
+    return morePending;
 }
 
 #else
-// Provide empty stubs for Gateway buffering functions if support is not compiled in.
-void AkitaSmartCityServices::publishMqttOrBuffer(const SmartCityPacket &, uint32_t) {}
-bool AkitaSmartCityServices::publishMqtt(const SensorData &, uint32_t) { return false; }
-void AkitaSmartCityServices::bufferPacket(const SmartCityPacket &) {}
-void AkitaSmartCityServices::processBufferedPackets() {}
-bool AkitaSmartCityServices::readPacketFromBuffer(File &, uint8_t*, size_t &) { return false; }
-void AkitaSmartCityServices::removePacketFromBuffer() {}
+// Provide empty stubs for Gateway output functions if support is not compiled in.
+void AkitaSmartCityServices::createGatewaySinks() {}
+void AkitaSmartCityServices::dispatchToSinks(const ASCSBatchRecord &) {}
+void AkitaSmartCityServices::publishGatewayMetrics() {}
+bool AkitaSmartCityServices::writeToSink(GatewaySink &, const std::vector<ASCSBatchRecord> &) { return false; }
+void AkitaSmartCityServices::flushSinkBatch(GatewaySink &) {}
+void AkitaSmartCityServices::spillRecord(GatewaySink &, const ASCSBatchRecord &) {}
+bool AkitaSmartCityServices::bufferPacket(const SmartCityPacket &, uint32_t, const char *) { return false; }
+bool AkitaSmartCityServices::appendFrame(const char *, uint32_t, const uint8_t *, size_t) { return false; }
+void AkitaSmartCityServices::migrateLegacyBuffer() {}
+bool AkitaSmartCityServices::processBufferedPackets(GatewaySink &) { return false; }
+bool AkitaSmartCityServices::readPacketFromBuffer(File &, uint8_t*, size_t &, uint32_t &) { return false; }
+void AkitaSmartCityServices::removeFromBufferFront(const char *, size_t) {}
 #endif // ASCS_ROLE_GATEWAY
 
 
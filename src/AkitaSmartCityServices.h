@@ -8,16 +8,32 @@
 #include "generated_proto/SmartCity.pb.h" // Generated header from SmartCity.proto
 #include "interfaces/SensorInterface.h" // Abstract sensor interface
 #include "ASCSConfig.h"      // Include the new config manager header
+#include "interfaces/GatewaySink.h" // Gateway outputs (MQTT, line protocol, local file)
+#include "ASCSRateLimiter.h" // Per-origin-node rate limiting (Gateway)
+#include "ASCSServiceTable.h" // Fixed-capacity table of discovered nodes
+#include "ASCSTrickleTimer.h" // Adaptive discovery announcement timing
+#include "ASCSDiscoveryReplies.h" // Replies to discovery queries
+#include "ASCSServiceSnapshot.h" // Service table persisted across restarts
+#include "ASCSTxSlot.h"        // Sensor transmit slots and the gateway's loss monitor
+#include "ASCSPollScheduler.h" // Gateway polls of sensors in poll mode
+#include "ASCSSensorRegistry.h" // Several sensors per node, each on its own schedule
+#include "ASCSSyncSensorAdapter.h" // Synchronous sensors read through the asynchronous interface
+#include "ASCSDeadband.h"  // Suppression of unchanged readings
+#include "ASCSAdaptiveInterval.h" // Read interval following the readings and battery
+#include "ASCSEventDebouncer.h" // State changes posted by sensors, sent at once
+#include "ASCSTypedReadings.h" // Booleans as bits, whole numbers as varints
+#include "ASCSPriorityRules.h" // Priority classes from reading keys
+#include "ASCSOutboundQueue.h" // Priority-ordered queue in front of the radio
+#include "ASCSStoreForward.h" // Packets held while no gateway is reachable
 
 // Standard C++/System Libraries
 #include <vector>
 #include <map>
 #include <string>
 #include <memory> // For std::unique_ptr
+#include <algorithm> // For std::stable_sort
 
 // Forward declarations for libraries used only in .cpp
-class PubSubClient;
-class WiFiClient;
 class File; // For SPIFFS/LittleFS
 
 // --- Constants ---
@@ -29,9 +45,18 @@ class File; // For SPIFFS/LittleFS
 // Default broadcast address for Meshtastic
 #define ASCS_BROADCAST_ADDR BROADCAST_ADDR // Use Meshtastic's definition
 
+// Aggregator Routing Config
+#define ASCS_AGGREGATOR_MAX_RELAY_HOPS 32 // Aggregator-to-aggregator forwards before a packet is dropped (breaks routing loops)
+#define ASCS_AGGREGATOR_ROUTE_CHANGE 0.25f // Relative route cost change that counts as a topology change
+
 // Gateway Buffering Config
-#define ASCS_GATEWAY_BUFFER_FILENAME "/ascs_buffer.dat" // Filename on the filesystem
-#define ASCS_GATEWAY_BUFFER_MAX_SIZE (10 * 1024) // Max buffer file size (e.g., 10KB) - adjust as needed!
+// Each sink with a spill file (see GatewaySink::getSpillFilename) buffers records there while it is unavailable.
+// Frame format: [uint32_t fromNode][uint16_t length][packet_bytes]
+#define ASCS_GATEWAY_LEGACY_BUFFER_FILENAME "/ascs_buffer.dat" // Old format without fromNode, moved to the spill files at startup
+#define ASCS_GATEWAY_BUFFER_FRAME_HEADER (sizeof(uint32_t) + sizeof(uint16_t)) // Bytes before each packet
+#define ASCS_GATEWAY_BUFFER_MAX_SIZE (10 * 1024) // Max size of each spill file (e.g., 10KB) - adjust as needed!
+#define ASCS_GATEWAY_BUFFER_CHECK_MS 5000 // Interval between spill file replay attempts while nothing is pending
+#define ASCS_GATEWAY_METRICS_SENSOR_ID "ascs_gateway" // Sensor ID of the gateway's own metrics records
 #define ASCS_GATEWAY_MAX_PACKET_SIZE 256 // Max size of a single encoded packet to buffer (should match SmartCityPacket_size or be slightly larger)
 
 // --- Nanopb Map Callback Struct ---
@@ -44,6 +69,8 @@ struct MapCallbackContext {
     std::map<std::string, float>::iterator map_iterator;
     // Flag to track success during encoding iteration (helps stop early on error)
     bool encode_successful = true;
+    // Readings sent as BOOL/INT (the 'bools' and 'ints' fields); null or missing keys are FLOAT
+    ReadingTypes* types_ptr = nullptr;
 };
 
 
@@ -88,13 +115,68 @@ public:
     // --- Public Configuration Methods ---
 
     /**
-     * @brief Sets the sensor implementation to be used by this node if configured as a Sensor.
+     * @brief Sets the sensor implementation to be used by this node if configured as a Sensor,
+     * read every `read_int`. Replaces any sensors added before.
      * Should be called *before* Meshtastic::begin() which calls plugin::init().
      * Takes ownership of the sensor object via std::unique_ptr.
      * @param sensor A unique_ptr to a SensorInterface implementation.
      */
     void setSensor(std::unique_ptr<SensorInterface> sensor);
 
+    /**
+     * @brief Adds a sensor implementation, read on its own schedule (Sensor role).
+     * Sensors due within `merge_win` of each other are read together and sent in one packet.
+     * Should be called *before* Meshtastic::begin(). Takes ownership of the sensor object.
+     * @param sensor A unique_ptr to a SensorInterface implementation.
+     * @param intervalMs Read interval (0 = `read_int`).
+     * @param phaseMs Delay of the first reading after the node's first transmit slot.
+     * @param windowMs Summary window: readings taken every 'intervalMs' are summarized and sent once per
+     *                 window as derived keys (`stat_out`, e.g. "noise_db_mean", "noise_db_max"); 0 = send every reading.
+     * @return False if the sensor is null or ASCS_SENSOR_MAX_SENSORS are already added.
+     */
+    bool addSensor(std::unique_ptr<SensorInterface> sensor, uint32_t intervalMs = 0, uint32_t phaseMs = 0, uint32_t windowMs = 0);
+
+    /**
+     * @brief Adds a non-blocking sensor implementation (see AsyncSensorInterface), read on its own schedule.
+     * Its reads are started when due and polled from loop() until done, so a slow conversion does not
+     * stall the node. Parameters as for the synchronous addSensor().
+     */
+    bool addSensor(std::unique_ptr<AsyncSensorInterface> sensor, uint32_t intervalMs = 0, uint32_t phaseMs = 0, uint32_t windowMs = 0);
+
+    /**
+     * @brief Counts of sensor readings sent and suppressed by the deadbands (`deadband`, `hb_int`).
+     */
+    const ASCSDeadbandStats &getDeadbandStats() const { return m_deadband.getStats(); }
+
+    /**
+     * @brief Read interval in effect (`read_int`, adapted within `read_min`..`read_max`) and how often it changed.
+     */
+    uint32_t getReadIntervalMs() const { return m_adaptive.getIntervalMs(); }
+    const ASCSAdaptiveStats &getAdaptiveStats() const { return m_adaptive.getStats(); }
+
+    /**
+     * @brief Sensor event counters (SensorInterface::getEventQueue()): events, packets, bursts coalesced,
+     * queue overflows and the longest wait from an event to its packet being queued.
+     */
+    const ASCSEventStats &getEventStats() const { return m_events.getStats(); }
+
+    /**
+     * @brief Outbound queue counters: per priority class, retries, duty-cycle deferrals, deepest queue.
+     */
+    const ASCSOutboundStats &getOutboundStats() const { return m_outbound.getStats(); }
+    size_t getOutboundQueueDepth() const { return m_outbound.size(); }
+
+    /**
+     * @brief Own airtime within the hour before 'now' (ms), against getDutyBudgetMs() (`duty_pct`, 0 = no limit).
+     */
+    uint32_t getAirtimeLastHourMs(unsigned long now) { return m_outbound.getAirtimeLastHourMs(now); }
+    uint32_t getDutyBudgetMs() const { return m_outbound.getDutyBudgetMs(); }
+
+    /**
+     * @brief Store-and-forward counters (`sf_max`): packets held, flushed, dropped and restored.
+     */
+    const ASCSStoreStats &getStoreStats() const { return m_store.getStats(); }
+
     // --- Public Information Methods ---
 
     /**
@@ -130,6 +212,23 @@ public:
      */
     static bool decode_map_callback(pb_istream_t *stream, const pb_field_t *field, void **arg);
 
+    /**
+     * @brief Nanopb callbacks of the typed readings: 'bools' (BoolChannels bitfields) and 'ints'
+     * (map<string, sint32>). They encode the BOOL/INT readings of the context's map (types_ptr),
+     * and decode into the same map, recording the types.
+     */
+    static bool encode_bools_callback(pb_ostream_t *stream, const pb_field_t *field, void * const *arg);
+    static bool decode_bools_callback(pb_istream_t *stream, const pb_field_t *field, void **arg);
+    static bool encode_ints_callback(pb_ostream_t *stream, const pb_field_t *field, void * const *arg);
+    static bool decode_ints_callback(pb_istream_t *stream, const pb_field_t *field, void **arg);
+
+    /**
+     * @brief Arms all readings fields of a SensorData (readings, bools, ints) to encode from, or
+     * decode into, the context's map and types.
+     */
+    static void setReadingsEncoder(SensorData &sensorData, MapCallbackContext &context);
+    static void setReadingsDecoder(SensorData &sensorData, MapCallbackContext &context);
+
 
 private:
     // --- Internal Helper Methods ---
@@ -137,48 +236,111 @@ private:
     // Network Management (Gateway Role)
     void connectWiFi();
     void checkWiFiConnection();
-    void connectMQTT();
-    void checkMQTTConnection();
-    // Static callback required by PubSubClient library signature.
+    // Static callback for incoming MQTT messages (PubSubClient-compatible signature).
     static void mqttCallback(char *topic, byte *payload, unsigned int length);
 
     // Packet Handling
-    void handleServiceDiscovery(const ServiceDiscovery &discovery, uint32_t fromNode);
-    // Takes the decoded SensorData and the originating node ID.
-    void handleSensorData(const SensorData &sensorData, uint32_t fromNode);
+    // 'link' is the signal quality of the packet the discovery arrived in.
+    // 'toNode' is the packet's destination (a reply to another node's query if it is neither us nor broadcast).
+    // Decodes one SmartCityPacket of a received packet (its payload, or one packet of a StoredBatch).
+    bool handlePayload(const uint8_t *data, size_t length, const meshPacket &packet, const ASCSLinkSample &link, bool refreshSender);
+    void handleServiceDiscovery(const ServiceDiscovery &discovery, uint32_t fromNode, uint32_t toNode, const ASCSLinkSample &link);
+    void handleServiceInfo(uint32_t fromNode, ServiceDiscovery_Role role, uint32_t serviceId, const ASCSLinkSample &link);
+    // Takes the decoded SensorData, its decoded readings map and their types, and the originating node ID
+    // (SensorData.origin_node if relayed by Aggregators, else the sender).
+    void handleSensorData(const SensorData &sensorData, std::map<std::string, float> &readings, ReadingTypes &types, uint32_t fromNode);
+    // Sensors in poll mode: schedules the answer if we are named in the request.
+    void handlePollRequest(const PollRequest &poll, uint32_t fromNode);
 
     // Message Sending
-    void sendServiceDiscovery(uint32_t toNode = ASCS_BROADCAST_ADDR);
+    void sendServiceDiscovery(uint32_t toNode = ASCS_BROADCAST_ADDR, bool query = false, bool reslot = false);
+    // Sends a discovery query while no gateway is known (Sensors/Aggregators), with backoff.
+    bool runDiscoveryQuery(unsigned long now);
+    // Gateway: asks the listed sensors (in poll mode) for their latest reading.
+    void sendPollRequest(const uint32_t *nodes, size_t count);
+
+    // Service Table Snapshot (NVS)
+    void restoreServiceTable();
+    // Writes the snapshot if gateways/aggregators changed since the last one. Returns true if written.
+    bool saveServiceTable();
+    // Store-and-forward queue (NVS): packets held while no gateway is known survive a restart.
+    void restoreStoredPackets();
+    bool saveStoredPackets();
+    // Holds a SensorData packet until a route to a gateway is known. Returns false if not held.
+    bool storePacket(const SmartCityPacket &packet, MessagePriority priority);
+    // Sends the next batch of held packets once a route is known again. Returns true if any were sent.
+    bool flushStoredPackets(unsigned long now);
+    // Lets data sent to 'toNode' (carrying our role) stand in for the discovery announcement.
+    void noteAnnouncedTraffic(uint32_t toNode);
     // Takes a fully prepared SensorData struct (including map callbacks set if needed).
-    void sendSensorData(const SensorData &sensorData);
+    // 'toNode' overrides the destination (e.g., the gateway that polled us); 0 = configured or discovered.
+    void sendSensorData(const SensorData &sensorData, uint32_t toNode = 0); // Priority from sensorData.priority
     // Core function to encode and send any SmartCityPacket via Meshtastic.
-    bool sendMessage(uint32_t toNode, const SmartCityPacket &packet);
+    // Queued by priority (ASCSOutboundQueue); critical packets are handed to the radio at once.
+    bool sendMessage(uint32_t toNode, const SmartCityPacket &packet, MessagePriority priority = MessagePriority::ROUTINE);
+    // Encodes a SmartCityPacket into 'buffer'. Returns the encoded length, 0 on failure.
+    size_t encodePacket(const SmartCityPacket &packet, uint8_t *buffer, size_t size);
+    // Queues an encoded packet ('announces': it carries our role, see noteAnnouncedTraffic()).
+    bool queueEncoded(uint32_t toNode, const uint8_t *data, size_t length, MessagePriority priority, bool announces);
+    // Hands queued packets to the radio when it should be free (called from loop() and after queueing).
+    bool serviceOutboundQueue(unsigned long now);
 
     // Role-Specific Logic - Called from loop() or handleReceived()
-    void runSensorLogic();
+    // Starts reading the given sensors (registry indexes); pollSensorReads() sends the readings once all are read.
+    void runSensorLogic(const std::vector<size_t> &sensors, uint32_t toNode = 0); // 'toNode' as in sendSensorData()
+    // Checks the reads started by runSensorLogic(); when all are finished, sends their readings, combined where they fit.
+    bool pollSensorReads(unsigned long now);
+    // Takes the events posted by the sensors and sends them (debounced per sensor). Returns true if any were sent.
+    bool pollSensorEvents(unsigned long now);
+    // Sends one SensorData packet with the given sensor ID and readings ('types': keys sent as BOOL/INT).
+    void sendReadings(const std::string &sensorId, std::map<std::string, float> &readings, uint32_t toNode,
+                      MessagePriority priority = MessagePriority::ROUTINE, ReadingTypes *types = nullptr);
+    // (Re)starts the sensor schedules at our first transmit slot after 'after'.
+    void scheduleSensors(unsigned long after);
+    // Adapts the read interval after a round ('excess': largest move in deadbands; 'batteryMv': 0 if not read).
+    void adaptReadInterval(float excess, uint32_t batteryMv);
     // Aggregator logic now takes the full packet for potential forwarding.
     void runAggregatorLogic(const SmartCityPacket &packet, uint32_t fromNode);
-    // Gateway logic now takes the full packet for potential buffering/publishing.
-    void runGatewayLogic(const SmartCityPacket &packet, uint32_t fromNode);
+    // Gateway logic takes the full packet (for buffering) and the decoded readings and their types (for publishing).
+    void runGatewayLogic(const SmartCityPacket &packet, const std::map<std::string, float> &readings, const ReadingTypes &types,
+                         uint32_t fromNode);
 
     // Service Discovery Management
-    void updateServiceTable(uint32_t nodeId, ServiceDiscovery_Role role, uint32_t serviceId);
+    // Returns true if a gateway/aggregator is new or changed its role or service ID (a topology change).
+    bool updateServiceTable(uint32_t nodeId, ServiceDiscovery_Role role, uint32_t serviceId, const ASCSLinkSample *link = nullptr);
     void cleanupServiceTable();
-    uint32_t findGatewayNode(); // Finds a suitable gateway from the service table
-
-    // MQTT Publishing & Buffering (Gateway Role)
-    // Decides whether to publish directly or buffer based on MQTT connection status.
-    void publishMqttOrBuffer(const SmartCityPacket &packet, uint32_t fromNode);
-    // Performs the actual MQTT publication. Returns true on success.
-    bool publishMqtt(const SensorData &sensorData, uint32_t fromNode);
-    // Appends an encoded packet to the buffer file.
-    void bufferPacket(const SmartCityPacket &packet);
-    // Reads and sends packets stored in the buffer file.
-    void processBufferedPackets();
-    // Helper to read the next length-prefixed packet from the buffer file.
-    bool readPacketFromBuffer(File &file, uint8_t* buffer, size_t &len);
-    // Helper to remove the first packet from the buffer file (basic file copy method).
-    void removePacketFromBuffer();
+    void logGatewayScores(); // Logs link metrics and cost of every known gateway
+    uint32_t findGatewayNode(); // Finds a suitable gateway from the service table (O(1))
+    // Next hop towards a gateway: a gateway in range or the Aggregator with the cheapest route. 0 if none.
+    uint32_t findRouteNextHop(float &cost);
+    // Aggregators: resets the discovery timer when our advertised route changed noticeably.
+    void checkRouteChange();
+
+    // Gateway Output (Gateway Role)
+    // Creates the sinks listed in 'gw_sinks' and configures their batching.
+    void createGatewaySinks();
+    // Offers a record to every sink (batching, writing or spilling it per sink).
+    void dispatchToSinks(const ASCSBatchRecord &record);
+    // Sends rate limiter and sink counters through the sinks as a record of this gateway.
+    void publishGatewayMetrics();
+    // Writes records to a sink and updates its counters. Returns true on success.
+    bool writeToSink(GatewaySink &sink, const std::vector<ASCSBatchRecord> &records);
+    // Writes the sink's open batch, or spills it if the sink cannot take it.
+    void flushSinkBatch(GatewaySink &sink);
+    // Moves a record the sink could not take to its spill file (or drops it if the sink has none).
+    void spillRecord(GatewaySink &sink, const ASCSBatchRecord &record);
+    // Appends an encoded packet and its originating node to a spill file. Returns true if written.
+    bool bufferPacket(const SmartCityPacket &packet, uint32_t fromNode, const char *filename);
+    // Appends one already encoded packet and its originating node to a spill file. Returns true if written.
+    bool appendFrame(const char *filename, uint32_t fromNode, const uint8_t *buffer, size_t len);
+    // Moves records from the buffer file of older firmware to the sinks' spill files (node ID 0).
+    void migrateLegacyBuffer();
+    // Replays one packet (or one batch) from the sink's spill file. Returns true if more are pending.
+    bool processBufferedPackets(GatewaySink &sink);
+    // Helper to read the next framed packet and its originating node from a spill file.
+    bool readPacketFromBuffer(File &file, uint8_t* buffer, size_t &len, uint32_t &fromNode);
+    // Helper to remove the first 'bytes' bytes (whole frames) from a spill file (basic file copy method).
+    void removeFromBufferFront(const char *filename, size_t bytes);
 
     // --- Member Variables ---
 
@@ -187,29 +349,66 @@ private:
 
     // Timers for periodic actions
     unsigned long m_lastSensorReadTime = 0;
-    unsigned long m_lastDiscoverySendTime = 0;
     unsigned long m_lastServiceCleanupTime = 0;
-    unsigned long m_lastMqttReconnectAttempt = 0;
-    unsigned long m_lastBufferProcessTime = 0; // Timer for processing buffered messages
+    unsigned long m_lastSnapshotCheckTime = 0;
+    uint32_t m_snapshotSignature = 0;         // Signature of the stored service table snapshot
+    unsigned long m_lastBufferProcessTime = 0; // Timer for replaying spill files
+    unsigned long m_lastMetricsTime = 0;       // Timer for gateway metrics records
 
     // State Variables
     uint32_t m_sensorSequenceNum = 0; // Sequence number for sensor data packets
-    bool m_gatewayBufferActive = false; // Flag indicating if buffering is currently needed/active
-
-    // Sensor Implementation (if configured as Sensor role)
-    std::unique_ptr<SensorInterface> m_sensor = nullptr;
-
-    // Service Discovery Table - Maps Node ID to discovered service info
-    struct DiscoveredService {
-        ServiceDiscovery_Role role;
-        uint32_t serviceId;
-        unsigned long lastSeen; // Timestamp of last message/discovery
-    };
-    std::map<uint32_t, DiscoveredService> m_serviceTable;
-
-    // Network Clients (Gateway Role) - Pointers to avoid global instances
-    WiFiClient *m_wifiClient = nullptr;
-    PubSubClient *m_mqttClient = nullptr;
+
+    // Transmit slot within the read interval (Sensor Role)
+    ASCSTxSlot m_txSlot;
+    bool m_slotOnUtc = false; // Sensor schedules counted from the UTC epoch (else from boot until the time is set)
+    // Poll mode (Sensor Role): answer due to the gateway that polled us
+    bool m_pollReplyPending = false;
+    unsigned long m_pollReplyTime = 0;
+    uint32_t m_pollReplyTo = 0;
+    unsigned long m_lastPollTime = 0;
+    uint32_t m_pollIntervalMs = 0; // Poll interval of our gateway (0 = never polled)
+
+    // Sensor Implementations, each with its own schedule (if configured as Sensor role)
+    ASCSSensorRegistry m_sensors;
+    std::vector<size_t> m_dueSensors; // Reused list of sensors to read
+    uint32_t m_sensorReadsTo = 0;      // Destination of the readings being read (0 = configured or discovered)
+    ASCSDeadband m_deadband;           // Readings are only sent when they changed enough (or on heartbeat)
+    ASCSAdaptiveInterval m_adaptive;   // read_int shortened while readings change, lengthened while stable or on low battery
+    ASCSEventDebouncer m_events;       // State changes posted by the sensors, sent without waiting for the next read
+    ASCSPriorityRules m_priorityRules; // Reading keys that make a packet high/critical (`prio_keys`)
+
+    // Outgoing packets of all roles, highest priority first
+    ASCSOutboundQueue m_outbound;
+    ASCSStoreForward m_store; // Sensors/Aggregators: packets held while no gateway is known
+    std::vector<std::pair<MessagePriority, std::vector<uint8_t>>> m_storeBatch; // Reused by flushStoredPackets()
+
+    // Service Discovery Table - Node ID to discovered service info (fixed capacity, LRU eviction)
+    ASCSServiceTable m_serviceTable;
+    bool m_hashGatewaySelection = false; // 'gw_select' = "hash": spread over gateways instead of the cheapest
+    // Trickle timer for the discovery announcement (backs off while the mesh is stable)
+    ASCSTrickleTimer m_discoveryTimer;
+    // Pending replies to other nodes' discovery queries (Gateway)
+    ASCSDiscoveryReplies m_discoveryReplies;
+    // Discovery query while no gateway is known (Sensor/Aggregator)
+    bool m_queryActive = false;
+    uint8_t m_queriesLeft = 0;
+    unsigned long m_lastQueryTime = 0;
+    uint32_t m_queryDelayMs = 0; // Wait before the next query
+    uint32_t m_nextHop = 0; // Current next hop towards a gateway (findRouteNextHop())
+    // Route to a gateway as last advertised (Aggregator)
+    uint32_t m_routeNextHop = 0;
+    float m_routeCost = 0;
+
+    // Gateway outputs, in 'gw_sinks' order (Gateway Role)
+    std::vector<std::unique_ptr<GatewaySink>> m_sinks;
+    // Sequence gaps per sensor, to ask lossy sensors to change slot (Gateway Role)
+    ASCSSlotLossMonitor m_slotMonitor;
+    // Round-robin polls of sensors in poll mode within an airtime budget (Gateway Role)
+    ASCSPollScheduler m_pollScheduler;
+    // Per-origin-node token buckets in front of the sinks (Gateway Role)
+    ASCSRateLimiter m_rateLimiter;
+    std::vector<ASCSBatchRecord> m_releasedRecords; // Reused buffer for records released by the rate limiter
+    uint32_t m_metricsSequenceNum = 0;
 
     // Static instance pointer for MQTT callback context
     static AkitaSmartCityServices* s_instance;
@@ -0,0 +1,77 @@
+#ifndef ASYNC_SENSOR_INTERFACE_H
+#define ASYNC_SENSOR_INTERFACE_H
+
+#include <stdint.h>
+#include "MessagePriority.h"
+#include "SensorEventQueue.h"
+#include "ReadingType.h"
+#include <map>
+#include <string>
+
+#define ASCS_SENSOR_READ_TIMEOUT_MS 10000 // Default time a started read may take before it counts as failed
+
+/**
+ * @brief State of a sensor read started with AsyncSensorInterface::startRead().
+ */
+enum class SensorReadStatus {
+    PENDING, // Still converting/measuring: poll again on a later loop()
+    DONE,    // Readings are filled in
+    FAILED   // The read failed; no readings
+};
+
+/**
+ * @brief Non-blocking interface for slow sensors (e.g., CO2 or particulate counters, oversampled
+ * conversions).
+ *
+ * The plugin starts a read when the sensor is due and polls it from every loop() until it is
+ * done, so a conversion taking seconds does not stall the mesh. startRead() and pollRead()
+ * should each return quickly (trigger a conversion, check a data-ready flag or a deadline, fetch
+ * the result).
+ *
+ * Synchronous SensorInterface implementations do not need to change: addSensor() wraps them in
+ * ASCSSyncSensorAdapter (their readData() still blocks, as before).
+ */
+class AsyncSensorInterface {
+public:
+    virtual ~AsyncSensorInterface() = default;
+
+    /**
+     * @brief Starts a measurement.
+     * @return False if it could not be started (the read counts as failed).
+     */
+    virtual bool startRead() = 0;
+
+    /**
+     * @brief Checks the measurement started last.
+     * @param readings Filled (after clearing) when DONE is returned.
+     * @return PENDING until the readings are available, then DONE (or FAILED).
+     */
+    virtual SensorReadStatus pollRead(std::map<std::string, float> &readings) = 0;
+
+    /**
+     * @brief Gets the specific ID or name for this sensor instance (see SensorInterface::getSensorId()).
+     */
+    virtual std::string getSensorId() = 0;
+
+    /**
+     * @brief Time after startRead() after which a read still PENDING counts as failed.
+     */
+    virtual uint32_t getReadTimeoutMs() { return ASCS_SENSOR_READ_TIMEOUT_MS; }
+
+    /**
+     * @brief Priority of a reading just taken (see SensorInterface::getPriority()).
+     */
+    virtual MessagePriority getPriority(const std::map<std::string, float> &readings) { (void)readings; return MessagePriority::ROUTINE; }
+
+    /**
+     * @brief Queue of the driver's state changes, or null (see SensorInterface::getEventQueue()).
+     */
+    virtual SensorEventQueue *getEventQueue() { return nullptr; }
+
+    /**
+     * @brief How a reading key is sent (see SensorInterface::getReadingType()).
+     */
+    virtual ReadingType getReadingType(const std::string &key) { (void)key; return ReadingType::FLOAT; }
+};
+
+#endif // ASYNC_SENSOR_INTERFACE_H
@@ -0,0 +1,80 @@
+#ifndef GATEWAY_SINK_H
+#define GATEWAY_SINK_H
+
+#include <stdint.h>
+#include <vector>
+#include "../ASCSPublishBatcher.h" // ASCSBatchRecord, per-sink batching
+
+/**
+ * @brief Per-sink counters, maintained by the gateway dispatcher.
+ */
+struct GatewaySinkStats {
+    uint32_t recordsWritten = 0;  // Records accepted by write()
+    uint32_t writes = 0;          // Successful write() calls (messages/batches)
+    uint32_t writeFailures = 0;   // write() calls that returned false
+    uint32_t recordsSpilled = 0;  // Records moved to the sink's spill file (backpressure)
+    uint32_t recordsDropped = 0;  // Records lost because the sink was unavailable and has no spill file
+};
+
+/**
+ * @brief Abstract output of the Gateway role (MQTT, time-series database, local file, ...).
+ *
+ * The gateway decodes each SensorData packet once into an ASCSBatchRecord and offers it to
+ * every configured sink. Each sink has its own batcher, so batch size and latency can be tuned
+ * per destination.
+ *
+ * Backpressure: a sink reports isReady() == false while it cannot accept writes (e.g., not
+ * connected). Records it cannot take, including batches whose write() fails, go to its spill
+ * file if getSpillFilename() returns one and are replayed once the sink is ready again;
+ * otherwise they are dropped and counted.
+ */
+class GatewaySink {
+public:
+    virtual ~GatewaySink() = default;
+
+    /**
+     * @brief Short sink name for logs and metrics (e.g., "mqtt").
+     */
+    virtual const char *getSinkName() const = 0;
+
+    /**
+     * @brief Allocates resources (clients, files). Called once from the plugin's init().
+     * @return False if the sink cannot operate; it is then removed.
+     */
+    virtual bool begin() = 0;
+
+    /**
+     * @brief Periodic upkeep (reconnects, keepalives). Called from the plugin loop.
+     */
+    virtual void loop() {}
+
+    /**
+     * @brief Whether the sink can accept a write() right now.
+     */
+    virtual bool isReady() = 0;
+
+    /**
+     * @brief Delivers one or more records. With batching enabled this is one full batch.
+     * @return True if all records were handed to the destination.
+     */
+    virtual bool write(const std::vector<ASCSBatchRecord> &records) = 0;
+
+    /**
+     * @brief File used to hold records while the sink is unavailable, or nullptr for none.
+     */
+    virtual const char *getSpillFilename() const { return nullptr; }
+
+    // --- State shared by all sinks (used by the gateway dispatcher) ---
+    ASCSPublishBatcher &getBatcher() { return m_batcher; }
+    GatewaySinkStats &getStats() { return m_stats; }
+    // True while the spill file holds records; new records are spilled too, to keep their order.
+    bool isSpilling() const { return m_spilling; }
+    void setSpilling(bool spilling) { m_spilling = spilling; }
+
+protected:
+    ASCSPublishBatcher m_batcher;
+    GatewaySinkStats m_stats;
+    bool m_spilling = false;
+};
+
+#endif // GATEWAY_SINK_H
@@ -0,0 +1,18 @@
+#ifndef MESSAGE_PRIORITY_H
+#define MESSAGE_PRIORITY_H
+
+#include <stdint.h>
+
+/**
+ * @brief Priority class of an outgoing message (carried in SensorData.priority).
+ *
+ * Higher classes leave a node's outbound queue first; CRITICAL messages (alarms) are handed to
+ * the radio at once and bypass gateway batching and rate limiting.
+ */
+enum class MessagePriority : uint8_t {
+    ROUTINE = 0,  // Periodic telemetry, discovery, polls
+    HIGH = 1,     // Notable but not urgent (e.g., battery low)
+    CRITICAL = 2  // Alarms (door open, flood, fire)
+};
+
+#endif // MESSAGE_PRIORITY_H
@@ -0,0 +1,104 @@
+#ifndef MQTT_TRANSPORT_H
+#define MQTT_TRANSPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Max size of one MQTT packet (fixed header + topic + properties + payload) handled by the
+// transports. Sized for batched payloads (see ASCS_BATCH_MAX_PAYLOAD_BYTES).
+#define ASCS_MQTT_MAX_PACKET_SIZE 4096
+
+/**
+ * @brief Signature of the callback invoked for incoming MQTT messages.
+ * Matches the PubSubClient callback so the plugin's static handler can be shared.
+ * The payload buffer has at least one spare byte after 'length' for a null terminator.
+ */
+typedef void (*MqttMessageCallback)(char *topic, uint8_t *payload, unsigned int length);
+
+/**
+ * @brief Per-publish options. Fields that the protocol version cannot express are ignored.
+ */
+struct MqttPublishOptions {
+    // Message Expiry Interval in seconds (MQTT 5 only). 0 means the message never expires.
+    uint32_t messageExpirySec = 0;
+    // Whether the topic may be replaced by a Topic Alias (MQTT 5 only).
+    bool allowTopicAlias = true;
+};
+
+/**
+ * @brief Abstract MQTT client used by the gateway publish path.
+ *
+ * Lets the gateway switch between the PubSubClient (MQTT 3.1.1) implementation and the
+ * built-in MQTT 5 client without touching the publishing logic.
+ */
+class MqttTransport {
+public:
+    virtual ~MqttTransport() = default;
+
+    /**
+     * @brief Sets the broker address. The host string must outlive the transport.
+     */
+    virtual void setServer(const char *host, uint16_t port) = 0;
+
+    /**
+     * @brief Sets the callback for incoming messages on subscribed topics.
+     */
+    virtual void setCallback(MqttMessageCallback callback) = 0;
+
+    /**
+     * @brief Opens the TCP connection and performs the MQTT handshake.
+     * @param clientId MQTT client identifier.
+     * @param user Username, or nullptr for anonymous access.
+     * @param password Password (ignored when user is nullptr).
+     * @return True if the broker accepted the connection.
+     */
+    virtual bool connect(const char *clientId, const char *user, const char *password) = 0;
+
+    virtual bool connected() = 0;
+    virtual void disconnect() = 0;
+
+    /**
+     * @brief Services keepalives and incoming packets. Call regularly from the plugin loop.
+     * @return True if the connection is still up.
+     */
+    virtual bool loop() = 0;
+
+    /**
+     * @brief Implementation-specific connection state / last error code (for logging).
+     */
+    virtual int state() = 0;
+
+    /**
+     * @brief Publishes a QoS 0 message.
+     * @return True if the message was handed to the network stack.
+     */
+    virtual bool publish(const char *topic, const uint8_t *payload, size_t length, bool retain,
+                         const MqttPublishOptions &options) = 0;
+
+    /**
+     * @brief Short protocol name for logs and metrics (e.g., "MQTT 3.1.1").
+     */
+    virtual const char *getProtocolName() const = 0;
+
+    // --- Wire accounting (PUBLISH packets only) ---
+    uint32_t getPublishCount() const { return m_publishCount; }
+    uint32_t getPublishBytes() const { return m_publishBytes; }
+
+protected:
+    // Called by implementations after each successful PUBLISH with its full size on the wire.
+    void recordPublish(size_t wireBytes) {
+        m_publishCount++;
+        m_publishBytes += wireBytes;
+    }
+
+    // Size of an MQTT "Remaining Length" variable byte integer.
+    static size_t varIntSize(size_t value) {
+        return value < 128 ? 1 : value < 16384 ? 2 : value < 2097152 ? 3 : 4;
+    }
+
+private:
+    uint32_t m_publishCount = 0;
+    uint32_t m_publishBytes = 0;
+};
+
+#endif // MQTT_TRANSPORT_H
@@ -0,0 +1,25 @@
+#ifndef READING_TYPE_H
+#define READING_TYPE_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+
+/**
+ * @brief How a reading is sent (SensorInterface::getReadingType()).
+ *
+ * Readings are floats in memory either way; the type only chooses their encoding in SensorData
+ * and how the gateway writes them out (JSON true/false and integers, line protocol t/f and "i").
+ */
+enum class ReadingType : uint8_t {
+    FLOAT = 0, // 4-byte float in SensorData.readings (default)
+    BOOL = 1,  // 0 or 1 (non-zero), one bit in SensorData.bools; keys "<name>_0".."<name>_<n>" share one bitfield
+    INT = 2    // Whole number or enum state (rounded), a zigzag varint in SensorData.ints: 1 byte for -64..63
+};
+
+/**
+ * @brief Types of the readings of a packet that are not FLOAT, keyed as in its readings map.
+ */
+typedef std::map<std::string, ReadingType> ReadingTypes;
+
+#endif // READING_TYPE_H
@@ -0,0 +1,80 @@
+#ifndef SENSOR_EVENT_QUEUE_H
+#define SENSOR_EVENT_QUEUE_H
+
+#include <stdint.h>
+#include <atomic>
+
+#define ASCS_SENSOR_EVENT_QUEUE_SIZE 16 // Events one sensor can have waiting for loop() (power of two)
+
+/**
+ * @brief A reading posted by a sensor driver when something happens (a door opens, a bay is taken),
+ * instead of waiting for the next read.
+ */
+struct SensorEvent {
+    const char *key;  // Reading key; must outlive the event (a string literal)
+    float value;
+    uint32_t timeMs;  // millis() when it happened
+};
+
+/**
+ * @brief Lock-free queue of sensor events from one producer (the driver's interrupt handler or
+ * task) to one consumer (the plugin's loop()).
+ *
+ * post() neither allocates nor blocks, so it may be called from an ISR: the producer only writes
+ * the head index and the consumer only the tail index, each published with release/acquire
+ * ordering. When the queue is full the new event is dropped and counted; loop() drains it far
+ * faster than contacts can bounce, so that means the node is stuck elsewhere.
+ *
+ * Only one context may post to a queue; a driver with several interrupt sources needs a queue per
+ * source or its own serialization.
+ */
+class SensorEventQueue {
+public:
+    /**
+     * @brief Adds an event (producer side, ISR-safe).
+     * @return False if the queue was full (the event is dropped).
+     */
+    bool post(const char *key, float value, uint32_t timeMs) {
+        uint32_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) >= ASCS_SENSOR_EVENT_QUEUE_SIZE) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        SensorEvent &slot = m_events[head & (ASCS_SENSOR_EVENT_QUEUE_SIZE - 1)];
+        slot.key = key;
+        slot.value = value;
+        slot.timeMs = timeMs;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Takes the oldest event (consumer side, loop()).
+     * @return False if there is none.
+     */
+    bool pop(SensorEvent &event) {
+        uint32_t tail = m_tail.load(std::memory_order_relaxed);
+        if (m_head.load(std::memory_order_acquire) == tail) return false;
+        event = m_events[tail & (ASCS_SENSOR_EVENT_QUEUE_SIZE - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const { return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Events dropped because the queue was full (since boot).
+     */
+    uint32_t getDropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    static_assert((ASCS_SENSOR_EVENT_QUEUE_SIZE & (ASCS_SENSOR_EVENT_QUEUE_SIZE - 1)) == 0,
+                  "ASCS_SENSOR_EVENT_QUEUE_SIZE must be a power of two");
+
+    SensorEvent m_events[ASCS_SENSOR_EVENT_QUEUE_SIZE] = {};
+    std::atomic<uint32_t> m_head{0}; // Written by the producer only
+    std::atomic<uint32_t> m_tail{0}; // Written by the consumer only
+    std::atomic<uint32_t> m_dropped{0};
+};
+
+#endif // SENSOR_EVENT_QUEUE_H
@@ -2,6 +2,9 @@
 #define SENSOR_INTERFACE_H
 
 #include "SmartCity.pb.h" // Include the generated header from SmartCity.proto
+#include "MessagePriority.h"
+#include "SensorEventQueue.h"
+#include "ReadingType.h"
 #include <map>
 #include <string>
 
@@ -34,6 +37,27 @@ public:
      * @return A string identifying the sensor. Can be empty if not needed.
      */
     virtual std::string getSensorId() = 0;
+
+    /**
+     * @brief Priority of a reading just taken (e.g., CRITICAL while an alarm contact is open).
+     * Reading keys configured in `prio_keys` can raise it further.
+     */
+    virtual MessagePriority getPriority(const std::map<std::string, float>& readings) { (void)readings; return MessagePriority::ROUTINE; }
+
+    /**
+     * @brief Queue the driver posts state changes to (e.g., from a pin interrupt), or null if it has none.
+     *
+     * Posted events are sent from the next loop() instead of at the next read, at least as HIGH
+     * priority; bursts (contact bounce) within `evt_debounce_ms` go out together with the latest
+     * values. The sensor is still read on its interval, which then serves as heartbeat.
+     */
+    virtual SensorEventQueue* getEventQueue() { return nullptr; }
+
+    /**
+     * @brief How a reading key is sent: BOOL (e.g., "door_open", or bays "bay_0".."bay_15" packed
+     * into one bitfield) and INT (counts, levels) cost a fraction of a float. Default FLOAT.
+     */
+    virtual ReadingType getReadingType(const std::string& key) { (void)key; return ReadingType::FLOAT; }
 };
 
 #endif // SENSOR_INTERFACE_H
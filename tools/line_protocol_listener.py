@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+
+"""
+Line Protocol Test Listener for Akita Smart City Services (ASCS)
+
+Stand-in for a line-protocol TCP listener (e.g., Telegraf socket_listener, QuestDB ILP)
+when testing the Gateway 'lp' sink. Accepts connections, counts received lines and
+prints the throughput once per reporting interval.
+Point the gateway at it with '!prefs set lp_host <this machine>' and 'lp_port'.
+"""
+
+import argparse
+import socket
+import threading
+import time
+
+# --- Configuration ---
+DEFAULT_BIND = "0.0.0.0"
+DEFAULT_PORT = 8094 # Should match gateway's 'lp_port' config
+
+# --- Argument Parsing ---
+parser = argparse.ArgumentParser(description="ASCS Line Protocol Test Listener")
+parser.add_argument("-b", "--bind", default=DEFAULT_BIND, help=f"Address to listen on (default: {DEFAULT_BIND})")
+parser.add_argument("-p", "--port", type=int, default=DEFAULT_PORT, help=f"TCP port to listen on (default: {DEFAULT_PORT})")
+parser.add_argument("-i", "--interval", type=float, default=5.0, help="Seconds between throughput reports (default: 5)")
+parser.add_argument("-v", "--verbose", action="store_true", help="Print every received line")
+
+args = parser.parse_args()
+
+# --- Counters (shared between connection threads) ---
+lock = threading.Lock()
+total_lines = 0
+total_bytes = 0
+
+def handle_connection(conn, addr):
+    """Reads newline-terminated lines from one gateway connection."""
+    global total_lines, total_bytes
+    print(f"Connection from {addr[0]}:{addr[1]}")
+    pending = b""
+    with conn:
+        while True:
+            data = conn.recv(65536)
+            if not data:
+                break
+            pending += data
+            *lines, pending = pending.split(b"\n")
+            with lock:
+                total_lines += len(lines)
+                total_bytes += len(data)
+            if args.verbose:
+                for line in lines:
+                    print(line.decode("utf-8", errors="replace"))
+    if pending:
+        print(f"Warning: {len(pending)} bytes without trailing newline from {addr[0]} (partial line)")
+    print(f"Connection from {addr[0]}:{addr[1]} closed")
+
+def report():
+    """Prints lines/s and bytes/s for each interval."""
+    last_lines, last_bytes, last_time = 0, 0, time.time()
+    while True:
+        time.sleep(args.interval)
+        now = time.time()
+        with lock:
+            lines, nbytes = total_lines, total_bytes
+        elapsed = now - last_time
+        if lines != last_lines:
+            print(f"{lines - last_lines} lines in {elapsed:.1f} s: "
+                  f"{(lines - last_lines) / elapsed:.1f} lines/s, {(nbytes - last_bytes) / elapsed:.0f} bytes/s "
+                  f"(total {lines} lines, {nbytes} bytes)")
+        last_lines, last_bytes, last_time = lines, nbytes, now
+
+# --- Main Execution ---
+if __name__ == "__main__":
+    server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind((args.bind, args.port))
+    server.listen()
+    print(f"Listening for line protocol on {args.bind}:{args.port}")
+    threading.Thread(target=report, daemon=True).start()
+    try:
+        while True:
+            conn, addr = server.accept()
+            threading.Thread(target=handle_connection, args=(conn, addr), daemon=True).start()
+    except KeyboardInterrupt:
+        print("\nStopping listener.")
+        with lock:
+            print(f"Received {total_lines} lines, {total_bytes} bytes in total.")
+    finally:
+        server.close()
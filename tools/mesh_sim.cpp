@@ -0,0 +1,2897 @@
+/**
+ * Host mesh simulator for Akita Smart City Services (ASCS)
+ *
+ * Runs the plugin's own decision logic (service table, link metrics, ...) against a
+ * simple statistical model of a LoRa mesh, to compare strategies without hardware.
+ * Needs only a host compiler and the generated SmartCity.pb.h:
+ *
+ *   g++ -O2 -std=gnu++17 -Isrc -I<nanopb> tools/mesh_sim.cpp src/ASCSServiceTable.cpp src/ASCSLinkMetrics.cpp \
+ *       src/ASCSTrickleTimer.cpp src/ASCSDiscoveryReplies.cpp src/ASCSServiceSnapshot.cpp \
+ *       src/ASCSTxSlot.cpp src/ASCSPollScheduler.cpp src/ASCSSensorRegistry.cpp src/ASCSSyncSensorAdapter.cpp \
+ *       src/ASCSDeadband.cpp src/ASCSWindowStats.cpp src/ASCSOutboundQueue.cpp src/ASCSLoRaAirtime.cpp \
+ *       src/ASCSDutyCycle.cpp src/ASCSStoreForward.cpp src/ASCSAdaptiveInterval.cpp \
+ *       src/ASCSEventDebouncer.cpp src/ASCSTypedReadings.cpp src/ASCSConfigList.cpp -o mesh_sim
+ *   ./mesh_sim gateway
+ *
+ * Scenarios:
+ *   gateway   - Gateway selection: most recently seen vs. link cost (with and without hysteresis).
+ *   balance   - Several gateways in one district: load per gateway and sensors moved when a gateway
+ *               leaves or joins, for link cost vs. hashed selection.
+ *   discovery - Discovery announcements on a 300-node mesh: fixed interval vs. Trickle timer.
+ *   piggyback - The same mesh with sensor data traffic, with and without role info on SensorData.
+ *   query     - Time from boot to the first sensor reading delivered to a gateway, with and without
+ *               discovery queries and the service table snapshot (cold boot of the whole mesh,
+ *               then single sensor reboots).
+ *   chain     - A road with a gateway at each end and a chain of aggregators: delivery by depth and
+ *               rerouting after a gateway fails, with and without aggregator-to-aggregator routes,
+ *               and with discovery queries answered by aggregators that have a route.
+ *   slots     - Sensors around one gateway after a power restore: delivered readings with
+ *               free-running read timers vs. transmit slots (and slot changes on gateway request).
+ *   poll      - Slow meters around one gateway: own read timers vs. gateway polls, with
+ *               delivered readings, channel use and the poll scheduler's statistics.
+ *   sensors   - Several sensors on one node: packets per hour with one packet per reading vs.
+ *               readings of sensors due close together combined (ASCSSensorRegistry).
+ *   async     - A slow (2 s) sensor read blocking vs. asynchronously: worst-case loop() time and
+ *               the wait of mesh packets for the next loop().
+ *   deadband  - Readings suppressed by report deadbands (ASCSDeadband): packets and airtime per day
+ *               and the error of the last value sent. "deadband <file.csv>" replays a recorded trace.
+ *   adaptive  - The same trace (plus a cold front and a low battery) read at fixed intervals vs. an
+ *               interval adapted to the readings and battery (ASCSAdaptiveInterval): reads, packets,
+ *               airtime and energy per day and the error, also right after the front.
+ *   stats     - A noise sensor sampled every second and reported as window summaries
+ *               (ASCSWindowStats) vs. raw readings: packets per hour and short events caught.
+ *   priority  - Alarms from a busy Aggregator: latency and losses of alarms and routine readings,
+ *               handed straight to the radio vs. through the priority-ordered ASCSOutboundQueue.
+ *   duty      - A day of Aggregator traffic with peaks and a shared radio queue: packets lost when
+ *               sendData() fails vs. retried with backoff, and own airtime per hour against `duty_pct`.
+ *   outage    - A Gateway off for 0.5..6 h: readings broadcast (flooded) vs. held by the Sensors
+ *               (ASCSStoreForward) and sent once it is back, with the flush time and channel load.
+ *   events    - A door contact and a parking bay detector: state changes polled every read_int vs.
+ *               posted from an interrupt (SensorEventQueue, ASCSEventDebouncer): latency from the
+ *               change to the air, changes missed, packets and airtime per day.
+ *   typed     - Parking, door and counter sensors: encoded bytes and airtime of their packets with
+ *               every reading a float vs. booleans as bitfields and counts as varints (ASCSTypedReadings).
+ */
+
+#include "ASCSServiceTable.h"
+#include "ASCSLinkMetrics.h"
+#include "ASCSTrickleTimer.h"
+#include "ASCSDiscoveryReplies.h"
+#include "ASCSServiceSnapshot.h"
+#include "ASCSTxSlot.h"
+#include "ASCSPollScheduler.h"
+#include "ASCSSensorRegistry.h"
+#include "ASCSDeadband.h"
+#include "ASCSAdaptiveInterval.h"
+#include "ASCSEventDebouncer.h"
+#include "ASCSTypedReadings.h"
+#include "ASCSOutboundQueue.h"
+#include "ASCSStoreForward.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// --- Gateway selection ---
+
+struct SimGatewayLink {
+    uint32_t nodeId;
+    float rssi;         // Mean RSSI of the last hop towards the sensor (dBm)
+    float snr;          // Mean SNR of the last hop (dB)
+    int hops;           // Hops between gateway and sensor (0 = direct)
+    unsigned long phase; // Offset of the gateway's discovery broadcasts (ms)
+};
+
+enum SelectionStrategy { MOST_RECENT, COST_NO_HYSTERESIS, COST_HYSTERESIS };
+
+struct SelectionResult {
+    double expectedTx = 0;  // Sum of true expected transmissions over all sensor sends
+    unsigned long sends = 0;
+    unsigned long switches = 0;
+};
+
+static SelectionResult runGatewaySelection(SelectionStrategy strategy, uint32_t seed) {
+    const int sensors = 200;
+    const int gatewaysPerSensor = 3;
+    const unsigned long duration = 24UL * 3600 * 1000;  // 24 h
+    const unsigned long discoveryInterval = 300000;     // Gateways announce every 5 min
+    const unsigned long sendInterval = 60000;           // Sensors send every minute
+    const float snrNoise = 2.5f, rssiNoise = 3.0f;      // Per-packet fading (std. dev.)
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> snrDist(-14.0f, 10.0f);
+    std::uniform_int_distribution<int> hopDist(0, 3);
+    std::uniform_int_distribution<unsigned long> phaseDist(0, discoveryInterval / 1000 - 1); // In 1 s ticks
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+
+    SelectionResult result;
+    for (int s = 0; s < sensors; s++) {
+        // Random gateways around this sensor; RSSI roughly follows SNR
+        std::vector<SimGatewayLink> links;
+        for (int g = 0; g < gatewaysPerSensor; g++) {
+            float snr = snrDist(rng);
+            links.push_back({(uint32_t)(0x1000 + g), -118.0f + 2.0f * (snr + 10.0f), snr, hopDist(rng), phaseDist(rng) * 1000});
+        }
+
+        ASCSServiceTable table(16);
+        table.setSwitchHysteresis(strategy == COST_HYSTERESIS ? ASCS_DEFAULT_GATEWAY_SWITCH_HYSTERESIS : 0.0f);
+        uint32_t mostRecent = 0, previous = 0;
+
+        for (unsigned long t = 0; t < duration; t += 1000) {
+            // Discovery broadcasts heard from each gateway (lost with the link's loss probability)
+            for (const SimGatewayLink &link : links) {
+                if ((t + link.phase) % discoveryInterval != 0) continue;
+                ASCSLinkSample sample;
+                sample.snr = link.snr + snrNoise * noise(rng);
+                sample.rssi = (int32_t)lroundf(link.rssi + rssiNoise * noise(rng));
+                sample.hops = (int8_t)link.hops;
+                float delivery = 1.0f / ASCSLinkStats::expectedTransmissions(link.rssi, link.snr, 0);
+                if (std::uniform_real_distribution<float>(0, 1)(rng) > delivery) continue;
+                table.update(link.nodeId, ServiceDiscovery_Role_GATEWAY, 1, t, &sample);
+                mostRecent = link.nodeId;
+            }
+
+            // Sensor sends: cost is the true expected transmissions to the chosen gateway
+            if (t % sendInterval == 0 && t > discoveryInterval) {
+                uint32_t chosen = (strategy == MOST_RECENT) ? mostRecent : table.getBestGateway();
+                if (chosen == 0) continue;
+                const SimGatewayLink &link = links[chosen - 0x1000];
+                result.expectedTx += ASCSLinkStats::expectedTransmissions(link.rssi, link.snr, (float)link.hops);
+                result.sends++;
+                if (previous != 0 && chosen != previous) result.switches++;
+                previous = chosen;
+            }
+        }
+    }
+    return result;
+}
+
+static void scenarioGateway() {
+    printf("Gateway selection: 200 sensors, 3 gateways each (random SNR -14..10 dB, 0-3 hops), 24 h\n");
+    printf("%-28s | %-22s | %-20s\n", "strategy", "transmissions / packet", "switches / sensor / day");
+    const char *names[] = {"most recently seen (old)", "link cost, no hysteresis", "link cost, 20% hysteresis"};
+    for (int strategy = MOST_RECENT; strategy <= COST_HYSTERESIS; strategy++) {
+        SelectionResult r = runGatewaySelection((SelectionStrategy)strategy, 42);
+        printf("%-28s | %22.3f | %20.1f\n", names[strategy], r.expectedTx / r.sends, r.switches / 200.0);
+    }
+}
+
+// --- Gateway load balancing ---
+// One 2 x 2 km district with 4 gateways near the corners (the last one advertising twice the
+// capacity) and 400 sensors. Links follow distance; each sensor has heard 5 announcements of
+// every gateway. Then gateway 0 leaves, and later a fifth gateway joins in the middle.
+static const int kBalanceSensors = 400;
+static const float kBalanceAreaM = 2000.0f;
+
+enum BalanceStrategy { BALANCE_COST, BALANCE_MODULO, BALANCE_HASH_UNWEIGHTED, BALANCE_HASH };
+
+struct SimBalanceGateway {
+    uint32_t nodeId;
+    float x, y;
+    uint32_t capacity;
+};
+
+static uint32_t selectBalanced(BalanceStrategy strategy, const ASCSServiceTable &table, uint32_t sensorId) {
+    switch (strategy) {
+        case BALANCE_COST:
+            return table.getBestGateway();
+        case BALANCE_MODULO: {
+            // Naive spreading: sensor ID modulo the number of gateways (sorted by ID)
+            std::vector<uint32_t> ids;
+            table.forEachOfRole(ServiceDiscovery_Role_GATEWAY, [&](const ASCSServiceEntry &e) { ids.push_back(e.nodeId); });
+            if (ids.empty()) return 0;
+            std::sort(ids.begin(), ids.end());
+            return ids[(sensorId * 2654435769u >> 8) % ids.size()];
+        }
+        default:
+            return table.getHashedGateway(sensorId);
+    }
+}
+
+static void scenarioBalance() {
+    printf("Balance: %d sensors, 4 gateways near the corners of a %.0f x %.0f m district (capacity 100, 100, 100, 200).\n",
+           kBalanceSensors, kBalanceAreaM, kBalanceAreaM);
+    printf("Load: share of sensors per gateway; 'worst' = highest load / capacity share. Moved: sensors whose\n");
+    printf("gateway changed although theirs is still there (gateway 0 leaves; a gateway joins in the middle).\n\n");
+    printf("%-24s | %-23s | %-6s | %-9s | %-11s | %-11s | %-9s\n", "strategy", "load gw0/1/2/3 %", "worst", "tx/packet",
+           "moved leave", "moved join", "to new gw");
+
+    std::vector<SimBalanceGateway> gateways = {{0x100, 200, 200, 100}, {0x101, 1800, 250, 100}, {0x102, 300, 1700, 100},
+                                               {0x103, 1750, 1800, 200}, {0x104, 1000, 1000, 100}};
+    const float capacityShare[4] = {0.2f, 0.2f, 0.2f, 0.4f};
+    const char *names[] = {"link cost (default)", "ID modulo gateways", "hash, unweighted", "hash, capacity-weighted"};
+
+    for (int strategy = BALANCE_COST; strategy <= BALANCE_HASH; strategy++) {
+        std::mt19937 rng(11);
+        std::uniform_real_distribution<float> pos(0.0f, kBalanceAreaM);
+        std::normal_distribution<float> noise(0.0f, 1.0f);
+        int load[4] = {0, 0, 0, 0};
+        int movedLeave = 0, movedJoin = 0, toNew = 0;
+        double expectedTx = 0;
+
+        for (int s = 0; s < kBalanceSensors; s++) {
+            uint32_t sensorId = 0x2000 + s * 7919; // Spread-out IDs, as real node numbers
+            float x = pos(rng), y = pos(rng);
+            ASCSServiceTable table(16);
+            auto hear = [&](const SimBalanceGateway &g) {
+                float d = std::hypot(x - g.x, y - g.y);
+                float snr = 12.0f - 30.0f * d / 2000.0f; // About -18 dB at the far corner
+                for (int k = 0; k < 5; k++) {
+                    ASCSLinkSample sample;
+                    sample.snr = snr + 2.5f * noise(rng);
+                    sample.rssi = (int32_t)lroundf(-118.0f + 2.0f * (snr + 10.0f) + 3.0f * noise(rng));
+                    sample.hops = 0;
+                    table.update(g.nodeId, ServiceDiscovery_Role_GATEWAY, 1, k * 1000, &sample);
+                }
+                table.setCapacity(g.nodeId, strategy == BALANCE_HASH ? g.capacity : 0);
+            };
+            for (int g = 0; g < 4; g++) hear(gateways[g]);
+
+            uint32_t chosen = selectBalanced((BalanceStrategy)strategy, table, sensorId);
+            const SimBalanceGateway &gw = gateways[chosen - 0x100];
+            float d = std::hypot(x - gw.x, y - gw.y);
+            float snr = 12.0f - 30.0f * d / 2000.0f;
+            expectedTx += ASCSLinkStats::expectedTransmissions(-118.0f + 2.0f * (snr + 10.0f), snr, 0);
+            load[chosen - 0x100]++;
+
+            table.remove(gateways[0].nodeId);
+            uint32_t afterLeave = selectBalanced((BalanceStrategy)strategy, table, sensorId);
+            if (chosen != gateways[0].nodeId && afterLeave != chosen) movedLeave++;
+
+            hear(gateways[4]);
+            uint32_t afterJoin = selectBalanced((BalanceStrategy)strategy, table, sensorId);
+            if (afterJoin == gateways[4].nodeId) toNew++;
+            else if (afterJoin != afterLeave) movedJoin++; // Moving to the new one is expected, between old ones not
+        }
+
+        float worst = 0;
+        char loads[64];
+        snprintf(loads, sizeof(loads), "%.0f / %.0f / %.0f / %.0f", 100.0 * load[0] / kBalanceSensors, 100.0 * load[1] / kBalanceSensors,
+                 100.0 * load[2] / kBalanceSensors, 100.0 * load[3] / kBalanceSensors);
+        for (int g = 0; g < 4; g++) worst = std::max(worst, (float)load[g] / kBalanceSensors / capacityShare[g]);
+        printf("%-24s | %23s | %5.2fx | %9.2f | %10.1f%% | %10.1f%% | %8.1f%%\n", names[strategy], loads, worst,
+               expectedTx / kBalanceSensors, 100.0 * movedLeave / kBalanceSensors, 100.0 * movedJoin / kBalanceSensors,
+               100.0 * toNew / kBalanceSensors);
+    }
+}
+
+// --- Discovery announcements ---
+
+// Single-hop model: a broadcast reaches every live node within range unless another transmission
+// audible at the receiver overlaps it (or the receiver is transmitting). Meshtastic's flood
+// relaying multiplies the airtime of every announcement by the same factor for both strategies.
+static const int kMeshNodes = 300;
+static const int kMeshGateways = 8;
+static const int kMeshAggregators = 30;
+static const int kMeshServices = 3;              // Service IDs, assigned at random
+static const float kMeshAreaM = 4000.0f;         // Square side (about 55 neighbours per node)
+static const float kSparseMeshAreaM = 8000.0f;   // About 14 neighbours per node
+static const float kMeshRangeM = 1000.0f;
+static const float kMeshLoss = 0.05f;            // Random loss of a non-colliding packet
+static const unsigned long kAirtimeMs = 477;     // ~30 byte discovery packet, LongFast (SF11, BW 250 kHz, CR 4/5)
+static const unsigned long kDataAirtimeMs = 682; // ~60 byte SensorData packet
+static const unsigned long kPiggybackAirtimeMs = 41; // +4 bytes of sender role/service ID (one more symbol block)
+static const unsigned long kSensorReportMs = 120000;
+static const unsigned long kTickMs = 100;
+static const unsigned long kDiscoveryMinMs = 30000;   // Defaults from ASCSConfig.h
+static const unsigned long kDiscoveryMaxMs = 300000;
+static const uint32_t kDiscoveryRedundancy = 3;
+static const unsigned long kServiceTimeoutMs = 900000;
+
+struct SimMeshNode {
+    uint32_t id;
+    float x, y;
+    ServiceDiscovery_Role role;
+    uint32_t serviceId;
+    bool alive = false;
+    unsigned long bootAt = 0;
+    unsigned long nextFixed = 0;      // Fixed-interval strategy: next announcement
+    unsigned long nextData = 0;
+    unsigned long lastCleanup = 0;
+    std::vector<int> neighbours;
+    ASCSServiceTable table{64};
+    ASCSTrickleTimer timer;
+    ASCSDiscoveryReplies replies;     // 'query' scenario
+    bool queryActive = false;
+    unsigned long lastQuery = 0;
+    unsigned long queryDelay = 0;
+    int queriesLeft = 0;
+    std::vector<uint8_t> snapshot;    // Service table snapshot "in NVS"
+    uint32_t snapshotSignature = 0;
+    unsigned long lastSnapshotCheck = 0;
+};
+
+struct SimTransmission {
+    int sender;
+    unsigned long start;
+    unsigned long airtime;
+    int dest;          // Receiving node, -1 for broadcast
+    bool senderInfo;   // Carries the sender's role and service ID
+    bool isData = false;
+    bool isQuery = false;
+};
+
+struct DiscoveryOptions {
+    bool trickle;
+    unsigned long minIntervalMs;
+    uint32_t redundancy;
+    unsigned long maxSilenceMs;
+    unsigned long dataIntervalMs = 0; // Sensor data traffic (0 = none)
+    bool piggyback = false;           // Sender role/service ID on SensorData
+    float areaM = kMeshAreaM;
+};
+
+struct DiscoveryResult {
+    unsigned long announcements = 0;
+    unsigned long bootAnnouncements = 0;     // First 10 minutes
+    unsigned long bootReceptions = 0, bootCollisions = 0;
+    double convergedAfterS = -1;             // Every node knows every gateway in range
+    double newGatewayKnownAfterS = -1;       // All neighbours of the gateway added at 18 h know it
+    unsigned long falseExpiries = 0;         // Live nodes timed out of a neighbour's table
+    unsigned long falseRouteExpiries = 0;    // ... of which gateways and aggregators
+    unsigned long falseSensorExpiries = 0;   // ... sensors timed out at a gateway
+    unsigned long dataPackets = 0;
+    double failedGatewayDroppedAfterS = -1;  // No node lists the gateway that failed at 12 h any more
+};
+
+static DiscoveryResult runDiscovery(const DiscoveryOptions &opt, uint32_t seed) {
+    const unsigned long duration = 24UL * 3600 * 1000;
+    const unsigned long gatewayFailsAt = 12UL * 3600 * 1000;
+    const unsigned long gatewayJoinsAt = 18UL * 3600 * 1000;
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> pos(0.0f, opt.areaM);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_int_distribution<uint32_t> service(1, kMeshServices);
+    std::uniform_int_distribution<unsigned long> bootJitter(0, 2000 / kTickMs - 1);
+    std::uniform_int_distribution<unsigned long> loopJitter(0, 1000 / kTickMs);
+    std::uniform_int_distribution<unsigned long> wifiConnect(3000 / kTickMs, 8000 / kTickMs);
+    std::uniform_int_distribution<unsigned long> dataPhase(0, (opt.dataIntervalMs ? opt.dataIntervalMs : 1000) / kTickMs - 1);
+
+    // Nodes 0..kMeshGateways-1 are gateways, then aggregators, then sensors. The extra last
+    // node is a gateway that joins late.
+    std::vector<SimMeshNode> nodes(kMeshNodes + 1);
+    for (int i = 0; i <= kMeshNodes; i++) {
+        SimMeshNode &n = nodes[i];
+        n.id = 0x1000 + i;
+        n.x = pos(rng);
+        n.y = pos(rng);
+        n.role = (i < kMeshGateways || i == kMeshNodes) ? ServiceDiscovery_Role_GATEWAY
+               : (i < kMeshGateways + kMeshAggregators) ? ServiceDiscovery_Role_AGGREGATOR : ServiceDiscovery_Role_SENSOR;
+        n.serviceId = service(rng);
+        n.alive = (i < kMeshNodes);
+        n.bootAt = (i < kMeshNodes) ? bootJitter(rng) * kTickMs : gatewayJoinsAt; // Power restore: all within 2 s
+        if (n.role == ServiceDiscovery_Role_GATEWAY && i < kMeshNodes) n.bootAt += wifiConnect(rng) * kTickMs; // init() connects WiFi first
+        n.timer.configure(opt.minIntervalMs, kDiscoveryMaxMs, opt.redundancy, opt.maxSilenceMs);
+        n.timer.seed(n.id);
+    }
+    for (int i = 0; i <= kMeshNodes; i++) {
+        for (int j = 0; j <= kMeshNodes; j++) {
+            if (i != j && std::hypot(nodes[i].x - nodes[j].x, nodes[i].y - nodes[j].y) <= kMeshRangeM) nodes[i].neighbours.push_back(j);
+        }
+    }
+
+    DiscoveryResult result;
+    std::vector<SimTransmission> onAir;  // Transmissions not yet delivered (plus recent ones for overlap checks)
+    std::vector<bool> started(kMeshNodes + 1, false);
+
+    auto audibleOverlap = [&](int receiver, const SimTransmission &tx) {
+        for (const SimTransmission &other : onAir) {
+            if (other.sender == tx.sender) continue;
+            if (other.start >= tx.start + tx.airtime || tx.start >= other.start + other.airtime) continue;
+            if (other.sender == receiver) return true; // Half duplex
+            const std::vector<int> &nb = nodes[receiver].neighbours;
+            if (std::find(nb.begin(), nb.end(), other.sender) != nb.end()) return true;
+        }
+        return false;
+    };
+
+    auto allGatewaysKnown = [&]() {
+        for (const SimMeshNode &n : nodes) {
+            if (!n.alive) continue;
+            for (int j : n.neighbours) {
+                if (nodes[j].alive && nodes[j].role == ServiceDiscovery_Role_GATEWAY && !n.table.find(nodes[j].id)) return false;
+            }
+        }
+        return true;
+    };
+
+    for (unsigned long t = 0; t < duration; t += kTickMs) {
+        // --- Topology events ---
+        if (t == gatewayFailsAt) nodes[0].alive = false;
+        if (t == gatewayJoinsAt) nodes[kMeshNodes].alive = true;
+
+        // --- Announcements due ---
+        for (int i = 0; i <= kMeshNodes; i++) {
+            SimMeshNode &n = nodes[i];
+            if (!n.alive || t < n.bootAt) continue;
+            if (!started[i]) {
+                started[i] = true;
+                n.lastCleanup = t;
+                n.timer.start(t);
+                n.nextFixed = t; // Old behaviour: announce from init()
+                if (opt.dataIntervalMs) n.nextData = t + dataPhase(rng) * kTickMs;
+            }
+
+            // Sensor data to the best gateway (broadcast if none is known)
+            if (opt.dataIntervalMs && n.role == ServiceDiscovery_Role_SENSOR && t >= n.nextData) {
+                n.nextData = t + opt.dataIntervalMs;
+                uint32_t gateway = n.table.getBestGateway();
+                int dest = gateway ? (int)(gateway - 0x1000) : -1;
+                onAir.push_back({i, t, kDataAirtimeMs + (opt.piggyback ? kPiggybackAirtimeMs : 0), dest, opt.piggyback, true});
+                result.dataPackets++;
+                if (opt.piggyback) n.timer.noteAnnounced(t); // Sensor: any send counts (noteAnnouncedTraffic())
+            }
+
+            bool send;
+            if (opt.trickle) {
+                send = n.timer.poll(t);
+            } else {
+                send = t >= n.nextFixed;
+                if (send) n.nextFixed = t + kDiscoveryMaxMs + loopJitter(rng) * kTickMs; // loop() latency drifts the phase
+            }
+            if (send) {
+                onAir.push_back({i, t, kAirtimeMs, -1, true});
+                result.announcements++;
+                if (t < 600000) result.bootAnnouncements++;
+            }
+        }
+
+        // --- Deliver transmissions that have finished ---
+        for (const SimTransmission &tx : onAir) {
+            if (tx.start + tx.airtime > t || tx.start + tx.airtime <= t - kTickMs) continue; // Finishes in this tick only
+            const SimMeshNode &sender = nodes[tx.sender];
+            for (int r : sender.neighbours) {
+                SimMeshNode &rx = nodes[r];
+                if (!rx.alive || !started[r]) continue;
+                if (tx.dest >= 0 && tx.dest != r) continue; // Unicast: other nodes do not process it
+                bool collided = audibleOverlap(r, tx);
+                if (tx.start < 600000) {
+                    result.bootReceptions++;
+                    if (collided) result.bootCollisions++;
+                }
+                if (collided || unit(rng) < kMeshLoss) continue;
+                if (!tx.senderInfo) continue; // Data without sender info: old receivers ignore it for discovery
+
+                // Same classification as AkitaSmartCityServices::handleServiceInfo()
+                const ASCSServiceEntry *known = rx.table.find(sender.id);
+                bool changed = !known || known->role != sender.role || known->serviceId != sender.serviceId;
+                bool relevant = ASCSServiceTable::isRoutingRole(sender.role) || (known && ASCSServiceTable::isRoutingRole(known->role));
+                rx.table.update(sender.id, sender.role, sender.serviceId, t);
+                if (changed && relevant) rx.timer.reset(t);
+                else if (sender.role == rx.role && sender.serviceId == rx.serviceId) rx.timer.hearConsistent();
+            }
+        }
+        onAir.erase(std::remove_if(onAir.begin(), onAir.end(),
+                                   [t](const SimTransmission &tx) { return tx.start + tx.airtime + kDataAirtimeMs + kPiggybackAirtimeMs <= t; }),
+                    onAir.end());
+
+        // --- Service table cleanup (every half timeout, as in the plugin) ---
+        for (int i = 0; i <= kMeshNodes; i++) {
+            SimMeshNode &n = nodes[i];
+            if (!n.alive || !started[i] || t - n.lastCleanup < kServiceTimeoutMs / 2) continue;
+            n.lastCleanup = t;
+            bool lostRoute = false;
+            n.table.expire(t, kServiceTimeoutMs, [&](const ASCSServiceEntry &entry) {
+                if (nodes[entry.nodeId - 0x1000].alive) {
+                    result.falseExpiries++;
+                    if (ASCSServiceTable::isRoutingRole(entry.role)) result.falseRouteExpiries++;
+                    if (entry.role == ServiceDiscovery_Role_SENSOR && n.role == ServiceDiscovery_Role_GATEWAY) result.falseSensorExpiries++;
+                }
+                if (ASCSServiceTable::isRoutingRole(entry.role)) lostRoute = true;
+            });
+            if (lostRoute) n.timer.reset(t);
+        }
+
+        // --- Convergence checks (every 10 s) ---
+        if (t % 10000 == 0) {
+            if (result.convergedAfterS < 0 && t < gatewayFailsAt && allGatewaysKnown()) result.convergedAfterS = t / 1000.0;
+            if (result.failedGatewayDroppedAfterS < 0 && t >= gatewayFailsAt) {
+                bool listed = false;
+                for (const SimMeshNode &n : nodes) {
+                    if (n.alive && n.table.find(nodes[0].id)) listed = true;
+                }
+                if (!listed) result.failedGatewayDroppedAfterS = (t - gatewayFailsAt) / 1000.0;
+            }
+            if (result.newGatewayKnownAfterS < 0 && t >= gatewayJoinsAt) {
+                const SimMeshNode &gw = nodes[kMeshNodes];
+                bool known = true;
+                for (int j : gw.neighbours) {
+                    if (nodes[j].alive && !nodes[j].table.find(gw.id)) known = false;
+                }
+                if (known) result.newGatewayKnownAfterS = (t - gatewayJoinsAt) / 1000.0;
+            }
+        }
+    }
+    return result;
+}
+
+static void scenarioDiscovery() {
+    printf("Discovery: %d nodes (%d gateways, %d aggregators) in %.0f x %.0f m, range %.0f m, all powered up within 2 s.\n",
+           kMeshNodes, kMeshGateways, kMeshAggregators, kMeshAreaM, kMeshAreaM, kMeshRangeM);
+    printf("Gateway 0 fails at 12 h, a new gateway joins at 18 h. 24 h, %lu ms airtime per announcement.\n\n", kAirtimeMs);
+    printf("%-40s | %-11s | %-14s | %-16s | %-15s | %-11s | %-14s\n", "strategy", "announce/day", "airtime h/day",
+           "boot: sent 10min", "boot collisions", "converged s", "new gw known s");
+    DiscoveryOptions runs[] = {
+        {false, 0, 0, 0},
+        {true, 10000, kDiscoveryRedundancy, kServiceTimeoutMs / 3},
+        {true, kDiscoveryMinMs, 0, kServiceTimeoutMs / 3},
+        {true, kDiscoveryMinMs, kDiscoveryRedundancy, kServiceTimeoutMs / 3}};
+    for (const DiscoveryOptions &run : runs) {
+        DiscoveryResult r = runDiscovery(run, 7);
+        char name[96];
+        if (run.trickle) snprintf(name, sizeof(name), "Trickle %lu..%lu s, k=%lu, silence %lu s", run.minIntervalMs / 1000, kDiscoveryMaxMs / 1000, (unsigned long)run.redundancy, run.maxSilenceMs / 1000);
+        else snprintf(name, sizeof(name), "fixed %lu s, announce at boot (old)", kDiscoveryMaxMs / 1000);
+        printf("%-40s | %12lu | %14.2f | %16lu | %14.1f%% | %11.0f | %14.0f\n", name,
+               r.announcements, r.announcements * kAirtimeMs / 3600000.0, r.bootAnnouncements,
+               r.bootReceptions ? 100.0 * r.bootCollisions / r.bootReceptions : 0.0, r.convergedAfterS, r.newGatewayKnownAfterS);
+        if (r.falseExpiries) printf("  (live nodes timed out of a neighbour's table: %lu, of which gateways/aggregators: %lu)\n", r.falseExpiries, r.falseRouteExpiries);
+    }
+}
+
+static void scenarioPiggyback() {
+    printf("Piggyback: %d nodes (%d gateways, %d aggregators) in %.0f x %.0f m, range %.0f m, failures as in 'discovery'.\n",
+           kMeshNodes, kMeshGateways, kMeshAggregators, kSparseMeshAreaM, kSparseMeshAreaM, kMeshRangeM);
+    printf("Sensors report every %lu s to their gateway (broadcast if none known).\n", kSensorReportMs / 1000);
+    printf("Data %lu ms airtime (+%lu ms with sender info). 24 h.\n\n", kDataAirtimeMs, kPiggybackAirtimeMs);
+    printf("%-30s | %-10s | %-10s | %-13s | %-13s | %-15s | %-15s | %-14s\n", "strategy", "disc/node/h", "pkts/node/h",
+           "airtime h/day", "gw/agg false", "sensor@gw false", "failed gw gone s", "new gw known s");
+    struct { const char *name; DiscoveryOptions opt; } runs[] = {
+        {"fixed 300 s (old)", {false, 0, 0, 0, kSensorReportMs, false, kSparseMeshAreaM}},
+        {"Trickle", {true, kDiscoveryMinMs, kDiscoveryRedundancy, kServiceTimeoutMs / 3, kSensorReportMs, false, kSparseMeshAreaM}},
+        {"Trickle + piggyback", {true, kDiscoveryMinMs, kDiscoveryRedundancy, kServiceTimeoutMs / 3, kSensorReportMs, true, kSparseMeshAreaM}}};
+    const double nodeHours = kMeshNodes * 24.0;
+    for (const auto &run : runs) {
+        DiscoveryResult r = runDiscovery(run.opt, 7);
+        double airtime = r.announcements * kAirtimeMs + r.dataPackets * (kDataAirtimeMs + (run.opt.piggyback ? kPiggybackAirtimeMs : 0));
+        printf("%-30s | %11.2f | %11.2f | %13.2f | %13lu | %15lu | %16.0f | %14.0f\n", run.name,
+               r.announcements / nodeHours, (r.announcements + r.dataPackets) / nodeHours, airtime / 3600000.0,
+               r.falseRouteExpiries, r.falseSensorExpiries, r.failedGatewayDroppedAfterS, r.newGatewayKnownAfterS);
+    }
+}
+
+// --- Discovery queries ---
+// The 'piggyback' mesh (Trickle + sender info on SensorData). Sensors read every 60 s, the first
+// reading 60 s after boot (as the plugin's loop()). Until a gateway is known a reading is broadcast
+// (flooded by the firmware); the measure is the time until the first one reaches a gateway as unicast.
+// Unlike the scenarios above, nodes listen before talking (as the firmware's contention window):
+// after a power-up, the first readings of all sensors are due within a few seconds.
+static const unsigned long kQueryReadMs = 60000;
+static const int kQueryReboots = 30;
+static const unsigned long kQueryRebootAt = 2UL * 3600 * 1000; // Then one sensor every 20 s
+static const unsigned long kContentionMs = 3000;                 // Max random wait while the channel is busy
+static const uint32_t kQuerySeeds = 5;
+static const unsigned long kQueryDurationMs = kQueryRebootAt + 3600UL * 1000;
+
+struct QueryOptions {
+    bool query;
+    bool overhear; // Firmware passes unicasts for other nodes to the plugin (reply suppression)
+    bool snapshot = false; // Service table restored from the snapshot after a reboot
+};
+
+struct QueryResult {
+    std::vector<double> coldS, rebootS;  // Boot to first unicast reading delivered to a gateway
+    unsigned long coldMissing = 0, rebootMissing = 0;
+    unsigned long broadcastReadings = 0; // Readings broadcast for lack of a gateway, first hour + reboots
+    unsigned long queries = 0, repliesSent = 0, repliesSuppressed = 0;
+    unsigned long snapshotWrites = 0;
+};
+
+static QueryResult runQuery(const QueryOptions &opt, uint32_t seed) {
+    const unsigned long duration = kQueryDurationMs;
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> pos(0.0f, kSparseMeshAreaM);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_int_distribution<uint32_t> service(1, kMeshServices);
+    std::uniform_int_distribution<unsigned long> bootJitter(0, 2000 / kTickMs - 1);
+    std::uniform_int_distribution<unsigned long> wifiConnect(3000 / kTickMs, 8000 / kTickMs);
+    std::uniform_int_distribution<unsigned long> loopJitter(0, 1000 / kTickMs);
+    std::uniform_int_distribution<uint32_t> anyValue;
+
+    std::vector<SimMeshNode> nodes(kMeshNodes);
+    for (int i = 0; i < kMeshNodes; i++) {
+        SimMeshNode &n = nodes[i];
+        n.id = 0x1000 + i;
+        n.x = pos(rng);
+        n.y = pos(rng);
+        n.role = (i < kMeshGateways) ? ServiceDiscovery_Role_GATEWAY
+               : (i < kMeshGateways + kMeshAggregators) ? ServiceDiscovery_Role_AGGREGATOR : ServiceDiscovery_Role_SENSOR;
+        n.serviceId = service(rng);
+        n.alive = true;
+        n.bootAt = bootJitter(rng) * kTickMs;
+        if (n.role == ServiceDiscovery_Role_GATEWAY) n.bootAt += wifiConnect(rng) * kTickMs;
+        n.timer.configure(kDiscoveryMinMs, kDiscoveryMaxMs, kDiscoveryRedundancy, kServiceTimeoutMs / 3);
+        n.timer.seed(n.id);
+    }
+    std::vector<bool> gatewayInRange(kMeshNodes, false);
+    for (int i = 0; i < kMeshNodes; i++) {
+        for (int j = 0; j < kMeshNodes; j++) {
+            if (i == j || std::hypot(nodes[i].x - nodes[j].x, nodes[i].y - nodes[j].y) > kMeshRangeM) continue;
+            nodes[i].neighbours.push_back(j);
+            if (nodes[j].role == ServiceDiscovery_Role_GATEWAY) gatewayInRange[i] = true;
+        }
+    }
+
+    // Sensors that reboot once the mesh is stable
+    std::vector<int> rebootList;
+    for (int i = kMeshGateways + kMeshAggregators; i < kMeshNodes && (int)rebootList.size() < kQueryReboots; i++) {
+        if (gatewayInRange[i]) rebootList.push_back(i);
+    }
+
+    QueryResult result;
+    std::vector<bool> started(kMeshNodes, false), rebooted(kMeshNodes, false), delivered(kMeshNodes, false);
+    std::vector<SimTransmission> onAir;
+    std::vector<std::vector<SimTransmission>> txQueue(kMeshNodes);
+    std::vector<unsigned long> txWaitUntil(kMeshNodes, 0);
+
+    auto audibleOverlap = [&](int receiver, const SimTransmission &tx) {
+        for (const SimTransmission &other : onAir) {
+            if (other.sender == tx.sender) continue;
+            if (other.start >= tx.start + tx.airtime || tx.start >= other.start + other.airtime) continue;
+            if (other.sender == receiver) return true;
+            const std::vector<int> &nb = nodes[receiver].neighbours;
+            if (std::find(nb.begin(), nb.end(), other.sender) != nb.end()) return true;
+        }
+        return false;
+    };
+    auto handleServiceInfo = [&](SimMeshNode &rx, const SimMeshNode &sender, unsigned long t) {
+        const ASCSServiceEntry *known = rx.table.find(sender.id);
+        bool changed = !known || known->role != sender.role || known->serviceId != sender.serviceId;
+        bool relevant = ASCSServiceTable::isRoutingRole(sender.role) || (known && ASCSServiceTable::isRoutingRole(known->role));
+        rx.table.update(sender.id, sender.role, sender.serviceId, t);
+        if (changed && relevant) rx.timer.reset(t);
+        else if (sender.role == rx.role && sender.serviceId == rx.serviceId) rx.timer.hearConsistent();
+    };
+
+    for (unsigned long t = 0; t < duration; t += kTickMs) {
+        // --- Sensor reboots (keep their position, lose their service table) ---
+        if (t >= kQueryRebootAt && (t - kQueryRebootAt) % 20000 == 0) {
+            size_t k = (t - kQueryRebootAt) / 20000;
+            if (k < rebootList.size()) {
+                SimMeshNode &n = nodes[rebootList[k]];
+                n.table.clear();
+                n.replies.clear();
+                txQueue[rebootList[k]].clear();
+                n.queryActive = false;
+                n.bootAt = t + bootJitter(rng) * kTickMs;
+                started[rebootList[k]] = false;
+                rebooted[rebootList[k]] = true;
+                delivered[rebootList[k]] = false;
+            }
+        }
+
+        for (int i = 0; i < kMeshNodes; i++) {
+            SimMeshNode &n = nodes[i];
+            if (t < n.bootAt) continue;
+            if (!started[i]) {
+                started[i] = true;
+                n.lastCleanup = t;
+                n.lastSnapshotCheck = t;
+                n.timer.start(t);
+                n.nextData = t + kQueryReadMs;
+                // AkitaSmartCityServices::restoreServiceTable()
+                if (opt.snapshot && !n.snapshot.empty()) {
+                    ASCSServiceSnapshot::decode(n.snapshot.data(), n.snapshot.size(), n.table, t, kServiceTimeoutMs);
+                }
+                n.snapshotSignature = ASCSServiceSnapshot::signature(n.table);
+            }
+
+            // AkitaSmartCityServices::saveServiceTable()
+            if (opt.snapshot && t - n.lastSnapshotCheck >= ASCS_SERVICE_SNAPSHOT_CHECK_INTERVAL_MS) {
+                n.lastSnapshotCheck = t;
+                uint32_t signature = ASCSServiceSnapshot::signature(n.table);
+                if (signature != n.snapshotSignature) {
+                    n.snapshot.resize(ASCS_SERVICE_SNAPSHOT_MAX_SIZE);
+                    n.snapshot.resize(ASCSServiceSnapshot::encode(n.table, t, n.snapshot.data(), n.snapshot.size()));
+                    n.snapshotSignature = signature;
+                    result.snapshotWrites++;
+                }
+            }
+
+            // Sensor reading: unicast to the best gateway, broadcast if none is known
+            if (n.role == ServiceDiscovery_Role_SENSOR && t >= n.nextData) {
+                n.nextData = t + kQueryReadMs + loopJitter(rng) * kTickMs; // loop() latency drifts the phase
+                uint32_t gateway = n.table.getBestGateway();
+                int dest = gateway ? (int)(gateway - 0x1000) : -1;
+                txQueue[i].push_back({i, t, kDataAirtimeMs + kPiggybackAirtimeMs, dest, true, true});
+                n.timer.noteAnnounced(t);
+                if (dest < 0 && (t < 3600000 || rebooted[i])) result.broadcastReadings++;
+            }
+
+            if (n.timer.poll(t)) txQueue[i].push_back({i, t, kAirtimeMs, -1, true});
+
+            // AkitaSmartCityServices::runDiscoveryQuery()
+            if (opt.query && n.role != ServiceDiscovery_Role_GATEWAY) {
+                if (n.table.getBestGateway() != 0) {
+                    n.queryActive = false;
+                } else if (!n.queryActive) {
+                    n.queryActive = true;
+                    n.lastQuery = t;
+                    n.queriesLeft = ASCS_DISCOVERY_QUERY_MAX_TRIES;
+                    n.queryDelay = anyValue(rng) % ASCS_DISCOVERY_QUERY_JITTER_MS;
+                } else if (n.queriesLeft > 0 && t - n.lastQuery >= n.queryDelay) {
+                    txQueue[i].push_back({i, t, kAirtimeMs, -1, true, false, true});
+                    n.timer.noteAnnounced(t);
+                    result.queries++;
+                    n.queriesLeft--;
+                    n.lastQuery = t;
+                    n.queryDelay = (unsigned long)ASCS_DISCOVERY_QUERY_RETRY_MS << (ASCS_DISCOVERY_QUERY_MAX_TRIES - 1 - n.queriesLeft);
+                }
+            }
+
+            uint32_t querier;
+            while (n.replies.popDue(t, querier)) txQueue[i].push_back({i, t, kAirtimeMs, (int)(querier - 0x1000), true});
+
+            // Listen before talk: wait a random time while a neighbour is transmitting
+            if (txQueue[i].empty() || t < txWaitUntil[i]) continue;
+            bool busy = false;
+            for (const SimTransmission &other : onAir) {
+                if (other.start + other.airtime <= t) continue;
+                if (other.sender == i) busy = true;
+                const std::vector<int> &nb = n.neighbours;
+                if (std::find(nb.begin(), nb.end(), other.sender) != nb.end()) busy = true;
+            }
+            if (busy) {
+                txWaitUntil[i] = t + (anyValue(rng) % (kContentionMs / kTickMs) + 1) * kTickMs;
+                continue;
+            }
+            SimTransmission tx = txQueue[i].front();
+            txQueue[i].erase(txQueue[i].begin());
+            tx.start = t;
+            onAir.push_back(tx);
+        }
+
+        // --- Deliver transmissions that have finished ---
+        for (const SimTransmission &tx : onAir) {
+            if (tx.start + tx.airtime > t || tx.start + tx.airtime <= t - kTickMs) continue;
+            const SimMeshNode &sender = nodes[tx.sender];
+            for (int r : sender.neighbours) {
+                SimMeshNode &rx = nodes[r];
+                if (!started[r] || tx.start < rx.bootAt) continue; // Not listening yet (or sent before a reboot)
+                bool forOther = tx.dest >= 0 && tx.dest != r;
+                if (forOther && (tx.isData || !opt.overhear)) continue;
+                if (audibleOverlap(r, tx) || unit(rng) < kMeshLoss) continue;
+
+                handleServiceInfo(rx, sender, t);
+                if (tx.isData) {
+                    if (tx.dest == r && rx.role == ServiceDiscovery_Role_GATEWAY && !delivered[tx.sender] && tx.start >= sender.bootAt) {
+                        delivered[tx.sender] = true;
+                        double s = (t - sender.bootAt) / 1000.0;
+                        (rebooted[tx.sender] ? result.rebootS : result.coldS).push_back(s);
+                    }
+                } else if (tx.isQuery) {
+                    // Aggregators carry no routes in this mesh; their replies are in the 'chain' scenario
+                    if (rx.role == ServiceDiscovery_Role_GATEWAY) {
+                        rx.replies.schedule(sender.id, t, ASCSDiscoveryReplies::replyDelayMs(1.0f, anyValue(rng)));
+                    }
+                } else if (forOther && rx.role == ServiceDiscovery_Role_GATEWAY && sender.role == ServiceDiscovery_Role_GATEWAY) {
+                    rx.replies.overheard(nodes[tx.dest].id);
+                }
+            }
+        }
+        onAir.erase(std::remove_if(onAir.begin(), onAir.end(),
+                                   [t](const SimTransmission &tx) { return tx.start + tx.airtime + kDataAirtimeMs + kPiggybackAirtimeMs <= t; }),
+                    onAir.end());
+
+        for (int i = 0; i < kMeshNodes; i++) {
+            SimMeshNode &n = nodes[i];
+            if (!started[i] || t - n.lastCleanup < kServiceTimeoutMs / 2) continue;
+            n.lastCleanup = t;
+            bool lostRoute = false;
+            n.table.expire(t, kServiceTimeoutMs, [&](const ASCSServiceEntry &entry) {
+                if (ASCSServiceTable::isRoutingRole(entry.role)) lostRoute = true;
+            });
+            if (lostRoute) n.timer.reset(t);
+        }
+    }
+
+    for (int i = kMeshGateways + kMeshAggregators; i < kMeshNodes; i++) {
+        if (!gatewayInRange[i] || delivered[i]) continue;
+        if (rebooted[i]) result.rebootMissing++;
+        else result.coldMissing++;
+    }
+    for (const SimMeshNode &n : nodes) {
+        result.repliesSent += n.replies.getStats().sent;
+        result.repliesSuppressed += n.replies.getStats().suppressed;
+    }
+    return result;
+}
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return -1;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, (size_t)(p * (values.size() - 1) + 0.5))];
+}
+
+static void scenarioQuery() {
+    printf("Query: %d nodes (%d gateways, %d aggregators) in %.0f x %.0f m, range %.0f m, Trickle + piggyback.\n",
+           kMeshNodes, kMeshGateways, kMeshAggregators, kSparseMeshAreaM, kSparseMeshAreaM, kMeshRangeM);
+    printf("All nodes power up within 2 s; from 2 h on, %d sensors reboot one by one (20 s apart). %lu meshes.\n",
+           kQueryReboots, (unsigned long)kQuerySeeds);
+    printf("Time from boot to the first reading delivered to a gateway as unicast (sensors with a gateway in range).\n");
+    printf("A reboot takes up to 2 s; with 'snapshot' the rebooted sensor restores its service table from NVS.\n\n");
+    printf("%-34s | %-15s | %-15s | %-13s | %-7s | %-13s | %-10s\n", "strategy", "cold med/p95 s", "reboot med/p95 s",
+           "not delivered", "queries", "replies sent", "suppressed");
+    struct { const char *name; QueryOptions opt; } runs[] = {
+        {"no query", {false, false}},
+        {"query", {true, false}},
+        {"query, replies overheard", {true, true}},
+        {"snapshot", {false, false, true}},
+        {"snapshot + query", {true, false, true}}};
+    for (const auto &run : runs) {
+        QueryResult r; // Pooled over a few meshes: 30 reboots per mesh are too few for a stable p95
+        for (uint32_t seed = 1; seed <= kQuerySeeds; seed++) {
+            QueryResult one = runQuery(run.opt, seed);
+            r.coldS.insert(r.coldS.end(), one.coldS.begin(), one.coldS.end());
+            r.rebootS.insert(r.rebootS.end(), one.rebootS.begin(), one.rebootS.end());
+            r.coldMissing += one.coldMissing;
+            r.rebootMissing += one.rebootMissing;
+            r.broadcastReadings += one.broadcastReadings;
+            r.queries += one.queries;
+            r.repliesSent += one.repliesSent;
+            r.repliesSuppressed += one.repliesSuppressed;
+            r.snapshotWrites += one.snapshotWrites;
+        }
+        char cold[32], reboot[32], missing[32];
+        snprintf(cold, sizeof(cold), "%.0f / %.0f", percentile(r.coldS, 0.5), percentile(r.coldS, 0.95));
+        snprintf(reboot, sizeof(reboot), "%.0f / %.0f", percentile(r.rebootS, 0.5), percentile(r.rebootS, 0.95));
+        snprintf(missing, sizeof(missing), "%lu + %lu", r.coldMissing, r.rebootMissing);
+        printf("%-34s | %15s | %16s | %13s | %7lu | %13lu | %10lu\n", run.name, cold, reboot, missing,
+               r.queries, r.repliesSent, r.repliesSuppressed);
+        printf("  (readings broadcast for lack of a gateway: %lu", r.broadcastReadings);
+        if (run.opt.snapshot) printf(", snapshot writes per node in %lu h: %.1f", kQueryDurationMs / 3600000, (double)r.snapshotWrites / (kQuerySeeds * kMeshNodes));
+        printf(")\n");
+    }
+}
+
+// --- Multi-tier aggregator routing ---
+// A road with a gateway at each end and a chain of aggregators in between, spaced so that each
+// only hears its two neighbours. Each aggregator serves a few sensors off the road that only hear
+// it. The firmware relays every packet up to its hop limit, so a packet reaches at most
+// kChainHopLimit + 1 radio hops; each radio hop succeeds with the link's delivery probability
+// (the same logistic model as ASCSLinkStats), and a unicast is retried by its sender. Relays away
+// from the destination are not counted. Without aggregator routes (old), an aggregator only
+// forwards to a gateway it has heard; a sensor without a gateway broadcasts. Gateway 0 fails at 6 h.
+// With queries, a node without a route sends discovery queries (as runDiscoveryQuery()); gateways
+// and aggregators with a route answer after ASCSDiscoveryReplies::replyDelayMs() of their link
+// plus route cost, so sensors off the road (which hear only their aggregator) find a path early.
+static const int kChainAggregators = 20;
+static const int kChainSensorsPerAggregator = 3;
+static const float kChainSpacingM = 900.0f;     // Between neighbours on the road (range about 1 km)
+static const float kChainSensorOffsetM = 450.0f; // Sensor to its aggregator; out of range of the others
+static const int kChainHopLimit = 3;             // Firmware default: 3 relays
+static const int kChainTries = 3;                // Sender transmissions of a unicast (want_ack retries)
+static const unsigned long kChainTickMs = 1000;
+static const unsigned long kChainWarmupMs = 3600UL * 1000;   // Delivery measured from here...
+static const unsigned long kChainFailAt = 6UL * 3600 * 1000; // ...to the failure of gateway 0
+static const unsigned long kChainDurationMs = 9UL * 3600 * 1000;
+static const float kChainSwitchHysteresis = ASCS_DEFAULT_GATEWAY_SWITCH_HYSTERESIS;
+static const float kChainRouteChange = 0.25f;    // ASCS_AGGREGATOR_ROUTE_CHANGE
+static const uint32_t kChainMaxRelayHops = 32;   // ASCS_AGGREGATOR_MAX_RELAY_HOPS
+static const uint32_t kChainSeeds = 5;
+
+struct SimChainNode {
+    uint32_t id;
+    ServiceDiscovery_Role role;
+    int pos;                    // Position on the road; sensors: their aggregator's
+    bool alive = true;
+    unsigned long bootAt = 0;
+    ASCSServiceTable table{48};
+    ASCSTrickleTimer timer;
+    unsigned long lastCleanup = 0;
+    unsigned long nextData = 0;
+    uint32_t sequence = 0;
+    uint32_t nextHop = 0;       // Current next hop (hysteresis)
+    uint32_t routeNextHop = 0;  // Aggregators: route as last advertised
+    float routeCost = 0;
+    ASCSDiscoveryReplies replies; // With queries
+    bool queryActive = false;
+    unsigned long lastQuery = 0;
+    unsigned long queryDelay = 0;
+    int queriesLeft = 0;
+};
+
+struct ChainResult {
+    unsigned long sent[kChainAggregators / 2 + 1] = {}, delivered[kChainAggregators / 2 + 1] = {}; // Steady state, by depth
+    unsigned long transmissions = 0, deliveredTotal = 0;  // Steady state: radio transmissions of data
+    std::vector<double> convergedS;                       // Boot to first delivered reading, per sensor
+    unsigned long neverDelivered = 0;
+    unsigned long sentAfterFail = 0, deliveredAfterFail = 0;
+    std::vector<double> rerouteS;                         // Sensors that used gateway 0: failure to next delivery
+    unsigned long notRerouted = 0;
+    unsigned long ttlDrops = 0, noRouteDrops = 0, routeChanges = 0, announcements = 0;
+    unsigned long queries = 0, gatewayReplies = 0, aggregatorReplies = 0;
+};
+
+static float chainSnr(float distanceM) { return 10.0f - 25.0f * distanceM / 1000.0f; }
+static float chainRssi(float distanceM) { return -60.0f - 60.0f * distanceM / 1000.0f; }
+static float chainDelivery(float distanceM) {
+    return 1.0f / ASCSLinkStats::expectedTransmissions(chainRssi(distanceM), chainSnr(distanceM), 0);
+}
+
+// Same choice as AkitaSmartCityServices::findRouteNextHop() ('gw_select' = "cost").
+static uint32_t chainNextHop(SimChainNode &n, bool routing, float &cost) {
+    uint32_t next = n.table.getBestGateway();
+    if (next) cost = n.table.find(next)->link.cost;
+    if (!routing) return next;
+    float viaCost = 0;
+    uint32_t via = n.table.getBestAggregatorRoute(n.id, viaCost);
+    if (via && (next == 0 || viaCost < cost)) {
+        next = via;
+        cost = viaCost;
+    }
+    const ASCSServiceEntry *current = (next != n.nextHop && n.nextHop != 0) ? n.table.find(n.nextHop) : nullptr;
+    bool betweenGateways = current && current->role == ServiceDiscovery_Role_GATEWAY && next != via;
+    float currentCost;
+    if (current && !betweenGateways && n.table.getRouteCost(n.nextHop, n.id, currentCost) &&
+        cost >= currentCost * (1.0f - kChainSwitchHysteresis)) {
+        next = n.nextHop;
+        cost = currentCost;
+    }
+    n.nextHop = next;
+    return next;
+}
+
+static ChainResult runChain(bool routing, bool query, uint32_t seed) {
+    const int backbone = kChainAggregators + 2; // Gateway 0, aggregators, gateway 1
+    const int sensors = kChainAggregators * kChainSensorsPerAggregator;
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    std::uniform_int_distribution<unsigned long> bootJitter(0, 2);
+    std::uniform_int_distribution<unsigned long> dataPhase(0, kSensorReportMs / kChainTickMs - 1);
+    std::uniform_int_distribution<uint32_t> anyValue;
+    const float backboneDelivery = chainDelivery(kChainSpacingM);
+    const float sensorDelivery = chainDelivery(kChainSensorOffsetM);
+
+    std::vector<SimChainNode> nodes(backbone + sensors);
+    for (int i = 0; i < (int)nodes.size(); i++) {
+        SimChainNode &n = nodes[i];
+        n.id = 0x3000 + i;
+        if (i < backbone) {
+            n.pos = i;
+            n.role = (i == 0 || i == backbone - 1) ? ServiceDiscovery_Role_GATEWAY : ServiceDiscovery_Role_AGGREGATOR;
+        } else {
+            n.pos = 1 + (i - backbone) / kChainSensorsPerAggregator;
+            n.role = ServiceDiscovery_Role_SENSOR;
+        }
+        n.bootAt = bootJitter(rng) * kChainTickMs;
+        n.nextData = n.bootAt + dataPhase(rng) * kChainTickMs;
+        n.lastCleanup = n.bootAt;
+        n.timer.configure(kDiscoveryMinMs, kDiscoveryMaxMs, kDiscoveryRedundancy, kServiceTimeoutMs / 3);
+        n.timer.seed(n.id);
+        n.table.setSwitchHysteresis(kChainSwitchHysteresis);
+    }
+    auto sensorsOf = [&](int pos) { return backbone + (pos - 1) * kChainSensorsPerAggregator; };
+
+    ChainResult result;
+    std::vector<double> firstDelivery(sensors, -1), rerouted(sensors, -1);
+    std::vector<bool> usedGateway0(sensors, false);
+    std::vector<uint32_t> lastDelivered(sensors, 0);
+
+    auto checkRoute = [&](SimChainNode &n, unsigned long t) {
+        if (!routing || n.role != ServiceDiscovery_Role_AGGREGATOR) return;
+        float cost = 0;
+        uint32_t next = chainNextHop(n, true, cost);
+        if (!next) cost = 0;
+        if (next != n.routeNextHop || std::fabs(cost - n.routeCost) > n.routeCost * kChainRouteChange) {
+            n.routeNextHop = next;
+            n.routeCost = cost;
+            n.timer.reset(t);
+            result.routeChanges++;
+        }
+    };
+
+    // Same handling as AkitaSmartCityServices::handleServiceDiscovery()/handleServiceInfo()
+    auto hearAnnouncement = [&](SimChainNode &rx, const SimChainNode &sender, int hops, float lastHopM,
+                                float routeCost, uint32_t routeVia, unsigned long t) {
+        ASCSLinkSample sample;
+        sample.snr = chainSnr(lastHopM) + 2.0f * noise(rng);
+        sample.rssi = (int32_t)lroundf(chainRssi(lastHopM) + 3.0f * noise(rng));
+        sample.hops = (int8_t)hops;
+        const ASCSServiceEntry *known = rx.table.find(sender.id);
+        bool changed = !known || known->role != sender.role;
+        rx.table.update(sender.id, sender.role, 1, t, &sample);
+        if (routing && sender.role == ServiceDiscovery_Role_AGGREGATOR) rx.table.setRoute(sender.id, routeCost, routeVia);
+        if (changed) rx.timer.reset(t);
+        else if (sender.role == rx.role) rx.timer.hearConsistent();
+        checkRoute(rx, t);
+    };
+
+    // Broadcast from a road node, relayed along the road up to the hop limit
+    auto announce = [&](int u, unsigned long t) {
+        SimChainNode &n = nodes[u];
+        float routeCost = 0;
+        uint32_t routeVia = 0;
+        if (routing && n.role == ServiceDiscovery_Role_AGGREGATOR) {
+            routeVia = chainNextHop(n, true, routeCost);
+            if (!routeVia) routeCost = 0;
+            n.routeNextHop = routeVia;
+            n.routeCost = routeCost;
+        }
+        result.announcements++;
+        auto reachSensors = [&](int pos, int hops) {
+            if (nodes[pos].role != ServiceDiscovery_Role_AGGREGATOR) return;
+            for (int s = sensorsOf(pos); s < sensorsOf(pos) + kChainSensorsPerAggregator; s++) {
+                if (nodes[s].alive && t >= nodes[s].bootAt && unit(rng) < sensorDelivery) {
+                    hearAnnouncement(nodes[s], n, hops, kChainSensorOffsetM, routeCost, routeVia, t);
+                }
+            }
+        };
+        reachSensors(u, 0);
+        for (int dir = -1; dir <= 1; dir += 2) {
+            for (int k = 1; k <= kChainHopLimit + 1; k++) {
+                int p = u + dir * k;
+                if (p < 0 || p >= backbone || !nodes[p].alive || t < nodes[p].bootAt || unit(rng) >= backboneDelivery) break;
+                hearAnnouncement(nodes[p], n, k - 1, kChainSpacingM, routeCost, routeVia, t);
+                if (k <= kChainHopLimit) reachSensors(p, k); // Relayed once more by that node
+            }
+        }
+    };
+
+    // Unicast along the road (retried by the sender); counts radio transmissions
+    auto unicast = [&](const SimChainNode &from, const SimChainNode &to, unsigned long &tx) {
+        bool fromSensor = from.role == ServiceDiscovery_Role_SENSOR;
+        int span = std::abs(from.pos - to.pos);
+        int hops = span + (fromSensor ? 1 : 0);
+        int step = to.pos > from.pos ? 1 : -1;
+        for (int attempt = 0; attempt < kChainTries; attempt++) {
+            bool ok = true;
+            for (int h = 0; h < std::min(hops, kChainHopLimit + 1) && ok; h++) {
+                tx++;
+                bool sensorHop = fromSensor && h == 0;
+                int rxPos = fromSensor ? from.pos + step * (h - 1) + (sensorHop ? 0 : step) : from.pos + step * (h + 1);
+                if (sensorHop) rxPos = from.pos;
+                ok = nodes[rxPos].alive && unit(rng) < (sensorHop ? sensorDelivery : backboneDelivery);
+            }
+            if (ok && hops <= kChainHopLimit + 1) return true;
+        }
+        return false;
+    };
+
+    // A query reached road node r (relays hops): gateways, and aggregators with a route, schedule a
+    // reply as AkitaSmartCityServices::handleServiceDiscovery()
+    auto hearQuery = [&](int r, const SimChainNode &querier, int hops, float lastHopM, unsigned long t) {
+        SimChainNode &rx = nodes[r];
+        float routeCost = 0;
+        if (rx.role == ServiceDiscovery_Role_AGGREGATOR && chainNextHop(rx, true, routeCost) == 0) return;
+        float linkCost = ASCSLinkStats::expectedTransmissions(chainRssi(lastHopM), chainSnr(lastHopM), hops);
+        rx.replies.schedule(querier.id, t, ASCSDiscoveryReplies::replyDelayMs(linkCost + routeCost, anyValue(rng)));
+    };
+
+    // Discovery query broadcast by node u, relayed along the road up to the hop limit
+    auto sendQuery = [&](int u, unsigned long t) {
+        SimChainNode &n = nodes[u];
+        result.queries++;
+        bool fromSensor = n.role == ServiceDiscovery_Role_SENSOR;
+        if (fromSensor && (!nodes[n.pos].alive || unit(rng) >= sensorDelivery)) return;
+        if (fromSensor) hearQuery(n.pos, n, 0, kChainSensorOffsetM, t);
+        for (int dir = -1; dir <= 1; dir += 2) {
+            for (int k = 1; k <= kChainHopLimit + (fromSensor ? 0 : 1); k++) {
+                int p = n.pos + dir * k;
+                if (p < 0 || p >= (int)nodes.size() || p >= backbone || !nodes[p].alive || t < nodes[p].bootAt ||
+                    unit(rng) >= backboneDelivery) break;
+                hearQuery(p, n, fromSensor ? k : k - 1, kChainSpacingM, t);
+            }
+        }
+    };
+
+    // A reply of road node r to 'querier' is due: a unicast discovery carrying r's route
+    auto sendReply = [&](int r, uint32_t querier, unsigned long t) {
+        SimChainNode &n = nodes[r];
+        SimChainNode &q = nodes[querier - 0x3000];
+        float routeCost = 0;
+        uint32_t routeVia = 0;
+        if (n.role == ServiceDiscovery_Role_AGGREGATOR) {
+            routeVia = chainNextHop(n, true, routeCost);
+            if (!routeVia) routeCost = 0;
+            result.aggregatorReplies++;
+        } else {
+            result.gatewayReplies++;
+        }
+        unsigned long tx = 0;
+        bool toSensor = q.role == ServiceDiscovery_Role_SENSOR;
+        if (!q.alive || t < q.bootAt || !unicast(n, q, tx)) return;
+        int relays = std::abs(n.pos - q.pos) - (toSensor ? 0 : 1);
+        hearAnnouncement(q, n, relays, toSensor ? kChainSensorOffsetM : kChainSpacingM, routeCost, routeVia, t);
+    };
+
+    // A road node got a reading: deliver (gateway) or forward (aggregator)
+    auto carry = [&](int r, int sensor, uint32_t sequence, unsigned long t, bool measured, unsigned long &tx) {
+        uint32_t relayHops = 0;
+        while (true) {
+            SimChainNode &n = nodes[r];
+            if (n.role == ServiceDiscovery_Role_GATEWAY) {
+                if (sequence > lastDelivered[sensor]) {
+                    lastDelivered[sensor] = sequence;
+                    if (firstDelivery[sensor] < 0) firstDelivery[sensor] = t / 1000.0;
+                    if (t < kChainFailAt) usedGateway0[sensor] = (r == 0);
+                    else if (rerouted[sensor] < 0) rerouted[sensor] = (t - kChainFailAt) / 1000.0;
+                    if (measured) result.deliveredTotal++;
+                    return true;
+                }
+                return false; // Duplicate (old: several aggregators forward one broadcast)
+            }
+            if (relayHops >= kChainMaxRelayHops) {
+                result.ttlDrops++;
+                return false;
+            }
+            float cost;
+            uint32_t next = chainNextHop(n, routing, cost);
+            if (!next) {
+                result.noRouteDrops++;
+                return false;
+            }
+            int nextIndex = (int)(next - 0x3000);
+            if (!unicast(n, nodes[nextIndex], tx)) return false;
+            r = nextIndex;
+            relayHops++;
+        }
+    };
+
+    for (unsigned long t = 0; t < kChainDurationMs; t += kChainTickMs) {
+        if (t == kChainFailAt) nodes[0].alive = false;
+
+        for (int i = 0; i < (int)nodes.size(); i++) {
+            SimChainNode &n = nodes[i];
+            if (!n.alive || t < n.bootAt) continue;
+            if (t == n.bootAt) n.timer.start(t);
+
+            if (i < backbone && n.timer.poll(t)) announce(i, t);
+
+            // AkitaSmartCityServices::runDiscoveryQuery() and the replies to other nodes' queries
+            if (query && n.role != ServiceDiscovery_Role_GATEWAY) {
+                float cost;
+                if (chainNextHop(n, routing, cost) != 0) {
+                    n.queryActive = false;
+                } else if (!n.queryActive) {
+                    n.queryActive = true;
+                    n.lastQuery = t;
+                    n.queriesLeft = ASCS_DISCOVERY_QUERY_MAX_TRIES;
+                    n.queryDelay = anyValue(rng) % ASCS_DISCOVERY_QUERY_JITTER_MS;
+                } else if (n.queriesLeft > 0 && t - n.lastQuery >= n.queryDelay) {
+                    sendQuery(i, t);
+                    n.queriesLeft--;
+                    n.lastQuery = t;
+                    n.queryDelay = (unsigned long)ASCS_DISCOVERY_QUERY_RETRY_MS << (ASCS_DISCOVERY_QUERY_MAX_TRIES - 1 - n.queriesLeft);
+                }
+            }
+            uint32_t querier;
+            while (n.replies.popDue(t, querier)) sendReply(i, querier, t);
+
+            // Service table cleanup (every half timeout, as in the plugin)
+            if (t - n.lastCleanup >= kServiceTimeoutMs / 2) {
+                n.lastCleanup = t;
+                bool lostRoute = false;
+                n.table.expire(t, kServiceTimeoutMs, [&](const ASCSServiceEntry &entry) {
+                    if (ASCSServiceTable::isRoutingRole(entry.role)) lostRoute = true;
+                });
+                if (lostRoute) n.timer.reset(t);
+                checkRoute(n, t);
+            }
+
+            // Sensor reading
+            if (n.role != ServiceDiscovery_Role_SENSOR || t < n.nextData) continue;
+            n.nextData = t + kSensorReportMs;
+            int sensor = i - backbone;
+            uint32_t sequence = ++n.sequence;
+            bool measured = t >= kChainWarmupMs && t < kChainFailAt;
+            int depth = std::min(n.pos, backbone - 1 - n.pos);
+            if (measured) result.sent[depth]++;
+            if (t >= kChainFailAt) result.sentAfterFail++;
+            unsigned long before = lastDelivered[sensor];
+            unsigned long tx = 0;
+
+            float cost;
+            uint32_t next = chainNextHop(n, routing, cost);
+            if (next) {
+                int nextIndex = (int)(next - 0x3000);
+                if (unicast(n, nodes[nextIndex], tx)) carry(nextIndex, sensor, sequence, t, measured, tx);
+            } else {
+                // Broadcast, relayed along the road; every aggregator that hears it forwards it
+                tx++;
+                if (nodes[n.pos].alive && unit(rng) < sensorDelivery) {
+                    carry(n.pos, sensor, sequence, t, measured, tx);
+                    for (int dir = -1; dir <= 1; dir += 2) {
+                        for (int k = 1; k <= kChainHopLimit; k++) {
+                            int p = n.pos + dir * k;
+                            tx++; // Relay by the previous node
+                            if (p < 0 || p >= backbone || !nodes[p].alive || unit(rng) >= backboneDelivery) break;
+                            carry(p, sensor, sequence, t, measured, tx);
+                        }
+                    }
+                }
+            }
+            if (lastDelivered[sensor] != before) {
+                if (measured) result.delivered[depth]++;
+                if (t >= kChainFailAt) result.deliveredAfterFail++;
+            }
+            if (measured) result.transmissions += tx;
+        }
+    }
+
+    for (int s = 0; s < sensors; s++) {
+        if (firstDelivery[s] < 0) result.neverDelivered++;
+        else result.convergedS.push_back(firstDelivery[s]);
+        if (!usedGateway0[s]) continue;
+        if (rerouted[s] < 0) result.notRerouted++;
+        else result.rerouteS.push_back(rerouted[s]);
+    }
+    return result;
+}
+
+static void scenarioChain() {
+    printf("Chain: %d aggregators %.0f m apart on a road (range about 1 km), a gateway at each end, %d sensors per aggregator.\n",
+           kChainAggregators, kChainSpacingM, kChainSensorsPerAggregator);
+    printf("Link delivery: %.0f%% between road nodes, %.0f%% sensor to aggregator. Firmware hop limit %d, %d tries per unicast.\n",
+           100.0f * chainDelivery(kChainSpacingM), 100.0f * chainDelivery(kChainSensorOffsetM), kChainHopLimit, kChainTries);
+    printf("Sensors report every %lu s. Gateway 0 fails at %lu h. %lu seeds.\n", kSensorReportMs / 1000,
+           kChainFailAt / 3600000, (unsigned long)kChainSeeds);
+    printf("Delivered by depth (aggregator hops to the nearest gateway), %lu h to %lu h; tx = radio transmissions per delivered reading.\n\n",
+           kChainWarmupMs / 3600000, kChainFailAt / 3600000);
+    printf("%-20s | %-50s | %-5s | %-6s | %-12s | %-14s | %-16s | %-8s\n", "strategy", "delivered % at depth 1 .. 10", "tx",
+           "never", "all seen s", "after failure", "reroute med/max s", "ttl/none");
+    struct { const char *name; bool routing, query; } runs[] = {
+        {"gateway only (old)", false, false},
+        {"aggregator routes", true, false},
+        {"routes + query", true, true}};
+    for (const auto &run : runs) {
+        ChainResult r;
+        for (uint32_t seed = 1; seed <= kChainSeeds; seed++) {
+            ChainResult one = runChain(run.routing, run.query, seed);
+            for (int d = 0; d <= kChainAggregators / 2; d++) {
+                r.sent[d] += one.sent[d];
+                r.delivered[d] += one.delivered[d];
+            }
+            r.transmissions += one.transmissions;
+            r.deliveredTotal += one.deliveredTotal;
+            r.convergedS.insert(r.convergedS.end(), one.convergedS.begin(), one.convergedS.end());
+            r.neverDelivered += one.neverDelivered;
+            r.sentAfterFail += one.sentAfterFail;
+            r.deliveredAfterFail += one.deliveredAfterFail;
+            r.rerouteS.insert(r.rerouteS.end(), one.rerouteS.begin(), one.rerouteS.end());
+            r.notRerouted += one.notRerouted;
+            r.ttlDrops += one.ttlDrops;
+            r.noRouteDrops += one.noRouteDrops;
+            r.routeChanges += one.routeChanges;
+            r.announcements += one.announcements;
+            r.queries += one.queries;
+            r.gatewayReplies += one.gatewayReplies;
+            r.aggregatorReplies += one.aggregatorReplies;
+        }
+        char depths[64] = "", after[32], reroute[32], drops[32];
+        for (int d = 1; d <= kChainAggregators / 2; d++) {
+            char one[8];
+            snprintf(one, sizeof(one), "%4.0f ", r.sent[d] ? 100.0 * r.delivered[d] / r.sent[d] : 0.0);
+            strncat(depths, one, sizeof(depths) - strlen(depths) - 1);
+        }
+        snprintf(after, sizeof(after), "%.1f%%", r.sentAfterFail ? 100.0 * r.deliveredAfterFail / r.sentAfterFail : 0.0);
+        snprintf(reroute, sizeof(reroute), "%.0f / %.0f", percentile(r.rerouteS, 0.5), percentile(r.rerouteS, 1.0));
+        snprintf(drops, sizeof(drops), "%lu / %lu", r.ttlDrops, r.noRouteDrops);
+        printf("%-20s | %-50s | %5.2f | %6lu | %12.0f | %14s | %16s | %8s\n", run.name, depths,
+               r.deliveredTotal ? (double)r.transmissions / r.deliveredTotal : 0.0, r.neverDelivered,
+               percentile(r.convergedS, 1.0), after, reroute, drops);
+        printf("  (sensors that used gateway 0 and never delivered again: %lu; route changes: %lu; announcements per road node and hour: %.1f)\n",
+               r.notRerouted, r.routeChanges, (double)r.announcements / (kChainSeeds * (kChainAggregators + 2) * (kChainDurationMs / 3600000.0)));
+        if (run.query) {
+            printf("  (queries: %lu; replies sent by gateways: %lu, by aggregators: %lu)\n", r.queries, r.gatewayReplies, r.aggregatorReplies);
+        }
+    }
+}
+
+// --- Transmit slots ---
+// One gateway and the sensors around it (all in its range, not all in each other's: hidden
+// nodes). Everything powers up within 2 s (a power restore). Sensors read every 60 s (default
+// read_int); loop() latency delays each reading by up to 1 s. Nodes listen before talking; the
+// gateway loses a packet that overlaps any other transmission (no capture effect).
+static const int kSlotSensors = 30;
+static const float kSlotRadiusM = 1000.0f;
+static const unsigned long kSlotReadMs = 60000;
+static const unsigned long kSlotWidthMs = 2000;  // ASCS_DEFAULT_TX_SLOT_MS
+static const uint32_t kSlotReslotPct = 25;       // ASCS_DEFAULT_GW_RESLOT_PCT
+static const unsigned long kSlotDurationMs = 24UL * 3600 * 1000;
+static const uint32_t kSlotSeeds = 5;
+
+enum SlotMode { SLOT_FREE, SLOT_BOOT, SLOT_UTC, SLOT_UTC_RESLOT };
+
+struct SlotResult {
+    unsigned long sent[3] = {}, delivered[3] = {}; // First 10 min, first hour, hours 1..24
+    unsigned long reslots = 0;
+};
+
+static SlotResult runSlots(SlotMode mode, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_int_distribution<unsigned long> bootJitter(0, 2000 / kTickMs - 1);
+    std::uniform_int_distribution<unsigned long> loopJitter(0, 1000 / kTickMs);
+    std::uniform_int_distribution<int> clockError(-500, 500); // Mesh time: whole seconds, set from a neighbour
+    std::uniform_int_distribution<uint32_t> anyValue;
+    const uint32_t utcEpoch = 1750000000;
+
+    // Node 0 is the gateway at the centre
+    const int count = kSlotSensors + 1;
+    std::vector<float> x(count, 0.0f), y(count, 0.0f);
+    std::vector<unsigned long> bootAt(count), nextRead(count), lastRead(count, 0), waitUntil(count, 0);
+    std::vector<int> clockErrorMs(count);
+    std::vector<bool> pending(count, false);
+    std::vector<uint32_t> sequence(count, 0);
+    std::vector<ASCSTxSlot> slots(count);
+    std::vector<std::vector<bool>> hears(count, std::vector<bool>(count, false));
+    for (int i = 0; i < count; i++) {
+        if (i > 0) {
+            float r = kSlotRadiusM * std::sqrt(unit(rng)), a = 6.2831853f * unit(rng);
+            x[i] = r * std::cos(a);
+            y[i] = r * std::sin(a);
+        }
+        bootAt[i] = bootJitter(rng) * kTickMs;
+        clockErrorMs[i] = clockError(rng);
+        slots[i].configure(0x5000 + i * 7919, 1, kSlotReadMs, mode == SLOT_FREE ? 0 : kSlotWidthMs);
+    }
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < count; j++) hears[i][j] = i != j && std::hypot(x[i] - x[j], y[i] - y[j]) <= kMeshRangeM;
+    }
+    // Node-local clocks: millis() since boot, and the mesh time in whole seconds (0 = not set)
+    auto utcOf = [&](int i, unsigned long t) -> uint32_t {
+        return (mode == SLOT_UTC || mode == SLOT_UTC_RESLOT) ? utcEpoch + (uint32_t)(((long)t + clockErrorMs[i]) / 1000) : 0;
+    };
+    for (int i = 1; i < count; i++) {
+        unsigned long local = 0; // At boot
+        nextRead[i] = bootAt[i] + (slots[i].isEnabled() ? slots[i].nextSlot(local, local, utcOf(i, bootAt[i])) : kSlotReadMs);
+    }
+
+    SlotResult result;
+    ASCSSlotLossMonitor monitor;
+    monitor.configure(mode == SLOT_UTC_RESLOT ? kSlotReslotPct : 0);
+    std::vector<SimTransmission> onAir;
+    std::vector<int> reslotQueue;
+
+    auto window = [](unsigned long t) { return t < 600000 ? 0 : (t < 3600000 ? 1 : 2); };
+    auto count3 = [&](unsigned long *counters, unsigned long t) {
+        int w = window(t);
+        if (w <= 1) counters[0] += (w == 0);
+        if (w <= 1) counters[1]++;
+        else counters[2]++;
+    };
+
+    for (unsigned long t = 0; t < kSlotDurationMs; t += kTickMs) {
+        for (int i = 1; i < count; i++) {
+            if (t < bootAt[i]) continue;
+            unsigned long local = t - bootAt[i];
+            if (t >= nextRead[i]) {
+                // AkitaSmartCityServices::loop(): read, send, schedule the next reading
+                pending[i] = true;
+                sequence[i]++;
+                lastRead[i] = local;
+                unsigned long latency = loopJitter(rng) * kTickMs;
+                if (slots[i].isEnabled()) {
+                    nextRead[i] = bootAt[i] + slots[i].nextSlot(local + kSlotReadMs / 2, local, utcOf(i, t)) + latency;
+                } else {
+                    nextRead[i] = t + kSlotReadMs + latency; // Free-running: latency adds up
+                }
+            }
+        }
+        // Gateway: reslot requests
+        if (!reslotQueue.empty()) pending[0] = true;
+
+        // Listen before talk, then transmit
+        for (int i = 0; i < count; i++) {
+            if (!pending[i] || t < waitUntil[i]) continue;
+            bool busy = false;
+            for (const SimTransmission &other : onAir) {
+                if (other.start + other.airtime > t && (other.sender == i || hears[i][other.sender])) busy = true;
+            }
+            if (busy) {
+                waitUntil[i] = t + (anyValue(rng) % (kContentionMs / kTickMs) + 1) * kTickMs;
+                continue;
+            }
+            pending[i] = false;
+            if (i == 0) {
+                int dest = reslotQueue.front();
+                reslotQueue.erase(reslotQueue.begin());
+                onAir.push_back({0, t, kAirtimeMs, dest, false});
+                if (!reslotQueue.empty()) pending[0] = true;
+            } else {
+                onAir.push_back({i, t, kDataAirtimeMs + kPiggybackAirtimeMs, 0, true, true});
+                count3(result.sent, t);
+            }
+        }
+
+        // Deliver transmissions that end in this tick
+        for (const SimTransmission &tx : onAir) {
+            if (tx.start + tx.airtime > t || tx.start + tx.airtime <= t - kTickMs) continue;
+            int rx = tx.dest;
+            if (t < bootAt[rx]) continue;
+            bool collided = false;
+            for (const SimTransmission &other : onAir) {
+                if (&other == &tx || other.start >= tx.start + tx.airtime || tx.start >= other.start + other.airtime) continue;
+                if (other.sender == rx || hears[rx][other.sender]) collided = true;
+            }
+            if (collided || unit(rng) < kMeshLoss) continue;
+            if (tx.isData) {
+                count3(result.delivered, tx.start);
+                if (monitor.onReading(0x5000 + tx.sender * 7919, sequence[tx.sender], t)) reslotQueue.push_back(tx.sender);
+            } else {
+                // Sensor: AkitaSmartCityServices::handleServiceDiscovery() with 'reslot'
+                slots[rx].reslot();
+                unsigned long local = t - bootAt[rx];
+                nextRead[rx] = bootAt[rx] + slots[rx].nextSlot(lastRead[rx] + kSlotReadMs / 2, local, utcOf(rx, t));
+                result.reslots++;
+            }
+        }
+        onAir.erase(std::remove_if(onAir.begin(), onAir.end(), [t](const SimTransmission &tx) { return tx.start + tx.airtime + 1000 <= t; }),
+                    onAir.end());
+    }
+    return result;
+}
+
+static void scenarioSlots() {
+    printf("Slots: %d sensors within %.0f m of one gateway (range %.0f m), all powered up within 2 s, reading every %lu s.\n",
+           kSlotSensors, kSlotRadiusM, kMeshRangeM, kSlotReadMs / 1000);
+    printf("Listen before talk; a packet overlapping any other at the gateway is lost, plus %.0f%% random loss. %lu meshes, 24 h.\n",
+           100.0f * kMeshLoss, (unsigned long)kSlotSeeds);
+    printf("Slot width %lu ms. Mesh time (UTC) in whole seconds, up to 0.5 s off per node.\n\n", kSlotWidthMs);
+    printf("%-36s | %-12s | %-12s | %-12s | %-7s\n", "schedule", "first 10 min", "first hour", "hours 1..24", "reslots");
+    struct { const char *name; SlotMode mode; } runs[] = {
+        {"free-running from boot (old)", SLOT_FREE},
+        {"slots from boot (time not set)", SLOT_BOOT},
+        {"slots from mesh time", SLOT_UTC},
+        {"slots from mesh time + gw reslot", SLOT_UTC_RESLOT}};
+    for (const auto &run : runs) {
+        SlotResult r;
+        for (uint32_t seed = 1; seed <= kSlotSeeds; seed++) {
+            SlotResult one = runSlots(run.mode, seed);
+            for (int w = 0; w < 3; w++) {
+                r.sent[w] += one.sent[w];
+                r.delivered[w] += one.delivered[w];
+            }
+            r.reslots += one.reslots;
+        }
+        printf("%-36s | %11.1f%% | %11.1f%% | %11.1f%% | %7lu\n", run.name, 100.0 * r.delivered[0] / r.sent[0],
+               100.0 * r.delivered[1] / r.sent[1], 100.0 * r.delivered[2] / r.sent[2], r.reslots);
+    }
+}
+
+// --- Poll mode ---
+// One gateway and 100 slow meters around it (hidden nodes as in the slots scenario), one reading
+// per 5 min each: sent on the sensors' own timers, or when the gateway polls them
+// (ASCSPollScheduler). Sensors announce themselves 15..30 s after power-up; the announcements
+// are the same in all runs and not simulated.
+static const int kPollSensors = 100;
+static const unsigned long kPollIntervalMs = 300000; // read_int of the timed runs, gw_poll_int of the polled ones
+static const unsigned long kPollDurationMs = 24UL * 3600 * 1000;
+static const uint32_t kPollSeeds = 5;
+
+struct PollRun {
+    const char *name;
+    bool polled;
+    bool slotted;         // Timed runs: tx_slot 2000 ms instead of the free-running timer
+    uint32_t batch;       // gw_poll_batch
+    uint32_t airtimePct;  // gw_poll_air
+};
+
+struct PollResult {
+    unsigned long sent = 0, delivered = 0;
+    unsigned long airtimeMs = 0;     // All transmissions
+    double maxGapSumS = 0;           // Per sensor: longest time without a delivered reading
+    unsigned long maxGapSensors = 0;
+    ASCSPollStats stats;
+    unsigned long covered = 0, nodes = 0; // At the end of the run
+};
+
+static PollResult runPoll(const PollRun &run, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_int_distribution<unsigned long> bootJitter(0, 2000 / kTickMs - 1);
+    std::uniform_int_distribution<unsigned long> loopJitter(0, 1000 / kTickMs);
+    std::uniform_int_distribution<unsigned long> announceDelay(150, 300); // Ticks
+    std::uniform_int_distribution<uint32_t> anyValue;
+
+    const int count = kPollSensors + 1; // Node 0 is the gateway
+    std::vector<float> x(count, 0.0f), y(count, 0.0f);
+    std::vector<unsigned long> bootAt(count, 0), nextRead(count), announceAt(count), waitUntil(count, 0);
+    std::vector<unsigned long> lastPolled(count, 0), lastDelivered(count, 0), maxGap(count, 0);
+    std::vector<bool> pending(count, false), announced(count, false), everPolled(count, false), answerDue(count, false);
+    std::vector<unsigned long> answerAt(count, 0);
+    std::vector<ASCSTxSlot> slots(count);
+    std::vector<std::vector<bool>> hears(count, std::vector<bool>(count, false));
+    for (int i = 1; i < count; i++) {
+        float r = kSlotRadiusM * std::sqrt(unit(rng)), a = 6.2831853f * unit(rng);
+        x[i] = r * std::cos(a);
+        y[i] = r * std::sin(a);
+        bootAt[i] = bootJitter(rng) * kTickMs;
+        announceAt[i] = bootAt[i] + announceDelay(rng) * kTickMs;
+        slots[i].configure(0x5000 + i * 7919, 1, kPollIntervalMs, run.slotted ? kSlotWidthMs : 0);
+        nextRead[i] = bootAt[i] + (slots[i].isEnabled() ? slots[i].nextSlot(0, 0, 0) : kPollIntervalMs);
+    }
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < count; j++) hears[i][j] = i != j && std::hypot(x[i] - x[j], y[i] - y[j]) <= kMeshRangeM;
+    }
+    auto nodeOf = [](int i) { return (uint32_t)(0x5000 + i * 7919); };
+
+    PollResult result;
+    ASCSPollScheduler scheduler;
+    scheduler.configure(run.polled ? kPollIntervalMs : 0, run.batch, run.airtimePct);
+    std::vector<SimTransmission> onAir;
+    std::vector<int> pollBatch; // Sensors named in the request on the air (one at a time)
+    uint32_t batch[ASCS_POLL_MAX_BATCH];
+
+    for (unsigned long t = 0; t < kPollDurationMs; t += kTickMs) {
+        for (int i = 1; i < count; i++) {
+            if (t < bootAt[i]) continue;
+            unsigned long local = t - bootAt[i];
+            if (run.polled && !announced[i] && t >= announceAt[i]) {
+                announced[i] = true;
+                scheduler.addNode(nodeOf(i), t);
+            }
+            if (answerDue[i]) {
+                // AkitaSmartCityServices::loop(): answer our poll in our turn
+                if (t < answerAt[i]) continue;
+                answerDue[i] = false;
+                pending[i] = true;
+                result.sent++;
+                continue;
+            }
+            bool polled = run.polled && everPolled[i] && t - lastPolled[i] < ASCS_POLL_FALLBACK_INTERVALS * kPollIntervalMs;
+            if (polled) continue; // The gateway decides when we send
+            if (t >= nextRead[i]) {
+                // Own timer (timed runs, or no poll yet, or polls stopped)
+                pending[i] = true;
+                result.sent++;
+                unsigned long latency = loopJitter(rng) * kTickMs;
+                nextRead[i] = slots[i].isEnabled()
+                                  ? bootAt[i] + slots[i].nextSlot(local + kPollIntervalMs / 2, local, 0) + latency
+                                  : t + kPollIntervalMs + latency;
+            }
+        }
+        // Gateway: next poll request (not while one of ours is on the air)
+        if (run.polled && !pending[0]) {
+            size_t n = scheduler.nextBatch(t, batch);
+            if (n > 0) {
+                pending[0] = true;
+                pollBatch.clear();
+                for (size_t k = 0; k < n; k++) pollBatch.push_back((int)((batch[k] - 0x5000) / 7919));
+            }
+        }
+
+        // Listen before talk, then transmit
+        for (int i = 0; i < count; i++) {
+            if (!pending[i] || t < waitUntil[i]) continue;
+            bool busy = false;
+            for (const SimTransmission &other : onAir) {
+                if (other.start + other.airtime > t && (other.sender == i || hears[i][other.sender])) busy = true;
+            }
+            if (busy) {
+                waitUntil[i] = t + (anyValue(rng) % (kContentionMs / kTickMs) + 1) * kTickMs;
+                continue;
+            }
+            pending[i] = false;
+            if (i == 0) {
+                onAir.push_back({0, t, kAirtimeMs, -1, false});
+                result.airtimeMs += kAirtimeMs;
+            } else {
+                onAir.push_back({i, t, kDataAirtimeMs + kPiggybackAirtimeMs, 0, true, true});
+                result.airtimeMs += kDataAirtimeMs + kPiggybackAirtimeMs;
+            }
+        }
+
+        // Receptions of transmissions that end in this tick
+        auto received = [&](const SimTransmission &tx, int rx) {
+            for (const SimTransmission &other : onAir) {
+                if (&other == &tx || other.start >= tx.start + tx.airtime || tx.start >= other.start + other.airtime) continue;
+                if (other.sender == rx || hears[rx][other.sender]) return false;
+            }
+            return unit(rng) >= kMeshLoss;
+        };
+        for (const SimTransmission &tx : onAir) {
+            unsigned long end = tx.start + tx.airtime;
+            if (end > t || end <= t - kTickMs) continue;
+            if (tx.isData) {
+                if (!received(tx, 0)) continue;
+                result.delivered++;
+                scheduler.onReply(nodeOf(tx.sender), t);
+                unsigned long gap = t - lastDelivered[tx.sender];
+                if (gap > maxGap[tx.sender]) maxGap[tx.sender] = gap;
+                lastDelivered[tx.sender] = t;
+            } else {
+                // AkitaSmartCityServices::handlePollRequest(): the n-th named sensor answers after n spacings
+                for (size_t k = 0; k < pollBatch.size(); k++) {
+                    int s = pollBatch[k];
+                    if (!received(tx, s)) continue;
+                    everPolled[s] = true;
+                    lastPolled[s] = t;
+                    answerDue[s] = true;
+                    answerAt[s] = t + k * ASCS_POLL_REPLY_SPACING_MS;
+                }
+            }
+        }
+        onAir.erase(std::remove_if(onAir.begin(), onAir.end(), [t](const SimTransmission &tx) { return tx.start + tx.airtime + 1000 <= t; }),
+                    onAir.end());
+    }
+    for (int i = 1; i < count; i++) {
+        unsigned long gap = std::max(maxGap[i], kPollDurationMs - lastDelivered[i]);
+        result.maxGapSumS += gap / 1000.0;
+        result.maxGapSensors++;
+    }
+    result.stats = scheduler.getStats();
+    result.covered = scheduler.getCoveredCount(kPollDurationMs);
+    result.nodes = scheduler.getNodeCount();
+    return result;
+}
+
+static void scenarioPoll() {
+    printf("Poll: %d sensors within %.0f m of one gateway, one reading per %lu s each, %lu meshes, 24 h.\n",
+           kPollSensors, kSlotRadiusM, kPollIntervalMs / 1000, (unsigned long)kPollSeeds);
+    printf("Readings/h: delivered per sensor and hour (12 = every reading). Max gap: per sensor, longest time without a reading.\n\n");
+    printf("%-32s | %-9s | %-10s | %-8s | %-9s | %-7s | %-8s | %-9s | %-8s\n", "schedule", "delivered", "readings/h", "channel",
+           "max gap s", "missed", "deferred", "wait s", "answer s");
+    PollRun runs[] = {{"own timer, free-running (old)", false, false, 0, 0},
+                      {"own timer, 2 s slots", false, true, 0, 0},
+                      {"polled, batch 1, 25% airtime", true, false, 1, 25},
+                      {"polled, batch 4, 10% airtime", true, false, 4, 10},
+                      {"polled, batch 4, 25% airtime", true, false, 4, 25},
+                      {"polled, batch 8, 25% airtime", true, false, 8, 25},
+                      {"polled, batch 4, 50% airtime", true, false, 4, 50}};
+    for (const PollRun &run : runs) {
+        PollResult r;
+        for (uint32_t seed = 1; seed <= kPollSeeds; seed++) {
+            PollResult one = runPoll(run, seed);
+            r.sent += one.sent;
+            r.delivered += one.delivered;
+            r.airtimeMs += one.airtimeMs;
+            r.maxGapSumS += one.maxGapSumS;
+            r.maxGapSensors += one.maxGapSensors;
+            r.stats.polls += one.stats.polls;
+            r.stats.replies += one.stats.replies;
+            r.stats.missed += one.stats.missed;
+            r.stats.deferred += one.stats.deferred;
+            r.stats.waitSumMs += one.stats.waitSumMs;
+            r.stats.latencySumMs += one.stats.latencySumMs;
+        }
+        double hours = kPollSeeds * kPollDurationMs / 3600000.0;
+        printf("%-32s | %8.1f%% | %10.2f | %7.1f%% | %9.0f", run.name, 100.0 * r.delivered / r.sent,
+               r.delivered / (hours * kPollSensors), 100.0 * r.airtimeMs / (kPollSeeds * (double)kPollDurationMs),
+               r.maxGapSumS / r.maxGapSensors);
+        if (run.polled) {
+            printf(" | %6.1f%% | %8lu | %9.1f | %8.1f\n", 100.0 * r.stats.missed / r.stats.polls, (unsigned long)r.stats.deferred,
+                   r.stats.waitSumMs / 1000.0 / r.stats.polls, r.stats.latencySumMs / 1000.0 / r.stats.replies);
+        } else {
+            printf(" | %7s | %8s | %9s | %8s\n", "-", "-", "-", "-");
+        }
+    }
+}
+
+// --- Several sensors per node ---
+// One pole, sensors added one by one, each with its own interval. Counts the packets a day
+// (no radio model): one packet per reading, or ASCSSensorRegistry with readings due close
+// together combined into one packet, split as in AkitaSmartCityServices::runSensorLogic().
+struct SimSensor : public SensorInterface {
+    std::string id;
+    std::vector<std::string> keys;
+    SimSensor(const std::string &sensorId, std::vector<std::string> readingKeys) : id(sensorId), keys(std::move(readingKeys)) {}
+    bool readData(std::map<std::string, float> &readings) override {
+        readings.clear();
+        for (const std::string &key : keys) readings[key] = 21.5f;
+        return true;
+    }
+    std::string getSensorId() override { return id; }
+};
+
+struct SimSensorSpec {
+    const char *id;
+    std::vector<std::string> keys;
+    uint32_t intervalMs;
+};
+
+static const std::vector<SimSensorSpec> kPoleSensors = {
+    {"bme280", {"temperature_c", "humidity_pct", "pressure_hpa"}, 60000},
+    {"noise", {"laeq_db", "lamax_db"}, 30000},
+    {"parking", {"occupied"}, 120000},
+    {"pm", {"pm25_ugm3", "pm10_ugm3"}, 300000},
+    {"wind", {"speed_ms", "dir_deg"}, 60000},
+    {"light", {"lux"}, 120000},
+    {"rain", {"rain_mm"}, 300000},
+    {"power", {"battery_v", "solar_v"}, 600000}};
+static const unsigned long kSensorsDurationMs = 24UL * 3600 * 1000;
+static const unsigned long kSensorsMergeWindowMs = 5000; // ASCS_DEFAULT_SENSOR_MERGE_WINDOW_MS
+static const size_t kSensorsPacketOverhead = 30; // SensorData fields besides the readings, SmartCityPacket wrapper
+
+struct SensorsResult {
+    unsigned long packets = 0;
+    unsigned long bytes = 0;
+};
+
+// Packets of one read round, packed like runSensorLogic()
+static void countRound(ASCSSensorRegistry &registry, const std::vector<size_t> &due, unsigned long now, SensorsResult &result) {
+    std::vector<ASCSSensorResult> results;
+    std::vector<size_t> failed;
+    registry.startRound(due, now);
+    registry.pollRound(now, results, failed); // Synchronous sensors: done right away
+    size_t first = 0;
+    while (first < results.size()) {
+        size_t last = first + 1;
+        size_t bytes = ASCSSensorRegistry::readingsSize(results[first].readings, results[first].sensorId.length() + 1);
+        while (last < results.size()) {
+            size_t more = ASCSSensorRegistry::readingsSize(results[last].readings, results[last].sensorId.length() + 1);
+            if (bytes + more > ASCS_SENSOR_PACKET_BUDGET) break;
+            bytes += more;
+            last++;
+        }
+        if (last - first == 1) bytes = ASCSSensorRegistry::readingsSize(results[first].readings, 0); // Plain keys
+        result.packets++;
+        result.bytes += kSensorsPacketOverhead + bytes;
+        first = last;
+    }
+}
+
+static SensorsResult runSensors(size_t count, uint32_t mergeWindowMs, bool randomPhase, bool separate, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<unsigned long> loopJitter(0, 50); // loop() latency, ms
+    SensorsResult result;
+    // 'separate': each sensor on a registry of its own (one packet per reading)
+    std::vector<ASCSSensorRegistry> registries(separate ? count : 1);
+    for (size_t i = 0; i < count; i++) {
+        const SimSensorSpec &spec = kPoleSensors[i];
+        uint32_t phase = randomPhase ? std::uniform_int_distribution<uint32_t>(0, spec.intervalMs - 1)(rng) : 0;
+        registries[separate ? i : 0].add(std::unique_ptr<SensorInterface>(new SimSensor(spec.id, spec.keys)), spec.intervalMs, phase);
+    }
+    for (ASCSSensorRegistry &registry : registries) registry.schedule(1000, 60000);
+
+    std::vector<size_t> due;
+    for (unsigned long t = 0; t < kSensorsDurationMs; t += 10 + loopJitter(rng)) {
+        for (ASCSSensorRegistry &registry : registries) {
+            if (registry.takeDue(t, separate ? 0 : mergeWindowMs, due)) countRound(registry, due, t, result);
+        }
+    }
+    return result;
+}
+
+static void scenarioSensors() {
+    printf("Sensors: one pole, sensors added one by one (interval in brackets), packets and payload bytes per hour.\n");
+    printf("Merged: readings due within the merge window (merge_win) go in one packet (up to %d bytes of readings).\n\n",
+           ASCS_SENSOR_PACKET_BUDGET);
+    printf("%-34s | %-16s | %-16s | %-16s | %-16s\n", "sensors", "packet each", "merged, 0 s", "merged, 5 s",
+           "5 s, random phase");
+    std::string names;
+    for (size_t count = 1; count <= kPoleSensors.size(); count++) {
+        if (!names.empty()) names += ",";
+        names += kPoleSensors[count - 1].id;
+        names += "(" + std::to_string(kPoleSensors[count - 1].intervalMs / 1000) + ")";
+        SensorsResult runs[4] = {runSensors(count, 0, false, true, 1), runSensors(count, 0, false, false, 1),
+                                 runSensors(count, kSensorsMergeWindowMs, false, false, 1),
+                                 runSensors(count, kSensorsMergeWindowMs, true, false, 1)};
+        printf("%-34s", count == 1 ? names.c_str() : ("+" + names.substr(names.rfind(',') + 1)).c_str());
+        for (const SensorsResult &r : runs) printf(" | %5.0f pk %6.0f B", r.packets / 24.0, r.bytes / 24.0);
+        printf("\n");
+    }
+}
+
+// --- Slow sensor: blocking vs. asynchronous reads ---
+// One Sensor node with a BME280-like sensor (10 ms read) and a slow sensor (2 s conversion, e.g.
+// CO2 or particulates), both read every minute, for one hour. Time is simulated in microseconds:
+// each loop() costs 0.5 ms plus the sensor calls, and loop() runs again 10 ms later. Mesh packets
+// arrive at random; one waits for the next loop() to be handled.
+static unsigned long g_asyncClockUs = 0;
+static const uint32_t kSlowConversionMs = 2000;
+
+struct SimBlockingSensor : public SensorInterface {
+    std::string id;
+    uint32_t conversionMs;
+    SimBlockingSensor(const std::string &sensorId, uint32_t ms) : id(sensorId), conversionMs(ms) {}
+    bool readData(std::map<std::string, float> &readings) override {
+        g_asyncClockUs += conversionMs * 1000UL; // Waits for the conversion
+        readings.clear();
+        readings["value"] = 1.0f;
+        return true;
+    }
+    std::string getSensorId() override { return id; }
+};
+
+struct SimAsyncSensor : public AsyncSensorInterface {
+    std::string id;
+    uint32_t conversionMs;
+    unsigned long readyUs = 0;
+    SimAsyncSensor(const std::string &sensorId, uint32_t ms) : id(sensorId), conversionMs(ms) {}
+    bool startRead() override {
+        g_asyncClockUs += 200; // Trigger the conversion (bus write)
+        readyUs = g_asyncClockUs + conversionMs * 1000UL;
+        return true;
+    }
+    SensorReadStatus pollRead(std::map<std::string, float> &readings) override {
+        g_asyncClockUs += 100; // Data-ready check
+        if ((long)(g_asyncClockUs - readyUs) < 0) return SensorReadStatus::PENDING;
+        g_asyncClockUs += 300; // Fetch the result
+        readings.clear();
+        readings["value"] = 1.0f;
+        return SensorReadStatus::DONE;
+    }
+    std::string getSensorId() override { return id; }
+};
+
+struct AsyncResult {
+    unsigned long loops = 0;
+    unsigned long loopMaxUs = 0;
+    double loopSumUs = 0;
+    std::vector<unsigned long> packetWaitUs; // Packet arrival until the loop() handling it
+    unsigned long rounds = 0;
+    unsigned long roundMaxMs = 0;
+};
+
+static AsyncResult runAsync(bool slowSensor, bool asyncSlow, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::exponential_distribution<double> packetGapUs(1.0 / 5e6); // One mesh packet per 5 s on average
+    g_asyncClockUs = 0;
+    ASCSSensorRegistry registry;
+    registry.add(std::unique_ptr<SensorInterface>(new SimBlockingSensor("bme280", 10)), 60000, 0);
+    if (slowSensor && asyncSlow) {
+        registry.add(std::unique_ptr<AsyncSensorInterface>(new SimAsyncSensor("co2", kSlowConversionMs)), 60000, 0);
+    } else if (slowSensor) {
+        registry.add(std::unique_ptr<SensorInterface>(new SimBlockingSensor("co2", kSlowConversionMs)), 60000, 0);
+    }
+    registry.schedule(1000, 60000);
+
+    AsyncResult result;
+    std::vector<size_t> due;
+    std::vector<ASCSSensorResult> results;
+    std::vector<size_t> failed;
+    unsigned long nextPacketUs = (unsigned long)packetGapUs(rng);
+    const unsigned long durationUs = 3600UL * 1000000UL;
+    while (g_asyncClockUs < durationUs) {
+        // Packets that arrived since the last loop() are handled now
+        while (nextPacketUs <= g_asyncClockUs) {
+            result.packetWaitUs.push_back(g_asyncClockUs - nextPacketUs);
+            nextPacketUs += (unsigned long)packetGapUs(rng);
+        }
+        unsigned long loopStartUs = g_asyncClockUs;
+        g_asyncClockUs += 500; // Discovery, service table, ...
+        unsigned long nowMs = g_asyncClockUs / 1000;
+        // As AkitaSmartCityServices::loop(): poll reads in progress, else start the due ones
+        if (registry.isReading()) {
+            if (registry.pollRound(g_asyncClockUs / 1000, results, failed)) result.rounds++;
+        } else if (registry.takeDue(nowMs, 0, due)) {
+            registry.startRound(due, nowMs);
+            if (registry.pollRound(g_asyncClockUs / 1000, results, failed)) result.rounds++;
+        }
+        unsigned long loopUs = g_asyncClockUs - loopStartUs;
+        result.loops++;
+        result.loopSumUs += loopUs;
+        if (loopUs > result.loopMaxUs) result.loopMaxUs = loopUs;
+        g_asyncClockUs += 10000; // Next loop()
+    }
+    result.roundMaxMs = registry.getStats().roundMaxMs;
+    return result;
+}
+
+static void scenarioAsync() {
+    printf("Async: one Sensor with a 10 ms sensor and a %lu ms sensor, both every 60 s, for 1 h.\n", (unsigned long)kSlowConversionMs);
+    printf("loop() time is the time spent in one call; packet wait is from a mesh packet's arrival to the loop() handling it.\n\n");
+    printf("%-32s | %12s | %12s | %14s | %14s | %12s | %8s\n", "sensors", "loop max ms", "loop mean ms",
+           "pkt wait p99", "pkt wait max", "pkts > 1 s", "round ms");
+    struct Variant {
+        const char *name;
+        bool slow;
+        bool async;
+    } variants[] = {{"10 ms sensor only", false, false},
+                    {"+ 2 s sensor, blocking read", true, false},
+                    {"+ 2 s sensor, async read", true, true}};
+    for (const Variant &variant : variants) {
+        AsyncResult r = runAsync(variant.slow, variant.async, 1);
+        std::vector<unsigned long> waits = r.packetWaitUs;
+        std::sort(waits.begin(), waits.end());
+        unsigned long late = 0;
+        for (unsigned long wait : waits) {
+            if (wait > 1000000UL) late++;
+        }
+        printf("%-32s | %12.1f | %12.2f | %11.1f ms | %11.1f ms | %5lu/%-6lu | %8lu\n", variant.name, r.loopMaxUs / 1000.0,
+               r.loopSumUs / r.loops / 1000.0, waits.empty() ? 0.0 : waits[waits.size() * 99 / 100] / 1000.0,
+               waits.empty() ? 0.0 : waits.back() / 1000.0, late, (unsigned long)waits.size(), r.roundMaxMs);
+    }
+}
+
+// --- Report deadbands ---
+// One BME280 Sensor read every 60 s for 7 days, its readings passed through ASCSDeadband as in
+// AkitaSmartCityServices::pollSensorReads(). The trace is synthetic (daily temperature cycle,
+// weather drift, sensor noise and resolution) unless a CSV file is given:
+// "seconds,temperature_c[,humidity_pct[,pressure_pa]]" per line, e.g. exported from a deployed node.
+struct TraceSample {
+    unsigned long t;
+    std::map<std::string, float> readings;
+};
+
+// 'smooth': the weather drift low-passed again (30 min), so it is smooth between readings like real
+// weather rather than a random walk at the minute scale (used by "adaptive").
+static std::vector<TraceSample> syntheticTrace(uint32_t seed, bool smooth = false) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> unit(0.0, 1.0);
+    std::vector<TraceSample> trace;
+    double weatherT = 0, weatherP = 0, smoothT = 0, smoothP = 0;
+    const double dt = 60.0;
+    for (unsigned long s = 0; s < 7UL * 86400; s += 60) {
+        // Weather: AR(1) drift (6 h for temperature, 12 h for pressure)
+        weatherT = weatherT * exp(-dt / 21600.0) + 1.5 * sqrt(1 - exp(-2 * dt / 21600.0)) * unit(rng);
+        weatherP = weatherP * exp(-dt / 43200.0) + 600.0 * sqrt(1 - exp(-2 * dt / 43200.0)) * unit(rng);
+        smoothT += (weatherT - smoothT) * (1 - exp(-dt / 1800.0));
+        smoothP += (weatherP - smoothP) * (1 - exp(-dt / 1800.0));
+        double driftT = smooth ? smoothT : weatherT, driftP = smooth ? smoothP : weatherP;
+        double temperature = 12.0 + 6.0 * sin(2 * M_PI * ((double)s - 9 * 3600.0) / 86400.0) + driftT + 0.03 * unit(rng);
+        double humidity = std::min(100.0, std::max(20.0, 70.0 - 2.5 * (temperature - 12.0) + 0.3 * unit(rng)));
+        double pressure = 101300.0 + driftP + 3.0 * unit(rng);
+        TraceSample sample;
+        sample.t = s * 1000UL;
+        sample.readings["temperature_c"] = (float)(round(temperature * 100) / 100); // BME280 resolution
+        sample.readings["humidity_pct"] = (float)(round(humidity * 100) / 100);
+        sample.readings["pressure_pa"] = (float)round(pressure);
+        trace.push_back(sample);
+    }
+    return trace;
+}
+
+static bool loadTrace(const char *path, std::vector<TraceSample> &trace) {
+    FILE *file = fopen(path, "r");
+    if (!file) return false;
+    static const char *keys[] = {"temperature_c", "humidity_pct", "pressure_pa"};
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        double values[4];
+        int n = sscanf(line, "%lf,%lf,%lf,%lf", &values[0], &values[1], &values[2], &values[3]);
+        if (n < 2) continue; // Header or blank line
+        TraceSample sample;
+        sample.t = (unsigned long)(values[0] * 1000.0);
+        for (int i = 1; i < n; i++) sample.readings[keys[i - 1]] = (float)values[i];
+        trace.push_back(sample);
+    }
+    fclose(file);
+    return !trace.empty();
+}
+
+static void scenarioDeadband(const char *tracePath) {
+    std::vector<TraceSample> trace;
+    if (tracePath) {
+        if (!loadTrace(tracePath, trace)) {
+            fprintf(stderr, "Cannot read trace '%s'.\n", tracePath);
+            return;
+        }
+    } else {
+        trace = syntheticTrace(1);
+    }
+    double days = (trace.back().t - trace.front().t) / 86400000.0;
+    if (days <= 0) days = 1;
+    printf("Deadband: %lu readings of one BME280 Sensor (%s, %.1f days), %lu ms airtime per packet.\n", (unsigned long)trace.size(),
+           tracePath ? tracePath : "synthetic trace", days, kDataAirtimeMs);
+    printf("Error: |reading - last value sent| of temperature_c at every reading (what a dashboard shows meanwhile).\n\n");
+    printf("%-58s | %9s | %9s | %12s | %11s | %10s | %10s\n", "deadband (heartbeat)", "pkts/day", "hb/day", "airtime s/day",
+           "suppressed", "temp err avg", "temp err max");
+    struct Variant {
+        const char *bands;
+        uint32_t heartbeatMs;
+    } variants[] = {{"", 0},
+                    {"temperature_c:0.1,humidity_pct:1,pressure_pa:20", 900000},
+                    {"temperature_c:0.1,humidity_pct:1,pressure_pa:20", 3600000},
+                    {"temperature_c:0.2,humidity_pct:2,pressure_pa:50", 3600000},
+                    {"temperature_c:0.5,humidity_pct:3,pressure_pa:100", 3600000},
+                    {"*:1%", 3600000}};
+    for (const Variant &variant : variants) {
+        ASCSDeadband deadband;
+        deadband.configure(variant.bands, variant.heartbeatMs);
+        float lastSent = 0;
+        double errSum = 0, errMax = 0;
+        for (const TraceSample &sample : trace) {
+            if (deadband.check("bme280", sample.readings, sample.t)) {
+                auto it = sample.readings.find("temperature_c");
+                if (it != sample.readings.end()) lastSent = it->second;
+            }
+            auto it = sample.readings.find("temperature_c");
+            if (it == sample.readings.end()) continue;
+            double err = fabs(it->second - lastSent);
+            errSum += err;
+            if (err > errMax) errMax = err;
+        }
+        const ASCSDeadbandStats &stats = deadband.getStats();
+        unsigned long packets = stats.sent + stats.heartbeats;
+        std::string name = variant.bands[0] ? variant.bands : "off (every reading)";
+        if (variant.heartbeatMs) name += " (" + std::to_string(variant.heartbeatMs / 60000) + " min)";
+        printf("%-58s | %9.0f | %9.1f | %12.0f | %10.1f%% | %9.3f C | %9.2f C\n", name.c_str(), packets / days,
+               stats.heartbeats / days, packets * kDataAirtimeMs / 1000.0 / days,
+               100.0 * stats.suppressed / trace.size(), errSum / trace.size(), errMax);
+    }
+}
+
+// --- Adaptive read interval ---
+// The deadband trace (7 days, weather drift smoothed; or "adaptive <file.csv>") replayed on a
+// solar-powered Sensor whose read interval follows its readings (ASCSAdaptiveInterval, as in
+// AkitaSmartCityServices::adaptReadInterval()). The synthetic trace adds a cold front on day 5
+// (-8 C and -300 Pa within 30 min) and a battery_v that sags to 3.35 V in two cloudy days
+// (days 3..4). Each variant runs with fine and coarse deadbands (the same for fixed and adaptive
+// intervals); energy per read (wake + BME280 forced measurement) 25 mJ, per packet 120 mA at
+// 3.3 V for the airtime. Error as in "deadband", also over the 2 h after the front.
+static const double kAdaptReadMj = 25.0;
+static const unsigned long kAdaptFrontAt = 4 * 86400000UL + 14 * 3600000UL;
+
+static void addFrontAndBattery(std::vector<TraceSample> &trace) {
+    for (TraceSample &sample : trace) {
+        double hours = sample.t / 3600000.0;
+        if (sample.t >= kAdaptFrontAt) {
+            double f = std::min(1.0, (sample.t - kAdaptFrontAt) / 1800000.0) * exp(-(double)(sample.t - kAdaptFrontAt) / 43200000.0);
+            sample.readings["temperature_c"] -= (float)(round(8.0 * f * 100) / 100);
+            sample.readings["pressure_pa"] -= (float)round(300.0 * f);
+        }
+        // Charges by day, drains by night; days 3 and 4 are overcast and the charge runs down
+        double sun = std::max(0.0, sin(2 * M_PI * (hours - 6.0) / 24.0));
+        double cloudy = hours >= 48 && hours < 96 ? 1.0 : 0.0;
+        double deficit = cloudy ? 0.5 * (hours - 48) / 48.0 : (hours >= 96 ? std::max(0.0, 0.5 - 0.05 * (hours - 96)) : 0.0);
+        sample.readings["battery_v"] = (float)(round((3.85 + 0.15 * sun * (1 - cloudy) - deficit) * 100) / 100);
+    }
+}
+
+struct AdaptiveResult {
+    unsigned long reads = 0, packets = 0;
+    double errSum = 0, errMax = 0, frontErrSum = 0, frontErrMax = 0;
+    unsigned long samples = 0, frontSamples = 0;
+    uint32_t minMs = 0xFFFFFFFF, maxMs = 0;
+    ASCSAdaptiveStats stats;
+};
+
+static AdaptiveResult runAdaptive(const std::vector<TraceSample> &trace, const char *bands, uint32_t baseMs, uint32_t minMs,
+                                  uint32_t maxMs, uint32_t batteryLowMv) {
+    ASCSDeadband deadband;
+    deadband.configure(bands, 3600000);
+    ASCSAdaptiveInterval adaptive;
+    adaptive.configure(baseMs, minMs, maxMs, batteryLowMv);
+
+    AdaptiveResult result;
+    unsigned long start = trace.front().t, end = trace.back().t;
+    unsigned long nextDue = start;
+    float lastSent = 0;
+    size_t index = 0;
+    for (unsigned long now = start; now <= end; now += 60000) {
+        while ((long)(now - nextDue) >= 0) {
+            // A read sees the latest trace sample at its due time
+            auto after = std::upper_bound(trace.begin(), trace.end(), nextDue,
+                                          [](unsigned long t, const TraceSample &sample) { return t < sample.t; });
+            const TraceSample &sample = after == trace.begin() ? trace.front() : *(after - 1);
+            result.reads++;
+            float excess = 0;
+            if (deadband.check("bme280", sample.readings, nextDue, false, &excess)) {
+                result.packets++;
+                lastSent = sample.readings.at("temperature_c");
+            }
+            auto battery = sample.readings.find(ASCS_BATTERY_KEY);
+            adaptive.onBattery(battery != sample.readings.end() ? (uint32_t)(battery->second * 1000.0f + 0.5f) : 0);
+            adaptive.onRound(excess);
+            nextDue += adaptive.getIntervalMs();
+            result.minMs = std::min(result.minMs, adaptive.getIntervalMs());
+            result.maxMs = std::max(result.maxMs, adaptive.getIntervalMs());
+        }
+        while (index + 1 < trace.size() && trace[index + 1].t <= now) index++;
+        double err = fabs(trace[index].readings.at("temperature_c") - lastSent);
+        result.errSum += err;
+        result.errMax = std::max(result.errMax, err);
+        result.samples++;
+        if (now >= kAdaptFrontAt && now < kAdaptFrontAt + 7200000UL) {
+            result.frontErrSum += err;
+            result.frontErrMax = std::max(result.frontErrMax, err);
+            result.frontSamples++;
+        }
+    }
+    result.stats = adaptive.getStats();
+    return result;
+}
+
+static void scenarioAdaptive(const char *tracePath) {
+    std::vector<TraceSample> trace;
+    if (tracePath) {
+        if (!loadTrace(tracePath, trace)) {
+            fprintf(stderr, "Cannot read trace '%s'.\n", tracePath);
+            return;
+        }
+    } else {
+        trace = syntheticTrace(1, true);
+        addFrontAndBattery(trace);
+    }
+    double days = (trace.back().t - trace.front().t) / 86400000.0;
+    if (days <= 0) days = 1;
+    double packetMj = 0.120 * 3.3 * kDataAirtimeMs;
+    printf("Adaptive: one BME280 Sensor (%s, %.1f days), heartbeat 60 min.\n",
+           tracePath ? tracePath : "synthetic trace, a front on day 5, low battery on days 3..4", days);
+    printf("Energy: %.0f mJ per read, %.0f mJ per packet (%lu ms airtime). Intervals: shortest..longest used\n", kAdaptReadMj, packetMj,
+           kDataAirtimeMs);
+    printf("(times shortened / lengthened / battery low).\n");
+    struct Bands {
+        const char *name;
+        const char *bands;
+    } bandSets[] = {{"fine", "temperature_c:0.1,humidity_pct:1,pressure_pa:20,battery_v:0.05"},
+                    {"coarse", "temperature_c:0.5,humidity_pct:3,pressure_pa:100,battery_v:0.1"}};
+    struct Variant {
+        const char *name;
+        uint32_t baseMs, minMs, maxMs, batteryLowMv;
+    } variants[] = {{"fixed 60 s", 60000, 0, 0, 0},
+                    {"fixed 300 s (read_int)", 300000, 0, 0, 0},
+                    {"fixed 1200 s", 1200000, 0, 0, 0},
+                    {"adaptive 300 s, 75..1200 s", 300000, 60000, 1200000, 0},
+                    {"adaptive 300 s, 75..2400 s", 300000, 60000, 2400000, 0},
+                    {"adaptive 300 s, 75..2400 s, bat 3.5 V", 300000, 60000, 2400000, 3500}};
+    for (const Bands &bands : bandSets) {
+        printf("\nDeadbands %s: %s\n", bands.name, bands.bands);
+        printf("%-38s | %7s | %6s | %13s | %10s | %11s | %17s | %s\n", "read interval", "reads/d", "pkts/d", "airtime s/day",
+               "energy J/d", "err avg/max", "front err avg/max", "intervals");
+        for (const Variant &variant : variants) {
+            AdaptiveResult r = runAdaptive(trace, bands.bands, variant.baseMs, variant.minMs, variant.maxMs, variant.batteryLowMv);
+            double energy = (r.reads * kAdaptReadMj + r.packets * packetMj) / 1000.0 / days;
+            printf("%-38s | %7.0f | %6.0f | %13.0f | %10.1f | %4.2f / %4.2f | %7.2f / %7.2f | %lu..%lu s (%lu/%lu/%lu)\n",
+                   variant.name, r.reads / days, r.packets / days, r.packets * kDataAirtimeMs / 1000.0 / days, energy,
+                   r.errSum / r.samples, r.errMax, r.frontSamples ? r.frontErrSum / r.frontSamples : 0.0, r.frontErrMax,
+                   (unsigned long)(r.minMs / 1000), (unsigned long)(r.maxMs / 1000), (unsigned long)r.stats.shortened,
+                   (unsigned long)r.stats.lengthened, (unsigned long)r.stats.batteryLow);
+        }
+    }
+}
+
+// --- Windowed statistics ---
+// A street noise sensor for 24 h: background ~55 dB with 2 dB noise and, 6 times an hour, a
+// passing truck (8..15 s at ~75 dB). Compares sending a reading every 60 s with sampling every
+// second and sending window summaries (ASCSWindowStats via ASCSSensorRegistry). A truck counts as
+// seen if the first packet sent after it started reports >= 70 dB (as reading or window
+// maximum).
+static unsigned long g_statsNowMs = 0;
+
+struct SimNoiseSensor : public SensorInterface {
+    const std::vector<float> *levels; // dB per second
+    explicit SimNoiseSensor(const std::vector<float> *trace) : levels(trace) {}
+    bool readData(std::map<std::string, float> &readings) override {
+        readings.clear();
+        readings["noise_db"] = (*levels)[(g_statsNowMs / 1000) % levels->size()];
+        return true;
+    }
+    std::string getSensorId() override { return "noise"; }
+};
+
+static void scenarioStats() {
+    std::mt19937 rng(1);
+    std::normal_distribution<float> background(55.0f, 2.0f);
+    std::uniform_int_distribution<int> truckLength(8, 15);
+    std::exponential_distribution<double> truckGap(6.0 / 3600.0);
+    const unsigned long seconds = 86400;
+    std::vector<float> levels(seconds);
+    for (unsigned long s = 0; s < seconds; s++) levels[s] = background(rng);
+    std::vector<std::pair<unsigned long, unsigned long>> trucks; // [start, end) in s
+    for (double s = truckGap(rng); s < seconds - 20; s += truckGap(rng)) {
+        unsigned long start = (unsigned long)s, end = start + truckLength(rng);
+        for (unsigned long i = start; i < end; i++) levels[i] = 75.0f + background(rng) - 55.0f;
+        trucks.push_back({start, end});
+    }
+
+    printf("Stats: street noise, 24 h, %lu passing trucks (8..15 s, ~75 dB). stat_out mean,max unless noted.\n\n",
+           (unsigned long)trucks.size());
+    printf("%-36s | %8s | %12s | %11s | %14s\n", "reporting", "pkts/h", "bytes/packet", "trucks seen", "std err (Welford)");
+    struct Variant {
+        const char *name;
+        uint32_t intervalMs;
+        uint32_t windowMs;
+        uint8_t outputs;
+    } variants[] = {{"reading every 60 s (raw)", 60000, 0, 0},
+                    {"reading every 1 s (raw)", 1000, 0, 0},
+                    {"1 s samples, 60 s window", 1000, 60000, ASCS_STATS_MEAN | ASCS_STATS_MAX},
+                    {"1 s samples, 300 s window", 1000, 300000, ASCS_STATS_MEAN | ASCS_STATS_MAX},
+                    {"1 s samples, 300 s, all outputs", 1000, 300000, 0x1F}};
+    for (const Variant &variant : variants) {
+        ASCSSensorRegistry registry;
+        registry.add(std::unique_ptr<SensorInterface>(new SimNoiseSensor(&levels)), variant.intervalMs, 0, variant.windowMs);
+        if (variant.outputs) registry.setSummaryOutputs(variant.outputs);
+        registry.schedule(0, 60000);
+
+        std::vector<size_t> due, failed;
+        std::vector<ASCSSensorResult> results;
+        std::vector<std::pair<unsigned long, float>> reports; // (time s, highest level reported)
+        unsigned long packets = 0, bytes = 0;
+        double stdErrMax = 0;
+        unsigned long windowFirst = 0; // First sample second of the current window (for the exact std)
+        for (g_statsNowMs = 0; g_statsNowMs < seconds * 1000UL; g_statsNowMs += 100) {
+            if (!registry.takeDue(g_statsNowMs, 0, due)) continue;
+            registry.startRound(due, g_statsNowMs);
+            if (!registry.pollRound(g_statsNowMs, results, failed)) continue;
+            for (const ASCSSensorResult &result : results) {
+                packets++;
+                bytes += kSensorsPacketOverhead + ASCSSensorRegistry::readingsSize(result.readings, 0);
+                float level = 0;
+                for (const auto &reading : result.readings) {
+                    if (reading.first == "noise_db" || reading.first == "noise_db_max") level = std::max(level, reading.second);
+                }
+                unsigned long now = g_statsNowMs / 1000;
+                reports.push_back({now, level});
+                auto std = result.readings.find("noise_db_std");
+                if (std != result.readings.end()) {
+                    // Two-pass standard deviation in double precision over the same samples
+                    double sum = 0, sq = 0;
+                    unsigned long n = now - windowFirst + 1;
+                    for (unsigned long s = windowFirst; s <= now; s++) sum += levels[s];
+                    double mean = sum / n;
+                    for (unsigned long s = windowFirst; s <= now; s++) sq += (levels[s] - mean) * (levels[s] - mean);
+                    stdErrMax = std::max(stdErrMax, fabs(std->second - sqrt(sq / (n - 1))));
+                }
+                windowFirst = now + 1;
+            }
+        }
+        unsigned long seen = 0;
+        for (const auto &truck : trucks) {
+            // The first packet after the truck arrived (its window covers the truck, or a reading taken meanwhile)
+            auto report = std::lower_bound(reports.begin(), reports.end(), std::make_pair(truck.first, -1.0f));
+            if (report != reports.end() && report->second >= 70.0f) seen++;
+        }
+        printf("%-36s | %8.1f | %12.1f | %5lu/%-5lu | %14s\n", variant.name, packets / 24.0, (double)bytes / packets, seen,
+               (unsigned long)trucks.size(), (variant.outputs & ASCS_STATS_STD) ? std::to_string(stdErrMax).c_str() : "-");
+    }
+}
+
+// --- Priority classes ---
+// A busy Aggregator forwarding bursty routine readings (bursts of 1..6 packets, e.g. a slot of
+// Sensors answering at once) at a given share of channel time, plus an alarm every 5 min on
+// average, for 6 h. The radio sends its queue (16 packets, new ones dropped when full) first in,
+// first out; airtime is the LongFast time on air of a 40-byte packet (ASCSOutboundQueue::airtimeMs()),
+// +-10 % per packet.
+// Compares handing every packet to the radio at once with ASCSOutboundQueue in front of it.
+static const size_t kRadioQueueMax = 16;
+
+struct SimRadioPacket {
+    unsigned long createdAt;
+    bool alarm;
+    uint32_t airtimeMs;
+};
+
+struct PriorityResult {
+    std::vector<double> alarmLatency;
+    unsigned long alarms = 0;
+    double routineLatencySum = 0;
+    unsigned long routine = 0, routineSent = 0;
+};
+
+static PriorityResult runPriority(double load, bool outboundQueue, uint32_t seed) {
+    std::mt19937 rng(seed), airRng(seed + 1); // Same traffic for both ways of sending
+    const unsigned long durationMs = 6 * 3600000UL;
+    const size_t packetBytes = 40;
+    ASCSOutboundQueue queue; // LongFast, no duty-cycle limit
+    const uint32_t airtime = queue.airtimeMs(packetBytes);
+    std::uniform_int_distribution<int> burstSize(1, 6);
+    std::uniform_real_distribution<double> jitter(0.9, 1.1);
+    // Mean burst 3.5 packets: bursts per ms for 'load' of the channel
+    std::exponential_distribution<double> burstGap(load / (3.5 * airtime));
+    std::exponential_distribution<double> alarmGap(1.0 / 300000.0);
+
+    PriorityResult result;
+    std::vector<SimRadioPacket> radio; // Radio queue, front on air
+    unsigned long onAirEnd = 0;
+    double nextBurst = burstGap(rng), nextAlarm = alarmGap(rng);
+
+    auto toRadio = [&](unsigned long createdAt, bool alarm) {
+        if (radio.size() >= kRadioQueueMax) return false;
+        radio.push_back({createdAt, alarm, (uint32_t)(airtime * jitter(airRng))});
+        return true;
+    };
+    auto submit = [&](unsigned long now, bool alarm) {
+        if (alarm) {
+            result.alarms++;
+        } else {
+            result.routine++;
+        }
+        if (!outboundQueue) {
+            toRadio(now, alarm);
+            return;
+        }
+        ASCSOutboundPacket queued;
+        queued.priority = alarm ? MessagePriority::CRITICAL : MessagePriority::ROUTINE;
+        queued.data.resize(packetBytes);
+        queue.push(std::move(queued), now);
+    };
+
+    for (unsigned long now = 0; now < durationMs; now += 10) {
+        while (nextBurst <= now) {
+            for (int i = burstSize(rng); i > 0; i--) submit(now, false);
+            nextBurst += burstGap(rng);
+        }
+        while (nextAlarm <= now) {
+            submit(now, true);
+            nextAlarm += alarmGap(rng);
+        }
+        if (outboundQueue) {
+            // As AkitaSmartCityServices::serviceOutboundQueue()
+            while (ASCSOutboundPacket *packet = queue.next(now)) {
+                if (!toRadio(packet->queuedAt, packet->priority == MessagePriority::CRITICAL)) {
+                    queue.onFailed(now);
+                    break;
+                }
+                queue.onSent(now);
+            }
+        }
+        // The radio: the front packet is on air until onAirEnd
+        while (!radio.empty() && now >= onAirEnd) {
+            if (onAirEnd != 0) {
+                const SimRadioPacket &done = radio.front();
+                if (done.alarm) {
+                    result.alarmLatency.push_back((onAirEnd - done.createdAt) / 1000.0);
+                } else {
+                    result.routineSent++;
+                    result.routineLatencySum += (onAirEnd - done.createdAt) / 1000.0;
+                }
+                radio.erase(radio.begin());
+                onAirEnd = 0;
+                continue;
+            }
+            onAirEnd = now + radio.front().airtimeMs;
+        }
+    }
+    return result;
+}
+
+static void scenarioPriority() {
+    printf("Priority: Aggregator forwarding bursty routine readings, alarm every 5 min on average, 6 h,\n");
+    printf("radio queue of %d packets (first in, first out), %lu ms airtime per packet.\n\n", (int)kRadioQueueMax,
+           (unsigned long)ASCSOutboundQueue().airtimeMs(40));
+    printf("%-5s | %-22s | %18s | %13s | %11s | %14s | %11s\n", "load", "sending", "alarm latency s", "alarm p95 s",
+           "alarms lost", "routine lat. s", "routine lost");
+    const double loads[] = {0.3, 0.6, 0.9, 1.1};
+    for (double load : loads) {
+        for (int outboundQueue = 0; outboundQueue < 2; outboundQueue++) {
+            PriorityResult result = runPriority(load, outboundQueue != 0, 7);
+            std::vector<double> &latency = result.alarmLatency;
+            std::sort(latency.begin(), latency.end());
+            double mean = 0;
+            for (double l : latency) mean += l;
+            mean = latency.empty() ? 0 : mean / latency.size();
+            double p95 = latency.empty() ? 0 : latency[(size_t)(0.95 * (latency.size() - 1))];
+            double maxLatency = latency.empty() ? 0 : latency.back();
+            printf("%4.0f%% | %-22s | %7.2f (max %4.1f) | %13.2f | %5lu/%-5lu | %14.1f | %10.1f%%\n", load * 100,
+                   outboundQueue ? "ASCSOutboundQueue" : "straight to radio", mean, maxLatency, p95,
+                   result.alarms - (unsigned long)latency.size(), result.alarms,
+                   result.routineSent ? result.routineLatencySum / result.routineSent : 0.0,
+                   100.0 * (result.routine - result.routineSent) / result.routine);
+        }
+    }
+}
+
+// --- Retries and duty cycle ---
+// An Aggregator for 24 h (LongFast, 40-byte packets): its own forwarded readings use 4 % of the
+// channel, 20 % from 07:00..09:00 and 17:00..19:00 (bursts of 1..6 packets), plus an alarm every
+// 10 min on average. The radio queue (16 packets) also takes the mesh's rebroadcasts (15 % of the
+// channel, bursty), so it is sometimes full and sendData() fails. Compares handing every packet to
+// the radio at once (lost when it fails) with ASCSOutboundQueue, without and with `duty_pct` 10.
+struct DutyResult {
+    unsigned long routine = 0, routineSent = 0, alarms = 0, alarmsSent = 0;
+    double routineLatencySum = 0, alarmLatencyMax = 0;
+    uint32_t maxHourMs = 0; // Most own airtime within any hour
+    uint32_t retries = 0, deferred = 0, depthMax = 0;
+};
+
+static DutyResult runDuty(bool outboundQueue, uint32_t dutyPct, uint32_t seed) {
+    std::mt19937 rng(seed), airRng(seed + 1); // Same traffic for all ways of sending
+    const unsigned long durationMs = 24 * 3600000UL;
+    const size_t packetBytes = 40;
+    ASCSOutboundQueue queue;
+    queue.configure(ASCSLoRaModem(), dutyPct);
+    const uint32_t airtime = queue.airtimeMs(packetBytes);
+    std::uniform_int_distribution<int> burstSize(1, 6);
+    std::uniform_real_distribution<double> jitter(0.9, 1.1), uniform(0, 1);
+    std::exponential_distribution<double> alarmGap(1.0 / 600000.0);
+
+    struct RadioPacket {
+        unsigned long createdAt;
+        int kind; // 0 routine, 1 alarm, 2 rebroadcast
+        uint32_t airtimeMs;
+    };
+    DutyResult result;
+    std::vector<RadioPacket> radio;
+    unsigned long onAirEnd = 0;
+    std::vector<uint32_t> ownPerSecond(durationMs / 1000 + 60, 0);
+    double nextAlarm = alarmGap(rng);
+
+    auto toRadio = [&](unsigned long createdAt, int kind) {
+        if (radio.size() >= kRadioQueueMax) return false;
+        radio.push_back({createdAt, kind, (uint32_t)(airtime * jitter(airRng))});
+        return true;
+    };
+    auto submit = [&](unsigned long now, bool alarm) {
+        if (alarm) {
+            result.alarms++;
+        } else {
+            result.routine++;
+        }
+        if (!outboundQueue) {
+            toRadio(now, alarm ? 1 : 0);
+            return;
+        }
+        ASCSOutboundPacket queued;
+        queued.priority = alarm ? MessagePriority::CRITICAL : MessagePriority::ROUTINE;
+        queued.data.resize(packetBytes);
+        queue.push(std::move(queued), now);
+    };
+
+    for (unsigned long now = 0; now < durationMs; now += 10) {
+        unsigned long hour = now / 3600000UL;
+        double load = (hour == 7 || hour == 8 || hour == 17 || hour == 18) ? 0.20 : 0.04;
+        // Bursts per 10 ms step: own readings (mean burst 3.5) and rebroadcasts
+        if (uniform(rng) < load * 10 / (3.5 * airtime)) {
+            for (int i = burstSize(rng); i > 0; i--) submit(now, false);
+        }
+        if (uniform(rng) < 0.15 * 10 / (3.5 * airtime)) {
+            for (int i = burstSize(rng); i > 0; i--) toRadio(now, 2);
+        }
+        while (nextAlarm <= now) {
+            submit(now, true);
+            nextAlarm += alarmGap(rng);
+        }
+        if (outboundQueue) {
+            // As AkitaSmartCityServices::serviceOutboundQueue()
+            while (ASCSOutboundPacket *packet = queue.next(now)) {
+                if (!toRadio(packet->queuedAt, packet->priority == MessagePriority::CRITICAL ? 1 : 0)) {
+                    queue.onFailed(now);
+                    break;
+                }
+                queue.onSent(now);
+            }
+        }
+        while (!radio.empty() && now >= onAirEnd) {
+            if (onAirEnd != 0) {
+                const RadioPacket &done = radio.front();
+                double latency = (onAirEnd - done.createdAt) / 1000.0;
+                if (done.kind == 1) {
+                    result.alarmsSent++;
+                    result.alarmLatencyMax = std::max(result.alarmLatencyMax, latency);
+                } else if (done.kind == 0) {
+                    result.routineSent++;
+                    result.routineLatencySum += latency;
+                }
+                if (done.kind != 2) ownPerSecond[(onAirEnd - done.airtimeMs) / 1000] += done.airtimeMs;
+                radio.erase(radio.begin());
+                onAirEnd = 0;
+                continue;
+            }
+            onAirEnd = now + radio.front().airtimeMs;
+        }
+    }
+
+    // Most own airtime within any hour
+    uint64_t window = 0;
+    for (size_t second = 0; second < ownPerSecond.size(); second++) {
+        window += ownPerSecond[second];
+        if (second >= 3600) window -= ownPerSecond[second - 3600];
+        result.maxHourMs = std::max(result.maxHourMs, (uint32_t)window);
+    }
+    const ASCSOutboundStats &stats = queue.getStats();
+    result.retries = stats.retries;
+    result.deferred = stats.deferred;
+    result.depthMax = stats.depthMax;
+    return result;
+}
+
+static void scenarioDuty() {
+    printf("Duty: Aggregator, 24 h, LongFast (%lu ms per packet), own traffic 4 %% of the channel, 20 %% in two\n",
+           (unsigned long)ASCSOutboundQueue().airtimeMs(40));
+    printf("2 h peaks, alarm every 10 min, rebroadcasts 15 %% sharing the radio queue (16 packets).\n\n");
+    printf("%-30s | %10s | %12s | %11s | %16s | %12s | %7s | %8s\n", "sending", "routine ok", "routine lat.",
+           "alarms ok", "alarm max lat. s", "max air/hour", "retries", "deferred");
+    struct Variant {
+        const char *name;
+        bool outboundQueue;
+        uint32_t dutyPct;
+    } variants[] = {{"straight to radio", false, 0}, {"ASCSOutboundQueue", true, 0}, {"ASCSOutboundQueue, duty 10 %", true, 10}};
+    for (const Variant &variant : variants) {
+        DutyResult r = runDuty(variant.outboundQueue, variant.dutyPct, 11);
+        printf("%-30s | %9.2f%% | %10.1f s | %5lu/%-5lu | %16.1f | %10.1f%% | %7lu | %8lu\n", variant.name,
+               100.0 * r.routineSent / r.routine, r.routineSent ? r.routineLatencySum / r.routineSent : 0.0, r.alarmsSent,
+               r.alarms, r.alarmLatencyMax, r.maxHourMs / 36000.0, (unsigned long)r.retries, (unsigned long)r.deferred);
+    }
+}
+
+// --- Store-and-forward during a gateway outage ---
+// A district of 40 Sensors (half of them two hops away, through an Aggregator) reporting every
+// 5 min to one Gateway, in a mesh of 60 nodes. The Gateway is off for a while from 01:00. Sensors
+// keep sending to it until it times out of their service table (svc_tout, 15 min; those readings
+// are lost either way), then have no route: they broadcast (old), which the firmware floods
+// (about a third of the 60 nodes rebroadcast, managed flooding), or hold the readings
+// (ASCSStoreForward). After the Gateway is back, each Sensor hears it within 60 s and sends what it
+// held, one StoredBatch (ASCSStoreForward::encodeBatch()) per `sf_flush_ms`. Airtime 682 ms per
+// SensorData packet; batches as computed by ASCSLoRaAirtime for LongFast.
+static const int kOutageSensors = 40;
+static const int kOutageFloodTx = 20;
+static const unsigned long kOutageReadMs = 300000;
+static const unsigned long kOutageDownAt = 3600000;
+
+struct OutageResult {
+    unsigned long duringOutage = 0;   // Readings taken while the gateway was down
+    unsigned long lostStaleRoute = 0; // Sent to the gateway before it timed out (lost either way)
+    unsigned long broadcasts = 0;     // Readings broadcast (flooded)
+    unsigned long held = 0, delivered = 0, dropped = 0, batches = 0;
+    double flushS = 0;                // From the gateway's return until all held readings were delivered
+    double peakMinutePct = 0;         // Busiest minute after the return (channel time, all transmissions)
+    double normalMinutePct = 0;       // Average minute before the outage
+};
+
+static OutageResult runOutage(unsigned long outageMs, uint32_t storeMax, uint32_t flushMs, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<unsigned long> slot(0, kOutageReadMs - 1), hearGateway(0, 60000);
+    const unsigned long upAt = kOutageDownAt + outageMs;
+    const unsigned long endMs = upAt + 3 * 3600000UL;
+    const uint8_t packet[60] = {};
+    uint8_t encoded[256];
+
+    struct Node {
+        unsigned long nextRead, knowsGatewayAt;
+        int hops;
+        ASCSStoreForward store;
+    };
+    std::vector<Node> nodes(kOutageSensors);
+    for (int i = 0; i < kOutageSensors; i++) {
+        nodes[i].nextRead = slot(rng);
+        nodes[i].knowsGatewayAt = upAt + hearGateway(rng);
+        nodes[i].hops = i % 2 ? 2 : 1;
+        nodes[i].store.configure(storeMax, flushMs, 1000 + i);
+    }
+
+    OutageResult result;
+    std::vector<double> minuteAirMs(endMs / 60000 + 1, 0);
+    std::vector<std::pair<MessagePriority, std::vector<uint8_t>>> batch;
+    unsigned long lastFlush = upAt;
+    for (unsigned long now = 0; now < endMs; now += 100) {
+        bool gatewayUp = now < kOutageDownAt || now >= upAt;
+        bool routeExpired = now >= kOutageDownAt + kServiceTimeoutMs;
+        for (Node &node : nodes) {
+            bool route;
+            if (now < kOutageDownAt) {
+                route = true;
+            } else if (now < upAt) {
+                route = !routeExpired; // Stale entry until svc_tout
+            } else {
+                route = upAt < kOutageDownAt + kServiceTimeoutMs || now >= node.knowsGatewayAt;
+            }
+            if (now >= node.nextRead) {
+                node.nextRead += kOutageReadMs;
+                bool down = now >= kOutageDownAt && now < upAt;
+                if (down) result.duringOutage++;
+                if (route) {
+                    minuteAirMs[now / 60000] += node.hops * kDataAirtimeMs;
+                    if (!gatewayUp) result.lostStaleRoute++;
+                } else if (node.store.push(packet, sizeof(packet), MessagePriority::ROUTINE)) {
+                    // Held
+                } else {
+                    result.broadcasts++;
+                    minuteAirMs[now / 60000] += kOutageFloodTx * kDataAirtimeMs;
+                }
+            }
+            if (!route) {
+                node.store.onRouteLost();
+            } else if (node.store.peekBatch(now, batch) > 0) {
+                node.store.commitBatch(batch.size());
+                result.delivered += batch.size();
+                result.batches++;
+                size_t length = batch.size() > 1 ? ASCSStoreForward::encodeBatch(batch, encoded, sizeof(encoded)) : sizeof(packet);
+                minuteAirMs[now / 60000] += node.hops * ASCSLoRaAirtime::timeOnAirMs(ASCSLoRaModem(), length);
+                lastFlush = now;
+            }
+        }
+    }
+    for (const Node &node : nodes) {
+        result.held += node.store.getStats().stored;
+        result.dropped += node.store.getStats().dropped;
+    }
+    result.flushS = (lastFlush - upAt) / 1000.0;
+    double normal = 0;
+    for (unsigned long m = 0; m < kOutageDownAt / 60000; m++) normal += minuteAirMs[m];
+    result.normalMinutePct = normal / (kOutageDownAt / 60000) / 600.0;
+    for (unsigned long m = upAt / 60000; m < minuteAirMs.size(); m++) {
+        result.peakMinutePct = std::max(result.peakMinutePct, minuteAirMs[m] / 600.0);
+    }
+    return result;
+}
+
+static void scenarioOutage() {
+    printf("Outage: 40 Sensors (every 5 min, half two hops away), one Gateway off from 01:00; a flood costs %d\n", kOutageFloodTx);
+    printf("transmissions. 'lost, stale' = sent to the Gateway before it timed out of the service table.\n\n");
+    printf("%-6s | %-32s | %8s | %11s | %10s | %9s | %7s | %8s | %10s | %s\n", "outage", "no gateway known",
+           "readings", "lost, stale", "broadcasts", "flood tx", "held", "dropped", "delivered", "flush s / peak min (normal)");
+    const unsigned long outages[] = {30 * 60000UL, 2 * 3600000UL, 6 * 3600000UL};
+    struct Variant {
+        const char *name;
+        uint32_t storeMax;
+        uint32_t flushMs;
+    } variants[] = {{"broadcast (old)", 0, 0},
+                    {"hold, sf_max 32, 15 s", 32, 15000},
+                    {"hold, sf_max 32, 60 s", 32, 60000},
+                    {"hold, sf_max 32, 300 s (default)", 32, 300000},
+                    {"hold, sf_max 32, 600 s", 32, 600000}};
+    for (unsigned long outage : outages) {
+        for (const Variant &variant : variants) {
+            OutageResult r = runOutage(outage, variant.storeMax, variant.flushMs, 3);
+            printf("%4.1f h | %-32s | %8lu | %11lu | %10lu | %9lu | %7lu | %8lu | %4lu (%3.0f%%) | %6.0f / %4.1f%% (%.1f%%)\n",
+                   outage / 3600000.0, variant.name, r.duringOutage, r.lostStaleRoute, r.broadcasts,
+                   r.broadcasts * kOutageFloodTx, r.held, r.dropped, r.delivered,
+                   r.duringOutage ? 100.0 * r.delivered / r.duringOutage : 0.0, r.flushS, r.peakMinutePct, r.normalMinutePct);
+        }
+    }
+}
+
+// --- Event-driven readings ---
+// One Sensor with a door contact (opened every 20 min on average from 07:00 to 22:00, a third of
+// the openings only 2..10 s long) and a parking bay detector (a car every 30 min on average,
+// staying 1..90 min), for a day. Every edge of the contact bounces 2..5 times within 20 ms.
+// Polled: the sensor is read every read_int and its readings sent when they changed or the
+// heartbeat (15 min) passed, as with `deadband`. Events: the driver posts every edge to its
+// SensorEventQueue, loop() (every 10 ms) sends them through ASCSEventDebouncer, and the sensor is
+// still read every 15 min as heartbeat. One radio, otherwise idle channel; airtime of each packet
+// as ASCSOutboundQueue::airtimeMs(). Latency is from a state change to the end of the first packet
+// on air carrying it; 'missed' are changes that were over before any packet carried them.
+static const unsigned long kEventsDurationMs = 24 * 3600000UL;
+static const unsigned long kEventsHeartbeatMs = 900000;
+
+struct SimEdge {
+    unsigned long atMs;
+    int key;     // 0 = door_open, 1 = occupied
+    float value;
+    bool real;   // The state change itself (false: a bounce)
+};
+
+static std::vector<SimEdge> eventTrace(uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<SimEdge> edges;
+    std::uniform_int_distribution<int> bounces(2, 5);
+    std::uniform_int_distribution<unsigned long> bounceMs(1, 20);
+    auto edge = [&](unsigned long at, int key, float value, bool bouncy) {
+        edges.push_back({at, key, value, true});
+        if (!bouncy) return;
+        unsigned long t = at;
+        for (int i = bounces(rng); i > 0; i--) {
+            // Opposite value, then back
+            t += bounceMs(rng);
+            edges.push_back({t, key, 1.0f - value, false});
+            t += bounceMs(rng);
+            edges.push_back({t, key, value, false});
+        }
+    };
+
+    std::exponential_distribution<double> doorGap(1.0 / 1200000.0), bayGap(1.0 / 1800000.0);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    double t = 0;
+    while ((t += doorGap(rng)) < kEventsDurationMs) {
+        double hour = fmod(t / 3600000.0, 24.0);
+        if (hour < 7 || hour >= 22) continue;
+        double openMs = uniform(rng) < 1.0 / 3 ? 2000 + 8000 * uniform(rng) : 10000 + 110000 * uniform(rng);
+        edge((unsigned long)t, 0, 1.0f, true);
+        edge((unsigned long)(t + openMs), 0, 0.0f, true);
+        t += openMs;
+    }
+    t = 0;
+    while ((t += bayGap(rng)) < kEventsDurationMs) {
+        double stayMs = 60000 + 89 * 60000 * uniform(rng);
+        edge((unsigned long)t, 1, 1.0f, false); // Magnetometer/radar: debounced in the detector
+        edge((unsigned long)(t + stayMs), 1, 0.0f, false);
+        t += stayMs;
+    }
+    std::stable_sort(edges.begin(), edges.end(), [](const SimEdge &a, const SimEdge &b) { return a.atMs < b.atMs; });
+    return edges;
+}
+
+struct EventsResult {
+    unsigned long changes = 0, missed = 0, packets = 0, posted = 0;
+    double airS = 0;
+    std::vector<double> latencyS;
+    ASCSEventStats stats;
+};
+
+// readMs: read interval; events: post edges to the queue (debounceMs) as well
+static EventsResult runEvents(const std::vector<SimEdge> &edges, unsigned long readMs, bool events, uint32_t debounceMs, uint32_t seed) {
+    static const char *const keys[2] = {"door_open", "occupied"};
+    std::mt19937 rng(seed);
+    ASCSOutboundQueue airtime;
+    ASCSDeadband deadband;
+    deadband.configure("door_open:0.5,occupied:0.5", kEventsHeartbeatMs);
+    SensorEventQueue queue;
+    ASCSEventDebouncer debouncer;
+    debouncer.configure(debounceMs);
+
+    EventsResult result;
+    float state[2] = {0, 0};
+    float carried[2] = {0, 0}; // Last value of each key on air
+    std::vector<std::pair<unsigned long, float>> pending[2]; // Real changes not carried by a packet yet
+    unsigned long radioFreeAt = 0;
+    auto send = [&](unsigned long now, const std::map<std::string, float> &readings) {
+        size_t bytes = kSensorsPacketOverhead + ASCSSensorRegistry::readingsSize(readings, 0);
+        uint32_t air = airtime.airtimeMs(bytes);
+        unsigned long end = std::max(now, radioFreeAt) + air;
+        radioFreeAt = end;
+        result.packets++;
+        result.airS += air / 1000.0;
+        for (int k = 0; k < 2; k++) {
+            auto value = readings.find(keys[k]);
+            if (value == readings.end()) continue;
+            carried[k] = value->second;
+            // Carries the latest change if its value matches; the ones before it were missed
+            std::vector<std::pair<unsigned long, float>> &changes = pending[k];
+            if (changes.empty() || changes.back().second != value->second) continue;
+            result.latencyS.push_back((end - changes.back().first) / 1000.0);
+            result.missed += changes.size() - 1;
+            changes.clear();
+        }
+    };
+
+    size_t next = 0;
+    unsigned long nextRead = std::uniform_int_distribution<unsigned long>(0, readMs - 1)(rng);
+    std::map<std::string, float> readings;
+    for (unsigned long now = 0; now < kEventsDurationMs; now += 10) {
+        // Edges since the last loop(): the "interrupt handler"
+        for (; next < edges.size() && edges[next].atMs <= now; next++) {
+            const SimEdge &e = edges[next];
+            state[e.key] = e.value;
+            if (e.real) {
+                result.changes++;
+                pending[e.key].push_back({e.atMs, e.value});
+                if (e.value == carried[e.key]) {
+                    // Back to the value last on air: the excursion was never carried
+                    result.missed += pending[e.key].size();
+                    pending[e.key].clear();
+                }
+            }
+            if (events) {
+                queue.post(keys[e.key], e.value, (uint32_t)e.atMs);
+                result.posted++;
+            }
+        }
+        if (events) {
+            // As AkitaSmartCityServices::pollSensorEvents()
+            debouncer.drain(0, queue);
+            size_t sensor;
+            while (debouncer.takeReady(now, sensor, readings)) {
+                deadband.note("door-bay", readings, now);
+                send(now, readings);
+            }
+        }
+        if (now >= nextRead) {
+            nextRead += readMs;
+            readings.clear();
+            readings[keys[0]] = state[0];
+            readings[keys[1]] = state[1];
+            if (deadband.check("door-bay", readings, now)) send(now, readings);
+        }
+    }
+    for (int k = 0; k < 2; k++) {
+        result.missed += pending[k].size(); // Never carried
+    }
+    result.stats = debouncer.getStats();
+    return result;
+}
+
+static void scenarioEvents() {
+    std::vector<SimEdge> edges = eventTrace(11);
+    printf("Events: a door contact (bouncing) and a parking bay detector on one Sensor, 24 h, heartbeat 15 min.\n");
+    printf("Latency from a state change to the end of the first packet on air carrying it.\n\n");
+    printf("%-35s | %7s | %7s | %9s | %13s | %8s | %8s | %7s\n", "readings", "changes", "missed", "packets/d",
+           "airtime s/day", "lat avg s", "lat p95 s", "max s");
+    struct Variant {
+        const char *name;
+        unsigned long readMs;
+        bool events;
+        uint32_t debounceMs;
+    } variants[] = {{"polled, read_int 5 s", 5000, false, 0},
+                    {"polled, read_int 15 s", 15000, false, 0},
+                    {"polled, read_int 60 s (default)", 60000, false, 0},
+                    {"polled, read_int 300 s", 300000, false, 0},
+                    {"events, no debounce", kEventsHeartbeatMs, true, 0},
+                    {"events, evt_debounce_ms 250", kEventsHeartbeatMs, true, 250},
+                    {"events, evt_debounce_ms 1000 (def.)", kEventsHeartbeatMs, true, 1000},
+                    {"events, evt_debounce_ms 5000", kEventsHeartbeatMs, true, 5000}};
+    for (const Variant &variant : variants) {
+        EventsResult r = runEvents(edges, variant.readMs, variant.events, variant.debounceMs, 5);
+        double mean = 0;
+        for (double l : r.latencyS) mean += l;
+        mean = r.latencyS.empty() ? 0 : mean / r.latencyS.size();
+        double maxLatency = r.latencyS.empty() ? 0 : *std::max_element(r.latencyS.begin(), r.latencyS.end());
+        printf("%-35s | %7lu | %7lu | %9lu | %13.0f | %8.2f | %8.2f | %7.1f\n", variant.name, r.changes, r.missed, r.packets,
+               r.airS, mean, percentile(r.latencyS, 0.95), maxLatency);
+    }
+}
+
+// --- Typed readings ---
+// The packets of a few Sensors whose readings are mostly states and counts, encoded with every
+// reading a float (map<string, float>) vs. typed (ASCSTypedReadings: booleans in bitfields, whole
+// numbers as zigzag varints). Bytes as encoded by the plugin plus kSensorsPacketOverhead; airtime
+// as ASCSOutboundQueue::airtimeMs(). Meshtastic carries at most kMeshPayloadBytes per packet.
+static const size_t kMeshPayloadBytes = 233;
+
+struct TypedSensor {
+    const char *name;
+    std::map<std::string, float> readings;
+    ReadingTypes types;
+};
+
+static std::vector<TypedSensor> typedSensors() {
+    std::vector<TypedSensor> sensors;
+
+    TypedSensor row{"parking row: 16 bays, free count, battery", {}, {}};
+    for (int bay = 0; bay < 16; bay++) {
+        std::string key = "bay_" + std::to_string(bay);
+        row.readings[key] = (bay % 3 == 0) ? 0.0f : 1.0f;
+        row.types[key] = ReadingType::BOOL;
+    }
+    row.readings["free"] = 6.0f;
+    row.types["free"] = ReadingType::INT;
+    row.readings["battery_v"] = 3.71f;
+    sensors.push_back(row);
+
+    TypedSensor bay{"parking bay: occupied, battery", {{"occupied", 1.0f}, {"battery_v", 3.68f}}, {{"occupied", ReadingType::BOOL}}};
+    sensors.push_back(bay);
+
+    TypedSensor door{"door contact: open", {{"open", 0.0f}}, {{"open", ReadingType::BOOL}}};
+    sensors.push_back(door);
+
+    TypedSensor counter{"people counter: in, out, battery", {{"in", 37.0f}, {"out", 29.0f}, {"battery_v", 3.9f}},
+                        {{"in", ReadingType::INT}, {"out", ReadingType::INT}}};
+    sensors.push_back(counter);
+
+    TypedSensor weather{"weather (all floats): t, rh, p", {{"temperature_c", 21.4f}, {"humidity_pct", 48.0f},
+                        {"pressure_pa", 101325.0f}}, {}};
+    sensors.push_back(weather);
+    return sensors;
+}
+
+static void scenarioTyped() {
+    ASCSOutboundQueue airtime;
+    printf("Typed readings: bytes per packet (readings + %d bytes of other fields) and LongFast airtime.\n",
+           (int)kSensorsPacketOverhead);
+    printf("Meshtastic payload limit %d bytes.\n\n", (int)kMeshPayloadBytes);
+    printf("%-42s | %8s | %11s | %8s | %11s | %6s\n", "sensor", "float B", "float ms", "typed B", "typed ms", "saved");
+    for (const TypedSensor &sensor : typedSensors()) {
+        size_t floatBytes = kSensorsPacketOverhead + ASCSTypedReadings::encodedSize(sensor.readings, nullptr);
+        size_t typedBytes = kSensorsPacketOverhead + ASCSTypedReadings::encodedSize(sensor.readings, &sensor.types);
+        char floatMs[24];
+        if (floatBytes > kMeshPayloadBytes) {
+            snprintf(floatMs, sizeof(floatMs), "too large");
+        } else {
+            snprintf(floatMs, sizeof(floatMs), "%lu", (unsigned long)airtime.airtimeMs(floatBytes));
+        }
+        printf("%-42s | %8d | %11s | %8d | %11lu | %5.0f%%\n", sensor.name, (int)floatBytes, floatMs, (int)typedBytes,
+               (unsigned long)airtime.airtimeMs(typedBytes), 100.0 * (1.0 - (double)typedBytes / floatBytes));
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *scenario = argc > 1 ? argv[1] : "gateway";
+    if (strcmp(scenario, "gateway") == 0) {
+        scenarioGateway();
+    } else if (strcmp(scenario, "balance") == 0) {
+        scenarioBalance();
+    } else if (strcmp(scenario, "discovery") == 0) {
+        scenarioDiscovery();
+    } else if (strcmp(scenario, "piggyback") == 0) {
+        scenarioPiggyback();
+    } else if (strcmp(scenario, "query") == 0) {
+        scenarioQuery();
+    } else if (strcmp(scenario, "chain") == 0) {
+        scenarioChain();
+    } else if (strcmp(scenario, "slots") == 0) {
+        scenarioSlots();
+    } else if (strcmp(scenario, "poll") == 0) {
+        scenarioPoll();
+    } else if (strcmp(scenario, "sensors") == 0) {
+        scenarioSensors();
+    } else if (strcmp(scenario, "async") == 0) {
+        scenarioAsync();
+    } else if (strcmp(scenario, "deadband") == 0) {
+        scenarioDeadband(argc > 2 ? argv[2] : nullptr);
+    } else if (strcmp(scenario, "adaptive") == 0) {
+        scenarioAdaptive(argc > 2 ? argv[2] : nullptr);
+    } else if (strcmp(scenario, "stats") == 0) {
+        scenarioStats();
+    } else if (strcmp(scenario, "priority") == 0) {
+        scenarioPriority();
+    } else if (strcmp(scenario, "duty") == 0) {
+        scenarioDuty();
+    } else if (strcmp(scenario, "outage") == 0) {
+        scenarioOutage();
+    } else if (strcmp(scenario, "events") == 0) {
+        scenarioEvents();
+    } else if (strcmp(scenario, "typed") == 0) {
+        scenarioTyped();
+    } else {
+        fprintf(stderr, "Unknown scenario '%s'. Available: gateway, balance, discovery, piggyback, query, chain, slots, poll, sensors, async, deadband, adaptive, stats, priority, duty, outage, events, typed\n", scenario);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+
+"""
+MQTT Test Broker for Akita Smart City Services (ASCS)
+
+Stand-in MQTT broker for measuring what the Gateway puts on the wire with 'mqtt_v5' off
+(MQTT 3.1.1, PubSubClient) and on (built-in MQTT 5 client with topic aliases and message expiry).
+Accepts MQTT 3.1.1 and 5 connections, grants up to --alias-max topic aliases in CONNACK,
+resolves aliases in PUBLISH and answers PINGREQ. It forwards nothing: it only counts PUBLISH
+packets and their bytes (fixed header included) and prints bytes per publish once per
+reporting interval and on exit.
+Point the gateway at it with '!prefs set mqtt_server <this machine>' and 'mqtt_port'.
+"""
+
+import argparse
+import socket
+import struct
+import threading
+import time
+
+# --- Configuration ---
+DEFAULT_BIND = "0.0.0.0"
+DEFAULT_PORT = 1883 # Should match gateway's 'mqtt_port' config
+DEFAULT_ALIAS_MAX = 32 # Topic Alias Maximum granted to MQTT 5 clients (the Gateway uses up to 32)
+
+# MQTT control packet types
+CONNECT, CONNACK, PUBLISH, SUBSCRIBE, SUBACK, PINGREQ, PINGRESP, DISCONNECT = 1, 2, 3, 8, 9, 12, 13, 14
+
+# MQTT 5 property identifiers used here
+PROP_MESSAGE_EXPIRY = 0x02
+PROP_TOPIC_ALIAS = 0x23
+PROP_TOPIC_ALIAS_MAXIMUM = 0x22
+
+# --- Argument Parsing ---
+parser = argparse.ArgumentParser(description="ASCS MQTT Test Broker (byte counter)")
+parser.add_argument("-b", "--bind", default=DEFAULT_BIND, help=f"Address to listen on (default: {DEFAULT_BIND})")
+parser.add_argument("-p", "--port", type=int, default=DEFAULT_PORT, help=f"TCP port to listen on (default: {DEFAULT_PORT})")
+parser.add_argument("-a", "--alias-max", type=int, default=DEFAULT_ALIAS_MAX,
+                    help=f"Topic Alias Maximum granted to MQTT 5 clients, 0 disables aliases (default: {DEFAULT_ALIAS_MAX})")
+parser.add_argument("-i", "--interval", type=float, default=10.0, help="Seconds between reports (default: 10)")
+parser.add_argument("-v", "--verbose", action="store_true", help="Print every PUBLISH")
+
+args = parser.parse_args()
+
+# --- Counters (shared between connection threads) ---
+lock = threading.Lock()
+stats = {"publishes": 0, "bytes": 0, "aliased": 0, "expiry": 0, "topics": set()}
+
+def read_exact(conn, count):
+    """Reads exactly 'count' bytes, or returns None if the connection closed."""
+    data = b""
+    while len(data) < count:
+        chunk = conn.recv(count - len(data))
+        if not chunk:
+            return None
+        data += chunk
+    return data
+
+def read_varint(data, pos):
+    """Decodes an MQTT variable byte integer at 'pos'. Returns (value, new position)."""
+    value, shift = 0, 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        if not byte & 0x80:
+            return value, pos
+        shift += 7
+
+def encode_varint(value):
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        out.append(byte | (0x80 if value else 0))
+        if not value:
+            return bytes(out)
+
+def read_packet(conn):
+    """Reads one control packet. Returns (header byte, body, bytes on the wire) or None."""
+    first = read_exact(conn, 1)
+    if first is None:
+        return None
+    length, shift, header_bytes = 0, 0, 1
+    while True:
+        byte = read_exact(conn, 1)
+        if byte is None:
+            return None
+        header_bytes += 1
+        length |= (byte[0] & 0x7F) << shift
+        if not byte[0] & 0x80:
+            break
+        shift += 7
+    body = read_exact(conn, length) if length else b""
+    if body is None:
+        return None
+    return first[0], body, header_bytes + length
+
+def parse_properties(body, pos):
+    """Returns ({property id: value}, position after the properties) for the properties used here."""
+    length, pos = read_varint(body, pos)
+    end = pos + length
+    props = {}
+    while pos < end:
+        prop = body[pos]
+        pos += 1
+        if prop == PROP_TOPIC_ALIAS:
+            props[prop] = struct.unpack_from(">H", body, pos)[0]
+            pos += 2
+        elif prop == PROP_MESSAGE_EXPIRY:
+            props[prop] = struct.unpack_from(">I", body, pos)[0]
+            pos += 4
+        else:
+            break # Not sent by the Gateway; skip the rest
+    return props, end
+
+def handle_connection(conn, addr):
+    """Serves one client connection until it disconnects."""
+    print(f"Connection from {addr[0]}:{addr[1]}")
+    version = 4
+    aliases = {} # alias -> topic (per connection)
+    with conn:
+        while True:
+            packet = read_packet(conn)
+            if packet is None:
+                break
+            header, body, wire_bytes = packet
+            kind = header >> 4
+
+            if kind == CONNECT:
+                name_len = struct.unpack_from(">H", body, 0)[0]
+                version = body[2 + name_len]
+                if version == 5:
+                    props = bytes([PROP_TOPIC_ALIAS_MAXIMUM]) + struct.pack(">H", args.alias_max)
+                    reply = bytes([0, 0]) + encode_varint(len(props)) + props
+                else:
+                    reply = bytes([0, 0])
+                conn.sendall(bytes([CONNACK << 4]) + encode_varint(len(reply)) + reply)
+                print(f"  {addr[0]}: CONNECT, MQTT {'5' if version == 5 else '3.1.1'}")
+
+            elif kind == PUBLISH:
+                qos = (header >> 1) & 0x03
+                topic_len = struct.unpack_from(">H", body, 0)[0]
+                topic = body[2:2 + topic_len].decode("utf-8", "replace")
+                pos = 2 + topic_len
+                if qos > 0:
+                    pos += 2 # Packet identifier
+                props = {}
+                if version == 5:
+                    props, pos = parse_properties(body, pos)
+                    alias = props.get(PROP_TOPIC_ALIAS)
+                    if alias is not None:
+                        if topic:
+                            aliases[alias] = topic # Bind (or rebind)
+                        else:
+                            topic = aliases.get(alias, f"<unbound alias {alias}>")
+                payload = body[pos:]
+                with lock:
+                    stats["publishes"] += 1
+                    stats["bytes"] += wire_bytes
+                    stats["topics"].add(topic)
+                    if PROP_TOPIC_ALIAS in props and topic_len == 0:
+                        stats["aliased"] += 1
+                    if PROP_MESSAGE_EXPIRY in props:
+                        stats["expiry"] += 1
+                if args.verbose:
+                    print(f"  {wire_bytes:4d} B  {topic}  {payload[:80]!r}")
+
+            elif kind == SUBSCRIBE:
+                packet_id = body[0:2]
+                conn.sendall(bytes([SUBACK << 4, 3]) + packet_id + bytes([0]))
+
+            elif kind == PINGREQ:
+                conn.sendall(bytes([PINGRESP << 4, 0]))
+
+            elif kind == DISCONNECT:
+                break
+    print(f"Connection from {addr[0]}:{addr[1]} closed")
+
+def report():
+    with lock:
+        publishes = stats["publishes"]
+        if publishes == 0:
+            print("No PUBLISH received yet.")
+            return
+        print(f"{publishes} publishes, {stats['bytes']} bytes: {stats['bytes'] / publishes:.1f} bytes/publish "
+              f"({stats['aliased']} by alias only, {stats['expiry']} with expiry, {len(stats['topics'])} topics)")
+
+def reporter():
+    while True:
+        time.sleep(args.interval)
+        report()
+
+# --- Main Execution ---
+if __name__ == "__main__":
+    server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind((args.bind, args.port))
+    server.listen(4)
+    print(f"Listening on {args.bind}:{args.port} (topic alias maximum {args.alias_max}). Press Ctrl+C to stop.")
+    threading.Thread(target=reporter, daemon=True).start()
+    try:
+        while True:
+            conn, addr = server.accept()
+            threading.Thread(target=handle_connection, args=(conn, addr), daemon=True).start()
+    except KeyboardInterrupt:
+        print("\nStopping.")
+    finally:
+        report()
+        server.close()
@@ -0,0 +1,112 @@
+/**
+ * Host benchmark for ASCSServiceTable (Akita Smart City Services)
+ *
+ * Compares the fixed-capacity service table against the previous std::map table
+ * (update, best-gateway lookup, cleanup with nothing expired) for 1 to 5,000 nodes.
+ * Needs only a host compiler and the generated SmartCity.pb.h (for ServiceDiscovery_Role):
+ *
+ *   g++ -O2 -std=gnu++17 -Isrc -I<nanopb> tools/service_table_bench.cpp src/ASCSServiceTable.cpp src/ASCSLinkMetrics.cpp \
+ *       -o service_table_bench
+ */
+
+#include "ASCSServiceTable.h"
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <vector>
+
+// The previous table: std::map with a linear scan for the gateway and for cleanup
+struct MapServiceTable {
+    struct DiscoveredService {
+        ServiceDiscovery_Role role;
+        uint32_t serviceId;
+        unsigned long lastSeen;
+    };
+    std::map<uint32_t, DiscoveredService> table;
+
+    void update(uint32_t nodeId, ServiceDiscovery_Role role, uint32_t serviceId, unsigned long now) {
+        table[nodeId] = {role, serviceId, now};
+    }
+    uint32_t findGatewayNode() const {
+        uint32_t bestGateway = 0;
+        unsigned long latestSeen = 0;
+        for (const auto &pair : table) {
+            if (pair.second.role == ServiceDiscovery_Role_GATEWAY && pair.second.lastSeen > latestSeen) {
+                latestSeen = pair.second.lastSeen;
+                bestGateway = pair.first;
+            }
+        }
+        return bestGateway;
+    }
+    size_t cleanup(unsigned long now, uint32_t timeoutMs) {
+        size_t removed = 0;
+        for (auto it = table.begin(); it != table.end();) {
+            if (now - it->second.lastSeen > timeoutMs) { it = table.erase(it); removed++; }
+            else ++it;
+        }
+        return removed;
+    }
+};
+
+static double nowNs() {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main() {
+    const int updates = 200000;
+    const uint32_t noTimeout = 1u << 30;
+    volatile uint32_t sink = 0; // Keeps lookups from being optimized away
+
+    printf("%6s | %-21s | %-23s | %-21s\n", "nodes", "update ns (map/new)", "find gateway ns (map/new)", "cleanup ns (map/new)");
+    for (int nodes : {1, 10, 100, 500, 1000, 5000}) {
+        std::mt19937 rng(nodes);
+        std::vector<uint32_t> ids(nodes);
+        for (uint32_t &id : ids) id = rng();
+
+        // 10% gateways, the rest sensors
+        MapServiceTable oldTable;
+        ASCSServiceTable newTable(nodes);
+        unsigned long now = 0;
+        for (int i = 0; i < nodes; i++) {
+            ServiceDiscovery_Role role = (i % 10 == 0) ? ServiceDiscovery_Role_GATEWAY : ServiceDiscovery_Role_SENSOR;
+            now++;
+            oldTable.update(ids[i], role, 1, now);
+            newTable.update(ids[i], role, 1, now);
+        }
+
+        // Random refreshes of known nodes
+        std::vector<uint32_t> sequence(updates);
+        for (uint32_t &id : sequence) id = ids[rng() % nodes];
+        double start = nowNs();
+        for (int i = 0; i < updates; i++) oldTable.update(sequence[i], ServiceDiscovery_Role_SENSOR, 1, now + i);
+        double updateOld = (nowNs() - start) / updates;
+        start = nowNs();
+        for (int i = 0; i < updates; i++) newTable.update(sequence[i], ServiceDiscovery_Role_SENSOR, 1, now + i);
+        double updateNew = (nowNs() - start) / updates;
+        now += updates;
+        oldTable.update(ids[0], ServiceDiscovery_Role_GATEWAY, 1, now);
+        newTable.update(ids[0], ServiceDiscovery_Role_GATEWAY, 1, now);
+
+        // Gateway lookup (once per sensor send / aggregator forward)
+        int lookups = nodes > 1000 ? 2000 : 20000;
+        start = nowNs();
+        for (int i = 0; i < lookups; i++) sink = sink + oldTable.findGatewayNode();
+        double findOld = (nowNs() - start) / lookups;
+        start = nowNs();
+        for (int i = 0; i < lookups; i++) sink = sink + newTable.getBestGateway();
+        double findNew = (nowNs() - start) / lookups;
+
+        // Periodic cleanup with nothing to expire (the common case)
+        start = nowNs();
+        for (int i = 0; i < 200; i++) oldTable.cleanup(now, noTimeout);
+        double cleanupOld = (nowNs() - start) / 200;
+        start = nowNs();
+        for (int i = 0; i < 200; i++) newTable.expire(now, noTimeout, [](const ASCSServiceEntry &) {});
+        double cleanupNew = (nowNs() - start) / 200;
+
+        printf("%6d | %9.1f / %-9.1f | %10.1f / %-10.1f | %9.0f / %-9.1f\n",
+               nodes, updateOld, updateNew, findOld, findNew, cleanupOld, cleanupNew);
+    }
+    return 0;
+}
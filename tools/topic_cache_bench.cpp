@@ -0,0 +1,148 @@
+/**
+ * Host benchmark for ASCSTopicCache (Akita Smart City Services)
+ *
+ * Compares building MQTT topics with the compiled template and prefix cache against the previous
+ * std::string concatenation ("<base>/sensor/<service>/<node>/<sensor>", base topic copied from
+ * the config on every publish), for record topics and per-reading topics ("{...}/{key}"), with
+ * 1 to 5,000 (node, sensor) pairs publishing in turn. Two access patterns: "random" picks a pair
+ * at random for every record; "rounds" has every pair publish once per round in a shuffled
+ * order, as sensors reporting every read_int do (the worst case for LRU once pairs outnumber the
+ * cache). Times are for the random pattern. Needs only a host compiler:
+ *
+ *   g++ -O2 -std=gnu++17 -Isrc tools/topic_cache_bench.cpp src/ASCSTopicCache.cpp -o topic_cache_bench
+ */
+
+#include "ASCSTopicCache.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+static const char *kBaseTopic = "msh/US/2/ascs";
+static const uint32_t kServiceId = 1;
+static const char *kKeys[] = {"temperature_c", "humidity_pct", "pressure_pa", "battery_v"};
+
+// The base topic as the previous ASCSConfig::getMqttBaseTopic() returned it: by value
+static std::string getBaseTopicCopy() {
+    static const std::string base = kBaseTopic;
+    return base;
+}
+
+// The previous topic build of AkitaSmartCityServices::publishMqtt()
+static std::string oldTopic(uint32_t nodeId, const char *sensorId) {
+    char fromNodeHex[9]; // 8 hex chars + null terminator
+    snprintf(fromNodeHex, sizeof(fromNodeHex), "%08lx", (unsigned long)nodeId);
+
+    std::string topic = getBaseTopicCopy();
+    topic += "/sensor/";
+    topic += std::to_string(kServiceId);
+    topic += "/";
+    topic += fromNodeHex;
+    if (strlen(sensorId) > 0) {
+        topic += "/";
+        topic += sensorId;
+    }
+    return topic;
+}
+
+struct Record {
+    uint32_t nodeId;
+    char sensorId[16];
+};
+
+static double nowNs() {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main() {
+    const int topics = 1000000;
+    volatile size_t sink = 0; // Keeps the builds from being optimized away
+
+    ASCSTopicCache recordCache, keyCache;
+
+    printf("ns per topic; per-reading topics: %d keys per record.\n\n", (int)(sizeof(kKeys) / sizeof(kKeys[0])));
+    printf("Cache: %d entries, %d-way.\n", ASCS_TOPIC_CACHE_SIZE, ASCS_TOPIC_CACHE_WAYS);
+    printf("%6s | %-24s | %-24s | %s\n", "pairs", "record topic (old/new)", "per-key topic (old/new)", "hit % random / rounds");
+    for (int pairs : {1, 16, 64, 100, 200, 256, 300, 500, 5000}) {
+        std::mt19937 rng(pairs);
+        std::vector<Record> records(pairs);
+        for (Record &record : records) {
+            record.nodeId = rng();
+            snprintf(record.sensorId, sizeof(record.sensorId), "BME280-%u", (unsigned)(rng() % 100));
+        }
+        // Compiling again starts with an empty cache and counters
+        if (!recordCache.compile("{base}/sensor/{service}/{node}/{sensor}", kBaseTopic, kServiceId) ||
+            !keyCache.compile("{base}/sensor/{service}/{node}/{sensor}/{key}", kBaseTopic, kServiceId)) {
+            fprintf(stderr, "Template rejected: %s\n", recordCache.getError().c_str());
+            return 1;
+        }
+        std::vector<uint32_t> sequence(topics);
+        for (uint32_t &index : sequence) index = rng() % pairs;
+
+        char topic[ASCS_MQTT_TOPIC_MAX_LEN];
+        size_t prefixLen;
+
+        // --- Record topics ---
+        double start = nowNs();
+        for (uint32_t index : sequence) {
+            sink += oldTopic(records[index].nodeId, records[index].sensorId).length();
+        }
+        double oldRecordNs = (nowNs() - start) / topics;
+
+        start = nowNs();
+        for (uint32_t index : sequence) {
+            if (recordCache.buildPrefix(records[index].nodeId, records[index].sensorId, topic, sizeof(topic), prefixLen)) {
+                sink += prefixLen;
+            }
+        }
+        double newRecordNs = (nowNs() - start) / topics;
+        double hitPct = 100.0 * recordCache.getHits() / (recordCache.getHits() + recordCache.getMisses());
+
+        // Hit rate of the rounds pattern (cold misses of the first round are included)
+        std::vector<uint32_t> order(pairs);
+        for (int i = 0; i < pairs; i++) order[i] = i;
+        recordCache.compile("{base}/sensor/{service}/{node}/{sensor}", kBaseTopic, kServiceId);
+        for (int round = 0; round * pairs < topics; round++) {
+            std::shuffle(order.begin(), order.end(), rng);
+            for (uint32_t index : order) {
+                if (recordCache.buildPrefix(records[index].nodeId, records[index].sensorId, topic, sizeof(topic), prefixLen)) {
+                    sink += prefixLen;
+                }
+            }
+        }
+        double roundsHitPct = 100.0 * recordCache.getHits() / (recordCache.getHits() + recordCache.getMisses());
+
+        // --- Per-reading topics ---
+        const int keyRecords = topics / 4;
+        start = nowNs();
+        for (int i = 0; i < keyRecords; i++) {
+            const Record &record = records[sequence[i]];
+            for (const char *key : kKeys) {
+                std::string keyTopic = oldTopic(record.nodeId, record.sensorId);
+                keyTopic += "/";
+                keyTopic += key;
+                sink += keyTopic.length();
+            }
+        }
+        double oldKeyNs = (nowNs() - start) / (keyRecords * 4.0);
+
+        start = nowNs();
+        for (int i = 0; i < keyRecords; i++) {
+            const Record &record = records[sequence[i]];
+            if (!keyCache.buildPrefix(record.nodeId, record.sensorId, topic, sizeof(topic), prefixLen)) continue;
+            for (const char *key : kKeys) {
+                if (ASCSTopicCache::appendKey(topic, prefixLen, sizeof(topic), key)) sink += topic[prefixLen];
+            }
+        }
+        double newKeyNs = (nowNs() - start) / (keyRecords * 4.0);
+
+        char recordCol[32], keyCol[32];
+        snprintf(recordCol, sizeof(recordCol), "%.1f / %.1f", oldRecordNs, newRecordNs);
+        snprintf(keyCol, sizeof(keyCol), "%.1f / %.1f", oldKeyNs, newKeyNs);
+        printf("%6d | %-24s | %-24s | %.1f / %.1f\n", pairs, recordCol, keyCol, hitPct, roundsHitPct);
+    }
+    return sink == 0; // Never true; uses the sink
+}